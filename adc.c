@@ -135,6 +135,18 @@ adc_power_on_reset(struct adc_struct* p_adc) {
   adc_recalculate_read(p_adc);
 }
 
+void
+adc_save_checkpoint(struct adc_struct* p_adc, struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, &p_adc->state, sizeof(p_adc->state));
+  timing_save_timer(p_adc->p_timing, p_adc->timer_id, p_buf);
+}
+
+void
+adc_load_checkpoint(struct adc_struct* p_adc, struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf, &p_adc->state, sizeof(p_adc->state));
+  timing_load_timer(p_adc->p_timing, p_adc->timer_id, p_buf);
+}
+
 static void
 adc_start(struct adc_struct* p_adc, uint32_t ms) {
   assert(!p_adc->state.is_busy);
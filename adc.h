@@ -4,6 +4,7 @@
 #include <stdint.h>
 
 struct timing_struct;
+struct util_buffer;
 struct via_struct;
 
 struct adc_struct;
@@ -14,6 +15,8 @@ struct adc_struct* adc_create(int is_externally_clocked,
 void adc_destroy(struct adc_struct* p_adc);
 
 void adc_power_on_reset(struct adc_struct* p_adc);
+void adc_save_checkpoint(struct adc_struct* p_adc, struct util_buffer* p_buf);
+void adc_load_checkpoint(struct adc_struct* p_adc, struct util_buffer* p_buf);
 void adc_apply_wall_time_delta(struct adc_struct* p_adc, uint64_t delta);
 
 uint8_t adc_read(struct adc_struct* p_adc, uint8_t addr);
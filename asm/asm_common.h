@@ -138,6 +138,11 @@ void asm_patch_int(struct util_buffer* p_buf,
                    void* p_start,
                    void* p_patch,
                    int value);
+void asm_patch_u64(struct util_buffer* p_buf,
+                   size_t offset,
+                   void* p_start,
+                   void* p_patch,
+                   uint64_t value);
 void asm_patch_jump(struct util_buffer* p_buf,
                     size_t offset,
                     void* p_start,
@@ -38,6 +38,7 @@ enum {
   k_opcode_load_carry,
   k_opcode_load_carry_inverted,
   k_opcode_load_overflow,
+  k_opcode_load_rel_offset,
   k_opcode_peek_to_scratch,
   k_opcode_save_carry,
   k_opcode_save_carry_inverted,
@@ -69,6 +69,31 @@ asm_patch_int(struct util_buffer* p_buf,
   util_buffer_set_pos(p_buf, original_pos);
 }
 
+void
+asm_patch_u64(struct util_buffer* p_buf,
+              size_t offset,
+              void* p_start,
+              void* p_patch,
+              uint64_t value) {
+  size_t original_pos = util_buffer_get_pos(p_buf);
+  int64_t pos = (offset + ((uint8_t*) p_patch - (uint8_t*) p_start));
+
+  assert(pos >= (int64_t) sizeof(uint64_t));
+
+  util_buffer_set_pos(p_buf, (pos - 8));
+  util_buffer_add_4b(p_buf,
+                     (value & 0xff),
+                     ((value >> 8) & 0xff),
+                     ((value >> 16) & 0xff),
+                     ((value >> 24) & 0xff));
+  util_buffer_add_4b(p_buf,
+                     ((value >> 32) & 0xff),
+                     ((value >> 40) & 0xff),
+                     ((value >> 48) & 0xff),
+                     (value >> 56));
+  util_buffer_set_pos(p_buf, original_pos);
+}
+
 void
 asm_patch_jump(struct util_buffer* p_buf,
                size_t offset,
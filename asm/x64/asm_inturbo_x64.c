@@ -1,9 +1,12 @@
 #include "../asm_inturbo.h"
 
 #include "../asm_common.h"
+#include "../asm_inturbo_defs.h"
 #include "../../defs_6502.h"
 #include "../../util.h"
 
+#include <assert.h>
+
 static void
 asm_emit_instruction_Bxx_interp_accurate(
     struct util_buffer* p_buf,
@@ -48,7 +51,37 @@ asm_inturbo_destroy(void) {
 
 void
 asm_emit_inturbo_epilog(struct util_buffer* p_buf) {
-  (void) p_buf;
+  asm_emit_inturbo_call_interp(p_buf);
+}
+
+static void
+asm_inturbo_patch_jump_epilog(struct util_buffer* p_buf,
+                              size_t offset,
+                              void* p_start,
+                              void* p_patch) {
+  /* Bounces to the interpreter are short jumps to the epilog at the end of
+   * the opcode's slot, which then jumps to the interpreter. This keeps more
+   * opcodes small enough to fit in the slot.
+   */
+  uint8_t* p_base = util_buffer_get_base_address(p_buf);
+  uint8_t* p_epilog = (p_base +
+                       K_INTURBO_OPCODE_SIZE -
+                       ((uint8_t*) asm_inturbo_jump_call_interp_END -
+                        (uint8_t*) asm_inturbo_jump_call_interp));
+  int64_t pos = (offset + ((uint8_t*) p_patch - (uint8_t*) p_start));
+  int64_t delta = (p_epilog - (p_base + pos));
+
+  if (delta < INT8_MIN) {
+    /* The jump is past the end of the slot, so the opcode is too large for
+     * it and gets discarded in favor of the interpreter. Leave the jump
+     * unpatched rather than point it anywhere.
+     */
+    assert(pos > K_INTURBO_OPCODE_SIZE);
+    return;
+  }
+  assert(delta <= INT8_MAX);
+
+  asm_patch_byte(p_buf, offset, p_start, p_patch, (uint8_t) delta);
 }
 
 void
@@ -68,11 +101,10 @@ asm_emit_inturbo_check_special_address(struct util_buffer* p_buf,
   /* NOTE: could consider implementing very simple load / store abs mode to
    * special registers inline. Calling out to the interpreter is expensive.
    */
-  asm_patch_jump(p_buf,
-                 offset,
-                 asm_inturbo_check_special_address,
-                 asm_inturbo_check_special_address_jb_patch,
-                 asm_inturbo_call_interp);
+  asm_inturbo_patch_jump_epilog(p_buf,
+                                offset,
+                                asm_inturbo_check_special_address,
+                                asm_inturbo_check_special_address_jb_patch);
 }
 
 void
@@ -100,11 +132,10 @@ asm_emit_inturbo_check_and_commit_countdown(struct util_buffer* p_buf) {
   asm_copy(p_buf,
            asm_inturbo_check_and_commit_countdown,
            asm_inturbo_check_and_commit_countdown_END);
-  asm_patch_jump(p_buf,
-                 offset,
-                 asm_inturbo_check_and_commit_countdown,
-                 asm_inturbo_check_and_commit_countdown_jb_patch,
-                 asm_inturbo_call_interp);
+  asm_inturbo_patch_jump_epilog(p_buf,
+                                offset,
+                                asm_inturbo_check_and_commit_countdown,
+                                asm_inturbo_check_and_commit_countdown_jb_patch);
 }
 
 void
@@ -119,11 +150,10 @@ asm_emit_inturbo_check_decimal(struct util_buffer* p_buf) {
   size_t offset = util_buffer_get_pos(p_buf);
 
   asm_copy(p_buf, asm_inturbo_check_decimal, asm_inturbo_check_decimal_END);
-  asm_patch_jump(p_buf,
-                 offset,
-                 asm_inturbo_check_decimal,
-                 asm_inturbo_check_decimal_jb_patch,
-                 asm_inturbo_call_interp);
+  asm_inturbo_patch_jump_epilog(p_buf,
+                                offset,
+                                asm_inturbo_check_decimal,
+                                asm_inturbo_check_decimal_jb_patch);
 }
 
 void
@@ -133,11 +163,10 @@ asm_emit_inturbo_check_interrupt(struct util_buffer* p_buf) {
   asm_copy(p_buf,
            asm_inturbo_check_interrupt,
            asm_inturbo_check_interrupt_END);
-  asm_patch_jump(p_buf,
-                 offset,
-                 asm_inturbo_check_interrupt,
-                 asm_inturbo_check_interrupt_jae_patch,
-                 asm_inturbo_call_interp);
+  asm_inturbo_patch_jump_epilog(p_buf,
+                                offset,
+                                asm_inturbo_check_interrupt,
+                                asm_inturbo_check_interrupt_jae_patch);
 }
 
 void
@@ -293,11 +322,10 @@ asm_emit_inturbo_mode_idx(struct util_buffer* p_buf) {
   size_t offset = util_buffer_get_pos(p_buf);
 
   asm_copy(p_buf, asm_inturbo_mode_idx, asm_inturbo_mode_idx_END);
-  asm_patch_jump(p_buf,
-                 offset,
-                 asm_inturbo_mode_idx,
-                 asm_inturbo_mode_idx_jump_patch,
-                 asm_inturbo_call_interp);
+  asm_inturbo_patch_jump_epilog(p_buf,
+                                offset,
+                                asm_inturbo_mode_idx,
+                                asm_inturbo_mode_idx_jump_patch);
 }
 
 void
@@ -305,11 +333,10 @@ asm_emit_inturbo_mode_idy(struct util_buffer* p_buf) {
   size_t offset = util_buffer_get_pos(p_buf);
 
   asm_copy(p_buf, asm_inturbo_mode_idy, asm_inturbo_mode_idy_END);
-  asm_patch_jump(p_buf,
-                 offset,
-                 asm_inturbo_mode_idy,
-                 asm_inturbo_mode_idy_jump_patch,
-                 asm_inturbo_call_interp);
+  asm_inturbo_patch_jump_epilog(p_buf,
+                                offset,
+                                asm_inturbo_mode_idy,
+                                asm_inturbo_mode_idy_jump_patch);
 }
 
 void
@@ -832,6 +832,33 @@ asm_emit_jit_PUSH_16(struct util_buffer* p_buf, uint16_t value) {
                 value);
 }
 
+static void
+asm_emit_jit_collapse_loop(struct util_buffer* p_buf, uint32_t loop_cycles) {
+  void asm_jit_collapse_loop(void);
+  void asm_jit_collapse_loop_cycles_patch(void);
+  void asm_jit_collapse_loop_reciprocal_patch(void);
+  void asm_jit_collapse_loop_END(void);
+  size_t offset = util_buffer_get_pos(p_buf);
+  /* Reciprocal for a 32-bit modulo via two multiplies:
+   * n % d == ((n * (UINT64_MAX / d + 1)) * d) >> 64, for 32-bit n and d.
+   */
+  uint64_t reciprocal = ((UINT64_MAX / loop_cycles) + 1);
+
+  assert(loop_cycles > 0);
+
+  asm_copy(p_buf, asm_jit_collapse_loop, asm_jit_collapse_loop_END);
+  asm_patch_int(p_buf,
+                offset,
+                asm_jit_collapse_loop,
+                asm_jit_collapse_loop_cycles_patch,
+                loop_cycles);
+  asm_patch_u64(p_buf,
+                offset,
+                asm_jit_collapse_loop,
+                asm_jit_collapse_loop_reciprocal_patch,
+                reciprocal);
+}
+
 static void
 asm_emit_jit_SLO_ABS(struct util_buffer* p_buf, uint16_t addr) {
   void asm_jit_SLO_ABS(void);
@@ -1764,7 +1791,9 @@ asm_emit_jit(struct asm_jit_struct* p_asm,
     ASM(check_page_crossing_y);
     ASM(check_page_crossing_adjust);
     break;
-  case k_opcode_collapse_loop: ASM_U32(load_PC); ASM(collapse_loop); break;
+  case k_opcode_collapse_loop:
+    asm_emit_jit_collapse_loop(p_dest_buf, value1);
+    break;
   case k_opcode_deref_context: ASM_U32(deref_context); break;
   case k_opcode_deref_scratch: ASM_U32(deref_scratch); break;
   case k_opcode_load_deref_scratch: ASM_U32(load_deref_scratch); break;
@@ -1822,6 +1851,10 @@ asm_emit_jit(struct asm_jit_struct* p_asm,
     break;
   case k_opcode_load_carry_inverted: ASM(load_carry_inv_for_calc); break;
   case k_opcode_load_overflow: ASM(load_overflow); break;
+  case k_opcode_load_rel_offset:
+    value2 = K_BBC_MEM_READ_IND_ADDR;
+    ASM_ADDR_U32(load_rel_offset);
+    break;
   case k_opcode_peek_to_scratch: ASM(peek_to_scratch); break;
   case k_opcode_PULL_16: ASM(PULL_16); break;
   case k_opcode_PUSH_16:
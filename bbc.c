@@ -49,11 +49,19 @@ static const size_t k_bbc_andy_size = 0x1000;
 
 static const size_t k_bbc_tick_rate = 2000000; /* 2Mhz. */
 static const size_t k_bbc_default_wakeup_rate = 500; /* 2ms / 500Hz. */
+/* Checkpoints for replays, initially every second. When the table fills up,
+ * every other one is dropped and the interval doubles.
+ */
+static const uint64_t k_bbc_default_checkpoint_cycles = 2000000;
 
 /* This data is from b-em, thanks b-em! */
 static const int k_FE_1mhz_array[8] = { 1, 0, 1, 1, 0, 0, 1, 0 };
 
 /* EMU: where given, any ranges are confirmed on a real model B. */
+enum {
+  k_bbc_max_checkpoints = 32,
+};
+
 enum {
   k_addr_fred = 0xFC00,
   k_addr_jim = 0xFD00,
@@ -141,6 +149,7 @@ struct bbc_struct {
   uint32_t exit_value;
   intptr_t mem_handle;
   uint64_t rewind_to_cycles;
+  uint64_t rewind_from_cycles;
   uint32_t log_count_shadow_speed;
   uint32_t log_count_misc_unimplemented;
   struct util_file* p_printer_file;
@@ -214,6 +223,7 @@ struct bbc_struct {
   uint32_t timer_id_stop_cycles;
   int32_t timer_id_autoboot;
   int32_t timer_id_test_nmi;
+  uint32_t timer_id_checkpoint;
   uint32_t wakeup_rate;
   uint64_t cycles_per_run_fast;
   uint64_t cycles_per_run_normal;
@@ -227,6 +237,12 @@ struct bbc_struct {
   uint64_t last_c2;
   uint64_t cycle_count_baseline;
 
+  /* Replay checkpoints, oldest first. */
+  uint64_t checkpoint_cycles;
+  uint32_t num_checkpoints;
+  uint64_t checkpoint_ticks[k_bbc_max_checkpoints];
+  struct util_buffer* p_checkpoints[k_bbc_max_checkpoints];
+
   uint64_t num_hw_reg_hits;
   int log_speed;
   int log_timestamp;
@@ -1751,6 +1767,7 @@ bbc_framebuffer_ready_callback(void* p,
   message.data[2] = framing_changed;
   message.data[3] = timing_get_total_timer_ticks(p_bbc->p_timing);
   message.data[4] = do_wait_for_paint;
+  message.data[5] = os_time_get_us();
   bbc_cpu_send_message(p_bbc, &message);
   if (do_wait_for_paint) {
     bbc_cpu_receive_message(p_bbc, &message);
@@ -1797,25 +1814,283 @@ bbc_virtual_keyboard_updated_callback(void* p) {
   }
 }
 
+static void
+bbc_save_optional_timer(struct bbc_struct* p_bbc,
+                        int32_t timer_id,
+                        struct util_buffer* p_buf) {
+  int has_timer = (timer_id != -1);
+
+  util_buffer_add_chunk(p_buf, &has_timer, sizeof(has_timer));
+  if (has_timer) {
+    timing_save_timer(p_bbc->p_timing, timer_id, p_buf);
+  }
+}
+
+static void
+bbc_load_optional_timer(struct bbc_struct* p_bbc,
+                        int32_t timer_id,
+                        struct util_buffer* p_buf) {
+  int has_timer;
+  struct timing_struct* p_timing = p_bbc->p_timing;
+
+  util_buffer_get_chunk(p_buf, &has_timer, sizeof(has_timer));
+  if (has_timer) {
+    /* Timers are never unregistered. */
+    assert(timer_id != -1);
+    timing_load_timer(p_timing, timer_id, p_buf);
+  } else if ((timer_id != -1) && timing_timer_is_running(p_timing, timer_id)) {
+    (void) timing_stop_timer(p_timing, timer_id);
+  }
+}
+
+static void
+bbc_save_checkpoint(struct bbc_struct* p_bbc) {
+  struct util_buffer* p_buf;
+  uint32_t i;
+
+  uint64_t ticks = timing_get_total_timer_ticks(p_bbc->p_timing);
+  uint32_t num_checkpoints = p_bbc->num_checkpoints;
+
+  if ((num_checkpoints > 0) &&
+      (ticks <= p_bbc->checkpoint_ticks[num_checkpoints - 1])) {
+    return;
+  }
+
+  if (num_checkpoints == k_bbc_max_checkpoints) {
+    /* Keep every other checkpoint, and take them half as often. */
+    for (i = 0; i < (k_bbc_max_checkpoints / 2); ++i) {
+      struct util_buffer* p_temp = p_bbc->p_checkpoints[i];
+      p_bbc->p_checkpoints[i] = p_bbc->p_checkpoints[(i * 2) + 1];
+      p_bbc->p_checkpoints[(i * 2) + 1] = p_temp;
+      p_bbc->checkpoint_ticks[i] = p_bbc->checkpoint_ticks[(i * 2) + 1];
+    }
+    num_checkpoints = (k_bbc_max_checkpoints / 2);
+    p_bbc->checkpoint_cycles *= 2;
+  }
+
+  p_buf = p_bbc->p_checkpoints[num_checkpoints];
+  if (p_buf == NULL) {
+    p_buf = util_buffer_create();
+    util_buffer_setup_internal(p_buf);
+    p_bbc->p_checkpoints[num_checkpoints] = p_buf;
+  }
+  util_buffer_set_pos(p_buf, 0);
+
+  timing_save_checkpoint(p_bbc->p_timing, p_buf);
+  video_save_checkpoint(p_bbc->p_video, p_buf);
+
+  util_buffer_add_chunk(p_buf, &p_bbc->romsel, sizeof(p_bbc->romsel));
+  util_buffer_add_chunk(p_buf, &p_bbc->acccon, sizeof(p_bbc->acccon));
+  util_buffer_add_chunk(p_buf, p_bbc->p_mem_raw, k_6502_addr_space_size);
+  for (i = 0; i < k_bbc_num_roms; ++i) {
+    if (!p_bbc->is_sideways_ram_bank[i]) {
+      continue;
+    }
+    util_buffer_add_chunk(p_buf,
+                          (p_bbc->p_mem_sideways + (i * k_bbc_rom_size)),
+                          k_bbc_rom_size);
+  }
+  if (p_bbc->is_master) {
+    util_buffer_add_chunk(
+        p_buf,
+        p_bbc->p_mem_master,
+        (k_bbc_andy_size + k_bbc_hazel_size + k_bbc_lynne_size));
+  }
+  util_buffer_add_chunk(p_buf, &p_bbc->IC32, sizeof(p_bbc->IC32));
+  bbc_save_optional_timer(p_bbc, p_bbc->timer_id_autoboot, p_buf);
+  bbc_save_optional_timer(p_bbc, p_bbc->timer_id_test_nmi, p_buf);
+
+  state_6502_save_checkpoint(p_bbc->p_state_6502, p_buf);
+  via_save_checkpoint(p_bbc->p_system_via, p_buf);
+  via_save_checkpoint(p_bbc->p_user_via, p_buf);
+  adc_save_checkpoint(p_bbc->p_adc, p_buf);
+  sound_save_checkpoint(p_bbc->p_sound, p_buf);
+  mc6850_save_checkpoint(p_bbc->p_serial, p_buf);
+  serial_ula_save_checkpoint(p_bbc->p_serial_ula, p_buf);
+  tape_save_checkpoint(p_bbc->p_tape, p_buf);
+  if (p_bbc->p_intel_fdc != NULL) {
+    intel_fdc_save_checkpoint(p_bbc->p_intel_fdc, p_buf);
+  }
+  if (p_bbc->p_wd_fdc != NULL) {
+    wd_fdc_save_checkpoint(p_bbc->p_wd_fdc, p_buf);
+  }
+  disc_drive_save_checkpoint(p_bbc->p_drive_0, p_buf);
+  disc_drive_save_checkpoint(p_bbc->p_drive_1, p_buf);
+  keyboard_save_checkpoint(p_bbc->p_keyboard, p_buf);
+  if (p_bbc->p_cmos != NULL) {
+    cmos_save_checkpoint(p_bbc->p_cmos, p_buf);
+  }
+
+  p_bbc->checkpoint_ticks[num_checkpoints] = ticks;
+  p_bbc->num_checkpoints = (num_checkpoints + 1);
+}
+
+static void
+bbc_load_checkpoint(struct bbc_struct* p_bbc, uint32_t index) {
+  uint8_t romsel;
+  uint8_t acccon;
+  uint32_t i;
+
+  struct util_buffer* p_buf = p_bbc->p_checkpoints[index];
+  struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
+
+  assert(index < p_bbc->num_checkpoints);
+
+  util_buffer_set_pos(p_buf, 0);
+
+  timing_load_checkpoint(p_bbc->p_timing, p_buf);
+  video_load_checkpoint(p_bbc->p_video, p_buf);
+
+  /* Page to match the saved memory image, then overwrite every byte of it,
+   * including the stores for whatever is paged out.
+   */
+  util_buffer_get_chunk(p_buf, &romsel, sizeof(romsel));
+  util_buffer_get_chunk(p_buf, &acccon, sizeof(acccon));
+  if (p_bbc->is_master) {
+    (void) bbc_set_acccon(p_bbc, acccon);
+  }
+  p_bbc->is_romsel_invalidated = 1;
+  bbc_sideways_select(p_bbc, romsel);
+  util_buffer_get_chunk(p_buf, p_bbc->p_mem_raw, k_6502_addr_space_size);
+  for (i = 0; i < k_bbc_num_roms; ++i) {
+    if (!p_bbc->is_sideways_ram_bank[i]) {
+      continue;
+    }
+    util_buffer_get_chunk(p_buf,
+                          (p_bbc->p_mem_sideways + (i * k_bbc_rom_size)),
+                          k_bbc_rom_size);
+  }
+  if (p_bbc->is_master) {
+    util_buffer_get_chunk(
+        p_buf,
+        p_bbc->p_mem_master,
+        (k_bbc_andy_size + k_bbc_hazel_size + k_bbc_lynne_size));
+  }
+  p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                 0,
+                                                 k_6502_addr_space_size);
+  util_buffer_get_chunk(p_buf, &p_bbc->IC32, sizeof(p_bbc->IC32));
+  bbc_load_optional_timer(p_bbc, p_bbc->timer_id_autoboot, p_buf);
+  bbc_load_optional_timer(p_bbc, p_bbc->timer_id_test_nmi, p_buf);
+
+  state_6502_load_checkpoint(p_bbc->p_state_6502, p_buf);
+  via_load_checkpoint(p_bbc->p_system_via, p_buf);
+  via_load_checkpoint(p_bbc->p_user_via, p_buf);
+  adc_load_checkpoint(p_bbc->p_adc, p_buf);
+  sound_load_checkpoint(p_bbc->p_sound, p_buf);
+  mc6850_load_checkpoint(p_bbc->p_serial, p_buf);
+  serial_ula_load_checkpoint(p_bbc->p_serial_ula, p_buf);
+  tape_load_checkpoint(p_bbc->p_tape, p_buf);
+  if (p_bbc->p_intel_fdc != NULL) {
+    intel_fdc_load_checkpoint(p_bbc->p_intel_fdc, p_buf);
+  }
+  if (p_bbc->p_wd_fdc != NULL) {
+    wd_fdc_load_checkpoint(p_bbc->p_wd_fdc, p_buf);
+  }
+  disc_drive_load_checkpoint(p_bbc->p_drive_0, p_buf);
+  disc_drive_load_checkpoint(p_bbc->p_drive_1, p_buf);
+  keyboard_load_checkpoint(p_bbc->p_keyboard, p_buf);
+  if (p_bbc->p_cmos != NULL) {
+    cmos_load_checkpoint(p_bbc->p_cmos, p_buf);
+  }
+
+  assert(timing_get_total_timer_ticks(p_bbc->p_timing) ==
+         p_bbc->checkpoint_ticks[index]);
+}
+
+static void
+bbc_schedule_checkpoint(struct bbc_struct* p_bbc) {
+  uint64_t next_ticks = p_bbc->checkpoint_cycles;
+  uint64_t ticks = timing_get_total_timer_ticks(p_bbc->p_timing);
+
+  if (p_bbc->num_checkpoints > 0) {
+    next_ticks += p_bbc->checkpoint_ticks[p_bbc->num_checkpoints - 1];
+  }
+  if (next_ticks <= ticks) {
+    next_ticks = (ticks + p_bbc->checkpoint_cycles);
+  }
+  (void) timing_set_timer_value(p_bbc->p_timing,
+                                p_bbc->timer_id_checkpoint,
+                                (next_ticks - ticks));
+}
+
+static void
+bbc_checkpoint_timer_callback(void* p) {
+  struct bbc_struct* p_bbc = (struct bbc_struct*) p;
+  struct keyboard_struct* p_keyboard = p_bbc->p_keyboard;
+
+  struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
+
+  /* Checkpoints are only any use to a replay, so stop once the capture or
+   * replay has ended.
+   */
+  if (!keyboard_is_capturing(p_keyboard) &&
+      !keyboard_is_replaying(p_keyboard)) {
+    (void) timing_stop_timer(p_bbc->p_timing, p_bbc->timer_id_checkpoint);
+    return;
+  }
+
+  (void) timing_set_timer_value(p_bbc->p_timing,
+                                p_bbc->timer_id_checkpoint,
+                                p_bbc->checkpoint_cycles);
+
+  /* We're in the middle of some timer callback, so let the CPU driver call
+   * back at a safe time.
+   */
+  p_cpu_driver->p_funcs->apply_flags(p_cpu_driver, k_cpu_flag_checkpoint, 0);
+}
+
 static void
 bbc_do_reset_callback(void* p, uint32_t flags) {
   struct bbc_struct* p_bbc = (struct bbc_struct*) p;
   struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
 
+  if (flags & k_cpu_flag_checkpoint) {
+    bbc_save_checkpoint(p_bbc);
+  }
   if (flags & k_cpu_flag_soft_reset) {
     bbc_break_reset(p_bbc);
   }
-  if (flags & k_cpu_flag_hard_reset) {
+  if ((flags & k_cpu_flag_hard_reset) && (flags & k_cpu_flag_replay)) {
+    /* Later checkpoints are for a future the replay is about to rewrite.
+     * Resume from the latest one not after the requested start, if any.
+     */
+    uint32_t i;
+    int32_t load_index = -1;
+    while ((p_bbc->num_checkpoints > 0) &&
+           (p_bbc->checkpoint_ticks[p_bbc->num_checkpoints - 1] >
+                p_bbc->rewind_to_cycles)) {
+      p_bbc->num_checkpoints--;
+    }
+    for (i = 0; i < p_bbc->num_checkpoints; ++i) {
+      if (p_bbc->checkpoint_ticks[i] <= p_bbc->rewind_from_cycles) {
+        load_index = i;
+      }
+    }
+    if (load_index != -1) {
+      bbc_load_checkpoint(p_bbc, load_index);
+    } else {
+      bbc_power_on_reset(p_bbc);
+    }
+  } else if (flags & k_cpu_flag_hard_reset) {
+    p_bbc->num_checkpoints = 0;
     bbc_power_on_reset(p_bbc);
   }
   if (flags & k_cpu_flag_replay) {
     keyboard_rewind(p_bbc->p_keyboard, p_bbc->rewind_to_cycles);
+    debug_replay_rewound(p_bbc->p_debug);
+  }
+  if (flags & (k_cpu_flag_hard_reset | k_cpu_flag_checkpoint)) {
+    bbc_schedule_checkpoint(p_bbc);
   }
 
   p_cpu_driver->p_funcs->apply_flags(
       p_cpu_driver,
       0,
-      (k_cpu_flag_soft_reset | k_cpu_flag_hard_reset | k_cpu_flag_replay));
+      (k_cpu_flag_soft_reset |
+           k_cpu_flag_hard_reset |
+           k_cpu_flag_replay |
+           k_cpu_flag_checkpoint));
 }
 
 static void
@@ -2188,6 +2463,9 @@ bbc_create(int mode,
   if (util_has_option(p_log_flags, "perf:timer")) {
     timing_set_log_expiries(p_timing, 1);
   }
+  if (util_has_option(p_log_flags, "perf:timing")) {
+    timing_set_accounting(p_timing, 1);
+  }
   p_bbc->p_timing = p_timing;
 
   p_state_6502 = state_6502_create(p_timing, p_bbc->p_mem_read);
@@ -2324,6 +2602,7 @@ bbc_create(int mode,
 
 void
 bbc_destroy(struct bbc_struct* p_bbc) {
+  uint32_t i;
   struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
   volatile int* p_running = &p_bbc->running;
   volatile int* p_thread_allocated = &p_bbc->thread_allocated;
@@ -2339,6 +2618,12 @@ bbc_destroy(struct bbc_struct* p_bbc) {
     (void) os_thread_destroy(p_bbc->p_thread_cpu);
   }
 
+  for (i = 0; i < k_bbc_max_checkpoints; ++i) {
+    if (p_bbc->p_checkpoints[i] != NULL) {
+      util_buffer_destroy(p_bbc->p_checkpoints[i]);
+    }
+  }
+
   p_cpu_driver->p_funcs->destroy(p_cpu_driver);
 
   debug_destroy(p_bbc->p_debug);
@@ -2346,8 +2631,8 @@ bbc_destroy(struct bbc_struct* p_bbc) {
   mc6850_destroy(p_bbc->p_serial);
   tape_destroy(p_bbc->p_tape);
   video_destroy(p_bbc->p_video);
-  teletext_destroy(p_bbc->p_teletext);
   render_destroy(p_bbc->p_render);
+  teletext_destroy(p_bbc->p_teletext);
   sound_destroy(p_bbc->p_sound);
   joystick_destroy(p_bbc->p_joystick);
   adc_destroy(p_bbc->p_adc);
@@ -2366,6 +2651,9 @@ bbc_destroy(struct bbc_struct* p_bbc) {
   disc_drive_destroy(p_bbc->p_drive_0);
   disc_drive_destroy(p_bbc->p_drive_1);
   state_6502_destroy(p_bbc->p_state_6502);
+  if (timing_is_accounting(p_bbc->p_timing)) {
+    timing_dump_accounting(p_bbc->p_timing);
+  }
   timing_destroy(p_bbc->p_timing);
   os_alloc_free_mapping(p_bbc->p_mapping_raw);
   os_alloc_free_mapping(p_bbc->p_mapping_read);
@@ -2866,13 +3154,18 @@ bbc_do_log_speed(struct bbc_struct* p_bbc, uint64_t curr_time_us) {
 }
 
 int
-bbc_replay_seek(struct bbc_struct* p_bbc, uint64_t seek_target) {
+bbc_replay_seek_from(struct bbc_struct* p_bbc,
+                     uint64_t from_ticks,
+                     uint64_t seek_target) {
   struct cpu_driver* p_cpu_driver = p_bbc->p_cpu_driver;
 
+  assert(from_ticks <= seek_target);
+
   if (!keyboard_can_rewind(p_bbc->p_keyboard)) {
     return 0;
   }
 
+  p_bbc->rewind_from_cycles = from_ticks;
   p_bbc->rewind_to_cycles = seek_target;
 
   p_cpu_driver->p_funcs->apply_flags(
@@ -2883,6 +3176,11 @@ bbc_replay_seek(struct bbc_struct* p_bbc, uint64_t seek_target) {
   return 1;
 }
 
+int
+bbc_replay_seek(struct bbc_struct* p_bbc, uint64_t seek_target) {
+  return bbc_replay_seek_from(p_bbc, seek_target, seek_target);
+}
+
 static inline void
 bbc_check_alt_keys(struct bbc_struct* p_bbc) {
   struct keyboard_struct* p_keyboard = p_bbc->p_keyboard;
@@ -3076,6 +3374,25 @@ bbc_start_timer_tick(struct bbc_struct* p_bbc) {
 
   (void) timing_start_timer_with_value(p_timing, p_bbc->timer_id_cycles, 1);
 
+  p_bbc->checkpoint_cycles = k_bbc_default_checkpoint_cycles;
+  (void) util_get_u64_option(&p_bbc->checkpoint_cycles,
+                             p_bbc->options.p_opt_flags,
+                             "bbc:checkpoint-cycles=");
+  if (p_bbc->checkpoint_cycles == 0) {
+    util_bail("bbc:checkpoint-cycles must be non-zero");
+  }
+  p_bbc->timer_id_checkpoint = timing_register_timer(
+      p_timing,
+      "bbc_checkpoint",
+      bbc_checkpoint_timer_callback,
+      p_bbc);
+  if (keyboard_is_capturing(p_bbc->p_keyboard) ||
+      keyboard_is_replaying(p_bbc->p_keyboard)) {
+    (void) timing_start_timer_with_value(p_timing,
+                                         p_bbc->timer_id_checkpoint,
+                                         p_bbc->checkpoint_cycles);
+  }
+
   p_bbc->last_time_us = os_time_get_us();
 }
 
@@ -3108,14 +3425,15 @@ bbc_cpu_thread(void* p) {
 
 void
 bbc_run_async(struct bbc_struct* p_bbc) {
-  p_bbc->p_thread_cpu = os_thread_create(bbc_cpu_thread, p_bbc);
-
   assert(!p_bbc->thread_allocated);
   assert(!p_bbc->running);
 
+  /* Before the thread starts, which clears running when it exits. */
   p_bbc->thread_allocated = 1;
   p_bbc->running = 1;
 
+  p_bbc->p_thread_cpu = os_thread_create(bbc_cpu_thread, p_bbc);
+
   sound_start_playing(p_bbc->p_sound);
 }
 
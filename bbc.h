@@ -94,6 +94,12 @@ void bbc_run_async(struct bbc_struct* p_bbc);
 uint32_t bbc_get_run_result(struct bbc_struct* p_bbc);
 int bbc_check_do_break(struct bbc_struct* p_bbc);
 int bbc_replay_seek(struct bbc_struct* p_bbc, uint64_t seek_target);
+/* Replays from the latest checkpoint at or before from_ticks, up to
+ * seek_target.
+ */
+int bbc_replay_seek_from(struct bbc_struct* p_bbc,
+                         uint64_t from_ticks,
+                         uint64_t seek_target);
 
 struct state_6502* bbc_get_6502(struct bbc_struct* p_bbc);
 struct via_struct* bbc_get_sysvia(struct bbc_struct* p_bbc);
@@ -143,7 +149,7 @@ void bbc_set_channel_handles(struct bbc_struct* p_bbc,
                              intptr_t handle_channel_write_client);
 
 struct bbc_message {
-  uint64_t data[5];
+  uint64_t data[6];
 };
 void bbc_client_send_message(struct bbc_struct* p_bbc,
                              struct bbc_message* p_message);
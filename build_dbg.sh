@@ -22,6 +22,6 @@ gcc -Wall -Wextra -Werror \
     disc_drive.c disc.c ibm_disc_format.c disc_tool.c \
     disc_fsd.c disc_hfe.c disc_ssd.c disc_adl.c \
     disc_rfi.c disc_kryo.c disc_scp.c disc_dfi.c \
-    debug.c expression.c jit.c \
+    debug.c expression.c jit.c trace.c frames.c \
     util.c util_string.c util_container.c util_compress.c \
     -lm -lX11 -lXext -lpthread -lasound -lpulse -lpulse-simple
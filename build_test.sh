@@ -20,3 +20,9 @@ gcc -Wall -W -Werror -g -o make_8271_rom make_8271_rom.c \
 gcc -Wall -W -Werror -g -o make_perf_rom make_perf_rom.c \
     util.c defs_6502.c emit_6502.c test_helper.c
 ./make_perf_rom
+
+gcc -Wall -W -Werror -g -o trace_tool trace_tool.c \
+    util.c util_compress.c defs_6502.c
+
+gcc -Wall -W -Werror -g -o frames_tool frames_tool.c \
+    util.c util_compress.c
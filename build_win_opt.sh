@@ -19,7 +19,7 @@ x86_64-w64-mingw32-gcc -D__USE_MINGW_ANSI_STDIO=0 \
     disc_drive.c disc.c ibm_disc_format.c disc_tool.c \
     disc_fsd.c disc_hfe.c disc_ssd.c disc_adl.c \
     disc_rfi.c disc_kryo.c disc_scp.c disc_dfi.c \
-    debug.c jit.c expression.c \
+    debug.c jit.c expression.c trace.c frames.c \
     util.c util_string.c util_container.c util_compress.c \
     os.c \
     asm/asm_abi.c asm/asm_tables.c asm/asm_util.c \
@@ -56,6 +56,16 @@ void cmos_destroy(struct cmos_struct* p_cmos) {
   util_free(p_cmos);
 }
 
+void
+cmos_save_checkpoint(struct cmos_struct* p_cmos, struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_cmos, sizeof(struct cmos_struct));
+}
+
+void
+cmos_load_checkpoint(struct cmos_struct* p_cmos, struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf, p_cmos, sizeof(struct cmos_struct));
+}
+
 uint8_t
 cmos_get_bus_value(struct cmos_struct* p_cmos) {
   uint8_t val = 0xFF;
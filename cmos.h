@@ -6,9 +6,14 @@
 struct cmos_struct;
 
 struct bbc_options;
+struct util_buffer;
 
 struct cmos_struct* cmos_create(struct bbc_options* p_options);
 void cmos_destroy(struct cmos_struct* p_cmos);
+void cmos_save_checkpoint(struct cmos_struct* p_cmos,
+                          struct util_buffer* p_buf);
+void cmos_load_checkpoint(struct cmos_struct* p_cmos,
+                          struct util_buffer* p_buf);
 
 uint8_t cmos_get_bus_value(struct cmos_struct* p_cmos);
 void cmos_update_external_inputs(struct cmos_struct* p_cmos,
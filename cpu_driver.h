@@ -22,6 +22,7 @@ enum {
   k_cpu_flag_soft_reset = 2,
   k_cpu_flag_hard_reset = 4,
   k_cpu_flag_replay = 8,
+  k_cpu_flag_checkpoint = 16,
 };
 
 struct cpu_driver_funcs {
@@ -13,6 +13,7 @@
 #include "state.h"
 #include "state_6502.h"
 #include "timing.h"
+#include "trace.h"
 #include "util.h"
 #include "util_string.h"
 #include "via.h"
@@ -35,6 +36,14 @@ enum {
   k_max_break = 16,
   k_max_input_len = 1024,
   k_max_temp_storage = (256 * 1024),
+  /* Comfortably longer than any instruction or IRQ, in ticks. */
+  k_reverse_step_window = 256,
+};
+
+enum {
+  k_debug_reverse_none = 0,
+  k_debug_reverse_step = 1,
+  k_debug_reverse_continue = 2,
 };
 
 struct debug_breakpoint {
@@ -76,6 +85,7 @@ struct debug_struct {
   struct util_string_list_struct* p_command_strings;
   struct util_string_list_struct* p_pending_commands;
   int opt_is_print_ticks;
+  int is_accurate;
 
   /* Modifiable register / machine state. */
   uint8_t reg_a;
@@ -99,6 +109,36 @@ struct debug_struct {
   uint32_t sub_instruction_tick;
   int32_t breakpoint_continue;
   uint32_t breakpoint_continue_count;
+  /* JIT code only calls out to the debugger at breakpointed addresses, unless
+   * something needs a callout at every instruction.
+   */
+  int is_callback_everywhere;
+  int is_callback_sites_dirty;
+  /* The address of the last callout from the main CPU driver, if the next
+   * callout could be a repeat of it from a nested interpreter.
+   */
+  int32_t driver_callback_pc;
+  /* Reverse execution. The machine is replayed from the latest checkpoint. A
+   * first pass runs up to the current position to find the target, noting the
+   * last stopping breakpoint hit or instruction start along the way. If there
+   * is none, the search moves back to the previous checkpoint and runs up to
+   * where the last pass started. A second pass then runs up to the target and
+   * stops there.
+   */
+  int reverse_mode;
+  int is_reverse_finding;
+  int is_reverse_window_open;
+  int is_reverse_timer_fired;
+  int has_reverse_found;
+  int reverse_was_fast;
+  uint64_t reverse_origin_ticks;
+  uint64_t reverse_start_ticks;
+  uint64_t reverse_target_ticks;
+  uint64_t reverse_window_ticks;
+  uint64_t reverse_found_ticks;
+
+  /* Binary instruction trace, if recording. */
+  struct trace_struct* p_trace;
 
   /* Stats. */
   int stats;
@@ -148,6 +188,7 @@ debug_clear_breakpoint(struct debug_struct* p_debug, uint32_t i) {
   p_breakpoint->exec_end = -1;
   p_breakpoint->memory_start = -1;
   p_breakpoint->memory_end = -1;
+  p_debug->is_callback_sites_dirty = 1;
 }
 
 static void
@@ -155,6 +196,9 @@ debug_timer_callback(void* p) {
   struct debug_struct* p_debug = (struct debug_struct*) p;
   (void) timing_stop_timer(p_debug->p_timing, p_debug->timer_id_debug);
 
+  if (p_debug->reverse_mode != k_debug_reverse_none) {
+    p_debug->is_reverse_timer_fired = 1;
+  }
   s_interrupt_received = 1;
 }
 
@@ -170,6 +214,9 @@ debug_init(struct debug_struct* p_debug) {
 
 void
 debug_destroy(struct debug_struct* p_debug) {
+  if (p_debug->p_trace != NULL) {
+    trace_destroy(p_debug->p_trace);
+  }
   disc_tool_destroy(p_debug->p_tool);
   util_string_list_free(p_debug->p_command_strings);
   util_string_list_free(p_debug->p_pending_commands);
@@ -189,6 +236,185 @@ debug_subsystem_active(void* p) {
   return p_debug->debug_active;
 }
 
+int
+debug_is_callback_everywhere(struct debug_struct* p_debug) {
+  return p_debug->is_callback_everywhere;
+}
+
+int
+debug_needs_exact_callbacks(struct debug_struct* p_debug) {
+  struct keyboard_struct* p_keyboard = bbc_get_keyboard(p_debug->p_bbc);
+
+  /* Reverse execution starts from, and stops at, exact cycle counts. It is
+   * available whenever there is a capture or replay to rewind.
+   */
+  if (p_debug->reverse_mode != k_debug_reverse_none) {
+    return 1;
+  }
+  return (keyboard_is_capturing(p_keyboard) ||
+          keyboard_is_replaying(p_keyboard));
+}
+
+static int
+debug_could_hit_memory_breakpoint(struct debug_struct* p_debug,
+                                  struct debug_breakpoint* p_breakpoint,
+                                  uint16_t addr_6502) {
+  /* Works out the range of addresses that debug_get_details() could report
+   * for the opcode at the given address, whatever the register values.
+   */
+  int32_t lo;
+  int32_t hi;
+  uint16_t operand;
+
+  uint8_t* p_mem_read = p_debug->p_mem_read;
+  uint8_t opcode = p_mem_read[addr_6502];
+  uint8_t opmode = p_debug->p_opcode_modes[opcode];
+  uint8_t optype = p_debug->p_opcode_types[opcode];
+  uint8_t opmem = p_debug->p_opcode_mem[opcode];
+  int32_t memory_start = p_breakpoint->memory_start;
+  int32_t memory_end = p_breakpoint->memory_end;
+  int is_stack_read = 0;
+  int is_stack_write = 0;
+
+  /* Stack pushes and pulls have no opmem flags but do write or read the stack
+   * page, as debug_get_details() reports.
+   */
+  switch (optype) {
+  case k_php:
+  case k_pha:
+  case k_phx:
+  case k_phy:
+    is_stack_write = 1;
+    break;
+  case k_plp:
+  case k_pla:
+  case k_plx:
+  case k_ply:
+    is_stack_read = 1;
+    break;
+  default:
+    break;
+  }
+  if (is_stack_read || is_stack_write) {
+    if (!(p_breakpoint->is_memory_read && is_stack_read) &&
+        !(p_breakpoint->is_memory_write && is_stack_write)) {
+      return 0;
+    }
+    return ((memory_start <= (k_6502_stack_addr + 0xFF)) &&
+            (memory_end >= k_6502_stack_addr));
+  }
+
+  if (!(p_breakpoint->is_memory_read && (opmem & k_opmem_read_flag)) &&
+      !(p_breakpoint->is_memory_write && (opmem & k_opmem_write_flag))) {
+    return 0;
+  }
+
+  operand = p_mem_read[(uint16_t) (addr_6502 + 1)];
+  operand |= (p_mem_read[(uint16_t) (addr_6502 + 2)] << 8);
+
+  switch (opmode) {
+  case k_zpg:
+    lo = (uint8_t) operand;
+    hi = lo;
+    break;
+  case k_zpx:
+  case k_zpy:
+    lo = 0;
+    hi = 0xFF;
+    break;
+  case k_abs:
+    if ((optype == k_jsr) || (optype == k_jmp)) {
+      return 0;
+    }
+    lo = operand;
+    hi = lo;
+    break;
+  case k_abx:
+  case k_aby:
+    lo = operand;
+    hi = (operand + 0xFF);
+    if (hi > 0xFFFF) {
+      /* Index wraps around the address space. */
+      if (memory_start <= (hi & 0xFFFF)) {
+        return 1;
+      }
+      hi = 0xFFFF;
+    }
+    break;
+  case k_rel:
+    return 0;
+  case k_idx:
+  case k_idy:
+  case k_id:
+    lo = 0;
+    hi = 0xFFFF;
+    break;
+  default:
+    return 0;
+  }
+
+  return ((memory_start <= hi) && (memory_end >= lo));
+}
+
+int
+debug_needs_callback_at(struct debug_struct* p_debug, uint16_t addr_6502) {
+  uint32_t i;
+
+  if (p_debug->is_callback_everywhere) {
+    return 1;
+  }
+  /* Replays only need breakpoint callbacks when finding a previous hit. */
+  if ((p_debug->reverse_mode != k_debug_reverse_none) &&
+      (!p_debug->is_reverse_finding ||
+       (p_debug->reverse_mode != k_debug_reverse_continue))) {
+    return 0;
+  }
+  if (addr_6502 == p_debug->next_or_finish_stop_addr) {
+    return 1;
+  }
+  for (i = 0; i < p_debug->max_breakpoint_used_plus_one; ++i) {
+    struct debug_breakpoint* p_breakpoint = &p_debug->breakpoints[i];
+    if (!p_breakpoint->is_in_use || !p_breakpoint->is_enabled) {
+      continue;
+    }
+    if (p_breakpoint->has_exec_range) {
+      if ((addr_6502 >= p_breakpoint->exec_start) &&
+          (addr_6502 <= p_breakpoint->exec_end)) {
+        return 1;
+      }
+    } else {
+      /* Without an exec range, it must be a memory breakpoint. Only the
+       * opcodes that could touch the watched range need a callback; the
+       * exact address is checked in the callback.
+       */
+      assert(p_breakpoint->has_memory_range);
+      if (debug_could_hit_memory_breakpoint(p_debug,
+                                            p_breakpoint,
+                                            addr_6502)) {
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
+
+int
+debug_has_memory_breakpoints(struct debug_struct* p_debug) {
+  uint32_t i;
+
+  for (i = 0; i < p_debug->max_breakpoint_used_plus_one; ++i) {
+    struct debug_breakpoint* p_breakpoint = &p_debug->breakpoints[i];
+    if (p_breakpoint->is_in_use &&
+        p_breakpoint->is_enabled &&
+        p_breakpoint->has_memory_range) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
 static void
 debug_print_opcode(struct debug_struct* p_debug,
                    char* buf,
@@ -198,11 +424,6 @@ debug_print_opcode(struct debug_struct* p_debug,
                    uint8_t operand2,
                    uint16_t reg_pc,
                    int do_irq) {
-  uint8_t optype;
-  uint8_t opmode;
-  const char* opname;
-  uint16_t addr;
-
   if (do_irq) {
     struct state_6502* p_state_6502 = bbc_get_6502(p_debug->p_bbc);
     /* Very close approximation. It's possible a non-NMI IRQ will be reported
@@ -217,66 +438,14 @@ debug_print_opcode(struct debug_struct* p_debug,
     return;
   }
 
-  optype = p_debug->p_opcode_types[opcode];
-  opmode = p_debug->p_opcode_modes[opcode];
-  opname = g_p_opnames[optype];
-  addr = (operand1 | (operand2 << 8));
-
-  switch (opmode) {
-  case k_nil:
-  case k_nil1:
-    (void) snprintf(buf, buf_len, "%s", opname);
-    break;
-  case k_acc:
-    (void) snprintf(buf, buf_len, "%s A", opname);
-    break;
-  case k_imm:
-    (void) snprintf(buf, buf_len, "%s #$%.2"PRIX8, opname, operand1);
-    break;
-  case k_zpg:
-    (void) snprintf(buf, buf_len, "%s $%.2"PRIX8, opname, operand1);
-    break;
-  case k_abs:
-    (void) snprintf(buf, buf_len, "%s $%.4"PRIX16, opname, addr);
-    break;
-  case k_zpx:
-    (void) snprintf(buf, buf_len, "%s $%.2"PRIX8",X", opname, operand1);
-    break;
-  case k_zpy:
-    (void) snprintf(buf, buf_len, "%s $%.2"PRIX8",Y", opname, operand1);
-    break;
-  case k_abx:
-    (void) snprintf(buf, buf_len, "%s $%.4"PRIX16",X", opname, addr);
-    break;
-  case k_aby:
-    (void) snprintf(buf, buf_len, "%s $%.4"PRIX16",Y", opname, addr);
-    break;
-  case k_idx:
-    (void) snprintf(buf, buf_len, "%s ($%.2"PRIX8",X)", opname, operand1);
-    break;
-  case k_idy:
-    (void) snprintf(buf, buf_len, "%s ($%.2"PRIX8"),Y", opname, operand1);
-    break;
-  case k_ind:
-    (void) snprintf(buf, buf_len, "%s ($%.4"PRIX16")", opname, addr);
-    break;
-  case k_rel:
-    addr = (reg_pc + 2 + (int8_t) operand1);
-    (void) snprintf(buf, buf_len, "%s $%.4"PRIX16, opname, addr);
-    break;
-  case k_iax:
-    (void) snprintf(buf, buf_len, "%s ($%.4"PRIX16",X)", opname, addr);
-    break;
-  case k_id:
-    (void) snprintf(buf, buf_len, "%s ($%.2"PRIX8")", opname, operand1);
-    break;
-  case 0:
-    (void) snprintf(buf, buf_len, "%s: $%.2"PRIX8, opname, opcode);
-    break;
-  default:
-    assert(0);
-    break;
-  }
+  defs_6502_format_opcode(buf,
+                          buf_len,
+                          p_debug->p_opcode_types[opcode],
+                          p_debug->p_opcode_modes[opcode],
+                          opcode,
+                          operand1,
+                          operand2,
+                          reg_pc);
 }
 
 static inline int
@@ -685,6 +854,7 @@ debug_get_free_breakpoint(struct debug_struct* p_debug) {
     struct debug_breakpoint* p_breakpoint = &p_debug->breakpoints[i];
     if (!p_breakpoint->is_in_use) {
       p_breakpoint->is_in_use = 1;
+      p_debug->is_callback_sites_dirty = 1;
       if ((i + 1) > p_debug->max_breakpoint_used_plus_one) {
         p_debug->max_breakpoint_used_plus_one = (i + 1);
       }
@@ -709,11 +879,64 @@ debug_calculate_max_breakpoint(struct debug_struct* p_debug) {
   }
 }
 
+static int
+debug_calculate_callback_everywhere(struct debug_struct* p_debug) {
+  uint32_t i;
+
+  /* Replays run flat out, apart from the final approach of a reverse step. */
+  if (p_debug->reverse_mode != k_debug_reverse_none) {
+    return p_debug->is_reverse_window_open;
+  }
+
+  if (!p_debug->debug_running ||
+      p_debug->debug_running_print ||
+      (p_debug->p_trace != NULL) ||
+      p_debug->stats ||
+      p_debug->is_sub_instruction_active) {
+    return 1;
+  }
+
+  /* Pure expression breakpoints could fire at any instruction. */
+  for (i = 0; i < p_debug->max_breakpoint_used_plus_one; ++i) {
+    struct debug_breakpoint* p_breakpoint = &p_debug->breakpoints[i];
+    if (!p_breakpoint->is_in_use || !p_breakpoint->is_enabled) {
+      continue;
+    }
+    if (!p_breakpoint->has_exec_range && !p_breakpoint->has_memory_range) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+static void
+debug_update_callback_sites(struct debug_struct* p_debug) {
+  struct cpu_driver* p_cpu_driver;
+  int is_callback_everywhere = debug_calculate_callback_everywhere(p_debug);
+
+  if ((is_callback_everywhere == p_debug->is_callback_everywhere) &&
+      (is_callback_everywhere || !p_debug->is_callback_sites_dirty)) {
+    return;
+  }
+
+  p_debug->is_callback_everywhere = is_callback_everywhere;
+  p_debug->is_callback_sites_dirty = 0;
+
+  /* The JIT asks debug_needs_callback_at() as it compiles, so throw away all
+   * compiled code to pick up the new set of callback sites. This is a no-op
+   * for the other CPU drivers.
+   */
+  p_cpu_driver = bbc_get_cpu_driver(p_debug->p_bbc);
+  p_cpu_driver->p_funcs->memory_range_invalidate(p_cpu_driver,
+                                                 0,
+                                                 k_6502_addr_space_size);
+}
+
 static inline void
 debug_check_breakpoints(struct debug_struct* p_debug,
                         int* p_out_print,
-                        int* p_out_stop,
-                        uint8_t opmem) {
+                        int* p_out_stop) {
   uint32_t i;
   uint32_t max_breakpoint_used_plus_one = p_debug->max_breakpoint_used_plus_one;
 
@@ -742,10 +965,9 @@ debug_check_breakpoints(struct debug_struct* p_debug,
           (p_debug->addr_6502 > p_breakpoint->memory_end)) {
         continue;
       }
-      if (p_breakpoint->is_memory_read && (opmem & k_opmem_read_flag)) {
+      if (p_breakpoint->is_memory_read && p_debug->is_read) {
         /* Match. */
-      } else if (p_breakpoint->is_memory_write &&
-                 (opmem & k_opmem_write_flag)) {
+      } else if (p_breakpoint->is_memory_write && p_debug->is_write) {
         /* Match. */
       } else {
         continue;
@@ -758,6 +980,15 @@ debug_check_breakpoints(struct debug_struct* p_debug,
       }
     }
     /* If we arrive here, it's a hit. */
+    if (p_debug->reverse_mode != k_debug_reverse_none) {
+      /* Finding a previous hit: note where it was but otherwise ignore it. */
+      if (p_breakpoint->do_stop) {
+        p_debug->has_reverse_found = 1;
+        p_debug->reverse_found_ticks =
+            timing_get_total_timer_ticks(p_debug->p_timing);
+      }
+      continue;
+    }
     p_breakpoint->num_hits++;
     if (p_breakpoint->do_stop && p_breakpoint->do_print) {
       (void) printf("breakpoint %"PRIu32" hit %"PRIu64" times\n",
@@ -1717,31 +1948,6 @@ debug_print_hex_line(uint8_t* p_buf,
   (void) printf("\n");
 }
 
-static void
-debug_print_flags_buf(char* p_flags_buf, uint8_t reg_flags) {
-  (void) memset(p_flags_buf, ' ', 8);
-  p_flags_buf[8] = '\0';
-  if (debug_flag_c(reg_flags)) {
-    p_flags_buf[0] = 'C';
-  }
-  if (debug_flag_z(reg_flags)) {
-    p_flags_buf[1] = 'Z';
-  }
-  if (debug_flag_i(reg_flags)) {
-    p_flags_buf[2] = 'I';
-  }
-  if (debug_flag_d(reg_flags)) {
-    p_flags_buf[3] = 'D';
-  }
-  p_flags_buf[5] = '1';
-  if (debug_flag_o(reg_flags)) {
-    p_flags_buf[6] = 'O';
-  }
-  if (debug_flag_n(reg_flags)) {
-    p_flags_buf[7] = 'N';
-  }
-}
-
 static inline void
 debug_print_status_line(struct debug_struct* p_debug,
                         struct cpu_driver* p_cpu_driver,
@@ -1783,7 +1989,7 @@ debug_print_status_line(struct debug_struct* p_debug,
                      p_debug->reg_pc,
                      do_irq);
 
-  debug_print_flags_buf(&flags_buf[0], reg_flags);
+  defs_6502_format_flags(&flags_buf[0], reg_flags);
 
   if (p_cpu_driver != NULL) {
     p_address_info = p_cpu_driver->p_funcs->get_address_info(p_cpu_driver,
@@ -1822,6 +2028,232 @@ debug_print_status_line(struct debug_struct* p_debug,
   (void) fflush(stdout);
 }
 
+static inline void
+debug_trace_instruction(struct debug_struct* p_debug,
+                        uint8_t opcode,
+                        uint8_t operand1,
+                        uint8_t operand2,
+                        uint8_t opmode,
+                        int do_irq) {
+  uint8_t opcode_bytes[3];
+  opcode_bytes[0] = opcode;
+  opcode_bytes[1] = operand1;
+  opcode_bytes[2] = operand2;
+  trace_instruction(p_debug->p_trace,
+                    timing_get_total_timer_ticks(p_debug->p_timing),
+                    p_debug->reg_pc,
+                    p_debug->reg_a,
+                    p_debug->reg_x,
+                    p_debug->reg_y,
+                    p_debug->reg_s,
+                    p_debug->reg_flags,
+                    do_irq,
+                    opmode,
+                    &opcode_bytes[0],
+                    (uint16_t) p_debug->addr_6502);
+}
+
+static void
+debug_set_trace(struct debug_struct* p_debug,
+                const char* p_file_name,
+                int is_compressed) {
+  int is_65c12;
+
+  if (p_debug->p_trace != NULL) {
+    trace_destroy(p_debug->p_trace);
+    p_debug->p_trace = NULL;
+    (void) printf("trace stopped\n");
+  }
+  if (p_file_name == NULL) {
+    return;
+  }
+
+  is_65c12 = (p_debug->p_opcode_modes == defs_6502_get_65c12_opmode_map());
+  p_debug->p_trace = trace_create(p_file_name, is_compressed, is_65c12);
+  if (p_debug->p_trace == NULL) {
+    (void) printf("couldn't open %s\n", p_file_name);
+  } else {
+    (void) printf("tracing to %s\n", p_file_name);
+  }
+}
+
+static void
+debug_reverse_end(struct debug_struct* p_debug) {
+  struct timing_struct* p_timing = p_debug->p_timing;
+
+  if (timing_timer_is_running(p_timing, p_debug->timer_id_debug)) {
+    (void) timing_stop_timer(p_timing, p_debug->timer_id_debug);
+  }
+  p_debug->reverse_mode = k_debug_reverse_none;
+  p_debug->is_reverse_finding = 0;
+  p_debug->is_reverse_window_open = 0;
+  p_debug->is_reverse_timer_fired = 0;
+  p_debug->is_callback_sites_dirty = 1;
+  /* The replay drops out of fast mode when it completes. */
+  bbc_set_fast_flag(p_debug->p_bbc, p_debug->reverse_was_fast);
+}
+
+static void
+debug_reverse_set_target(struct debug_struct* p_debug, uint64_t target_ticks) {
+  p_debug->has_reverse_found = 0;
+  p_debug->is_reverse_window_open = 0;
+  p_debug->reverse_target_ticks = target_ticks;
+  p_debug->reverse_window_ticks = 0;
+  if ((p_debug->reverse_mode == k_debug_reverse_step) &&
+      (target_ticks > k_reverse_step_window)) {
+    p_debug->reverse_window_ticks = (target_ticks - k_reverse_step_window);
+  }
+  p_debug->is_callback_sites_dirty = 1;
+}
+
+static int
+debug_reverse_start(struct debug_struct* p_debug, int reverse_mode) {
+  struct bbc_struct* p_bbc = p_debug->p_bbc;
+  uint64_t ticks = timing_get_total_timer_ticks(p_debug->p_timing);
+
+  if (p_debug->is_sub_instruction_active) {
+    (void) printf("reverse execution not available in sub-instruction mode\n");
+    return 0;
+  }
+  /* Without -accurate, a replay doesn't retrace the same instructions, so it
+   * could stop somewhere that was never executed.
+   */
+  if (!p_debug->is_accurate) {
+    (void) printf("reverse execution needs -accurate\n");
+    return 0;
+  }
+  /* Replays start with the disc contents as they are now, so any disc write
+   * since the capture began would be seen too early.
+   */
+  if (disc_drive_has_written(bbc_get_drive_0(p_bbc)) ||
+      disc_drive_has_written(bbc_get_drive_1(p_bbc))) {
+    (void) printf("reverse execution not available after a disc write\n");
+    return 0;
+  }
+  if (!bbc_replay_seek(p_bbc, ticks)) {
+    (void) printf("reverse execution needs -capture or -replay\n");
+    return 0;
+  }
+
+  p_debug->reverse_mode = reverse_mode;
+  p_debug->is_reverse_finding = 1;
+  p_debug->is_reverse_timer_fired = 0;
+  p_debug->reverse_was_fast = bbc_get_fast_flag(p_bbc);
+  p_debug->reverse_origin_ticks = ticks;
+  p_debug->reverse_start_ticks = 0;
+  debug_reverse_set_target(p_debug, ticks);
+  p_debug->next_or_finish_stop_addr = -1;
+  p_debug->breakpoint_continue = -1;
+
+  return 1;
+}
+
+void
+debug_replay_rewound(struct debug_struct* p_debug) {
+  struct timing_struct* p_timing = p_debug->p_timing;
+  uint64_t ticks = timing_get_total_timer_ticks(p_timing);
+  uint64_t target_ticks = p_debug->reverse_target_ticks;
+
+  /* The machine moved, so the next callout is not a repeat. */
+  p_debug->driver_callback_pc = -1;
+
+  if (p_debug->reverse_mode == k_debug_reverse_none) {
+    return;
+  }
+
+  p_debug->reverse_start_ticks = ticks;
+  if (p_debug->is_reverse_finding &&
+      (p_debug->reverse_mode == k_debug_reverse_step)) {
+    target_ticks = p_debug->reverse_window_ticks;
+  }
+  if (timing_timer_is_running(p_timing, p_debug->timer_id_debug)) {
+    (void) timing_stop_timer(p_timing, p_debug->timer_id_debug);
+  }
+  if (target_ticks > ticks) {
+    (void) timing_start_timer_with_value(p_timing,
+                                         p_debug->timer_id_debug,
+                                         (target_ticks - ticks));
+  } else {
+    p_debug->is_reverse_timer_fired = 1;
+    s_interrupt_received = 1;
+  }
+}
+
+static int
+debug_reverse_callback(struct debug_struct* p_debug) {
+  int is_timer_fired = p_debug->is_reverse_timer_fired;
+  uint64_t ticks = timing_get_total_timer_ticks(p_debug->p_timing);
+
+  p_debug->is_reverse_timer_fired = 0;
+  if (s_interrupt_received && !is_timer_fired) {
+    (void) printf("reverse execution interrupted\n");
+    debug_reverse_end(p_debug);
+    return 1;
+  }
+  s_interrupt_received = 0;
+
+  if (ticks >= p_debug->reverse_target_ticks) {
+    uint64_t start_ticks = p_debug->reverse_start_ticks;
+    if (p_debug->is_reverse_finding &&
+        !p_debug->has_reverse_found &&
+        (start_ticks > 0)) {
+      /* Nothing since the checkpoint, so search from the one before. */
+      debug_reverse_set_target(p_debug, start_ticks);
+      if (bbc_replay_seek_from(p_debug->p_bbc,
+                               (start_ticks - 1),
+                               p_debug->reverse_origin_ticks)) {
+        return 0;
+      }
+      (void) printf("replay ended\n");
+    } else if (p_debug->is_reverse_finding) {
+      if (!p_debug->has_reverse_found) {
+        if (p_debug->reverse_mode == k_debug_reverse_step) {
+          (void) printf("no earlier instruction\n");
+        } else {
+          (void) printf("no earlier breakpoint hit\n");
+        }
+        /* Searching earlier segments moved away from where we started. */
+        p_debug->reverse_found_ticks = p_debug->reverse_origin_ticks;
+      }
+      if (p_debug->reverse_found_ticks != ticks) {
+        /* Found it, so replay again and stop there. */
+        p_debug->is_reverse_finding = 0;
+        debug_reverse_set_target(p_debug, p_debug->reverse_found_ticks);
+        if (bbc_replay_seek(p_debug->p_bbc, p_debug->reverse_target_ticks)) {
+          return 0;
+        }
+        (void) printf("replay ended\n");
+      }
+    }
+    /* Reverse execution ends after the breakpoint checks, so that arriving at
+     * a breakpoint doesn't count as another hit.
+     */
+    s_interrupt_received = 1;
+    return 1;
+  }
+
+  if (!p_debug->is_reverse_finding) {
+    return 0;
+  }
+  if (p_debug->reverse_mode == k_debug_reverse_step) {
+    if (ticks >= p_debug->reverse_window_ticks) {
+      /* Close to the current position, so note every instruction start. */
+      if (!p_debug->is_reverse_window_open) {
+        p_debug->is_reverse_window_open = 1;
+        p_debug->is_callback_sites_dirty = 1;
+      }
+      p_debug->has_reverse_found = 1;
+      p_debug->reverse_found_ticks = ticks;
+    }
+  } else {
+    int unused_print = 0;
+    int unused_stop = 0;
+    debug_check_breakpoints(p_debug, &unused_print, &unused_stop);
+  }
+
+  return 0;
+}
+
 static void*
 debug_callback_common(struct debug_struct* p_debug,
                       struct cpu_driver* p_cpu_driver,
@@ -1891,6 +2323,23 @@ debug_callback_common(struct debug_struct* p_debug,
                     operand2,
                     p_mem_read);
 
+  /* Replays for reverse execution stay silent until they arrive. */
+  if ((p_debug->reverse_mode != k_debug_reverse_none) &&
+      !debug_reverse_callback(p_debug)) {
+    debug_update_callback_sites(p_debug);
+    return 0;
+  }
+
+  /* Sub-instruction callbacks would repeat the instruction. */
+  if ((p_debug->p_trace != NULL) && (p_cpu_driver != NULL)) {
+    debug_trace_instruction(p_debug,
+                            opcode,
+                            operand1,
+                            operand2,
+                            opmode,
+                            do_irq);
+  }
+
   if (p_debug->stats) {
     /* Don't log the address as hit if it was an IRQ. That led to double
      * counting of the address (the second time after RTI). Upon consideration,
@@ -1960,10 +2409,10 @@ debug_callback_common(struct debug_struct* p_debug,
     p_breakpoint_continue = &p_debug->breakpoints[p_debug->breakpoint_continue];
     breakpoint_continue_hit_count = p_breakpoint_continue->num_hits;
   }
-  debug_check_breakpoints(p_debug,
-                          &break_print,
-                          &break_stop,
-                          opmem);
+  debug_check_breakpoints(p_debug, &break_print, &break_stop);
+  if (p_debug->reverse_mode != k_debug_reverse_none) {
+    debug_reverse_end(p_debug);
+  }
   if ((p_breakpoint_continue != NULL) &&
       (p_breakpoint_continue->num_hits > breakpoint_continue_hit_count)) {
     assert(p_debug->breakpoint_continue_count > 0);
@@ -2002,6 +2451,7 @@ debug_callback_common(struct debug_struct* p_debug,
 
   if (p_debug->reg_pc == p_debug->next_or_finish_stop_addr) {
     p_debug->next_or_finish_stop_addr = -1;
+    p_debug->is_callback_sites_dirty = 1;
   }
 
   oplen = g_opmodelens[opmode];
@@ -2117,6 +2567,7 @@ debug_callback_common(struct debug_struct* p_debug,
     }
 
     if (!strcmp(p_command, "q")) {
+      debug_set_trace(p_debug, NULL, 0);
       exit(0);
     } else if (!strcmp(p_command, "bail")) {
       util_bail("debug bail (command)");
@@ -2128,11 +2579,34 @@ debug_callback_common(struct debug_struct* p_debug,
       is_fast = !is_fast;
       bbc_set_fast_flag(p_bbc, is_fast);
       (void) printf("fast now: %d\n", is_fast);
+    } else if (!strcmp(p_command, "trace")) {
+      debug_set_trace(p_debug,
+                      p_param_1_str,
+                      ((p_param_2_str != NULL) && !strcmp(p_param_2_str, "z")));
+      /* Include the instruction we're stopped at. */
+      if ((p_debug->p_trace != NULL) && (p_cpu_driver != NULL)) {
+        debug_trace_instruction(p_debug,
+                                opcode,
+                                operand1,
+                                operand2,
+                                opmode,
+                                do_irq);
+      }
     } else if (!strcmp(p_command, "stats")) {
       p_debug->stats = !p_debug->stats;
       (void) printf("stats now: %d\n", p_debug->stats);
     } else if (!strcmp(p_command, "ds")) {
       debug_dump_stats(p_debug);
+    } else if (!strcmp(p_command, "timers")) {
+      struct timing_struct* p_timing = p_debug->p_timing;
+      if ((p_param_1_str != NULL) && !strcmp(p_param_1_str, "c")) {
+        timing_clear_accounting(p_timing);
+      } else if (timing_is_accounting(p_timing)) {
+        timing_dump_accounting(p_timing);
+      } else {
+        timing_set_accounting(p_timing, 1);
+        (void) printf("timer cost accounting now on\n");
+      }
     } else if (!strcmp(p_command, "cs")) {
       debug_clear_stats(p_debug);
     } else if (!strcmp(p_command, "s") || !strcmp(p_command, "step")) {
@@ -2155,6 +2629,7 @@ debug_callback_common(struct debug_struct* p_debug,
       break;
     } else if (!strcmp(p_command, "n") || !strcmp(p_command, "next")) {
       p_debug->next_or_finish_stop_addr = (p_debug->reg_pc + oplen);
+      p_debug->is_callback_sites_dirty = 1;
       p_debug->debug_running = 1;
       break;
     } else if (!strcmp(p_command, "f")) {
@@ -2166,6 +2641,7 @@ debug_callback_common(struct debug_struct* p_debug,
       finish_addr++;
       (void) printf("finish will stop at $%.4"PRIX16"\n", finish_addr);
       p_debug->next_or_finish_stop_addr = finish_addr;
+      p_debug->is_callback_sites_dirty = 1;
       p_debug->debug_running = 1;
       break;
     } else if (!strcmp(p_command, "m")) {
@@ -2194,6 +2670,18 @@ debug_callback_common(struct debug_struct* p_debug,
       (void) bbc_replay_seek(p_bbc, (parse_int * 2000000ull));
       p_debug->debug_running = 1;
       break;
+    } else if (!strcmp(p_command, "rs") ||
+               !strcmp(p_command, "reverse-step")) {
+      if (debug_reverse_start(p_debug, k_debug_reverse_step)) {
+        p_debug->debug_running = 1;
+        break;
+      }
+    } else if (!strcmp(p_command, "rc") ||
+               !strcmp(p_command, "reverse-continue")) {
+      if (debug_reverse_start(p_debug, k_debug_reverse_continue)) {
+        p_debug->debug_running = 1;
+        break;
+      }
     } else if (!strcmp(p_command, "b") || !strcmp(p_command, "break")) {
       debug_setup_breakpoint(p_debug);
     } else if (!strcmp(p_command, "bm")) {
@@ -2218,6 +2706,7 @@ debug_callback_common(struct debug_struct* p_debug,
       struct debug_breakpoint* p_breakpoint = &p_debug->breakpoints[parse_int];
       if (p_breakpoint->is_in_use) {
         p_breakpoint->is_enabled = 1;
+        p_debug->is_callback_sites_dirty = 1;
       }
     } else if (!strcmp(p_command, "disable") &&
                (parse_int >= 0) &&
@@ -2225,6 +2714,7 @@ debug_callback_common(struct debug_struct* p_debug,
       struct debug_breakpoint* p_breakpoint = &p_debug->breakpoints[parse_int];
       if (p_breakpoint->is_in_use) {
         p_breakpoint->is_enabled = 0;
+        p_debug->is_callback_sites_dirty = 1;
       }
     } else if (!strcmp(p_command, "eval") && (p_param_1_str != NULL)) {
       int64_t expression_ret;
@@ -2337,7 +2827,7 @@ debug_callback_common(struct debug_struct* p_debug,
       uint64_t ticks = timing_get_total_timer_ticks(p_timing);
       uint64_t countdown = timing_get_countdown(p_timing);
       uint64_t cycles = state_6502_get_cycles(p_state_6502);
-      debug_print_flags_buf(&flags_buf[0], p_debug->reg_flags);
+      defs_6502_format_flags(&flags_buf[0], p_debug->reg_flags);
       debug_print_registers(p_debug->reg_a,
                             p_debug->reg_x,
                             p_debug->reg_y,
@@ -2504,7 +2994,9 @@ debug_callback_common(struct debug_struct* p_debug,
   "bc <b> <count>     : run until breakpoint <b> hits <count> times\n"
   "stats              : toggle stats collection (default: off)\n"
   "ds                 : dump stats collected\n"
+  "trace (<f>) (z)    : binary trace to <f> (z: compressed), or stop\n"
   "cs                 : clear stats collected\n"
+  "timers (c)         : dump timer costs, or start collecting (c: clear)\n"
   "t                  : trap into gdb\n"
   "breakat <c>        : break at <c> cycles\n"
   "keydown <k>        : simulate key press <k>\n"
@@ -2512,6 +3004,9 @@ debug_callback_common(struct debug_struct* p_debug,
   "ss <f>             : save state to BEM file <f> (deprecated)\n"
   "fast               : toggle fast mode on/off\n"
   "seek <s>           : seek a replay file to <s> seconds\n"
+  "rs                 : reverse step (needs -accurate, and -capture or\n"
+  "                     -replay)\n"
+  "rc                 : reverse continue to the previous breakpoint hit\n"
   "bail               : exit emulator with failure code\n"
   );
     } else {
@@ -2529,6 +3024,7 @@ debug_callback_common(struct debug_struct* p_debug,
       util_bail("fflush() failed");
     }
   }
+  debug_update_callback_sites(p_debug);
   if (do_trap) {
     os_debug_trap();
   }
@@ -2549,6 +3045,22 @@ debug_sub_instruction_callback(void* p) {
 void*
 debug_callback(struct cpu_driver* p_cpu_driver, int do_irq) {
   struct debug_struct* p_debug = p_cpu_driver->abi.p_debug_object;
+  struct cpu_driver* p_main_cpu_driver = bbc_get_cpu_driver(p_debug->p_bbc);
+  uint16_t pc = state_6502_get_pc(p_debug->p_state_6502);
+  int32_t driver_callback_pc = p_debug->driver_callback_pc;
+
+  /* JIT code calls out at the start of an instruction, but may then bail to
+   * the interpreter for it, e.g. ADC in decimal mode, or CLI with an IRQ
+   * pending. The interpreter calls out again at the same address, which is
+   * not another hit.
+   */
+  p_debug->driver_callback_pc = -1;
+  if (p_cpu_driver == p_main_cpu_driver) {
+    p_debug->driver_callback_pc = pc;
+  } else if (!do_irq && (pc == driver_callback_pc)) {
+    return 0;
+  }
+
   p_debug->sub_instruction_tick = 0;
   return debug_callback_common(p_debug, p_cpu_driver, do_irq);
 }
@@ -2585,6 +3097,7 @@ debug_create(struct bbc_struct* p_bbc,
   p_debug->p_command_strings = util_string_list_alloc();
   p_debug->p_pending_commands = util_string_list_alloc();
   p_debug->breakpoint_continue = -1;
+  p_debug->driver_callback_pc = -1;
 
   p_debug->p_temp_storage_buf = util_buffer_create();
   util_buffer_setup_internal(p_debug->p_temp_storage_buf);
@@ -2612,6 +3125,11 @@ debug_create(struct bbc_struct* p_bbc,
   }
   p_debug->opt_is_print_ticks = util_has_option(p_options->p_opt_flags,
                                                 "debug:print-ticks");
+  p_debug->is_accurate = p_options->accurate;
+
+  p_debug->is_callback_everywhere =
+      debug_calculate_callback_everywhere(p_debug);
+  p_debug->is_callback_sites_dirty = 0;
 
   os_terminal_set_ctrl_c_callback(debug_interrupt_callback);
 
@@ -18,7 +18,24 @@ void debug_destroy(struct debug_struct* p_debug);
 
 volatile int* debug_get_interrupt(struct debug_struct* p_debug);
 int debug_subsystem_active(void* p);
+/* Whether compiled code must call out to the debugger before executing the
+ * instruction at the given address. Compiled code is invalidated whenever the
+ * answer might change.
+ */
+int debug_needs_callback_at(struct debug_struct* p_debug, uint16_t addr_6502);
+int debug_is_callback_everywhere(struct debug_struct* p_debug);
+/* Whether debugger callouts need exact cycle counts, which only the
+ * interpreter provides. Reverse execution needs them.
+ */
+int debug_needs_exact_callbacks(struct debug_struct* p_debug);
+/* Memory breakpoints rely on the operand bytes at compile time, so the JIT
+ * must not compile dynamic operands while any are active.
+ */
+int debug_has_memory_breakpoints(struct debug_struct* p_debug);
 void debug_set_commands(struct debug_struct* p_debug, const char* p_commands);
+/* Called after a replay has rewound the machine to a checkpoint or power on.
+ */
+void debug_replay_rewound(struct debug_struct* p_debug);
 
 void* debug_callback(struct cpu_driver* p_cpu_driver, int do_irq);
 
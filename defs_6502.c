@@ -1,7 +1,10 @@
 #include "defs_6502.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <stddef.h>
+#include <stdio.h>
+#include <string.h>
 
 const char* g_p_opnames[k_6502_op_num_types] =
 {
@@ -586,3 +589,97 @@ defs_6502_init() {
   defs_6502_setup_6502();
   defs_6502_setup_65c12();
 }
+
+void
+defs_6502_format_opcode(char* p_buf,
+                        size_t buf_len,
+                        uint8_t optype,
+                        uint8_t opmode,
+                        uint8_t opcode,
+                        uint8_t operand1,
+                        uint8_t operand2,
+                        uint16_t reg_pc) {
+  const char* opname = g_p_opnames[optype];
+  uint16_t addr = (operand1 | (operand2 << 8));
+
+  switch (opmode) {
+  case k_nil:
+  case k_nil1:
+    (void) snprintf(p_buf, buf_len, "%s", opname);
+    break;
+  case k_acc:
+    (void) snprintf(p_buf, buf_len, "%s A", opname);
+    break;
+  case k_imm:
+    (void) snprintf(p_buf, buf_len, "%s #$%.2"PRIX8, opname, operand1);
+    break;
+  case k_zpg:
+    (void) snprintf(p_buf, buf_len, "%s $%.2"PRIX8, opname, operand1);
+    break;
+  case k_abs:
+    (void) snprintf(p_buf, buf_len, "%s $%.4"PRIX16, opname, addr);
+    break;
+  case k_zpx:
+    (void) snprintf(p_buf, buf_len, "%s $%.2"PRIX8",X", opname, operand1);
+    break;
+  case k_zpy:
+    (void) snprintf(p_buf, buf_len, "%s $%.2"PRIX8",Y", opname, operand1);
+    break;
+  case k_abx:
+    (void) snprintf(p_buf, buf_len, "%s $%.4"PRIX16",X", opname, addr);
+    break;
+  case k_aby:
+    (void) snprintf(p_buf, buf_len, "%s $%.4"PRIX16",Y", opname, addr);
+    break;
+  case k_idx:
+    (void) snprintf(p_buf, buf_len, "%s ($%.2"PRIX8",X)", opname, operand1);
+    break;
+  case k_idy:
+    (void) snprintf(p_buf, buf_len, "%s ($%.2"PRIX8"),Y", opname, operand1);
+    break;
+  case k_ind:
+    (void) snprintf(p_buf, buf_len, "%s ($%.4"PRIX16")", opname, addr);
+    break;
+  case k_rel:
+    addr = (reg_pc + 2 + (int8_t) operand1);
+    (void) snprintf(p_buf, buf_len, "%s $%.4"PRIX16, opname, addr);
+    break;
+  case k_iax:
+    (void) snprintf(p_buf, buf_len, "%s ($%.4"PRIX16",X)", opname, addr);
+    break;
+  case k_id:
+    (void) snprintf(p_buf, buf_len, "%s ($%.2"PRIX8")", opname, operand1);
+    break;
+  case 0:
+    (void) snprintf(p_buf, buf_len, "%s: $%.2"PRIX8, opname, opcode);
+    break;
+  default:
+    assert(0);
+    break;
+  }
+}
+
+void
+defs_6502_format_flags(char* p_buf, uint8_t reg_flags) {
+  (void) memset(p_buf, ' ', 8);
+  p_buf[8] = '\0';
+  if (reg_flags & (1 << k_flag_carry)) {
+    p_buf[0] = 'C';
+  }
+  if (reg_flags & (1 << k_flag_zero)) {
+    p_buf[1] = 'Z';
+  }
+  if (reg_flags & (1 << k_flag_interrupt)) {
+    p_buf[2] = 'I';
+  }
+  if (reg_flags & (1 << k_flag_decimal)) {
+    p_buf[3] = 'D';
+  }
+  p_buf[5] = '1';
+  if (reg_flags & (1 << k_flag_overflow)) {
+    p_buf[6] = 'O';
+  }
+  if (reg_flags & (1 << k_flag_negative)) {
+    p_buf[7] = 'N';
+  }
+}
@@ -1,6 +1,7 @@
 #ifndef BEEBJIT_DEFS_6502_H
 #define BEEBJIT_DEFS_6502_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 enum {
@@ -175,4 +176,16 @@ uint8_t* defs_6502_get_65c12_opmode_map();
 uint8_t* defs_6502_get_65c12_opcycles_map();
 uint8_t* defs_6502_get_65c12_opmem_map();
 
+/* Disassembles one instruction, e.g. "LDA ($70),Y". */
+void defs_6502_format_opcode(char* p_buf,
+                             size_t buf_len,
+                             uint8_t optype,
+                             uint8_t opmode,
+                             uint8_t opcode,
+                             uint8_t operand1,
+                             uint8_t operand2,
+                             uint16_t reg_pc);
+/* Writes 8 characters plus a terminator, e.g. "CZ   1 N". */
+void defs_6502_format_flags(char* p_buf, uint8_t reg_flags);
+
 #endif /* BEEBJIT_DEFS_6502_H */
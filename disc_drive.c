@@ -8,6 +8,7 @@
 #include "util.h"
 
 #include <assert.h>
+#include <string.h>
 
 enum {
   /* My Chinon drive holds the index pulse low for about 4ms. */
@@ -31,6 +32,8 @@ struct disc_drive_struct {
   struct disc_struct* p_discs[k_disc_max_discs_per_drive + 1];
   uint32_t discs_added;
   int is_40_track;
+  /* Disc contents are not in checkpoints, so note if they have changed. */
+  int has_written;
 
   /* State of the drive. */
   uint32_t disc_index;
@@ -43,6 +46,14 @@ struct disc_drive_struct {
   uint32_t head_position;
   /* Extra precision for head position, needed for MFM. */
   uint32_t pulse_position;
+
+  /* While the controller has no use for the pulses, the timer only fires at
+   * the index pulse edges and the head position is worked out on demand.
+   */
+  int is_coast_requested;
+  int is_coasting;
+  uint32_t coast_start_position;
+  uint32_t coast_target_position;
 };
 
 struct disc_struct*
@@ -98,6 +109,91 @@ disc_drive_get_track_length(struct disc_drive_struct* p_drive) {
   return track_length;
 }
 
+static uint32_t
+disc_drive_get_index_end_position(uint32_t track_length) {
+  /* The first head position outside the index pulse. */
+  double index_end = (track_length * (k_disc_index_ms / (double) 200));
+  uint32_t head_position = (uint32_t) index_end;
+
+  if (head_position < index_end) {
+    head_position++;
+  }
+  return head_position;
+}
+
+static uint32_t
+disc_drive_get_coast_position(struct disc_drive_struct* p_drive,
+                              int64_t* p_ticks) {
+  /* The callback for position p would run (time(target) - time(p)) ticks
+   * before the one for the target. Find the first position whose callback
+   * hasn't run yet, which is the current head position.
+   */
+  uint32_t track_length = disc_drive_get_track_length(p_drive);
+  uint32_t target = p_drive->coast_target_position;
+  int64_t ticks_to_target = timing_get_timer_value(p_drive->p_timing,
+                                                   p_drive->timer_id);
+  int64_t target_ticks = disc_get_time_for_position(track_length, target, 0);
+  uint32_t low = p_drive->coast_start_position;
+  uint32_t high = target;
+
+  assert(p_drive->is_coasting);
+  assert(ticks_to_target >= 0);
+
+  while (low < high) {
+    uint32_t mid = ((low + high) / 2);
+    int64_t mid_ticks = disc_get_time_for_position(track_length, mid, 0);
+    if ((ticks_to_target - (target_ticks - mid_ticks)) < 0) {
+      low = (mid + 1);
+    } else {
+      high = mid;
+    }
+  }
+
+  if (p_ticks != NULL) {
+    *p_ticks = (ticks_to_target -
+                (target_ticks -
+                 disc_get_time_for_position(track_length, low, 0)));
+  }
+  return low;
+}
+
+static void
+disc_drive_coast_catch_up(struct disc_drive_struct* p_drive) {
+  uint32_t head_position;
+
+  if (!p_drive->is_coasting) {
+    return;
+  }
+  head_position = disc_drive_get_coast_position(p_drive, NULL);
+  if (head_position == disc_drive_get_track_length(p_drive)) {
+    head_position = 0;
+  }
+  p_drive->head_position = head_position;
+}
+
+void
+disc_drive_coast_to_index(struct disc_drive_struct* p_drive) {
+  p_drive->is_coast_requested = 1;
+}
+
+void
+disc_drive_stop_coasting(struct disc_drive_struct* p_drive) {
+  uint32_t head_position;
+  int64_t ticks;
+
+  if (!p_drive->is_coasting) {
+    return;
+  }
+  head_position = disc_drive_get_coast_position(p_drive, &ticks);
+  if (head_position == disc_drive_get_track_length(p_drive)) {
+    head_position = 0;
+  }
+  p_drive->head_position = head_position;
+  p_drive->is_coasting = 0;
+  /* Resume per-byte callbacks exactly in phase. */
+  (void) timing_set_timer_value(p_drive->p_timing, p_drive->timer_id, ticks);
+}
+
 uint32_t
 disc_drive_get_quasi_random_pulses(struct disc_drive_struct* p_drive) {
   uint64_t ticks = timing_get_total_timer_ticks(p_drive->p_timing);
@@ -121,9 +217,23 @@ disc_drive_timer_callback(void* p) {
   struct disc_struct* p_disc = disc_drive_get_disc(p_drive);
   uint32_t track = p_drive->track;
   int is_side_upper = p_drive->is_side_upper;
-  uint32_t head_position = p_drive->head_position;
+  uint32_t head_position;
   uint32_t pulse_position = p_drive->pulse_position;
 
+  if (p_drive->is_coasting) {
+    /* Arrived at the index pulse edge. */
+    head_position = p_drive->coast_target_position;
+    if (head_position == disc_drive_get_track_length(p_drive)) {
+      head_position = 0;
+      if (p_disc != NULL) {
+        disc_flush_writes(p_disc);
+      }
+    }
+    p_drive->head_position = head_position;
+    p_drive->is_coasting = 0;
+  }
+  head_position = p_drive->head_position;
+
   if (p_disc != NULL) {
     pulses = disc_read_pulses(p_disc, is_side_upper, track, head_position);
   }
@@ -151,6 +261,7 @@ disc_drive_timer_callback(void* p) {
     pulses = disc_drive_get_quasi_random_pulses(p_drive);
   }
 
+  p_drive->is_coast_requested = 0;
   if (p_drive->p_pulses_callback != NULL) {
     p_drive->p_pulses_callback(p_drive->p_pulses_callback_object,
                                pulses,
@@ -179,9 +290,34 @@ disc_drive_timer_callback(void* p) {
     head_position++;
   }
 
-  next_ticks = disc_get_time_for_position(track_length,
-                                          head_position,
-                                          pulse_position);
+  /* If the controller is idle, skip ahead to the next index pulse edge. Only
+   * the index pulse is observable, and the head position is derived from the
+   * timer if anyone asks.
+   */
+  if (p_drive->is_coast_requested &&
+      !p_drive->is_32us_mode &&
+      (pulse_position == 0) &&
+      (head_position < track_length)) {
+    uint32_t coast_target = disc_drive_get_index_end_position(track_length);
+    if (head_position > coast_target) {
+      coast_target = track_length;
+    }
+    if (head_position < coast_target) {
+      p_drive->is_coasting = 1;
+      p_drive->coast_start_position = head_position;
+      p_drive->coast_target_position = coast_target;
+    }
+  }
+
+  if (p_drive->is_coasting) {
+    next_ticks = disc_get_time_for_position(track_length,
+                                            p_drive->coast_target_position,
+                                            0);
+  } else {
+    next_ticks = disc_get_time_for_position(track_length,
+                                            head_position,
+                                            pulse_position);
+  }
 
   if (head_position == track_length) {
     assert(pulse_position == 0);
@@ -267,6 +403,33 @@ disc_drive_power_on_reset(struct disc_drive_struct* p_drive) {
   }
 }
 
+void
+disc_drive_save_checkpoint(struct disc_drive_struct* p_drive,
+                           struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_drive, sizeof(struct disc_drive_struct));
+  timing_save_timer(p_drive->p_timing, p_drive->timer_id, p_buf);
+}
+
+void
+disc_drive_load_checkpoint(struct disc_drive_struct* p_drive,
+                           struct util_buffer* p_buf) {
+  /* The loaded discs are a user "physical" choice and are kept. Their
+   * contents are not part of the checkpoint.
+   */
+  struct disc_drive_struct saved_drive = *p_drive;
+
+  util_buffer_get_chunk(p_buf, p_drive, sizeof(struct disc_drive_struct));
+  (void) memcpy(&p_drive->p_discs[0],
+                &saved_drive.p_discs[0],
+                sizeof(p_drive->p_discs));
+  p_drive->discs_added = saved_drive.discs_added;
+  p_drive->has_written = saved_drive.has_written;
+  if (p_drive->disc_index >= p_drive->discs_added) {
+    p_drive->disc_index = 0;
+  }
+  timing_load_timer(p_drive->p_timing, p_drive->timer_id, p_buf);
+}
+
 void
 disc_drive_add_disc(struct disc_drive_struct* p_drive,
                     struct disc_struct* p_disc) {
@@ -303,8 +466,11 @@ disc_drive_cycle_disc(struct disc_drive_struct* p_drive) {
    */
   struct disc_struct* p_disc;
   const char* p_file_name;
+  double fraction;
   uint32_t disc_index = p_drive->disc_index;
-  double fraction = disc_drive_get_position_fraction(p_drive);
+
+  disc_drive_stop_coasting(p_drive);
+  fraction = disc_drive_get_position_fraction(p_drive);
 
   if (disc_index == p_drive->discs_added) {
     disc_index = 0;
@@ -362,6 +528,7 @@ disc_drive_is_index_pulse(struct disc_drive_struct* p_drive) {
   /* EMU: the 8271 datasheet says that the index pulse must be held for over
    * 0.5us. Most drives are in the milisecond range.
    */
+  disc_drive_coast_catch_up(p_drive);
   track_length = disc_drive_get_track_length(p_drive);
   if (p_drive->head_position <
           (track_length * (k_disc_index_ms / (double) 200))) {
@@ -372,9 +539,15 @@ disc_drive_is_index_pulse(struct disc_drive_struct* p_drive) {
 
 uint32_t
 disc_drive_get_head_position(struct disc_drive_struct* p_drive) {
+  disc_drive_coast_catch_up(p_drive);
   return p_drive->head_position;
 }
 
+int
+disc_drive_has_written(struct disc_drive_struct* p_drive) {
+  return p_drive->has_written;
+}
+
 int
 disc_drive_is_write_protect(struct disc_drive_struct* p_drive) {
   struct disc_struct* p_disc = disc_drive_get_disc(p_drive);
@@ -407,6 +580,7 @@ disc_drive_check_track_needs_write(struct disc_drive_struct* p_drive) {
 
 void
 disc_drive_stop_spinning(struct disc_drive_struct* p_drive) {
+  disc_drive_stop_coasting(p_drive);
   disc_drive_check_track_needs_write(p_drive);
 
   (void) timing_stop_timer(p_drive->p_timing, p_drive->timer_id);
@@ -414,7 +588,10 @@ disc_drive_stop_spinning(struct disc_drive_struct* p_drive) {
 
 void
 disc_drive_select_side(struct disc_drive_struct* p_drive, int side) {
-  double fraction = disc_drive_get_position_fraction(p_drive);
+  double fraction;
+
+  disc_drive_stop_coasting(p_drive);
+  fraction = disc_drive_get_position_fraction(p_drive);
   disc_drive_check_track_needs_write(p_drive);
 
   p_drive->is_side_upper = side;
@@ -424,7 +601,10 @@ disc_drive_select_side(struct disc_drive_struct* p_drive, int side) {
 
 void
 disc_drive_select_track(struct disc_drive_struct* p_drive, int32_t track) {
-  double fraction = disc_drive_get_position_fraction(p_drive);
+  double fraction;
+
+  disc_drive_stop_coasting(p_drive);
+  fraction = disc_drive_get_position_fraction(p_drive);
   disc_drive_check_track_needs_write(p_drive);
 
   if (track < 0) {
@@ -457,7 +637,10 @@ disc_drive_write_pulses(struct disc_drive_struct* p_drive, uint32_t pulses) {
   struct disc_struct* p_disc = disc_drive_get_disc(p_drive);
   int is_side_upper = p_drive->is_side_upper;
   uint32_t track = p_drive->track;
-  uint32_t head_position = p_drive->head_position;
+  uint32_t head_position;
+
+  assert(!p_drive->is_coasting);
+  head_position = p_drive->head_position;
 
   if (p_disc == NULL) {
     return;
@@ -468,6 +651,8 @@ disc_drive_write_pulses(struct disc_drive_struct* p_drive, uint32_t pulses) {
     return;
   }
 
+  p_drive->has_written = 1;
+
   if (p_drive->is_32us_mode) {
     uint32_t read_pulses = disc_read_pulses(p_disc,
                                             is_side_upper,
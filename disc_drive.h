@@ -8,6 +8,7 @@ struct disc_drive_struct;
 struct bbc_options;
 struct disc_struct;
 struct timing_struct;
+struct util_buffer;
 
 struct disc_drive_struct* disc_drive_create(uint32_t id,
                                             struct timing_struct* p_timing,
@@ -22,8 +23,18 @@ void disc_drive_set_pulses_callback(struct disc_drive_struct* p_drive,
  * This selects 32us worth (16x 2us each), suitable for MFM.
  */
 void disc_drive_set_32us_mode(struct disc_drive_struct* p_drive, int on);
+/* Called from the pulses callback by a controller with no use for pulses,
+ * other than seeing the index pulse. The drive then only calls back at index
+ * pulse edges, until the controller calls disc_drive_stop_coasting().
+ */
+void disc_drive_coast_to_index(struct disc_drive_struct* p_drive);
+void disc_drive_stop_coasting(struct disc_drive_struct* p_drive);
 
 void disc_drive_power_on_reset(struct disc_drive_struct* p_drive);
+void disc_drive_save_checkpoint(struct disc_drive_struct* p_drive,
+                                struct util_buffer* p_buf);
+void disc_drive_load_checkpoint(struct disc_drive_struct* p_drive,
+                                struct util_buffer* p_buf);
 
 void disc_drive_add_disc(struct disc_drive_struct* p_drive,
                          struct disc_struct* p_disc);
@@ -36,6 +47,7 @@ uint32_t disc_drive_get_track(struct disc_drive_struct* p_drive);
 int disc_drive_is_index_pulse(struct disc_drive_struct* p_drive);
 uint32_t disc_drive_get_head_position(struct disc_drive_struct* p_drive);
 int disc_drive_is_write_protect(struct disc_drive_struct* p_drive);
+int disc_drive_has_written(struct disc_drive_struct* p_drive);
 
 uint32_t disc_drive_get_quasi_random_pulses(struct disc_drive_struct* p_drive);
 
@@ -10,6 +10,13 @@
 #include <stdlib.h>
 #include <string.h>
 
+struct expression_op {
+  int32_t opcode;
+  int64_t value;
+  expression_var_read_func_t p_read_func;
+  expression_var_write_func_t p_write_func;
+};
+
 struct expression_struct {
   expression_var_read_lookup_func_t p_var_read_lookup_func;
   expression_var_write_lookup_func_t p_var_write_lookup_func;
@@ -17,6 +24,14 @@ struct expression_struct {
   char* p_expr_str;
   struct util_tree_struct* p_tree;
   struct util_tree_node_struct* p_current_node;
+
+  /* The tree is compiled down to a flat stack machine program for
+   * execution.
+   */
+  struct expression_op* p_ops;
+  uint32_t num_ops;
+  uint32_t max_ops;
+  int64_t* p_stack;
 };
 
 struct expression_variable_funcs_struct {
@@ -48,6 +63,29 @@ enum {
   k_expression_node_assign = 21,
 };
 
+enum {
+  k_expression_op_const = 1,
+  k_expression_op_read = 2,
+  k_expression_op_read_const_index = 3,
+  k_expression_op_write = 4,
+  k_expression_op_drop = 5,
+  k_expression_op_bool = 6,
+  k_expression_op_jump_if_zero = 7,
+  k_expression_op_jump_if_non_zero = 8,
+  k_expression_op_plus = 9,
+  k_expression_op_minus = 10,
+  k_expression_op_multiply = 11,
+  k_expression_op_divide = 12,
+  k_expression_op_equal = 13,
+  k_expression_op_not_equal = 14,
+  k_expression_op_less_than = 15,
+  k_expression_op_less_than_equal = 16,
+  k_expression_op_greater_than = 17,
+  k_expression_op_greater_than_equal = 18,
+  k_expression_op_bitwise_and = 19,
+  k_expression_op_bitwise_or = 20,
+};
+
 struct expression_struct*
 expression_create(expression_var_read_lookup_func_t p_var_read_lookup_func,
                   expression_var_write_lookup_func_t p_var_write_lookup_func,
@@ -66,6 +104,8 @@ void
 expression_destroy(struct expression_struct* p_expression) {
   util_free(p_expression->p_expr_str);
   util_tree_free(p_expression->p_tree);
+  util_free(p_expression->p_ops);
+  util_free(p_expression->p_stack);
   util_free(p_expression);
 }
 
@@ -76,6 +116,12 @@ expression_clear(struct expression_struct* p_expression) {
   util_tree_free(p_expression->p_tree);
   p_expression->p_tree = util_tree_alloc();
   p_expression->p_current_node = NULL;
+  util_free(p_expression->p_ops);
+  p_expression->p_ops = NULL;
+  p_expression->num_ops = 0;
+  p_expression->max_ops = 0;
+  util_free(p_expression->p_stack);
+  p_expression->p_stack = NULL;
 }
 
 static int32_t
@@ -304,6 +350,246 @@ expression_process_token(struct expression_struct* p_expression,
   p_expression->p_current_node = p_new_node;
 }
 
+static void expression_compile_node(struct expression_struct* p_expression,
+                                    struct util_tree_node_struct* p_node);
+
+static inline int64_t
+expression_do_binary_op(int32_t opcode, int64_t lhs, int64_t rhs) {
+  int64_t ret = 0;
+  switch (opcode) {
+  case k_expression_op_plus: ret = (lhs + rhs); break;
+  case k_expression_op_minus: ret = (lhs - rhs); break;
+  case k_expression_op_multiply: ret = (lhs * rhs); break;
+  case k_expression_op_divide: ret = (lhs / rhs); break;
+  case k_expression_op_equal: ret = (lhs == rhs); break;
+  case k_expression_op_not_equal: ret = (lhs != rhs); break;
+  case k_expression_op_less_than: ret = (lhs < rhs); break;
+  case k_expression_op_less_than_equal: ret = (lhs <= rhs); break;
+  case k_expression_op_greater_than: ret = (lhs > rhs); break;
+  case k_expression_op_greater_than_equal: ret = (lhs >= rhs); break;
+  case k_expression_op_bitwise_and: ret = (lhs & rhs); break;
+  case k_expression_op_bitwise_or: ret = (lhs | rhs); break;
+  default: assert(0); break;
+  }
+  return ret;
+}
+
+static struct expression_op*
+expression_add_op(struct expression_struct* p_expression,
+                  int32_t opcode,
+                  int64_t value) {
+  struct expression_op* p_op;
+  assert(p_expression->num_ops < p_expression->max_ops);
+  p_op = &p_expression->p_ops[p_expression->num_ops++];
+  p_op->opcode = opcode;
+  p_op->value = value;
+  p_op->p_read_func = NULL;
+  p_op->p_write_func = NULL;
+  return p_op;
+}
+
+static int
+expression_get_const_since(struct expression_struct* p_expression,
+                           uint32_t op_index,
+                           int64_t* p_value) {
+  struct expression_op* p_op;
+  if ((op_index + 1) != p_expression->num_ops) {
+    return 0;
+  }
+  p_op = &p_expression->p_ops[op_index];
+  if (p_op->opcode != k_expression_op_const) {
+    return 0;
+  }
+  *p_value = p_op->value;
+  return 1;
+}
+
+static void
+expression_compile_var_index(struct expression_struct* p_expression,
+                             struct util_tree_node_struct* p_node) {
+  if (util_tree_node_get_num_children(p_node) == 1) {
+    expression_compile_node(p_expression, util_tree_node_get_child(p_node, 0));
+  } else {
+    (void) expression_add_op(p_expression, k_expression_op_const, 0);
+  }
+}
+
+static void
+expression_compile_node(struct expression_struct* p_expression,
+                        struct util_tree_node_struct* p_node) {
+  struct expression_variable_funcs_struct* p_funcs;
+  struct expression_op* p_op;
+  uint32_t lhs_index;
+  uint32_t rhs_index;
+  int is_and;
+  int64_t lhs;
+  int64_t rhs;
+  int32_t jump_index = -1;
+  int32_t opcode = 0;
+  int32_t type = util_tree_node_get_type(p_node);
+  uint32_t num_children = util_tree_node_get_num_children(p_node);
+  struct util_tree_node_struct* p_child_node_1 = NULL;
+  struct util_tree_node_struct* p_child_node_2 = NULL;
+
+  if (num_children > 0) {
+    p_child_node_1 = util_tree_node_get_child(p_node, 0);
+  }
+  if (num_children > 1) {
+    p_child_node_2 = util_tree_node_get_child(p_node, 1);
+  }
+
+  switch (type) {
+  case k_expression_node_integer:
+    (void) expression_add_op(p_expression,
+                             k_expression_op_const,
+                             util_tree_node_get_int_value(p_node));
+    return;
+  case k_expression_node_var:
+    p_funcs = (struct expression_variable_funcs_struct*)
+        util_tree_node_get_object_value(p_node);
+    lhs_index = p_expression->num_ops;
+    expression_compile_var_index(p_expression, p_node);
+    if (p_funcs->p_var_read_func == NULL) {
+      /* The index is still evaluated, in case it has side effects. */
+      (void) expression_add_op(p_expression, k_expression_op_drop, 0);
+      (void) expression_add_op(p_expression, k_expression_op_const, 0);
+    } else if (expression_get_const_since(p_expression, lhs_index, &lhs)) {
+      p_expression->num_ops = lhs_index;
+      p_op = expression_add_op(p_expression,
+                               k_expression_op_read_const_index,
+                               lhs);
+      p_op->p_read_func = p_funcs->p_var_read_func;
+    } else {
+      p_op = expression_add_op(p_expression, k_expression_op_read, 0);
+      p_op->p_read_func = p_funcs->p_var_read_func;
+    }
+    return;
+  case k_expression_node_paren_close:
+  case k_expression_node_square_close:
+    if (num_children == 1) {
+      expression_compile_node(p_expression, p_child_node_1);
+      return;
+    }
+    break;
+  case k_expression_node_assign:
+    if (num_children != 2) {
+      break;
+    }
+    expression_compile_node(p_expression, p_child_node_2);
+    if (util_tree_node_get_type(p_child_node_1) != k_expression_node_var) {
+      return;
+    }
+    p_funcs = (struct expression_variable_funcs_struct*)
+        util_tree_node_get_object_value(p_child_node_1);
+    expression_compile_var_index(p_expression, p_child_node_1);
+    p_op = expression_add_op(p_expression, k_expression_op_write, 0);
+    p_op->p_write_func = p_funcs->p_var_write_func;
+    return;
+  case k_expression_node_logical_and:
+  case k_expression_node_logical_or:
+    if (num_children != 2) {
+      break;
+    }
+    is_and = (type == k_expression_node_logical_and);
+    lhs_index = p_expression->num_ops;
+    expression_compile_node(p_expression, p_child_node_1);
+    if (expression_get_const_since(p_expression, lhs_index, &lhs)) {
+      /* Either the left hand side decides, or the right hand side does. */
+      p_expression->num_ops = lhs_index;
+      if (is_and == !lhs) {
+        (void) expression_add_op(p_expression, k_expression_op_const, !!lhs);
+        return;
+      }
+    } else {
+      jump_index = p_expression->num_ops;
+      opcode = k_expression_op_jump_if_non_zero;
+      if (is_and) {
+        opcode = k_expression_op_jump_if_zero;
+      }
+      (void) expression_add_op(p_expression, opcode, 0);
+    }
+    rhs_index = p_expression->num_ops;
+    expression_compile_node(p_expression, p_child_node_2);
+    if (expression_get_const_since(p_expression, rhs_index, &rhs)) {
+      p_expression->p_ops[rhs_index].value = !!rhs;
+    } else {
+      (void) expression_add_op(p_expression, k_expression_op_bool, 0);
+    }
+    if (jump_index != -1) {
+      p_expression->p_ops[jump_index].value = p_expression->num_ops;
+    }
+    return;
+  case k_expression_node_plus: opcode = k_expression_op_plus; break;
+  case k_expression_node_minus: opcode = k_expression_op_minus; break;
+  case k_expression_node_multiply: opcode = k_expression_op_multiply; break;
+  case k_expression_node_divide: opcode = k_expression_op_divide; break;
+  case k_expression_node_equal: opcode = k_expression_op_equal; break;
+  case k_expression_node_not_equal: opcode = k_expression_op_not_equal; break;
+  case k_expression_node_less_than: opcode = k_expression_op_less_than; break;
+  case k_expression_node_less_than_equal:
+    opcode = k_expression_op_less_than_equal;
+    break;
+  case k_expression_node_greater_than:
+    opcode = k_expression_op_greater_than;
+    break;
+  case k_expression_node_greater_than_equal:
+    opcode = k_expression_op_greater_than_equal;
+    break;
+  case k_expression_node_bitwise_and:
+    opcode = k_expression_op_bitwise_and;
+    break;
+  case k_expression_node_bitwise_or: opcode = k_expression_op_bitwise_or; break;
+  default:
+    /* Malformed expression, e.g. an unclosed bracket. */
+    break;
+  }
+
+  if ((opcode == 0) || (num_children != 2)) {
+    (void) expression_add_op(p_expression, k_expression_op_const, 0);
+    return;
+  }
+
+  lhs_index = p_expression->num_ops;
+  expression_compile_node(p_expression, p_child_node_1);
+  rhs_index = p_expression->num_ops;
+  expression_compile_node(p_expression, p_child_node_2);
+  /* Fold the operator away if both sides are constants. Division by zero is
+   * left for run time.
+   */
+  if ((rhs_index == (lhs_index + 1)) &&
+      expression_get_const_since(p_expression, rhs_index, &rhs) &&
+      (p_expression->p_ops[lhs_index].opcode == k_expression_op_const) &&
+      ((opcode != k_expression_op_divide) || (rhs != 0))) {
+    lhs = p_expression->p_ops[lhs_index].value;
+    p_expression->num_ops = lhs_index;
+    (void) expression_add_op(p_expression,
+                             k_expression_op_const,
+                             expression_do_binary_op(opcode, lhs, rhs));
+    return;
+  }
+  (void) expression_add_op(p_expression, opcode, 0);
+}
+
+static void
+expression_compile(struct expression_struct* p_expression) {
+  struct util_tree_node_struct* p_node =
+      util_tree_get_root(p_expression->p_tree);
+  uint32_t tree_size = util_tree_get_tree_size(p_expression->p_tree);
+
+  if (p_node == NULL) {
+    return;
+  }
+
+  /* Each node emits at most two ops of its own, and pushes at most one value
+   * that is still live when its parent runs.
+   */
+  p_expression->max_ops = ((tree_size * 2) + 1);
+  p_expression->p_ops =
+      util_mallocz(p_expression->max_ops * sizeof(struct expression_op));
+  p_expression->p_stack = util_mallocz((tree_size + 1) * sizeof(int64_t));
+  expression_compile_node(p_expression, p_node);
+}
+
 int64_t
 expression_parse(struct expression_struct* p_expression,
                  const char* p_expr_str) {
@@ -378,177 +664,9 @@ expression_parse(struct expression_struct* p_expression,
     }
   }
 
-  return 0;
-}
-
-static int64_t
-expression_execute_node(struct expression_struct* p_expression,
-                        struct util_tree_node_struct* p_node) {
-  struct expression_variable_funcs_struct* p_funcs;
-  expression_var_read_func_t p_read_func;
-  expression_var_write_func_t p_write_func;
-  int64_t lhs;
-  int64_t rhs;
-  uint32_t index;
-  int64_t ret = 0;
-  int32_t type = util_tree_node_get_type(p_node);
-  uint32_t num_children = util_tree_node_get_num_children(p_node);
-  struct util_tree_node_struct* p_child_node_1 = NULL;
-  struct util_tree_node_struct* p_child_node_2 = NULL;
-
-  if (num_children > 0) {
-    p_child_node_1 = util_tree_node_get_child(p_node, 0);
-  }
-  if (num_children > 1) {
-    p_child_node_2 = util_tree_node_get_child(p_node, 1);
-  }
-
-  switch (type) {
-  case k_expression_node_integer:
-    ret = util_tree_node_get_int_value(p_node);
-    break;
-  case k_expression_node_var:
-    index = 0;
-    if (num_children == 1) {
-      index = expression_execute_node(p_expression, p_child_node_1);
-    }
-    p_funcs = (struct expression_variable_funcs_struct*)
-        util_tree_node_get_object_value(p_node);
-    p_read_func = p_funcs->p_var_read_func;
-    if (p_read_func != NULL) {
-      ret = p_read_func(p_expression->p_variable_object, index);
-    }
-    break;
-  case k_expression_node_plus:
-    if (num_children == 2) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-      ret += expression_execute_node(p_expression, p_child_node_2);
-    }
-    break;
-  case k_expression_node_minus:
-    if (num_children == 2) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-      ret -= expression_execute_node(p_expression, p_child_node_2);
-    }
-    break;
-  case k_expression_node_multiply:
-    if (num_children == 2) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-      ret *= expression_execute_node(p_expression, p_child_node_2);
-    }
-    break;
-  case k_expression_node_divide:
-    if (num_children == 2) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-      ret /= expression_execute_node(p_expression, p_child_node_2);
-    }
-    break;
-  case k_expression_node_equal:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = expression_execute_node(p_expression, p_child_node_2);
-      ret = (lhs == rhs);
-    }
-    break;
-  case k_expression_node_not_equal:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = expression_execute_node(p_expression, p_child_node_2);
-      ret = (lhs != rhs);
-    }
-    break;
-  case k_expression_node_less_than:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = expression_execute_node(p_expression, p_child_node_2);
-      ret = (lhs < rhs);
-    }
-    break;
-  case k_expression_node_less_than_equal:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = expression_execute_node(p_expression, p_child_node_2);
-      ret = (lhs <= rhs);
-    }
-    break;
-  case k_expression_node_greater_than:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = expression_execute_node(p_expression, p_child_node_2);
-      ret = (lhs > rhs);
-    }
-    break;
-  case k_expression_node_greater_than_equal:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = expression_execute_node(p_expression, p_child_node_2);
-      ret = (lhs >= rhs);
-    }
-    break;
-  case k_expression_node_logical_and:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = 0;
-      if (lhs) {
-        rhs = expression_execute_node(p_expression, p_child_node_2);
-      }
-      ret = (lhs && rhs);
-    }
-    break;
-  case k_expression_node_logical_or:
-    if (num_children == 2) {
-      lhs = expression_execute_node(p_expression, p_child_node_1);
-      rhs = 0;
-      if (!lhs) {
-        rhs = expression_execute_node(p_expression, p_child_node_2);
-      }
-      ret = (lhs || rhs);
-    }
-    break;
-  case k_expression_node_bitwise_and:
-    if (num_children == 2) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-      ret &= expression_execute_node(p_expression, p_child_node_2);
-    }
-    break;
-  case k_expression_node_bitwise_or:
-    if (num_children == 2) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-      ret |= expression_execute_node(p_expression, p_child_node_2);
-    }
-    break;
-  case k_expression_node_paren_close:
-  case k_expression_node_square_close:
-    if (num_children == 1) {
-      ret = expression_execute_node(p_expression, p_child_node_1);
-    }
-    break;
-  case k_expression_node_assign:
-    if (num_children != 2) {
-      break;
-    }
-    rhs = expression_execute_node(p_expression, p_child_node_2);
-    ret = rhs;
-    if (util_tree_node_get_type(p_child_node_1) == k_expression_node_var) {
-      index = 0;
-      if (util_tree_node_get_num_children(p_child_node_1) == 1) {
-        struct util_tree_node_struct* p_index_node =
-            util_tree_node_get_child(p_child_node_1, 0);
-        index = expression_execute_node(p_expression, p_index_node);
-      }
-      p_funcs = (struct expression_variable_funcs_struct*)
-          util_tree_node_get_object_value(p_child_node_1);
-      p_write_func = p_funcs->p_var_write_func;
-      if (p_write_func != NULL) {
-        p_write_func(p_expression->p_variable_object, index, rhs);
-      }
-    }
-    break;
-  default:
-    assert(0);
-  }
+  expression_compile(p_expression);
 
-  return ret;
+  return 0;
 }
 
 const char*
@@ -563,15 +681,71 @@ expression_get_tree_size(struct expression_struct* p_expression) {
 
 int64_t
 expression_execute(struct expression_struct* p_expression) {
-  struct util_tree_node_struct* p_node;
-  if (p_expression->p_tree == NULL) {
+  uint32_t i_op;
+  int64_t value;
+  struct expression_op* p_ops = p_expression->p_ops;
+  uint32_t num_ops = p_expression->num_ops;
+  void* p_variable_object = p_expression->p_variable_object;
+  int64_t* p_stack = p_expression->p_stack;
+  /* The top of stack is cached in value; p_top points to the slot below it. */
+  int64_t* p_top = p_stack;
+
+  if (num_ops == 0) {
     return 0;
   }
-  p_node = util_tree_get_root(p_expression->p_tree);
-  if (p_node == NULL) {
-    return 0;
+
+  value = 0;
+  i_op = 0;
+  while (i_op < num_ops) {
+    struct expression_op* p_op = &p_ops[i_op++];
+    switch (p_op->opcode) {
+    case k_expression_op_const:
+      *p_top++ = value;
+      value = p_op->value;
+      break;
+    case k_expression_op_read:
+      value = p_op->p_read_func(p_variable_object, (uint32_t) value);
+      break;
+    case k_expression_op_read_const_index:
+      *p_top++ = value;
+      value = p_op->p_read_func(p_variable_object, (uint32_t) p_op->value);
+      break;
+    case k_expression_op_write:
+      /* Stack is: value to write, index. The value written is the result. */
+      if (p_op->p_write_func != NULL) {
+        p_op->p_write_func(p_variable_object, (uint32_t) value, p_top[-1]);
+      }
+      value = *--p_top;
+      break;
+    case k_expression_op_drop:
+      value = *--p_top;
+      break;
+    case k_expression_op_bool:
+      value = !!value;
+      break;
+    case k_expression_op_jump_if_zero:
+      if (value == 0) {
+        i_op = p_op->value;
+      } else {
+        value = *--p_top;
+      }
+      break;
+    case k_expression_op_jump_if_non_zero:
+      if (value != 0) {
+        value = 1;
+        i_op = p_op->value;
+      } else {
+        value = *--p_top;
+      }
+      break;
+    default:
+      value = expression_do_binary_op(p_op->opcode, *--p_top, value);
+      break;
+    }
   }
-  return expression_execute_node(p_expression, p_node);
+
+  assert(p_top == (p_stack + 1));
+  return value;
 }
 
 #include "test-expression.c"
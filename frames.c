@@ -0,0 +1,291 @@
+#include "frames.h"
+
+#include "log.h"
+#include "util.h"
+#include "util_compress.h"
+
+#include "os_channel.h"
+#include "os_thread.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <string.h>
+
+/* Frames are handed to a writer thread, which deltas, compresses and writes
+ * them while the next frame is being emulated. A zero length asks the thread
+ * to exit.
+ */
+struct frames_message {
+  uint32_t buffer_index;
+  uint32_t length;
+};
+
+struct frames_struct {
+  struct util_file* p_file;
+  uint32_t frame_size;
+  struct os_thread_struct* p_thread;
+  intptr_t handle_writer_read;
+  intptr_t handle_client_write;
+  intptr_t handle_client_read;
+  intptr_t handle_writer_write;
+  uint32_t* p_buffers[2];
+  uint32_t buffer_index;
+  int is_writer_busy;
+  /* Only touched by the writer thread. */
+  uint32_t* p_previous;
+  uint8_t* p_compress_buffer;
+  size_t compress_buffer_size;
+};
+
+static void
+frames_put_le32(uint8_t* p_buf, uint32_t val) {
+  p_buf[0] = (val & 0xFF);
+  p_buf[1] = ((val >> 8) & 0xFF);
+  p_buf[2] = ((val >> 16) & 0xFF);
+  p_buf[3] = (val >> 24);
+}
+
+struct frame_hashes_struct {
+  struct util_file* p_file;
+  int is_check;
+  uint32_t num_frames;
+};
+
+static void
+frames_write_frame(struct frames_struct* p_frames, uint32_t* p_pixels) {
+  uint8_t header[k_frames_chunk_header_size];
+  uint32_t i;
+  uint32_t* p_previous = p_frames->p_previous;
+  uint32_t num_pixels = (p_frames->frame_size / 4);
+  size_t stored_length = p_frames->compress_buffer_size;
+
+  /* Delta in place, keeping the new frame for next time. Mostly unchanged
+   * frames become mostly zeros, which compress to almost nothing.
+   */
+  for (i = 0; i < num_pixels; ++i) {
+    uint32_t pixel = p_pixels[i];
+    p_pixels[i] = (pixel ^ p_previous[i]);
+    p_previous[i] = pixel;
+  }
+
+  if (util_compress(&stored_length,
+                    (uint8_t*) p_pixels,
+                    p_frames->frame_size,
+                    p_frames->p_compress_buffer) != 0) {
+    util_bail("frame compression failed");
+  }
+
+  frames_put_le32(&header[0], p_frames->frame_size);
+  frames_put_le32(&header[4], (uint32_t) stored_length);
+  util_file_write(p_frames->p_file, &header[0], sizeof(header));
+  util_file_write(p_frames->p_file, p_frames->p_compress_buffer, stored_length);
+}
+
+static void*
+frames_writer_thread(void* p) {
+  struct frames_struct* p_frames = (struct frames_struct*) p;
+
+  while (1) {
+    struct frames_message message;
+    os_channel_read(p_frames->handle_writer_read, &message, sizeof(message));
+    if (message.length == 0) {
+      break;
+    }
+    frames_write_frame(p_frames, p_frames->p_buffers[message.buffer_index]);
+    os_channel_write(p_frames->handle_writer_write, &message, sizeof(message));
+  }
+
+  return NULL;
+}
+
+static void
+frames_wait_for_writer(struct frames_struct* p_frames) {
+  struct frames_message message;
+
+  if (!p_frames->is_writer_busy) {
+    return;
+  }
+  os_channel_read(p_frames->handle_client_read, &message, sizeof(message));
+  assert(message.buffer_index != p_frames->buffer_index);
+  p_frames->is_writer_busy = 0;
+}
+
+struct frames_struct*
+frames_create(const char* p_file_name, uint32_t width, uint32_t height) {
+  uint8_t header[k_frames_header_size];
+  struct util_file* p_file = util_file_try_open(p_file_name, 1, 1);
+  struct frames_struct* p_frames;
+  uint32_t frame_size = (width * height * 4);
+
+  if (p_file == NULL) {
+    return NULL;
+  }
+
+  (void) memset(&header[0], '\0', sizeof(header));
+  (void) memcpy(&header[0], FRAMES_MAGIC, sizeof(FRAMES_MAGIC));
+  frames_put_le32(&header[8], k_frames_version);
+  frames_put_le32(&header[12], width);
+  frames_put_le32(&header[16], height);
+  util_file_write(p_file, &header[0], sizeof(header));
+
+  p_frames = util_mallocz(sizeof(struct frames_struct));
+  p_frames->p_file = p_file;
+  p_frames->frame_size = frame_size;
+  p_frames->p_buffers[0] = util_malloc(frame_size);
+  p_frames->p_buffers[1] = util_malloc(frame_size);
+  p_frames->p_previous = util_mallocz(frame_size);
+  p_frames->compress_buffer_size = util_compress_bound(frame_size);
+  p_frames->p_compress_buffer = util_malloc(p_frames->compress_buffer_size);
+
+  os_channel_get_handles(&p_frames->handle_writer_read,
+                         &p_frames->handle_client_write,
+                         &p_frames->handle_client_read,
+                         &p_frames->handle_writer_write);
+  p_frames->p_thread = os_thread_create(frames_writer_thread, p_frames);
+
+  return p_frames;
+}
+
+void
+frames_destroy(struct frames_struct* p_frames) {
+  struct frames_message message;
+
+  frames_wait_for_writer(p_frames);
+
+  message.buffer_index = 0;
+  message.length = 0;
+  os_channel_write(p_frames->handle_client_write, &message, sizeof(message));
+  (void) os_thread_destroy(p_frames->p_thread);
+  os_channel_free_handles(p_frames->handle_writer_read,
+                          p_frames->handle_client_write,
+                          p_frames->handle_client_read,
+                          p_frames->handle_writer_write);
+
+  util_file_close(p_frames->p_file);
+  util_free(p_frames->p_buffers[0]);
+  util_free(p_frames->p_buffers[1]);
+  util_free(p_frames->p_previous);
+  util_free(p_frames->p_compress_buffer);
+  util_free(p_frames);
+}
+
+void
+frames_add(struct frames_struct* p_frames, const uint32_t* p_pixels) {
+  struct frames_message message;
+
+  /* The writer only ever has the other buffer, so copy first and then only
+   * block if the host can't compress as fast as frames are saved.
+   */
+  (void) memcpy(p_frames->p_buffers[p_frames->buffer_index],
+                p_pixels,
+                p_frames->frame_size);
+  frames_wait_for_writer(p_frames);
+
+  message.buffer_index = p_frames->buffer_index;
+  message.length = p_frames->frame_size;
+  os_channel_write(p_frames->handle_client_write, &message, sizeof(message));
+  p_frames->is_writer_busy = 1;
+
+  p_frames->buffer_index ^= 1;
+}
+
+struct frame_hashes_struct*
+frame_hashes_create(const char* p_file_name, int is_check) {
+  uint8_t header[k_frame_hashes_header_size];
+  struct frame_hashes_struct* p_hashes;
+  struct util_file* p_file;
+
+  if (is_check) {
+    p_file = util_file_try_read_open(p_file_name);
+  } else {
+    p_file = util_file_try_open(p_file_name, 1, 1);
+  }
+  if (p_file == NULL) {
+    return NULL;
+  }
+
+  if (is_check) {
+    if ((util_file_read(p_file, &header[0], sizeof(header)) !=
+            sizeof(header)) ||
+        memcmp(&header[0], FRAME_HASHES_MAGIC, sizeof(FRAME_HASHES_MAGIC))) {
+      util_bail("not a beebjit frame hashes file");
+    }
+    if (util_read_le32(&header[8]) != k_frame_hashes_version) {
+      util_bail("unsupported frame hashes version");
+    }
+  } else {
+    (void) memset(&header[0], '\0', sizeof(header));
+    (void) memcpy(&header[0], FRAME_HASHES_MAGIC, sizeof(FRAME_HASHES_MAGIC));
+    frames_put_le32(&header[8], k_frame_hashes_version);
+    util_file_write(p_file, &header[0], sizeof(header));
+  }
+
+  p_hashes = util_mallocz(sizeof(struct frame_hashes_struct));
+  p_hashes->p_file = p_file;
+  p_hashes->is_check = is_check;
+
+  return p_hashes;
+}
+
+void
+frame_hashes_destroy(struct frame_hashes_struct* p_hashes) {
+  if (p_hashes->is_check) {
+    uint8_t record[k_frame_hashes_record_size];
+    /* A run that stops short of the recorded frames is a difference too. */
+    if (util_file_read(p_hashes->p_file, &record[0], sizeof(record)) != 0) {
+      util_bail("run ended after %"PRIu32" frames but more were recorded",
+                p_hashes->num_frames);
+    }
+    log_do_log(k_log_misc,
+               k_log_info,
+               "frame hashes match for %"PRIu32" frames",
+               p_hashes->num_frames);
+  }
+  util_file_close(p_hashes->p_file);
+  util_free(p_hashes);
+}
+
+void
+frame_hashes_add(struct frame_hashes_struct* p_hashes,
+                 uint64_t cycles,
+                 uint32_t crc) {
+  uint8_t record[k_frame_hashes_record_size];
+  uint64_t expect_cycles;
+  uint32_t expect_crc;
+  uint32_t frame = p_hashes->num_frames;
+
+  p_hashes->num_frames++;
+
+  if (!p_hashes->is_check) {
+    frames_put_le32(&record[0], (uint32_t) cycles);
+    frames_put_le32(&record[4], (uint32_t) (cycles >> 32));
+    frames_put_le32(&record[8], crc);
+    util_file_write(p_hashes->p_file, &record[0], sizeof(record));
+    return;
+  }
+
+  if (util_file_read(p_hashes->p_file, &record[0], sizeof(record)) !=
+      sizeof(record)) {
+    util_bail("frame %"PRIu32" at cycles %"PRIu64" is past the recorded frames",
+              frame,
+              cycles);
+  }
+  expect_cycles = util_read_le32(&record[4]);
+  expect_cycles <<= 32;
+  expect_cycles |= util_read_le32(&record[0]);
+  expect_crc = util_read_le32(&record[8]);
+  if (cycles != expect_cycles) {
+    util_bail("frame %"PRIu32" at cycles %"PRIu64", expected at %"PRIu64,
+              frame,
+              cycles,
+              expect_cycles);
+  }
+  if (crc != expect_crc) {
+    util_bail("frame %"PRIu32" at cycles %"PRIu64" differs, "
+                  "CRC %.8"PRIX32", expected %.8"PRIX32,
+              frame,
+              cycles,
+              crc,
+              expect_crc);
+  }
+}
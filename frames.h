@@ -0,0 +1,58 @@
+#ifndef BEEBJIT_FRAMES_H
+#define BEEBJIT_FRAMES_H
+
+#include <stdint.h>
+
+/* Saved frames file format.
+ * A 24 byte header: the magic, then little endian 32-bit version, width and
+ * height. Then a chunk per frame, each with a little endian 32-bit raw length,
+ * a little endian 32-bit stored length and the stored data, which is zlib
+ * format. The raw data is the frame's 32-bit pixels XOR the previous frame's,
+ * so unchanged pixels are zero. The first frame is XOR zero.
+ */
+#define FRAMES_MAGIC "BJFRAME"
+
+enum {
+  k_frames_header_size = 24,
+  k_frames_chunk_header_size = 8,
+  k_frames_version = 1,
+};
+
+/* Frame hashes file format.
+ * A 16 byte header: the magic and a little endian 32-bit version. Then 12
+ * bytes per frame: the little endian 64-bit cycle count at which the frame
+ * was saved and the little endian 32-bit CRC32 of its pixels.
+ */
+#define FRAME_HASHES_MAGIC "BJHASH"
+
+enum {
+  k_frame_hashes_header_size = 16,
+  k_frame_hashes_record_size = 12,
+  k_frame_hashes_version = 1,
+};
+
+struct frames_struct;
+struct frame_hashes_struct;
+
+struct frames_struct* frames_create(const char* p_file_name,
+                                    uint32_t width,
+                                    uint32_t height);
+/* Flushes everything to the file. */
+void frames_destroy(struct frames_struct* p_frames);
+
+/* Takes a copy of the pixels; the writing is done on another thread. */
+void frames_add(struct frames_struct* p_frames, const uint32_t* p_pixels);
+
+/* Records frame hashes to a file or, if checking, compares against those
+ * previously recorded and bails at the first frame that differs.
+ */
+struct frame_hashes_struct* frame_hashes_create(const char* p_file_name,
+                                                int is_check);
+/* If checking, bails if any recorded frames were not reached. */
+void frame_hashes_destroy(struct frame_hashes_struct* p_hashes);
+
+void frame_hashes_add(struct frame_hashes_struct* p_hashes,
+                      uint64_t cycles,
+                      uint32_t crc);
+
+#endif /* BEEBJIT_FRAMES_H */
@@ -0,0 +1,175 @@
+/* Extracts the frames saved by -frames-file, as PNG files or as the raw .bgra
+ * files -frames-dir would have saved. See frames.h for the file format.
+ */
+#include "frames.h"
+#include "util.h"
+#include "util_compress.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void
+frames_tool_usage(void) {
+  (void) fprintf(stderr,
+"Usage: frames_tool <frames file> <output dir> [options]\n"
+"-bgra     : write raw .bgra files rather than PNGs.\n"
+"-from <n> : only frames from number <n> on.\n"
+"-max <n>  : write at most <n> frames.\n");
+  exit(1);
+}
+
+static void
+frames_tool_write_file(const char* p_file_name, void* p_buf, size_t length) {
+  struct util_file* p_file = util_file_open(p_file_name, 1, 1);
+
+  util_file_write(p_file, p_buf, length);
+  util_file_close(p_file);
+}
+
+int
+main(int argc, const char* argv[]) {
+  uint8_t header[k_frames_header_size];
+  struct util_file* p_file;
+  uint32_t width;
+  uint32_t height;
+  uint32_t frame_size;
+  uint32_t* p_frame;
+  uint32_t* p_delta;
+  uint8_t* p_rgb;
+  int i;
+
+  uint8_t* p_stored = NULL;
+  size_t stored_alloc = 0;
+  int is_bgra = 0;
+  uint64_t from = 0;
+  uint64_t max = UINT64_MAX;
+  uint64_t num_written = 0;
+  uint32_t frame_number = 0;
+
+  if (argc < 3) {
+    frames_tool_usage();
+  }
+
+  for (i = 3; i < argc; ++i) {
+    const char* p_arg = argv[i];
+    if (!strcmp(p_arg, "-bgra")) {
+      is_bgra = 1;
+      continue;
+    }
+    if ((i + 1) == argc) {
+      frames_tool_usage();
+    }
+    ++i;
+    if (!strcmp(p_arg, "-from")) {
+      from = util_parse_u64(argv[i], 0);
+    } else if (!strcmp(p_arg, "-max")) {
+      max = util_parse_u64(argv[i], 0);
+    } else {
+      frames_tool_usage();
+    }
+  }
+
+  p_file = util_file_try_read_open(argv[1]);
+  if (p_file == NULL) {
+    util_bail("couldn't open %s", argv[1]);
+  }
+  if ((util_file_read(p_file, &header[0], sizeof(header)) != sizeof(header)) ||
+      memcmp(&header[0], FRAMES_MAGIC, sizeof(FRAMES_MAGIC))) {
+    util_bail("not a beebjit frames file");
+  }
+  if (util_read_le32(&header[8]) != k_frames_version) {
+    util_bail("unsupported frames version");
+  }
+  width = util_read_le32(&header[12]);
+  height = util_read_le32(&header[16]);
+  if ((width == 0) || (height == 0) || (width > 8192) || (height > 8192)) {
+    util_bail("bad frame size");
+  }
+  frame_size = (width * height * 4);
+  p_frame = util_mallocz(frame_size);
+  p_delta = util_malloc(frame_size);
+  p_rgb = util_malloc(width * height * 3);
+
+  while (num_written < max) {
+    uint8_t chunk_header[k_frames_chunk_header_size];
+    char file_name[256];
+    size_t length;
+    size_t stored_length;
+    uint32_t j;
+    uint64_t ret = util_file_read(p_file,
+                                  &chunk_header[0],
+                                  sizeof(chunk_header));
+    if (ret == 0) {
+      break;
+    } else if (ret != sizeof(chunk_header)) {
+      util_bail("truncated frames file");
+    }
+    if (util_read_le32(&chunk_header[0]) != frame_size) {
+      util_bail("bad frame length");
+    }
+    stored_length = util_read_le32(&chunk_header[4]);
+    if (stored_length > stored_alloc) {
+      stored_alloc = stored_length;
+      p_stored = util_realloc(p_stored, stored_alloc);
+    }
+    if (util_file_read(p_file, p_stored, stored_length) != stored_length) {
+      util_bail("truncated frames file");
+    }
+    length = frame_size;
+    if ((util_uncompress(&length,
+                         p_stored,
+                         stored_length,
+                         (uint8_t*) p_delta) != 0) ||
+        (length != frame_size)) {
+      util_bail("corrupt compressed frame");
+    }
+
+    /* Every frame is a delta, so they must all be decoded. */
+    for (j = 0; j < (width * height); ++j) {
+      p_frame[j] ^= p_delta[j];
+    }
+    frame_number++;
+    if ((frame_number - 1) < from) {
+      continue;
+    }
+
+    if (is_bgra) {
+      (void) snprintf(file_name,
+                      sizeof(file_name),
+                      "%s/beebjit_frame_%d.bgra",
+                      argv[2],
+                      (frame_number - 1));
+      frames_tool_write_file(&file_name[0], p_frame, frame_size);
+    } else {
+      void* p_png;
+      size_t png_length;
+      for (j = 0; j < (width * height); ++j) {
+        uint32_t pixel = p_frame[j];
+        p_rgb[(j * 3) + 0] = ((pixel >> 16) & 0xFF);
+        p_rgb[(j * 3) + 1] = ((pixel >> 8) & 0xFF);
+        p_rgb[(j * 3) + 2] = (pixel & 0xFF);
+      }
+      p_png = util_png(&png_length, p_rgb, width, height);
+      if (p_png == NULL) {
+        util_bail("PNG encoding failed");
+      }
+      (void) snprintf(file_name,
+                      sizeof(file_name),
+                      "%s/beebjit_frame_%d.png",
+                      argv[2],
+                      (frame_number - 1));
+      frames_tool_write_file(&file_name[0], p_png, png_length);
+      util_free(p_png);
+    }
+    num_written++;
+  }
+
+  util_file_close(p_file);
+  util_free(p_stored);
+  util_free(p_frame);
+  util_free(p_delta);
+  util_free(p_rgb);
+
+  return 0;
+}
@@ -573,6 +573,13 @@ intel_fdc_command_abort(struct intel_fdc_struct* p_fdc) {
   state_6502_set_irq_level(p_fdc->p_state_6502, k_state_6502_irq_nmi, 0);
 }
 
+static void
+intel_fdc_wake_drive(struct intel_fdc_struct* p_fdc) {
+  if (p_fdc->p_current_drive != NULL) {
+    disc_drive_stop_coasting(p_fdc->p_current_drive);
+  }
+}
+
 void
 intel_fdc_power_on_reset(struct intel_fdc_struct* p_fdc) {
   /* The chip's reset line does take care of a lot of things.... */
@@ -597,8 +604,23 @@ intel_fdc_power_on_reset(struct intel_fdc_struct* p_fdc) {
   intel_fdc_update_external_status(p_fdc);
 }
 
+void
+intel_fdc_save_checkpoint(struct intel_fdc_struct* p_fdc,
+                          struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_fdc, sizeof(struct intel_fdc_struct));
+  timing_save_timer(p_fdc->p_timing, p_fdc->timer_id, p_buf);
+}
+
+void
+intel_fdc_load_checkpoint(struct intel_fdc_struct* p_fdc,
+                          struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf, p_fdc, sizeof(struct intel_fdc_struct));
+  timing_load_timer(p_fdc->p_timing, p_fdc->timer_id, p_buf);
+}
+
 void
 intel_fdc_break_reset(struct intel_fdc_struct* p_fdc) {
+  intel_fdc_wake_drive(p_fdc);
   /* Abort any in-progress command. */
   intel_fdc_command_abort(p_fdc);
   intel_fdc_clear_callbacks(p_fdc);
@@ -841,6 +863,7 @@ static void
 intel_fdc_timer_fired(void* p) {
   struct intel_fdc_struct* p_fdc = (struct intel_fdc_struct*) p;
 
+  intel_fdc_wake_drive(p_fdc);
   (void) timing_stop_timer(p_fdc->p_timing, p_fdc->timer_id);
 
   /* Counting milliseconds is done with R8 and R9, which are left at zero
@@ -1336,6 +1359,8 @@ void
 intel_fdc_write(struct intel_fdc_struct* p_fdc,
                 uint16_t addr,
                 uint8_t val) {
+  intel_fdc_wake_drive(p_fdc);
+
   switch (addr & 0x07) {
   case k_intel_fdc_command:
     intel_fdc_command_written(p_fdc, val);
@@ -2128,6 +2153,15 @@ intel_fdc_pulses_callback(void* p, uint32_t pulses, uint32_t count) {
     assert(0);
     break;
   }
+
+  /* If idle and not writing, the drive can skip calling back until the next
+   * index pulse edge. Anything that could start us up again from outside
+   * (register writes, our timer) stops the coasting first.
+   */
+  if ((p_fdc->state == k_intel_fdc_state_idle) &&
+      !(p_fdc->drive_out & k_intel_fdc_drive_out_write_enable)) {
+    disc_drive_coast_to_index(p_current_drive);
+  }
 }
 
 void
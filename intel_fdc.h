@@ -9,6 +9,7 @@ struct bbc_options;
 struct disc_drive_struct;
 struct state_6502;
 struct timing_struct;
+struct util_buffer;
 
 struct intel_fdc_struct* intel_fdc_create(struct state_6502* p_state_6502,
                                           struct timing_struct* p_timing,
@@ -21,6 +22,10 @@ void intel_fdc_set_drives(struct intel_fdc_struct* p_fdc,
                           struct disc_drive_struct* p_drive_1);
 
 void intel_fdc_power_on_reset(struct intel_fdc_struct* p_fdc);
+void intel_fdc_save_checkpoint(struct intel_fdc_struct* p_fdc,
+                               struct util_buffer* p_buf);
+void intel_fdc_load_checkpoint(struct intel_fdc_struct* p_fdc,
+                               struct util_buffer* p_buf);
 void intel_fdc_break_reset(struct intel_fdc_struct* p_fdc);
 
 /* Host hardware register I/O. */
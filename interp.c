@@ -21,6 +21,7 @@ enum {
   k_interp_special_entry = 16,
   k_interp_special_memory_written_callback = 32,
   k_interp_special_KIL = 64,
+  k_interp_special_flags = 128,
 };
 
 struct interp_struct {
@@ -233,6 +234,50 @@ interp_check_log_bcd(struct interp_struct* p_interp) {
   p_interp->counter_bcd++;
 }
 
+/* With GNU C, the opcode dispatch is threaded: each opcode handler ends with
+ * its own copy of the fast path fetch and an indirect jump straight to the
+ * next handler, which is far kinder to the host branch predictor than the
+ * single switch jump. Handlers for instructions with very common successors
+ * (DEX / BNE, CMP / BEQ, LDA / STA, etc.) check for those first and jump
+ * directly, making the pair behave much like a superinstruction.
+ * All of this is only taken when no special checks are pending, so the
+ * per-instruction semantics are identical to the switch.
+ */
+#if defined(__GNUC__)
+#define INTERP_THREADED
+
+#define INTERP_CASE(op) case op: interp_op_ ## op
+
+#define INTERP_DISPATCH()                                                     \
+  goto *s_p_dispatch[opcode]
+
+#define INTERP_NEXT()                                                         \
+  countdown -= cycles_this_instruction;                                       \
+  if ((countdown > 0) && !special_checks) {                                   \
+    opcode = p_mem_read[pc];                                                  \
+    INTERP_DISPATCH();                                                        \
+  }                                                                           \
+  goto do_special_checks
+
+#define INTERP_NEXT_PREDICT(op1, op2)                                         \
+  countdown -= cycles_this_instruction;                                       \
+  if ((countdown > 0) && !special_checks) {                                   \
+    opcode = p_mem_read[pc];                                                  \
+    if (opcode == op1) {                                                      \
+      goto interp_op_ ## op1;                                                 \
+    } else if (opcode == op2) {                                               \
+      goto interp_op_ ## op2;                                                 \
+    }                                                                         \
+    INTERP_DISPATCH();                                                        \
+  }                                                                           \
+  goto do_special_checks
+#else
+#define INTERP_CASE(op) case op
+#define INTERP_DISPATCH() continue
+#define INTERP_NEXT() break
+#define INTERP_NEXT_PREDICT(op1, op2) break
+#endif
+
 #define INTERP_TIMING_ADVANCE(num_cycles)                                     \
   countdown -= num_cycles;                                                    \
   countdown = timing_advance_time(p_timing, countdown);                       \
@@ -1157,6 +1202,74 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
   uint16_t addr = 0;
   int do_irq = 0;
   int is_65c12 = p_interp->is_65c12;
+#if defined(INTERP_THREADED)
+  static void* const s_p_dispatch[256] = {
+    &&interp_op_0x00, &&interp_op_0x01, &&interp_op_0x02, &&interp_op_0x03,
+    &&interp_op_0x04, &&interp_op_0x05, &&interp_op_0x06, &&interp_op_0x07,
+    &&interp_op_0x08, &&interp_op_0x09, &&interp_op_0x0A, &&interp_op_0x0B,
+    &&interp_op_0x0C, &&interp_op_0x0D, &&interp_op_0x0E, &&interp_op_0x0F,
+    &&interp_op_0x10, &&interp_op_0x11, &&interp_op_0x12, &&interp_op_0x13,
+    &&interp_op_0x14, &&interp_op_0x15, &&interp_op_0x16, &&interp_op_0x17,
+    &&interp_op_0x18, &&interp_op_0x19, &&interp_op_0x1A, &&interp_op_0x1B,
+    &&interp_op_0x1C, &&interp_op_0x1D, &&interp_op_0x1E, &&interp_op_0x1F,
+    &&interp_op_0x20, &&interp_op_0x21, &&interp_op_0x22, &&interp_op_0x23,
+    &&interp_op_0x24, &&interp_op_0x25, &&interp_op_0x26, &&interp_op_0x27,
+    &&interp_op_0x28, &&interp_op_0x29, &&interp_op_0x2A, &&interp_op_0x2B,
+    &&interp_op_0x2C, &&interp_op_0x2D, &&interp_op_0x2E, &&interp_op_0x2F,
+    &&interp_op_0x30, &&interp_op_0x31, &&interp_op_0x32, &&interp_op_0x33,
+    &&interp_op_0x34, &&interp_op_0x35, &&interp_op_0x36, &&interp_op_0x37,
+    &&interp_op_0x38, &&interp_op_0x39, &&interp_op_0x3A, &&interp_op_0x3B,
+    &&interp_op_0x3C, &&interp_op_0x3D, &&interp_op_0x3E, &&interp_op_0x3F,
+    &&interp_op_0x40, &&interp_op_0x41, &&interp_op_0x42, &&interp_op_0x43,
+    &&interp_op_0x44, &&interp_op_0x45, &&interp_op_0x46, &&interp_op_0x47,
+    &&interp_op_0x48, &&interp_op_0x49, &&interp_op_0x4A, &&interp_op_0x4B,
+    &&interp_op_0x4C, &&interp_op_0x4D, &&interp_op_0x4E, &&interp_op_0x4F,
+    &&interp_op_0x50, &&interp_op_0x51, &&interp_op_0x52, &&interp_op_0x53,
+    &&interp_op_0x54, &&interp_op_0x55, &&interp_op_0x56, &&interp_op_0x57,
+    &&interp_op_0x58, &&interp_op_0x59, &&interp_op_0x5A, &&interp_op_0x5B,
+    &&interp_op_0x5C, &&interp_op_0x5D, &&interp_op_0x5E, &&interp_op_0x5F,
+    &&interp_op_0x60, &&interp_op_0x61, &&interp_op_0x62, &&interp_op_0x63,
+    &&interp_op_0x64, &&interp_op_0x65, &&interp_op_0x66, &&interp_op_0x67,
+    &&interp_op_0x68, &&interp_op_0x69, &&interp_op_0x6A, &&interp_op_0x6B,
+    &&interp_op_0x6C, &&interp_op_0x6D, &&interp_op_0x6E, &&interp_op_0x6F,
+    &&interp_op_0x70, &&interp_op_0x71, &&interp_op_0x72, &&interp_op_0x73,
+    &&interp_op_0x74, &&interp_op_0x75, &&interp_op_0x76, &&interp_op_0x77,
+    &&interp_op_0x78, &&interp_op_0x79, &&interp_op_0x7A, &&interp_op_0x7B,
+    &&interp_op_0x7C, &&interp_op_0x7D, &&interp_op_0x7E, &&interp_op_0x7F,
+    &&interp_op_0x80, &&interp_op_0x81, &&interp_op_0x82, &&interp_op_0x83,
+    &&interp_op_0x84, &&interp_op_0x85, &&interp_op_0x86, &&interp_op_0x87,
+    &&interp_op_0x88, &&interp_op_0x89, &&interp_op_0x8A, &&interp_op_0x8B,
+    &&interp_op_0x8C, &&interp_op_0x8D, &&interp_op_0x8E, &&interp_op_0x8F,
+    &&interp_op_0x90, &&interp_op_0x91, &&interp_op_0x92, &&interp_op_0x93,
+    &&interp_op_0x94, &&interp_op_0x95, &&interp_op_0x96, &&interp_op_0x97,
+    &&interp_op_0x98, &&interp_op_0x99, &&interp_op_0x9A, &&interp_op_0x9B,
+    &&interp_op_0x9C, &&interp_op_0x9D, &&interp_op_0x9E, &&interp_op_0x9F,
+    &&interp_op_0xA0, &&interp_op_0xA1, &&interp_op_0xA2, &&interp_op_0xA3,
+    &&interp_op_0xA4, &&interp_op_0xA5, &&interp_op_0xA6, &&interp_op_0xA7,
+    &&interp_op_0xA8, &&interp_op_0xA9, &&interp_op_0xAA, &&interp_op_0xAB,
+    &&interp_op_0xAC, &&interp_op_0xAD, &&interp_op_0xAE, &&interp_op_0xAF,
+    &&interp_op_0xB0, &&interp_op_0xB1, &&interp_op_0xB2, &&interp_op_0xB3,
+    &&interp_op_0xB4, &&interp_op_0xB5, &&interp_op_0xB6, &&interp_op_0xB7,
+    &&interp_op_0xB8, &&interp_op_0xB9, &&interp_op_0xBA, &&interp_op_0xBB,
+    &&interp_op_0xBC, &&interp_op_0xBD, &&interp_op_0xBE, &&interp_op_0xBF,
+    &&interp_op_0xC0, &&interp_op_0xC1, &&interp_op_0xC2, &&interp_op_0xC3,
+    &&interp_op_0xC4, &&interp_op_0xC5, &&interp_op_0xC6, &&interp_op_0xC7,
+    &&interp_op_0xC8, &&interp_op_0xC9, &&interp_op_0xCA, &&interp_op_0xCB,
+    &&interp_op_0xCC, &&interp_op_0xCD, &&interp_op_0xCE, &&interp_op_0xCF,
+    &&interp_op_0xD0, &&interp_op_0xD1, &&interp_op_0xD2, &&interp_op_0xD3,
+    &&interp_op_0xD4, &&interp_op_0xD5, &&interp_op_0xD6, &&interp_op_0xD7,
+    &&interp_op_0xD8, &&interp_op_0xD9, &&interp_op_0xDA, &&interp_op_0xDB,
+    &&interp_op_0xDC, &&interp_op_0xDD, &&interp_op_0xDE, &&interp_op_0xDF,
+    &&interp_op_0xE0, &&interp_op_0xE1, &&interp_op_0xE2, &&interp_op_0xE3,
+    &&interp_op_0xE4, &&interp_op_0xE5, &&interp_op_0xE6, &&interp_op_0xE7,
+    &&interp_op_0xE8, &&interp_op_0xE9, &&interp_op_0xEA, &&interp_op_0xEB,
+    &&interp_op_0xEC, &&interp_op_0xED, &&interp_op_0xEE, &&interp_op_0xEF,
+    &&interp_op_0xF0, &&interp_op_0xF1, &&interp_op_0xF2, &&interp_op_0xF3,
+    &&interp_op_0xF4, &&interp_op_0xF5, &&interp_op_0xF6, &&interp_op_0xF7,
+    &&interp_op_0xF8, &&interp_op_0xF9, &&interp_op_0xFA, &&interp_op_0xFB,
+    &&interp_op_0xFC, &&interp_op_0xFD, &&interp_op_0xFE, &&interp_op_0xFF
+  };
+#endif
 
   assert(countdown >= 0);
 
@@ -1191,7 +1304,7 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
 
   while (1) {
     switch (opcode) {
-    case 0x00: /* BRK */
+    INTERP_CASE(0x00): /* BRK */
       /* EMU NOTE: if both an NMI and normal IRQ are asserted at the same time,        * only the NMI should fire. This is confirmed via visual 6502; see:
        * http://forum.6502.org/viewtopic.php?t=1797
        * Note that jsbeeb, b-em and beebem all appear to get this wrong, they
@@ -1235,69 +1348,69 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       intf = 1;
       do_irq = 0;
       cycles_this_instruction = 4;
-      break;
-    case 0x01: /* ORA idx */
+      INTERP_NEXT();
+    INTERP_CASE(0x01): /* ORA idx */
       INTERP_MODE_IDX_READ(INTERP_INSTR_ORA());
-      break;
-    case 0x02: /* KIL */ /* Undocumented. */ /* NOP imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x02): /* KIL */ /* Undocumented. */ /* NOP imm */
       if (is_65c12) {
         pc += 2;
         cycles_this_instruction = 2;
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x03: /* SLO idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x03): /* SLO idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_SLO());
       }
-      break;
-    case 0x04: /* NOP zpg */ /* Undocumented. */ /* TSB zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x04): /* NOP zpg */ /* Undocumented. */ /* TSB zpg */
       if (is_65c12) {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_TSB());
       } else {
         pc += 2;
         cycles_this_instruction = 3;
       }
-      break;
-    case 0x05: /* ORA zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x05): /* ORA zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_ORA());
-      break;
-    case 0x06: /* ASL zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x06): /* ASL zpg */
       INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ASL());
-      break;
-    case 0x07: /* SLO zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x07): /* SLO zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_SLO());
       }
-      break;
-    case 0x08: /* PHP */
+      INTERP_NEXT();
+    INTERP_CASE(0x08): /* PHP */
       v = interp_get_flags(zf, nf, cf, of, df, intf);
       v |= ((1 << k_flag_brk) | (1 << k_flag_always_set));
       p_stack[s--] = v;
       pc++;
       cycles_this_instruction = 3;
-      break;
-    case 0x09: /* ORA imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x09): /* ORA imm */
       a |= p_mem_read[pc + 1];
       INTERP_LOAD_NZ_FLAGS(a);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0x0A: /* ASL A */
+      INTERP_NEXT();
+    INTERP_CASE(0x0A): /* ASL A */
       v = a;
       INTERP_INSTR_ASL();
       a = v;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x0B: /* ANC imm */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x0B): /* ANC imm */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -1309,80 +1422,80 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x0C: /* NOP abs */ /* Undocumented. */ /* TSB abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x0C): /* NOP abs */ /* Undocumented. */ /* TSB abs */
       if (is_65c12) {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_TSB());
       } else {
         INTERP_MODE_ABS_READ(INTERP_INSTR_NOP());
       }
-      break;
-    case 0x0D: /* ORA abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x0D): /* ORA abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_ORA());
-      break;
-    case 0x0E: /* ASL abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x0E): /* ASL abs */
       INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ASL());
-      break;
-    case 0x0F: /* SLO abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x0F): /* SLO abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_SLO());
       }
-      break;
-    case 0x10: /* BPL */
+      INTERP_NEXT();
+    INTERP_CASE(0x10): /* BPL */
       INTERP_INSTR_BRANCH(!nf);
-      break;
-    case 0x11: /* ORA idy */
+      INTERP_NEXT();
+    INTERP_CASE(0x11): /* ORA idy */
       INTERP_MODE_IDY_READ(INTERP_INSTR_ORA());
-      break;
-    case 0x12: /* KIL */ /* Undocumented. */ /* ORA id */
+      INTERP_NEXT();
+    INTERP_CASE(0x12): /* KIL */ /* Undocumented. */ /* ORA id */
       if (is_65c12) {
         INTERP_MODE_ID_READ(INTERP_INSTR_ORA());
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x13: /* SLO idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x13): /* SLO idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_SLO());
       }
-      break;
-    case 0x14: /* NOP zpx */ /* Undocumented. */ /* TRB zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x14): /* NOP zpx */ /* Undocumented. */ /* TRB zpg */
       if (is_65c12) {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_TRB());
       } else {
         pc += 2;
         cycles_this_instruction = 4;
       }
-      break;
-    case 0x15: /* ORA zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x15): /* ORA zpx */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_ORA(), x);
-      break;
-    case 0x16: /* ASL zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x16): /* ASL zpx */
       INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_ASL());
-      break;
-    case 0x17: /* SLO zpx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x17): /* SLO zpx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_SLO());
       }
-      break;
-    case 0x18: /* CLC */
+      INTERP_NEXT();
+    INTERP_CASE(0x18): /* CLC */
       cf = 0;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x19: /* ORA aby */
+      INTERP_NEXT();
+    INTERP_CASE(0x19): /* ORA aby */
       INTERP_MODE_ABr_READ(INTERP_INSTR_ORA(), y);
-      break;
-    case 0x1A: /* NOP */ /* Undocumented. */ /* INC A */
+      INTERP_NEXT();
+    INTERP_CASE(0x1A): /* NOP */ /* Undocumented. */ /* INC A */
       if (is_65c12) {
         a++;
         INTERP_LOAD_NZ_FLAGS(a);
@@ -1392,41 +1505,41 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc++;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x1B: /* SLO aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x1B): /* SLO aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SLO(), y);
       }
-      break;
-    case 0x1C: /* NOP abx */ /* Undocumented. */ /* TRB abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x1C): /* NOP abx */ /* Undocumented. */ /* TRB abs */
       if (is_65c12) {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_TRB());
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
       }
-      break;
-    case 0x1D: /* ORA abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x1D): /* ORA abx */
       INTERP_MODE_ABr_READ(INTERP_INSTR_ORA(), x);
-      break;
-    case 0x1E: /* ASL abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x1E): /* ASL abx */
       if (is_65c12) {
         INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_ASL());
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ASL(), x);
       }
-      break;
-    case 0x1F: /* SLO abx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x1F): /* SLO abx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SLO(), x);
       }
-      break;
-    case 0x20: /* JSR */
+      INTERP_NEXT();
+    INTERP_CASE(0x20): /* JSR */
       /* JSR has an interesting order of address fetching vs. stack writes,
        * which means it can actuall self-modify.
        * See: https://www.stardot.org.uk/forums/viewtopic.php?t=27208
@@ -1438,44 +1551,44 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       addr |= (p_mem_read[pc + 2] << 8);
       pc = addr;
       cycles_this_instruction = 6;
-      break;
-    case 0x21: /* AND idx */
+      INTERP_NEXT();
+    INTERP_CASE(0x21): /* AND idx */
       INTERP_MODE_IDX_READ(INTERP_INSTR_AND());
-      break;
-    case 0x22: /* KIL */ /* Undocumented. */ /* NOP imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x22): /* KIL */ /* Undocumented. */ /* NOP imm */
       if (is_65c12) {
         pc += 2;
         cycles_this_instruction = 2;
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x23: /* RLA idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x23): /* RLA idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_RLA());
       }
-      break;
-    case 0x24: /* BIT zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x24): /* BIT zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_BIT());
-      break;
-    case 0x25: /* AND zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x25): /* AND zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_AND());
-      break;
-    case 0x26: /* ROL zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x26): /* ROL zpg */
       INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ROL());
-      break;
-    case 0x27: /* RLA zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x27): /* RLA zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_RLA());
       }
-      break;
-    case 0x28: /* PLP */
+      INTERP_NEXT();
+    INTERP_CASE(0x28): /* PLP */
       /* PLP fiddles with the interrupt disable flag so we need to tick it
        * out to get the correct ordering and behavior.
        */
@@ -1486,21 +1599,21 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       pc++;
       INTERP_TIMING_ADVANCE(2);
       goto check_irq;
-    case 0x29: /* AND imm */
+    INTERP_CASE(0x29): /* AND imm */
       v = p_mem_read[pc + 1];
       a &= v;
       INTERP_LOAD_NZ_FLAGS(a);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0x2A: /* ROL A */
+      INTERP_NEXT();
+    INTERP_CASE(0x2A): /* ROL A */
       v = a;
       INTERP_INSTR_ROL();
       a = v;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x2B: /* ANC imm */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x2B): /* ANC imm */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -1512,76 +1625,76 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x2C: /* BIT abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x2C): /* BIT abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_BIT());
-      break;
-    case 0x2D: /* AND abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x2D): /* AND abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_AND());
-      break;
-    case 0x2E: /* ROL abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x2E): /* ROL abs */
       INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ROL());
-      break;
-    case 0x2F: /* RLA abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x2F): /* RLA abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_RLA());
       }
-      break;
-    case 0x30: /* BMI */
+      INTERP_NEXT();
+    INTERP_CASE(0x30): /* BMI */
       INTERP_INSTR_BRANCH(nf);
-      break;
-    case 0x31: /* AND idy */
+      INTERP_NEXT();
+    INTERP_CASE(0x31): /* AND idy */
       INTERP_MODE_IDY_READ(INTERP_INSTR_AND());
-      break;
-    case 0x32: /* KIL */ /* Undocumented. */ /* AND id */
+      INTERP_NEXT();
+    INTERP_CASE(0x32): /* KIL */ /* Undocumented. */ /* AND id */
       if (is_65c12) {
         INTERP_MODE_ID_READ(INTERP_INSTR_AND());
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x33: /* RLA idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x33): /* RLA idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_RLA());
       }
-      break;
-    case 0x34: /* NOP zpx */ /* Undocumented. */ /* BIT zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x34): /* NOP zpx */ /* Undocumented. */ /* BIT zpx */
       if (is_65c12) {
         INTERP_MODE_ZPr_READ(INTERP_INSTR_BIT(), x);
       } else {
         pc += 2;
         cycles_this_instruction = 4;
       }
-      break;
-    case 0x35: /* AND zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x35): /* AND zpx */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_AND(), x);
-      break;
-    case 0x36: /* ROL zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x36): /* ROL zpx */
       INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_ROL());
-      break;
-    case 0x37: /* RLA zpx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x37): /* RLA zpx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_RLA());
       }
-      break;
-    case 0x38: /* SEC */
+      INTERP_NEXT();
+    INTERP_CASE(0x38): /* SEC */
       cf = 1;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x39: /* AND aby */
+      INTERP_NEXT();
+    INTERP_CASE(0x39): /* AND aby */
       INTERP_MODE_ABr_READ(INTERP_INSTR_AND(), y);
-      break;
-    case 0x3A: /* NOP */ /* Undocumented. */ /* DEC A */
+      INTERP_NEXT();
+    INTERP_CASE(0x3A): /* NOP */ /* Undocumented. */ /* DEC A */
       if (is_65c12) {
         a--;
         INTERP_LOAD_NZ_FLAGS(a);
@@ -1591,41 +1704,41 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc++;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x3B: /* RLA aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x3B): /* RLA aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RLA(), y);
       }
-      break;
-    case 0x3C: /* NOP abx */ /* Undocumented. */ /* BIT abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x3C): /* NOP abx */ /* Undocumented. */ /* BIT abx */
       if (is_65c12) {
         INTERP_MODE_ABr_READ(INTERP_INSTR_BIT(), x);
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
       }
-      break;
-    case 0x3D: /* AND abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x3D): /* AND abx */
       INTERP_MODE_ABr_READ(INTERP_INSTR_AND(), x);
-      break;
-    case 0x3E: /* ROL abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x3E): /* ROL abx */
       if (is_65c12) {
         INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_ROL());
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ROL(), x);
       }
-      break;
-    case 0x3F: /* RLA abx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x3F): /* RLA abx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RLA(), x);
       }
-      break;
-    case 0x40: /* RTI */
+      INTERP_NEXT();
+    INTERP_CASE(0x40): /* RTI */
       /* RTI fiddles with the interrupt disable flag so we need to tick it
        * out to get the correct ordering and behavior.
        */
@@ -1637,62 +1750,62 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       interp_poll_irq_now(&do_irq, p_state_6502, intf);
       INTERP_TIMING_ADVANCE(2);
       goto check_irq;
-    case 0x41: /* EOR idx */
+    INTERP_CASE(0x41): /* EOR idx */
       INTERP_MODE_IDX_READ(INTERP_INSTR_EOR());
-      break;
-    case 0x42: /* KIL */ /* Undocumented. */ /* NOP imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x42): /* KIL */ /* Undocumented. */ /* NOP imm */
       if (is_65c12) {
         pc += 2;
         cycles_this_instruction = 2;
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x43: /* SRE idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x43): /* SRE idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_SRE());
       }
-      break;
-    case 0x44: /* NOP zpg */ /* Undocumented. */
+      INTERP_NEXT();
+    INTERP_CASE(0x44): /* NOP zpg */ /* Undocumented. */
       pc += 2;
       cycles_this_instruction = 3;
-      break;
-    case 0x45: /* EOR zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x45): /* EOR zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_EOR());
-      break;
-    case 0x46: /* LSR zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x46): /* LSR zpg */
       INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_LSR());
-      break;
-    case 0x47: /* SRE zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x47): /* SRE zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_SRE());
       }
-      break;
-    case 0x48: /* PHA */
+      INTERP_NEXT();
+    INTERP_CASE(0x48): /* PHA */
       p_stack[s--] = a;
       pc++;
       cycles_this_instruction = 3;
-      break;
-    case 0x49: /* EOR imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x49): /* EOR imm */
       a ^= p_mem_read[pc + 1];
       INTERP_LOAD_NZ_FLAGS(a);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0x4A: /* LSR A */
+      INTERP_NEXT();
+    INTERP_CASE(0x4A): /* LSR A */
       v = a;
       INTERP_INSTR_LSR();
       a = v;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x4B: /* ALR imm */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x4B): /* ALR imm */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -1705,67 +1818,67 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x4C: /* JMP abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x4C): /* JMP abs */
       pc = *(uint16_t*) &p_mem_read[pc + 1];
       cycles_this_instruction = 3;
-      break;
-    case 0x4D: /* EOR abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x4D): /* EOR abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_EOR());
-      break;
-    case 0x4E: /* LSR abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x4E): /* LSR abs */
       INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_LSR());
-      break;
-    case 0x4F: /* SRE abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x4F): /* SRE abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_SRE());
       }
-      break;
-    case 0x50: /* BVC */
+      INTERP_NEXT();
+    INTERP_CASE(0x50): /* BVC */
       INTERP_INSTR_BRANCH(!of);
-      break;
-    case 0x51: /* EOR idy */
+      INTERP_NEXT();
+    INTERP_CASE(0x51): /* EOR idy */
       INTERP_MODE_IDY_READ(INTERP_INSTR_EOR());
-      break;
-    case 0x52: /* KIL */ /* Undocumented. */ /* EOR id */
+      INTERP_NEXT();
+    INTERP_CASE(0x52): /* KIL */ /* Undocumented. */ /* EOR id */
       if (is_65c12) {
         INTERP_MODE_ID_READ(INTERP_INSTR_EOR());
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x53: /* SRE idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x53): /* SRE idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_SRE());
       }
-      break;
-    case 0x54: /* NOP zpx */ /* Undocumented. */
-    case 0xD4:
-    case 0xF4:
+      INTERP_NEXT();
+    INTERP_CASE(0x54): /* NOP zpx */ /* Undocumented. */
+    INTERP_CASE(0xD4):
+    INTERP_CASE(0xF4):
       pc += 2;
       cycles_this_instruction = 4;
-      break;
-    case 0x55: /* EOR zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x55): /* EOR zpx */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_EOR(), x);
-      break;
-    case 0x56: /* LSR zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x56): /* LSR zpx */
       INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_LSR());
-      break;
-    case 0x57: /* SRE zpx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x57): /* SRE zpx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_SRE());
       }
-      break;
-    case 0x58: /* CLI */
+      INTERP_NEXT();
+    INTERP_CASE(0x58): /* CLI */
       /* CLI enables interrupts but this takes effect after the IRQ poll
        * point.
        */
@@ -1774,10 +1887,10 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       pc++;
       INTERP_TIMING_ADVANCE(2);
       goto check_irq;
-    case 0x59: /* EOR aby */
+    INTERP_CASE(0x59): /* EOR aby */
       INTERP_MODE_ABr_READ(INTERP_INSTR_EOR(), y);
-      break;
-    case 0x5A: /* NOP */ /* Undocumented. */ /* PHY */
+      INTERP_NEXT();
+    INTERP_CASE(0x5A): /* NOP */ /* Undocumented. */ /* PHY */
       if (is_65c12) {
         p_stack[s--] = y;
         pc++;
@@ -1786,16 +1899,16 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc++;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x5B: /* SRE aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x5B): /* SRE aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SRE(), y);
       }
-      break;
-    case 0x5C: /* NOP abx */ /* Undocumented. */ /* NOP abs (8) */
+      INTERP_NEXT();
+    INTERP_CASE(0x5C): /* NOP abx */ /* Undocumented. */ /* NOP abs (8) */
       if (is_65c12) {
         /* Apparently, cycle stretching isn't possible in any of these 8 ticks.
          * See: https://laughtonelectronics.com/Arcana/KimKlone/Kimklone_opcode_mapping.html
@@ -1805,32 +1918,32 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
       }
-      break;
-    case 0x5D: /* EOR abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x5D): /* EOR abx */
       INTERP_MODE_ABr_READ(INTERP_INSTR_EOR(), x);
-      break;
-    case 0x5E: /* LSR abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x5E): /* LSR abx */
       if (is_65c12) {
         INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_LSR());
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_LSR(), x);
       }
-      break;
-    case 0x5F: /* SRE abx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x5F): /* SRE abx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_SRE(), x);
       }
-      break;
-    case 0x60: /* RTS */
+      INTERP_NEXT();
+    INTERP_CASE(0x60): /* RTS */
       pc = p_stack[++s];
       pc |= (p_stack[++s] << 8);
       pc++;
       cycles_this_instruction = 6;
-      break;
-    case 0x61: /* ADC idx */
+      INTERP_NEXT();
+    INTERP_CASE(0x61): /* ADC idx */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_IDX_READ(INTERP_INSTR_BCD_ADC());
@@ -1840,32 +1953,32 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_IDX_READ(INTERP_INSTR_ADC());
       }
-      break;
-    case 0x62: /* KIL */ /* Undocumented. */ /* NOP imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x62): /* KIL */ /* Undocumented. */ /* NOP imm */
       if (is_65c12) {
         pc += 2;
         cycles_this_instruction = 2;
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x63: /* RRA idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x63): /* RRA idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_RRA());
       }
-      break;
-    case 0x64: /* NOP zpg */ /* Undocumented. */ /* STZ zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x64): /* NOP zpg */ /* Undocumented. */ /* STZ zpg */
       if (is_65c12) {
         INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STZ());
       } else {
         pc += 2;
         cycles_this_instruction = 3;
       }
-      break;
-    case 0x65: /* ADC zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x65): /* ADC zpg */
       if (df) {
         INTERP_MODE_ZPG_READ(INTERP_INSTR_BCD_ADC());
         if (is_65c12) {
@@ -1874,25 +1987,25 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ZPG_READ(INTERP_INSTR_ADC());
       }
-      break;
-    case 0x66: /* ROR zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x66): /* ROR zpg */
       INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ROR());
-      break;
-    case 0x67: /* RRA zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x67): /* RRA zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_RRA());
       }
-      break;
-    case 0x68: /* PLA */
+      INTERP_NEXT();
+    INTERP_CASE(0x68): /* PLA */
       a = p_stack[++s];
       INTERP_LOAD_NZ_FLAGS(a);
       pc++;
       cycles_this_instruction = 4;
-      break;
-    case 0x69: /* ADC imm */
+      INTERP_NEXT();
+    INTERP_CASE(0x69): /* ADC imm */
       v = p_mem_read[pc + 1];
       pc += 2;
       cycles_this_instruction = 2;
@@ -1904,15 +2017,15 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_INSTR_ADC();
       }
-      break;
-    case 0x6A: /* ROR A */
+      INTERP_NEXT();
+    INTERP_CASE(0x6A): /* ROR A */
       v = a;
       INTERP_INSTR_ROR();
       a = v;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x6B: /* ARR imm */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x6B): /* ARR imm */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -1922,8 +2035,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x6C: /* JMP ind */
+      INTERP_NEXT();
+    INTERP_CASE(0x6C): /* JMP ind */
       addr = *(uint16_t*) &p_mem_read[pc + 1];
       if (is_65c12) {
         pc = *(uint16_t*) &p_mem_read[addr];
@@ -1935,8 +2048,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc |= (p_mem_read[addr_temp] << 8);
         cycles_this_instruction = 5;
       }
-      break;
-    case 0x6D: /* ADC abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x6D): /* ADC abs */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_ABS_READ(INTERP_INSTR_BCD_ADC());
@@ -1946,22 +2059,22 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABS_READ(INTERP_INSTR_ADC());
       }
-      break;
-    case 0x6E: /* ROR abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x6E): /* ROR abs */
       INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ROR());
-      break;
-    case 0x6F: /* RRA abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x6F): /* RRA abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_RRA());
       }
-      break;
-    case 0x70: /* BVS */
+      INTERP_NEXT();
+    INTERP_CASE(0x70): /* BVS */
       INTERP_INSTR_BRANCH(of);
-      break;
-    case 0x71: /* ADC idy */
+      INTERP_NEXT();
+    INTERP_CASE(0x71): /* ADC idy */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_IDY_READ(INTERP_INSTR_BCD_ADC());
@@ -1971,8 +2084,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_IDY_READ(INTERP_INSTR_ADC());
       }
-      break;
-    case 0x72: /* KIL */ /* Undocumented. */ /* ADC id */
+      INTERP_NEXT();
+    INTERP_CASE(0x72): /* KIL */ /* Undocumented. */ /* ADC id */
       if (is_65c12) {
         if (df) {
           INTERP_MODE_BCD_ID_READ(INTERP_INSTR_BCD_ADC());
@@ -1982,24 +2095,24 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x73: /* RRA idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x73): /* RRA idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_RRA());
       }
-      break;
-    case 0x74: /* NOP zpx */ /* Undocumented. */ /* STZ zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x74): /* NOP zpx */ /* Undocumented. */ /* STZ zpx */
       if (is_65c12) {
         INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STZ(), x);
       } else {
         pc += 2;
         cycles_this_instruction = 4;
       }
-      break;
-    case 0x75: /* ADC zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x75): /* ADC zpx */
       if (df) {
         INTERP_MODE_ZPr_READ(INTERP_INSTR_BCD_ADC(), x);
         if (is_65c12) {
@@ -2008,19 +2121,19 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ZPr_READ(INTERP_INSTR_ADC(), x);
       }
-      break;
-    case 0x76: /* ROR zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x76): /* ROR zpx */
       INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_ROR());
-      break;
-    case 0x77: /* RRA zpx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x77): /* RRA zpx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_RRA());
       }
-      break;
-    case 0x78: /* SEI */
+      INTERP_NEXT();
+    INTERP_CASE(0x78): /* SEI */
       /* SEI disables interrupts but this takes effect after the IRQ poll
        * point.
        */
@@ -2029,7 +2142,7 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       pc++;
       INTERP_TIMING_ADVANCE(2);
       goto check_irq;
-    case 0x79: /* ADC aby */
+    INTERP_CASE(0x79): /* ADC aby */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_ADC(), y);
@@ -2039,8 +2152,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_ADC(), y);
       }
-      break;
-    case 0x7A: /* NOP */ /* Undocumented. */ /* PLY */
+      INTERP_NEXT();
+    INTERP_CASE(0x7A): /* NOP */ /* Undocumented. */ /* PLY */
       if (is_65c12) {
         y = p_stack[++s];
         INTERP_LOAD_NZ_FLAGS(y);
@@ -2050,16 +2163,16 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc++;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x7B: /* RRA aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x7B): /* RRA aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RRA(), y);
       }
-      break;
-    case 0x7C: /* NOP abx */ /* Undocumented. */ /* JMP iax */
+      INTERP_NEXT();
+    INTERP_CASE(0x7C): /* NOP abx */ /* Undocumented. */ /* JMP iax */
       if (is_65c12) {
         addr = *(uint16_t*) &p_mem_read[pc + 1];
         addr += x;
@@ -2068,8 +2181,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
       }
-      break;
-    case 0x7D: /* ADC abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x7D): /* ADC abx */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_ADC(), x);
@@ -2079,71 +2192,71 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_ADC(), x);
       }
-      break;
-    case 0x7E: /* ROR abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x7E): /* ROR abx */
       if (is_65c12) {
         INTERP_MODE_ABX_READ_WRITE_6_CYC(INTERP_INSTR_ROR());
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ROR(), x);
       }
-      break;
-    case 0x7F: /* RRA abx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x7F): /* RRA abx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_RRA(), x);
       }
-      break;
-    case 0x80: /* NOP imm */ /* Undocumented. */ /* BRA */
+      INTERP_NEXT();
+    INTERP_CASE(0x80): /* NOP imm */ /* Undocumented. */ /* BRA */
       if (is_65c12) {
         INTERP_INSTR_BRANCH(1);
       } else {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x81: /* STA idx */
+      INTERP_NEXT();
+    INTERP_CASE(0x81): /* STA idx */
       INTERP_MODE_IDX_WRITE(INTERP_INSTR_STA());
-      break;
-    case 0x82: /* NOP imm */ /* Undocumented. */
-    case 0xC2:
-    case 0xE2:
+      INTERP_NEXT();
+    INTERP_CASE(0x82): /* NOP imm */ /* Undocumented. */
+    INTERP_CASE(0xC2):
+    INTERP_CASE(0xE2):
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0x83: /* SAX idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x83): /* SAX idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_WRITE(INTERP_INSTR_SAX());
       }
-      break;
-    case 0x84: /* STY zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x84): /* STY zpg */
       INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STY());
-      break;
-    case 0x85: /* STA zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x85): /* STA zpg */
       INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STA());
-      break;
-    case 0x86: /* STX zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0x86): /* STX zpg */
       INTERP_MODE_ZPG_WRITE(INTERP_INSTR_STX());
-      break;
-    case 0x87: /* SAX zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x87): /* SAX zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_WRITE(INTERP_INSTR_SAX());
       }
-      break;
-    case 0x88: /* DEY */
+      INTERP_NEXT();
+    INTERP_CASE(0x88): /* DEY */
       y--;
       INTERP_LOAD_NZ_FLAGS(y);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x89: /* NOP imm */ /* Undocumented. */ /* BIT imm */
+      INTERP_NEXT_PREDICT(0xD0, 0x10);
+    INTERP_CASE(0x89): /* NOP imm */ /* Undocumented. */ /* BIT imm */
       if (is_65c12) {
         v = p_mem_read[pc + 1];
         INTERP_INSTR_BIT();
@@ -2153,14 +2266,14 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x8A: /* TXA */
+      INTERP_NEXT();
+    INTERP_CASE(0x8A): /* TXA */
       a = x;
       INTERP_LOAD_NZ_FLAGS(a);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x8B: /* XAA */ /* Undocumented and unstable. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x8B): /* XAA */ /* Undocumented and unstable. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -2177,168 +2290,168 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0x8C: /* STY abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x8C): /* STY abs */
       INTERP_MODE_ABS_WRITE(INTERP_INSTR_STY());
-      break;
-    case 0x8D: /* STA abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x8D): /* STA abs */
       INTERP_MODE_ABS_WRITE(INTERP_INSTR_STA());
-      break;
-    case 0x8E: /* STX abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x8E): /* STX abs */
       INTERP_MODE_ABS_WRITE(INTERP_INSTR_STX());
-      break;
-    case 0x8F: /* SAX abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x8F): /* SAX abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_WRITE(INTERP_INSTR_SAX());
       }
-      break;
-    case 0x90: /* BCC */
+      INTERP_NEXT();
+    INTERP_CASE(0x90): /* BCC */
       INTERP_INSTR_BRANCH(!cf);
-      break;
-    case 0x91: /* STA idy */
+      INTERP_NEXT();
+    INTERP_CASE(0x91): /* STA idy */
       INTERP_MODE_IDY_WRITE(INTERP_INSTR_STA());
-      break;
-    case 0x92: /* KIL */ /* Undocumented. */ /* STA id */
+      INTERP_NEXT();
+    INTERP_CASE(0x92): /* KIL */ /* Undocumented. */ /* STA id */
       if (is_65c12) {
         INTERP_MODE_ID_WRITE(INTERP_INSTR_STA());
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0x93: /* AHX idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x93): /* AHX idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_WRITE_AHX(INTERP_INSTR_AHX());
       }
-      break;
-    case 0x94: /* STY zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x94): /* STY zpx */
       INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STY(), x);
-      break;
-    case 0x95: /* STA zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0x95): /* STA zpx */
       INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STA(), x);
-      break;
-    case 0x96: /* STX zpy */
+      INTERP_NEXT();
+    INTERP_CASE(0x96): /* STX zpy */
       INTERP_MODE_ZPr_WRITE(INTERP_INSTR_STX(), y);
-      break;
-    case 0x97: /* SAX zpy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x97): /* SAX zpy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPr_WRITE(INTERP_INSTR_SAX(), y);
       }
-      break;
-    case 0x98: /* TYA */
+      INTERP_NEXT();
+    INTERP_CASE(0x98): /* TYA */
       a = y;
       INTERP_LOAD_NZ_FLAGS(a);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x99: /* STA aby */
+      INTERP_NEXT();
+    INTERP_CASE(0x99): /* STA aby */
       INTERP_MODE_ABr_WRITE(INTERP_INSTR_STA(), y);
-      break;
-    case 0x9A: /* TXS */
+      INTERP_NEXT();
+    INTERP_CASE(0x9A): /* TXS */
       s = x;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0x9B: /* TAS aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x9B): /* TAS aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_WRITE_SHr(INTERP_INSTR_TAS(), y);
       }
-      break;
-    case 0x9C: /* SHY abx */ /* Undocumented. */ /* STZ abs */
+      INTERP_NEXT();
+    INTERP_CASE(0x9C): /* SHY abx */ /* Undocumented. */ /* STZ abs */
       if (is_65c12) {
         INTERP_MODE_ABS_WRITE(INTERP_INSTR_STZ());
       } else {
         INTERP_MODE_ABr_WRITE_SHr(INTERP_INSTR_SHY(), x);
       }
-      break;
-    case 0x9D: /* STA abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x9D): /* STA abx */
       INTERP_MODE_ABr_WRITE(INTERP_INSTR_STA(), x);
-      break;
-    case 0x9E: /* SHX aby */ /* Undocumented. */ /* STZ abx */
+      INTERP_NEXT();
+    INTERP_CASE(0x9E): /* SHX aby */ /* Undocumented. */ /* STZ abx */
       if (is_65c12) {
         INTERP_MODE_ABr_WRITE(INTERP_INSTR_STZ(), x);
       } else {
         INTERP_MODE_ABr_WRITE_SHr(INTERP_INSTR_SHX(), y);
       }
-      break;
-    case 0x9F: /* AHX aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0x9F): /* AHX aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_WRITE_SHr(INTERP_INSTR_AHX(), y);
       }
-      break;
-    case 0xA0: /* LDY imm */
+      INTERP_NEXT();
+    INTERP_CASE(0xA0): /* LDY imm */
       y = p_mem_read[pc + 1];
       INTERP_LOAD_NZ_FLAGS(y);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0xA1: /* LDA idx */
+      INTERP_NEXT();
+    INTERP_CASE(0xA1): /* LDA idx */
       INTERP_MODE_IDX_READ(INTERP_INSTR_LDA());
-      break;
-    case 0xA2: /* LDX imm */
+      INTERP_NEXT();
+    INTERP_CASE(0xA2): /* LDX imm */
       x = p_mem_read[pc + 1];
       INTERP_LOAD_NZ_FLAGS(x);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0xA3: /* LAX idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xA3): /* LAX idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ(INTERP_INSTR_LAX());
       }
-      break;
-    case 0xA4: /* LDY zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xA4): /* LDY zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_LDY());
-      break;
-    case 0xA5: /* LDA zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xA5): /* LDA zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_LDA());
-      break;
-    case 0xA6: /* LDX zpg */
+      INTERP_NEXT_PREDICT(0x85, 0x8D);
+    INTERP_CASE(0xA6): /* LDX zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_LDX());
-      break;
-    case 0xA7: /* LAX zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xA7): /* LAX zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ(INTERP_INSTR_LAX());
       }
-      break;
-    case 0xA8: /* TAY */
+      INTERP_NEXT();
+    INTERP_CASE(0xA8): /* TAY */
       y = a;
       INTERP_LOAD_NZ_FLAGS(y);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xA9: /* LDA imm */
+      INTERP_NEXT();
+    INTERP_CASE(0xA9): /* LDA imm */
       a = p_mem_read[pc + 1];
       INTERP_LOAD_NZ_FLAGS(a);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0xAA: /* TAX */
+      INTERP_NEXT_PREDICT(0x85, 0x8D);
+    INTERP_CASE(0xAA): /* TAX */
       x = a;
       INTERP_LOAD_NZ_FLAGS(x);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xAB: /* LAX imm */ /* Undocumented and unstable. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xAB): /* LAX imm */ /* Undocumented and unstable. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -2353,154 +2466,154 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0xAC: /* LDY abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xAC): /* LDY abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_LDY());
-      break;
-    case 0xAD: /* LDA abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xAD): /* LDA abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_LDA());
-      break;
-    case 0xAE: /* LDX abs */
+      INTERP_NEXT_PREDICT(0x85, 0x8D);
+    INTERP_CASE(0xAE): /* LDX abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_LDX());
-      break;
-    case 0xAF: /* LAX abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xAF): /* LAX abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ(INTERP_INSTR_LAX());
       }
-      break;
-    case 0xB0: /* BCS */
+      INTERP_NEXT();
+    INTERP_CASE(0xB0): /* BCS */
       INTERP_INSTR_BRANCH(cf);
-      break;
-    case 0xB1: /* LDA idy */
+      INTERP_NEXT();
+    INTERP_CASE(0xB1): /* LDA idy */
       INTERP_MODE_IDY_READ(INTERP_INSTR_LDA());
-      break;
-    case 0xB2: /* KIL */ /* Undocumented. */ /* LDA id */
+      INTERP_NEXT_PREDICT(0x91, 0x99);
+    INTERP_CASE(0xB2): /* KIL */ /* Undocumented. */ /* LDA id */
       if (is_65c12) {
         INTERP_MODE_ID_READ(INTERP_INSTR_LDA());
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0xB3: /* LAX idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xB3): /* LAX idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ(INTERP_INSTR_LAX());
       }
-      break;
-    case 0xB4: /* LDY zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0xB4): /* LDY zpx */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_LDY(), x);
-      break;
-    case 0xB5: /* LDA zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0xB5): /* LDA zpx */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_LDA(), x);
-      break;
-    case 0xB6: /* LDX zpy */
+      INTERP_NEXT();
+    INTERP_CASE(0xB6): /* LDX zpy */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_LDX(), y);
-      break;
-    case 0xB7: /* LAX zpy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xB7): /* LAX zpy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPr_READ(INTERP_INSTR_LAX(), y);
       }
-      break;
-    case 0xB8: /* CLV */
+      INTERP_NEXT();
+    INTERP_CASE(0xB8): /* CLV */
       of = 0;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xB9: /* LDA aby */
+      INTERP_NEXT();
+    INTERP_CASE(0xB9): /* LDA aby */
       INTERP_MODE_ABr_READ(INTERP_INSTR_LDA(), y);
-      break;
-    case 0xBA: /* TSX */
+      INTERP_NEXT();
+    INTERP_CASE(0xBA): /* TSX */
       x = s;
       INTERP_LOAD_NZ_FLAGS(x);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xBB: /* LAS aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xBB): /* LAS aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_LAS(), y);
       }
-      break;
-    case 0xBC: /* LDY abx */
+      INTERP_NEXT();
+    INTERP_CASE(0xBC): /* LDY abx */
       INTERP_MODE_ABr_READ(INTERP_INSTR_LDY(), x);
-      break;
-    case 0xBD: /* LDA abx */
+      INTERP_NEXT();
+    INTERP_CASE(0xBD): /* LDA abx */
       INTERP_MODE_ABr_READ(INTERP_INSTR_LDA(), x);
-      break;
-    case 0xBE: /* LDX aby */
+      INTERP_NEXT_PREDICT(0x9D, 0x99);
+    INTERP_CASE(0xBE): /* LDX aby */
       INTERP_MODE_ABr_READ(INTERP_INSTR_LDX(), y);
-      break;
-    case 0xBF: /* LAX aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xBF): /* LAX aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_LAX(), y);
       }
-      break;
-    case 0xC0: /* CPY imm */
+      INTERP_NEXT();
+    INTERP_CASE(0xC0): /* CPY imm */
       v = p_mem_read[pc + 1];
       INTERP_INSTR_CMP(y);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0xC1: /* CMP idx */
+      INTERP_NEXT_PREDICT(0xD0, 0xF0);
+    INTERP_CASE(0xC1): /* CMP idx */
       INTERP_MODE_IDX_READ(INTERP_INSTR_CMP(a));
-      break;
-    case 0xC3: /* DCP idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xC3): /* DCP idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_DCP());
       }
-      break;
-    case 0xC4: /* CPY zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xC4): /* CPY zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_CMP(y));
-      break;
-    case 0xC5: /* CMP zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xC5): /* CMP zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_CMP(a));
-      break;
-    case 0xC6: /* DEC zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xC6): /* DEC zpg */
       INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_DEC());
-      break;
-    case 0xC7: /* DCP zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xC7): /* DCP zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_DCP());
       }
-      break;
-    case 0xC8: /* INY */
+      INTERP_NEXT();
+    INTERP_CASE(0xC8): /* INY */
       y++;
       INTERP_LOAD_NZ_FLAGS(y);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xC9: /* CMP imm */
+      INTERP_NEXT_PREDICT(0xD0, 0xC0);
+    INTERP_CASE(0xC9): /* CMP imm */
       v = p_mem_read[pc + 1];
       INTERP_INSTR_CMP(a);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0xCA: /* DEX */
+      INTERP_NEXT_PREDICT(0xD0, 0xF0);
+    INTERP_CASE(0xCA): /* DEX */
       x--;
       INTERP_LOAD_NZ_FLAGS(x);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xCB: /* AXS imm */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT_PREDICT(0xD0, 0x10);
+    INTERP_CASE(0xCB): /* AXS imm */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -2513,68 +2626,68 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc += 2;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0xCC: /* CPY abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xCC): /* CPY abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_CMP(y));
-      break;
-    case 0xCD: /* CMP abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xCD): /* CMP abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_CMP(a));
-      break;
-    case 0xCE: /* DEC abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xCE): /* DEC abs */
       INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_DEC());
-      break;
-    case 0xCF: /* DCP abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xCF): /* DCP abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_DCP());
       }
-      break;
-    case 0xD0: /* BNE */
+      INTERP_NEXT();
+    INTERP_CASE(0xD0): /* BNE */
       INTERP_INSTR_BRANCH(!zf);
-      break;
-    case 0xD1: /* CMP idy */
+      INTERP_NEXT();
+    INTERP_CASE(0xD1): /* CMP idy */
       INTERP_MODE_IDY_READ(INTERP_INSTR_CMP(a));
-      break;
-    case 0xD2: /* KIL */ /* Undocumented. */ /* CMP id */
+      INTERP_NEXT();
+    INTERP_CASE(0xD2): /* KIL */ /* Undocumented. */ /* CMP id */
       if (is_65c12) {
         INTERP_MODE_ID_READ(INTERP_INSTR_CMP(a));
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0xD3: /* DCP idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xD3): /* DCP idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_DCP());
       }
-      break;
-    case 0xD5: /* CMP zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0xD5): /* CMP zpx */
       INTERP_MODE_ZPr_READ(INTERP_INSTR_CMP(a), x);
-      break;
-    case 0xD6: /* DEC zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0xD6): /* DEC zpx */
       INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_DEC());
-      break;
-    case 0xD7: /* DCP zpx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xD7): /* DCP zpx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_DCP());
       }
-      break;
-    case 0xD8: /* CLD */
+      INTERP_NEXT();
+    INTERP_CASE(0xD8): /* CLD */
       df = 0;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xD9: /* CMP aby */
+      INTERP_NEXT();
+    INTERP_CASE(0xD9): /* CMP aby */
       INTERP_MODE_ABr_READ(INTERP_INSTR_CMP(a), y);
-      break;
-    case 0xDA: /* NOP */ /* Undocumented. */ /* PHX */
+      INTERP_NEXT();
+    INTERP_CASE(0xDA): /* NOP */ /* Undocumented. */ /* PHX */
       if (is_65c12) {
         p_stack[s--] = x;
         pc++;
@@ -2583,44 +2696,44 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc++;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0xDB: /* DCP aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xDB): /* DCP aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_DCP(), y);
       }
-      break;
-    case 0xDC: /* NOP abx */ /* NOP abs */ /* Both undocumented. */
-    case 0xFC:
+      INTERP_NEXT();
+    INTERP_CASE(0xDC): /* NOP abx */ /* NOP abs */ /* Both undocumented. */
+    INTERP_CASE(0xFC):
       if (is_65c12) {
         INTERP_MODE_ABS_READ(INTERP_INSTR_NOP());
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_NOP(), x);
       }
-      break;
-    case 0xDD: /* CMP abx */
+      INTERP_NEXT();
+    INTERP_CASE(0xDD): /* CMP abx */
       INTERP_MODE_ABr_READ(INTERP_INSTR_CMP(a), x);
-      break;
-    case 0xDE: /* DEC abx */
+      INTERP_NEXT();
+    INTERP_CASE(0xDE): /* DEC abx */
       INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_DEC(), x);
-      break;
-    case 0xDF: /* DCP abx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xDF): /* DCP abx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_DCP(), x);
       }
-      break;
-    case 0xE0: /* CPX imm */
+      INTERP_NEXT();
+    INTERP_CASE(0xE0): /* CPX imm */
       v = p_mem_read[pc + 1];
       INTERP_INSTR_CMP(x);
       pc += 2;
       cycles_this_instruction = 2;
-      break;
-    case 0xE1: /* SBC idx */
+      INTERP_NEXT_PREDICT(0xD0, 0xF0);
+    INTERP_CASE(0xE1): /* SBC idx */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_IDX_READ(INTERP_INSTR_BCD_SBC());
@@ -2630,19 +2743,19 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_IDX_READ(INTERP_INSTR_SBC());
       }
-      break;
-    case 0xE3: /* ISC idx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xE3): /* ISC idx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDX_READ_WRITE(INTERP_INSTR_ISC());
       }
-      break;
-    case 0xE4: /* CPX zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xE4): /* CPX zpg */
       INTERP_MODE_ZPG_READ(INTERP_INSTR_CMP(x));
-      break;
-    case 0xE5: /* SBC zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xE5): /* SBC zpg */
       if (df) {
         INTERP_MODE_ZPG_READ(INTERP_INSTR_BCD_SBC());
         if (is_65c12) {
@@ -2651,25 +2764,25 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ZPG_READ(INTERP_INSTR_SBC());
       }
-      break;
-    case 0xE6: /* INC zpg */
+      INTERP_NEXT();
+    INTERP_CASE(0xE6): /* INC zpg */
       INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_INC());
-      break;
-    case 0xE7: /* ISC zpg */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xE7): /* ISC zpg */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPG_READ_WRITE(INTERP_INSTR_ISC());
       }
-      break;
-    case 0xE8: /* INX */
+      INTERP_NEXT();
+    INTERP_CASE(0xE8): /* INX */
       x++;
       INTERP_LOAD_NZ_FLAGS(x);
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xE9: /* SBC imm */
+      INTERP_NEXT_PREDICT(0xD0, 0xE0);
+    INTERP_CASE(0xE9): /* SBC imm */
       v = p_mem_read[pc + 1];
       pc += 2;
       cycles_this_instruction = 2;
@@ -2681,12 +2794,12 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_INSTR_SBC();
       }
-      break;
-    case 0xEA: /* NOP */
+      INTERP_NEXT();
+    INTERP_CASE(0xEA): /* NOP */
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xEB: /* SBC imm */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xEB): /* SBC imm */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
@@ -2700,11 +2813,11 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
           INTERP_INSTR_SBC();
         }
       }
-      break;
-    case 0xEC: /* CPX abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xEC): /* CPX abs */
       INTERP_MODE_ABS_READ(INTERP_INSTR_CMP(x));
-      break;
-    case 0xED: /* SBC abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xED): /* SBC abs */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_ABS_READ(INTERP_INSTR_BCD_SBC());
@@ -2714,22 +2827,22 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABS_READ(INTERP_INSTR_SBC());
       }
-      break;
-    case 0xEE: /* INC abs */
+      INTERP_NEXT();
+    INTERP_CASE(0xEE): /* INC abs */
       INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_INC());
-      break;
-    case 0xEF: /* ISC abs */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xEF): /* ISC abs */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABS_READ_WRITE(INTERP_INSTR_ISC());
       }
-      break;
-    case 0xF0: /* BEQ */
+      INTERP_NEXT();
+    INTERP_CASE(0xF0): /* BEQ */
       INTERP_INSTR_BRANCH(zf);
-      break;
-    case 0xF1: /* SBC idy */
+      INTERP_NEXT();
+    INTERP_CASE(0xF1): /* SBC idy */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_IDY_READ(INTERP_INSTR_BCD_SBC());
@@ -2739,8 +2852,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_IDY_READ(INTERP_INSTR_SBC());
       }
-      break;
-    case 0xF2: /* KIL */ /* Undocumented. */ /* SBC id */
+      INTERP_NEXT();
+    INTERP_CASE(0xF2): /* KIL */ /* Undocumented. */ /* SBC id */
       if (is_65c12) {
         if (df) {
           INTERP_MODE_BCD_ID_READ(INTERP_INSTR_BCD_SBC());
@@ -2750,16 +2863,16 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_INSTR_KIL();
       }
-      break;
-    case 0xF3: /* ISC idy */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xF3): /* ISC idy */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_IDY_READ_WRITE(INTERP_INSTR_ISC());
       }
-      break;
-    case 0xF5: /* SBC zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0xF5): /* SBC zpx */
       if (df) {
         INTERP_MODE_ZPr_READ(INTERP_INSTR_BCD_SBC(), x);
         if (is_65c12) {
@@ -2768,24 +2881,24 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ZPr_READ(INTERP_INSTR_SBC(), x);
       }
-      break;
-    case 0xF6: /* INC zpx */
+      INTERP_NEXT();
+    INTERP_CASE(0xF6): /* INC zpx */
       INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_INC());
-      break;
-    case 0xF7: /* ISC zpx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xF7): /* ISC zpx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ZPX_READ_WRITE(INTERP_INSTR_ISC());
       }
-      break;
-    case 0xF8: /* SED */
+      INTERP_NEXT();
+    INTERP_CASE(0xF8): /* SED */
       df = 1;
       pc++;
       cycles_this_instruction = 2;
-      break;
-    case 0xF9: /* SBC aby */
+      INTERP_NEXT();
+    INTERP_CASE(0xF9): /* SBC aby */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_SBC(), y);
@@ -2795,8 +2908,8 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_SBC(), y);
       }
-      break;
-    case 0xFA: /* NOP */ /* Undocumented. */ /* PLX */
+      INTERP_NEXT();
+    INTERP_CASE(0xFA): /* NOP */ /* Undocumented. */ /* PLX */
       if (is_65c12) {
         x = p_stack[++s];
         INTERP_LOAD_NZ_FLAGS(x);
@@ -2806,16 +2919,16 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
         pc++;
         cycles_this_instruction = 2;
       }
-      break;
-    case 0xFB: /* ISC aby */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xFB): /* ISC aby */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ISC(), y);
       }
-      break;
-    case 0xFD: /* SBC abx */
+      INTERP_NEXT();
+    INTERP_CASE(0xFD): /* SBC abx */
       if (df) {
         if (is_65c12) {
           INTERP_MODE_65c12_BCD_ABr_READ(INTERP_INSTR_BCD_SBC(), x);
@@ -2825,18 +2938,18 @@ interp_enter_with_countdown(struct interp_struct* p_interp, int64_t countdown) {
       } else {
         INTERP_MODE_ABr_READ(INTERP_INSTR_SBC(), x);
       }
-      break;
-    case 0xFE: /* INC abx */
+      INTERP_NEXT();
+    INTERP_CASE(0xFE): /* INC abx */
       INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_INC(), x);
-      break;
-    case 0xFF: /* ISC abx */ /* Undocumented. */ /* NOP1 */
+      INTERP_NEXT();
+    INTERP_CASE(0xFF): /* ISC abx */ /* Undocumented. */ /* NOP1 */
       if (is_65c12) {
         pc++;
         cycles_this_instruction = 1;
       } else {
         INTERP_MODE_ABr_READ_WRITE(INTERP_INSTR_ISC(), x);
       }
-      break;
+      INTERP_NEXT();
     default:
       assert(0);
       break;
@@ -2856,7 +2969,7 @@ do_special_checks:
        * opcode without drama.
        */
       opcode = p_mem_read[pc];
-      continue;
+      INTERP_DISPATCH();
     }
 
     poll_irq = (special_checks & k_interp_special_poll_irq);
@@ -2961,15 +3074,43 @@ check_irq:
       if (cpu_driver_flags & k_cpu_flag_exited) {
         break;
       }
-      if (cpu_driver_flags & (k_cpu_flag_soft_reset | k_cpu_flag_hard_reset)) {
+      special_checks &= ~k_interp_special_flags;
+      if ((cpu_driver_flags == k_cpu_flag_checkpoint) && do_irq) {
+        /* A checkpoint is taken between instructions, not half way into
+         * an interrupt. Try again at the next boundary.
+         */
+        special_checks |= k_interp_special_flags;
+      } else if (cpu_driver_flags & (k_cpu_flag_soft_reset |
+                                     k_cpu_flag_hard_reset |
+                                     k_cpu_flag_checkpoint)) {
         void (*do_reset_callback)(void* p, uint32_t flags) =
             p_interp->driver.do_reset_callback;
         if (do_reset_callback != NULL) {
+          /* Checkpoints save the CPU state and time, so they must be
+           * current.
+           */
+          INTERP_TIMING_ADVANCE(0);
+          flags = interp_get_flags(zf, nf, cf, of, df, intf);
+          state_6502_set_registers(p_state_6502, a, x, y, s, flags, pc);
           do_reset_callback(p_interp->driver.p_do_reset_callback_object,
                             cpu_driver_flags);
           state_6502_get_registers(p_state_6502, &a, &x, &y, &s, &flags, &pc);
           interp_set_flags(flags, &zf, &nf, &cf, &of, &df, &intf);
           do_irq = 0;
+          /* A loaded checkpoint may differ in IRQ state and memory mapping,
+           * so recalculate as if entering afresh.
+           */
+          special_checks &= ~(k_interp_special_poll_irq | k_interp_special_KIL);
+          if (p_state_6502->abi_state.irq_fire &&
+              (state_6502_check_irq_firing(p_state_6502,
+                                           k_state_6502_irq_nmi) ||
+               !intf)) {
+            special_checks |= k_interp_special_poll_irq;
+          }
+          read_callback_from =
+              p_memory_access->memory_read_needs_callback_from(p_memory_obj);
+          write_callback_from =
+              p_memory_access->memory_write_needs_callback_from(p_memory_obj);
 
           countdown = timing_get_countdown(p_timing);
         }
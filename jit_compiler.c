@@ -1,6 +1,7 @@
 #include "jit_compiler.h"
 
 #include "bbc_options.h"
+#include "debug.h"
 #include "defs_6502.h"
 #include "jit_metadata.h"
 #include "jit_opcode.h"
@@ -54,6 +55,7 @@ struct jit_compiler {
   struct jit_metadata* p_metadata;
   uint8_t* p_mem_read;
   int debug;
+  struct debug_struct* p_debug;
   int log_dynamic;
   uint8_t* p_opcode_types;
   uint8_t* p_opcode_modes;
@@ -83,6 +85,7 @@ struct jit_compiler {
   uint8_t addr_flags[k_6502_addr_space_size];
 
   struct jit_compile_history history[k_6502_addr_space_size];
+  uint64_t history_ticks;
   int32_t addr_cycles_fixup[k_6502_addr_space_size];
   int32_t addr_countdown_adjustment_fixup[k_6502_addr_space_size];
   int32_t addr_nz_fixup[k_6502_addr_space_size];
@@ -127,6 +130,7 @@ jit_compiler_create(struct asm_jit_struct* p_asm,
   p_compiler->p_metadata = p_metadata;
   p_compiler->p_mem_read = p_memory_access->p_mem_read;
   p_compiler->debug = debug;
+  p_compiler->p_debug = p_options->p_debug_object;
   p_compiler->p_opcode_types = p_opcode_types;
   p_compiler->p_opcode_modes = p_opcode_modes;
   p_compiler->p_opcode_mem = p_opcode_mem;
@@ -228,6 +232,7 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   uint16_t addr_plus_2 = (addr_6502 + 2);
   struct asm_uop* p_uop = &p_details->uops[0];
   struct asm_uop* p_first_post_debug_uop = p_uop;
+  int is_debug_site = 0;
   int use_interp = 0;
   int use_inturbo = 0;
   int uses_callback = 0;
@@ -286,10 +291,29 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   p_details->c_flag_location = 0;
   p_details->v_flag_location = 0;
 
-  if (p_compiler->debug) {
-    asm_make_uop1(p_uop, k_opcode_debug, addr_6502);
-    p_uop++;
-    p_first_post_debug_uop = p_uop;
+  if (p_compiler->debug &&
+      debug_needs_callback_at(p_compiler->p_debug, addr_6502)) {
+    if (!debug_is_callback_everywhere(p_compiler->p_debug)) {
+      /* The debugger may stop here and then want callouts at every
+       * instruction, so end the block after this instruction. The code after
+       * a callout site then always starts a block, which will be freshly
+       * compiled after the debugger invalidates everything.
+       */
+      uint16_t next_addr_6502 = (addr_6502 + p_details->num_bytes_6502);
+      p_compiler->addr_flags[next_addr_6502] |= k_addr_flag_block_start;
+    }
+
+    if (debug_needs_exact_callbacks(p_compiler->p_debug)) {
+      /* Bounce into the interpreter for this instruction, which calls the
+       * debugger itself. Reverse execution needs the exact cycle counts that
+       * only the interpreter has.
+       */
+      is_debug_site = 1;
+    } else {
+      asm_make_uop1(p_uop, k_opcode_debug, addr_6502);
+      p_uop++;
+      p_first_post_debug_uop = p_uop;
+    }
   }
 
   if ((optype == k_adc) || (optype == k_sbc)) {
@@ -460,10 +484,11 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   p_details->operand_6502 = operand_6502;
   is_addr_known = (p_details->min_6502_addr == p_details->max_6502_addr);
 
-  if (uses_callback) {
+  if (uses_callback || is_debug_site) {
     use_interp = 1;
   }
   if (uses_callback &&
+      !is_debug_site &&
       is_addr_known &&
       is_read &&
       !is_write &&
@@ -704,6 +729,7 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   }
 
   if (uses_callback &&
+      !is_debug_site &&
       is_addr_known &&
       ((optype == k_sta) || (optype == k_stx) || (optype == k_sty)) &&
       !p_compiler->option_no_encoded_callback) {
@@ -748,6 +774,8 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
     asm_make_uop1(p_uop, k_opcode_interp, addr_6502);
     p_uop++;
     p_details->ends_block = 1;
+    /* The interpreter takes care of any branch. */
+    p_details->opbranch_6502 = k_bra_n;
 
     p_details->num_uops = (p_uop - &p_details->uops[0]);
     assert(p_details->num_uops <= k_max_uops_per_opcode);
@@ -870,6 +898,25 @@ jit_compiler_get_opcode_details(struct jit_compiler* p_compiler,
   assert(p_details->num_uops <= k_max_uops_per_opcode);
 }
 
+static void
+jit_compiler_check_history_ticks(struct jit_compiler* p_compiler) {
+  uint32_t i;
+  uint32_t j;
+  uint64_t ticks = timing_get_total_timer_ticks(p_compiler->p_timing);
+
+  /* A replay rewinds time, which makes all the history from the future. */
+  if (ticks < p_compiler->history_ticks) {
+    /* Invalidations also clear the flag, so clear everything. */
+    for (i = 0; i < k_6502_addr_space_size; ++i) {
+      p_compiler->addr_flags[i] &= ~k_addr_flag_has_history;
+      for (j = 0; j < k_opcode_history_length; ++j) {
+        p_compiler->history[i].opcodes[j] = -1;
+      }
+    }
+  }
+  p_compiler->history_ticks = ticks;
+}
+
 static void
 jit_compiler_add_history(struct jit_compiler* p_compiler,
                          uint16_t addr_6502,
@@ -979,6 +1026,8 @@ jit_compiler_try_make_dynamic_opcode(struct jit_compiler* p_compiler,
   uint8_t opmode;
   struct asm_uop* p_uop;
   int32_t index;
+  int32_t find_uopcode;
+  int32_t new_uopcode;
   int32_t opcode_6502 = p_opcode->opcode_6502;
   uint16_t addr = p_opcode->addr_6502;
   uint16_t next_addr = (uint16_t) (addr + 1);
@@ -1040,6 +1089,51 @@ jit_compiler_try_make_dynamic_opcode(struct jit_compiler* p_compiler,
     p_uop = jit_opcode_insert_uop(p_opcode, index);
     asm_make_uop1(p_uop, k_opcode_addr_check, addr);
     break;
+  case k_rel:
+    /* Examples: Castle Quest. */
+    if (p_compiler->option_accurate_timings) {
+      /* Accurate timings charge an extra cycle if the taken branch crosses a
+       * page, which isn't known until the operand is read at runtime.
+       */
+      return;
+    }
+    if (!asm_jit_supports_uopcode(k_opcode_load_rel_offset)) {
+      return;
+    }
+    /* Every possible branch target must be in the address space so that the
+     * computed jump doesn't need to wrap.
+     */
+    if (((addr + 2) < 0x80) || ((addr + 2) > (0xFFFF - 0x7F))) {
+      return;
+    }
+    /* The branch is flipped to jump to the next opcode if not taken, and
+     * the fall through path calculates the target from the operand.
+     */
+    switch (optype) {
+    case k_bcc: find_uopcode = k_opcode_BCC; new_uopcode = k_opcode_BCS; break;
+    case k_bcs: find_uopcode = k_opcode_BCS; new_uopcode = k_opcode_BCC; break;
+    case k_beq: find_uopcode = k_opcode_BEQ; new_uopcode = k_opcode_BNE; break;
+    case k_bmi: find_uopcode = k_opcode_BMI; new_uopcode = k_opcode_BPL; break;
+    case k_bne: find_uopcode = k_opcode_BNE; new_uopcode = k_opcode_BEQ; break;
+    case k_bpl: find_uopcode = k_opcode_BPL; new_uopcode = k_opcode_BMI; break;
+    case k_bvc: find_uopcode = k_opcode_BVC; new_uopcode = k_opcode_BVS; break;
+    case k_bvs: find_uopcode = k_opcode_BVS; new_uopcode = k_opcode_BVC; break;
+    default:
+      /* BRA on the 65c12 is not a conditional branch. */
+      return;
+    }
+    p_uop = jit_opcode_find_uop(p_opcode, &index, find_uopcode);
+    assert(p_uop != NULL);
+    asm_make_uop1(p_uop,
+                  new_uopcode,
+                  (uintptr_t) jit_metadata_get_host_block_address(
+                      p_compiler->p_metadata, (uint16_t) (addr + 2)));
+    p_uop = jit_opcode_insert_uop(p_opcode, (index + 1));
+    asm_make_uop1(p_uop, k_opcode_load_rel_offset, next_addr);
+    p_uop = jit_opcode_insert_uop(p_opcode, (index + 2));
+    asm_make_uop1(p_uop, k_opcode_JMP_SCRATCH_n, (uint16_t) (addr + 2));
+    p_opcode->ends_block = 1;
+    break;
   case k_zpg:
     if (optype == k_bit) {
       /* x64 backend currently has trouble with BIT_addr. */
@@ -1247,7 +1341,12 @@ jit_compiler_check_dynamics(struct jit_compiler* p_compiler) {
       }
     }
 
+    /* Debugger memory breakpoints decide their callback sites from the operand
+     * at compile time, so operands must then stay static.
+     */
     if (!p_compiler->option_no_dynamic_operand &&
+        !(p_compiler->debug &&
+          debug_has_memory_breakpoints(p_compiler->p_debug)) &&
         (new_opcode_invalidate_count >= p_compiler->dynamic_trigger)) {
       is_dynamic_operand_match = 1;
       /* This can be a no-op if we don't support dynamic operands with this
@@ -1263,6 +1362,12 @@ jit_compiler_check_dynamics(struct jit_compiler* p_compiler) {
                      addr_6502,
                      opcode_6502);
         }
+        /* Dynamic branches jump away on both paths. */
+        if (p_details->ends_block) {
+          p_details += p_details->num_bytes_6502;
+          p_details->addr_6502 = -1;
+          break;
+        }
         continue;
       }
     }
@@ -1634,6 +1739,8 @@ jit_compiler_prepare_compile_block(struct jit_compiler* p_compiler,
     p_compiler->opcode_details[i_opcodes].addr_6502 = -1;
   }
 
+  jit_compiler_check_history_ticks(p_compiler);
+
   p_compiler->start_addr_6502 = start_addr_6502;
   p_compiler->sub_instruction_addr_6502 = -1;
 
@@ -1901,6 +2008,8 @@ jit_compiler_tag_address_as_dynamic(struct jit_compiler* p_compiler,
   uint64_t ticks = timing_get_total_timer_ticks(p_compiler->p_timing);
   struct jit_compile_history* p_history = &p_compiler->history[addr_6502];
 
+  jit_compiler_check_history_ticks(p_compiler);
+
   p_compiler->addr_flags[addr_6502] |= k_addr_flag_has_history;
   p_history->ring_buffer_index = 0;
 
@@ -486,6 +486,10 @@ jit_optimizer_collapse_indefinite_loops(struct jit_opcode_details* p_opcodes,
       if (target_addr != start_addr_6502) {
         is_collapsible = 0;
       }
+      /* The branch target isn't fixed if the operand is dynamic. */
+      if (p_opcode->is_dynamic_operand) {
+        is_collapsible = 0;
+      }
       branch_optype = optype;
       hit_branch = 1;
       break;
@@ -639,6 +643,9 @@ jit_optimizer_collapse_delay_loops(struct jit_opcode_details* p_opcodes,
       if (target_addr != start_addr_6502) {
         is_collapsible = 0;
       }
+      if (p_opcode->is_dynamic_operand) {
+        is_collapsible = 0;
+      }
       p_uop = jit_opcode_find_uop(p_opcode, &index, k_opcode_add_cycles);
       if (p_uop != NULL) {
         branch_fixup_cycles = p_uop->value1;
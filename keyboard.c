@@ -60,6 +60,8 @@ struct keyboard_struct {
   char* p_replay_file_name;
   uint32_t replay_timer_id;
   uint32_t rewind_timer_id;
+  /* Where the next rewind resumes the replay, 0 for the start. */
+  uint64_t checkpoint_replay_pos;
 
   uint8_t replay_next_num_keys;
   uint8_t replay_next_keys[k_keyboard_queue_size];
@@ -765,6 +767,46 @@ keyboard_power_on_reset(struct keyboard_struct* p_keyboard) {
       p_keyboard->p_physical_keyboard->bbc_keys[0][9 - i] = 1;
     }
   }
+
+  p_keyboard->checkpoint_replay_pos = 0;
+}
+
+void
+keyboard_save_checkpoint(struct keyboard_struct* p_keyboard,
+                         struct util_buffer* p_buf) {
+  uint64_t replay_pos = 0;
+
+  /* Frames up to now are in the capture, or have been read from the replay
+   * along with the next one.
+   */
+  if (p_keyboard->p_capture_file != NULL) {
+    replay_pos = util_file_get_pos(p_keyboard->p_capture_file);
+  } else if (p_keyboard->p_replay_file != NULL) {
+    replay_pos = util_file_get_pos(p_keyboard->p_replay_file);
+    replay_pos -= (sizeof(uint64_t) +
+                   sizeof(uint8_t) +
+                   (p_keyboard->replay_next_num_keys * 2));
+  }
+
+  util_buffer_add_chunk(p_buf,
+                        p_keyboard->p_active,
+                        sizeof(struct keyboard_state));
+  util_buffer_add_chunk(p_buf, &replay_pos, sizeof(replay_pos));
+}
+
+void
+keyboard_load_checkpoint(struct keyboard_struct* p_keyboard,
+                         struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf,
+                        p_keyboard->p_virtual_keyboard,
+                        sizeof(struct keyboard_state));
+  (void) memcpy(p_keyboard->p_physical_keyboard,
+                p_keyboard->p_virtual_keyboard,
+                sizeof(struct keyboard_state));
+  /* Picked up by the rewind that follows. */
+  util_buffer_get_chunk(p_buf,
+                        &p_keyboard->checkpoint_replay_pos,
+                        sizeof(p_keyboard->checkpoint_replay_pos));
 }
 
 void
@@ -791,6 +833,7 @@ keyboard_start_file_replay(struct keyboard_struct* p_keyboard,
                            struct util_file* p_file) {
   char buf[k_capture_header_size];
   uint64_t ret;
+  uint64_t replay_pos;
 
   assert(p_keyboard->p_replay_file == NULL);
   p_keyboard->p_replay_file = p_file;
@@ -808,6 +851,31 @@ keyboard_start_file_replay(struct keyboard_struct* p_keyboard,
                 k_capture_version_len);
   p_keyboard->replay_version[k_capture_version_len - 1] = '\0';
 
+  /* Resuming from a checkpoint skips the frames before it. A capture in
+   * progress keeps them, as is.
+   */
+  replay_pos = p_keyboard->checkpoint_replay_pos;
+  p_keyboard->checkpoint_replay_pos = 0;
+  if ((replay_pos > 0) && (p_keyboard->p_capture_file == NULL)) {
+    util_file_seek(p_file, replay_pos);
+  } else if (replay_pos > 0) {
+    uint8_t copy_buf[4096];
+    uint64_t to_go = (replay_pos - sizeof(buf));
+    while (to_go > 0) {
+      uint64_t length = sizeof(copy_buf);
+      if (to_go < length) {
+        length = to_go;
+      }
+      ret = util_file_read(p_file, copy_buf, length);
+      if (ret != length) {
+        util_bail("replay: file truncated before checkpoint");
+      }
+      util_file_write(p_keyboard->p_capture_file, copy_buf, length);
+      to_go -= length;
+    }
+    util_file_flush(p_keyboard->p_capture_file);
+  }
+
   (void) timing_start_timer_with_value(p_keyboard->p_timing,
                                        p_keyboard->replay_timer_id,
                                        0);
@@ -873,23 +941,16 @@ keyboard_end_replay(struct keyboard_struct* p_keyboard) {
 
 int
 keyboard_can_rewind(struct keyboard_struct* p_keyboard) {
-  int is_capturing;
-  int is_replaying;
-
-  /* Can't rewind if we're already rewinding. */
-  if (timing_timer_is_running(p_keyboard->p_timing,
-                              p_keyboard->rewind_timer_id)) {
-    return 0;
-  }
-
-  is_capturing = keyboard_is_capturing(p_keyboard);
-  is_replaying = keyboard_is_replaying(p_keyboard);
+  int is_capturing = keyboard_is_capturing(p_keyboard);
+  int is_replaying = keyboard_is_replaying(p_keyboard);
+  int is_rewinding = timing_timer_is_running(p_keyboard->p_timing,
+                                             p_keyboard->rewind_timer_id);
 
   /* We don't yet have a behavior decided if both replaying and capturing at
-   * the same time.
+   * the same time, except when that's a rewind of a capture in progress.
    */
   if (is_capturing && is_replaying) {
-    return 0;
+    return is_rewinding;
   }
 
   if (is_capturing || is_replaying) {
@@ -902,16 +963,40 @@ keyboard_can_rewind(struct keyboard_struct* p_keyboard) {
 void
 keyboard_rewind(struct keyboard_struct* p_keyboard, uint64_t stop_cycles) {
   struct timing_struct* p_timing = p_keyboard->p_timing;
+  uint64_t ticks = timing_get_total_timer_ticks(p_timing);
 
   int is_capturing = keyboard_is_capturing(p_keyboard);
   int is_replaying = keyboard_is_replaying(p_keyboard);
 
   /* Replay may have ended in the interim. */
   if (!is_capturing && !is_replaying) {
+    p_keyboard->checkpoint_replay_pos = 0;
     return;
   }
 
-  if (is_capturing) {
+  if (timing_timer_is_running(p_timing, p_keyboard->rewind_timer_id)) {
+    (void) timing_stop_timer(p_timing, p_keyboard->rewind_timer_id);
+  }
+
+  if (is_capturing && is_replaying) {
+    /* Rewinding again, part way through re-capturing a rewound capture. The
+     * replay file has the full capture, so re-capture from it again.
+     */
+    struct util_file* p_replay_file = p_keyboard->p_replay_file;
+    char* p_capture_file_name = p_keyboard->p_capture_file_name;
+
+    (void) timing_stop_timer(p_timing, p_keyboard->replay_timer_id);
+
+    util_file_close(p_keyboard->p_capture_file);
+    p_keyboard->p_capture_file = NULL;
+    p_keyboard->p_capture_file_name = NULL;
+    keyboard_set_capture_file_name(p_keyboard, p_capture_file_name);
+    util_free(p_capture_file_name);
+
+    p_keyboard->p_replay_file = NULL;
+    util_file_seek(p_replay_file, 0);
+    keyboard_start_file_replay(p_keyboard, p_replay_file);
+  } else if (is_capturing) {
     char* p_capture_file_name = p_keyboard->p_capture_file_name;
     char* p_new_replay_file_name = util_strdup2(p_capture_file_name, ".replay");
     util_file_close(p_keyboard->p_capture_file);
@@ -933,9 +1018,13 @@ keyboard_rewind(struct keyboard_struct* p_keyboard, uint64_t stop_cycles) {
     keyboard_start_file_replay(p_keyboard, p_replay_file);
   }
 
+  /* The machine may have been restored to a checkpoint rather than power
+   * on.
+   */
+  assert(stop_cycles >= ticks);
   (void) timing_start_timer_with_value(p_timing,
                                        p_keyboard->rewind_timer_id,
-                                       stop_cycles);
+                                       (stop_cycles - ticks));
 
   if (p_keyboard->log_replay) {
     log_do_log(k_log_keyboard,
@@ -7,6 +7,7 @@ struct keyboard_struct;
 
 struct bbc_options;
 struct timing_struct;
+struct util_buffer;
 
 enum {
   k_keyboard_key_escape = 128,
@@ -56,6 +57,10 @@ void keyboard_set_fast_mode_callback(struct keyboard_struct* p_keyboard,
                                      void* p_set_fast_mode_callback_object);
 
 void keyboard_power_on_reset(struct keyboard_struct* p_keyboard);
+void keyboard_save_checkpoint(struct keyboard_struct* p_keyboard,
+                              struct util_buffer* p_buf);
+void keyboard_load_checkpoint(struct keyboard_struct* p_keyboard,
+                              struct util_buffer* p_buf);
 
 void keyboard_set_capture_file_name(struct keyboard_struct* p_keyboard,
                                     const char* p_name);
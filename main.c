@@ -1,6 +1,7 @@
 #include "bbc.h"
 #include "config.h"
 #include "cpu_driver.h"
+#include "frames.h"
 #include "keyboard.h"
 #include "log.h"
 #include "os_channel.h"
@@ -41,6 +42,7 @@ static const char** s_argv;
 
 static void
 main_save_frame(const char* p_frames_dir,
+                struct frames_struct* p_frames,
                 uint32_t save_frame_count,
                 struct render_struct* p_render) {
   char file_name[256];
@@ -48,6 +50,11 @@ main_save_frame(const char* p_frames_dir,
   uint32_t* p_buffer = render_get_buffer(p_render);
   uint32_t size = render_get_buffer_size(p_render);
 
+  if (p_frames != NULL) {
+    frames_add(p_frames, p_buffer);
+    return;
+  }
+
   (void) snprintf(file_name,
                   sizeof(file_name),
                   "%s/beebjit_frame_%d.bgra",
@@ -101,6 +108,11 @@ beebjit_main(void) {
   const char* p_create_hfe_file = NULL;
   const char* p_create_hfe_spec = NULL;
   const char* p_frames_dir = ".";
+  const char* p_frames_file = NULL;
+  struct frames_struct* p_frames = NULL;
+  const char* p_frame_hashes_file = NULL;
+  int is_check_frame_hashes = 0;
+  struct frame_hashes_struct* p_frame_hashes = NULL;
   const char* p_commands = NULL;
   int debug_flag = 0;
   int run_flag = 0;
@@ -109,6 +121,7 @@ beebjit_main(void) {
   int test_flag = 0;
   int accurate_flag = 0;
   int test_map_flag = 0;
+  int test_bench_flag = 0;
   int disc_writeable_flag = 0;
   int disc_mutable_flag = 0;
   int terminal_flag = 0;
@@ -138,11 +151,16 @@ beebjit_main(void) {
   uint32_t save_frame_count = 0;
   uint64_t frame_cycles = 0;
   uint32_t max_frames = 1;
+  uint32_t frame_every = 1;
+  uint32_t frame_every_count = 0;
   int is_exit_on_max_frames_flag = 0;
+  int has_max_frames = 0;
   uint32_t keyboard_num_remaps = 0;
   uint8_t keyboard_remap_from[k_max_keyboard_remaps];
   uint8_t keyboard_remap_to[k_max_keyboard_remaps];
 
+  util_crc32_build_tables();
+
   if (asm_jit_is_default()) {
     mode = k_cpu_mode_jit;
   } else {
@@ -270,10 +288,28 @@ beebjit_main(void) {
       ++i_args;
     } else if (has_1 && !strcmp(arg, "-max-frames")) {
       max_frames = (uint32_t) util_parse_u64(val1, 0);
+      has_max_frames = 1;
       ++i_args;
     } else if (has_1 && !strcmp(arg, "-frames-dir")) {
       p_frames_dir = val1;
       ++i_args;
+    } else if (has_1 && !strcmp(arg, "-frames-file")) {
+      p_frames_file = val1;
+      ++i_args;
+    } else if (has_1 && !strcmp(arg, "-frame-every")) {
+      frame_every = (uint32_t) util_parse_u64(val1, 0);
+      if (frame_every == 0) {
+        util_bail("frame-every must be at least 1");
+      }
+      ++i_args;
+    } else if (has_1 && !strcmp(arg, "-frame-hashes")) {
+      p_frame_hashes_file = val1;
+      is_check_frame_hashes = 0;
+      ++i_args;
+    } else if (has_1 && !strcmp(arg, "-check-frame-hashes")) {
+      p_frame_hashes_file = val1;
+      is_check_frame_hashes = 1;
+      ++i_args;
     } else if (has_1 && !strcmp(arg, "-expect")) {
       expect = (uint32_t) util_parse_u64(val1, 1);
       ++i_args;
@@ -294,8 +330,9 @@ beebjit_main(void) {
       print_flag = 1;
     } else if (!strcmp(arg, "-fast")) {
       fast_flag = 1;
-    } else if (!strcmp(arg, "-test")) {
+    } else if (!strcmp(arg, "-test") || !strcmp(arg, "-test-bench")) {
       test_flag = 1;
+      test_bench_flag = !strcmp(arg, "-test-bench");
       test_map_flag = 1;
     } else if (!strcmp(arg, "-accurate")) {
       accurate_flag = 1;
@@ -391,9 +428,13 @@ beebjit_main(void) {
     } else if (!strcmp(arg, "-more")) {
       (void) printf(
 "-frame-cycles   <c>: start saving frame images after <c> cycles.\n"
-"-max-frames     <m>: max frame images to save, default 1.\n"
+"-max-frames     <m>: max frames to save, default 1, or all for hashes.\n"
 "-exit-on-max-frames: exit the process once max-frames is hit.\n"
 "-frames-dir     <d>: directory for frame files, default '.'.\n"
+"-frames-file    <f>: save frames compressed into one file, see frames_tool.\n"
+"-frame-every    <n>: save only every <n>th frame, default 1.\n"
+"-frame-hashes   <f>: save frame CRC32s to a file instead of images.\n"
+"-check-frame-hashes <f>: check frame CRC32s against a -frame-hashes file.\n"
 "-watford           : for a model B with a 1770, load Watford DDFS ROM.\n"
 "-opus              : for a model B with a 1770, load Opus DDOS ROM.\n"
 "-dfs12             : for a model B with an 8271, load newer DFS v1.2 ROM.\n"
@@ -414,6 +455,26 @@ beebjit_main(void) {
     has_sideways_ram = 1;
   }
 
+  if (p_frame_hashes_file != NULL) {
+    /* Frames must be rendered at every vsync, and vsync must be in virtual
+     * time, even in fast mode, or which frames get saved would depend on host
+     * speed.
+     */
+    char* p_old_opt_flags = p_opt_flags;
+    accurate_flag = 1;
+    p_opt_flags = util_strdup2(p_opt_flags, ",video:always-render");
+    util_free(p_old_opt_flags);
+    if (frame_cycles == 0) {
+      frame_cycles = 1;
+    }
+    /* Hashes are small, so hash every frame of the run by default rather than
+     * the single frame that's saved as an image by default.
+     */
+    if (!has_max_frames) {
+      max_frames = UINT32_MAX;
+    }
+  }
+
   if (util_has_option(p_log_flags, "os:addrs")) {
     log_do_log(k_log_misc,
                k_log_info,
@@ -482,6 +543,9 @@ beebjit_main(void) {
 
   if (test_flag) {
     test_do_tests(p_bbc);
+    if (test_bench_flag) {
+      test_do_benchmarks();
+    }
     exit(0);
   }
 
@@ -590,6 +654,11 @@ beebjit_main(void) {
     os_window_set_name(p_window, "beebjit technology preview");
     os_window_set_keyboard_callback(p_window, p_keyboard);
     os_window_set_focus_lost_callback(p_window, bbc_focus_lost_callback, p_bbc);
+    if (util_has_option(p_opt_flags, "os:paced-present")) {
+      uint32_t refresh_hz = 60;
+      (void) util_get_u32_option(&refresh_hz, p_opt_flags, "os:refresh-hz=");
+      os_window_set_paced(p_window, refresh_hz);
+    }
     p_render_buffer = os_window_get_buffer(p_window);
     render_set_buffer(p_render, p_render_buffer);
 
@@ -598,6 +667,21 @@ beebjit_main(void) {
     /* TODO: push this down into video.c. */
     render_create_internal_buffer(p_render);
   }
+  if (p_frame_hashes_file != NULL) {
+    p_frame_hashes = frame_hashes_create(p_frame_hashes_file,
+                                         is_check_frame_hashes);
+    if (p_frame_hashes == NULL) {
+      util_bail("couldn't open frame hashes file %s", p_frame_hashes_file);
+    }
+  }
+  if ((frame_cycles > 0) && (p_frames_file != NULL)) {
+    p_frames = frames_create(p_frames_file,
+                             render_get_width(p_render),
+                             render_get_height(p_render));
+    if (p_frames == NULL) {
+      util_bail("couldn't open frames file %s", p_frames_file);
+    }
+  }
 
   /* Do the power on reset before any of the below options that change state:
    * - Loading a state file.
@@ -717,6 +801,7 @@ beebjit_main(void) {
       int save_frame;
       uint64_t cycles;
       int do_ack_rendered;
+      uint64_t vsync_us;
 
       bbc_client_receive_message(p_bbc, &message);
       if (message.data[0] == k_message_exited) {
@@ -731,25 +816,47 @@ beebjit_main(void) {
       do_clear_after_paint = message.data[2];
       cycles = message.data[3];
       do_ack_rendered = message.data[4];
+      vsync_us = message.data[5];
 
       save_frame = 0;
       if ((frame_cycles > 0) &&
           (cycles >= frame_cycles) &&
           (save_frame_count < max_frames)) {
-        save_frame = 1;
+        save_frame = ((frame_every_count % frame_every) == 0);
+        frame_every_count++;
       }
       if (do_full_render) {
         video_render_full_frame(p_video);
       }
       render_process_full_buffer(p_render);
       if (window_open) {
-        os_window_sync_buffer_to_screen(p_window);
+        uint32_t start_line;
+        uint32_t num_lines;
+        os_window_set_vsync_time(p_window, vsync_us);
+        /* Static screens, e.g. menus, cost nothing to present. */
+        if (render_get_dirty_lines(p_render, &start_line, &num_lines)) {
+          os_window_sync_buffer_lines_to_screen(p_window,
+                                                start_line,
+                                                num_lines);
+        }
       }
       if (save_frame) {
-        main_save_frame(p_frames_dir, save_frame_count, p_render);
+        if (p_frame_hashes != NULL) {
+          frame_hashes_add(p_frame_hashes,
+                           cycles,
+                           render_get_buffer_crc32(p_render));
+        } else {
+          main_save_frame(p_frames_dir, p_frames, save_frame_count, p_render);
+        }
         save_frame_count++;
         if (is_exit_on_max_frames_flag && (save_frame_count == max_frames)) {
           log_do_log(k_log_misc, k_log_info, "save frame count exit");
+          if (p_frames != NULL) {
+            frames_destroy(p_frames);
+          }
+          if (p_frame_hashes != NULL) {
+            frame_hashes_destroy(p_frame_hashes);
+          }
           exit(0);
         }
       }
@@ -787,6 +894,12 @@ beebjit_main(void) {
   }
 
   os_poller_destroy(p_poller);
+  if (p_frames != NULL) {
+    frames_destroy(p_frames);
+  }
+  if (p_frame_hashes != NULL) {
+    frame_hashes_destroy(p_frame_hashes);
+  }
   if (p_window != NULL) {
     os_window_destroy(p_window);
   }
@@ -373,6 +373,18 @@ mc6850_power_on_reset(struct mc6850_struct* p_serial) {
   mc6850_reset(p_serial);
 }
 
+void
+mc6850_save_checkpoint(struct mc6850_struct* p_serial,
+                       struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_serial, sizeof(struct mc6850_struct));
+}
+
+void
+mc6850_load_checkpoint(struct mc6850_struct* p_serial,
+                       struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf, p_serial, sizeof(struct mc6850_struct));
+}
+
 uint8_t
 mc6850_read(struct mc6850_struct* p_serial, uint8_t reg) {
   if (reg == 0) {
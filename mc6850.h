@@ -8,6 +8,7 @@ struct mc6850_struct;
 struct bbc_options;
 struct state_6502;
 struct tape_struct;
+struct util_buffer;
 
 struct mc6850_struct* mc6850_create(struct state_6502* p_state_6502,
                                     struct bbc_options* p_options);
@@ -19,6 +20,10 @@ void mc6850_set_transmit_ready_callback(
     void* p_transmit_ready_object);
 
 void mc6850_power_on_reset(struct mc6850_struct* p_serial);
+void mc6850_save_checkpoint(struct mc6850_struct* p_serial,
+                            struct util_buffer* p_buf);
+void mc6850_load_checkpoint(struct mc6850_struct* p_serial,
+                            struct util_buffer* p_buf);
 
 uint8_t mc6850_read(struct mc6850_struct* p_serial, uint8_t reg);
 void mc6850_write(struct mc6850_struct* p_serial, uint8_t reg, uint8_t val);
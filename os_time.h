@@ -8,6 +8,7 @@ struct os_time_sleeper;
 void os_time_setup_hi_res(void);
 
 uint64_t os_time_get_us(void);
+uint64_t os_time_get_ns(void);
 
 struct os_time_sleeper* os_time_create_sleeper(void);
 void os_time_free_sleeper(struct os_time_sleeper* p_sleeper);
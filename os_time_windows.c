@@ -33,8 +33,8 @@ os_time_setup_hi_res(void) {
   }
 }
 
-uint64_t
-os_time_get_us() {
+static uint64_t
+os_time_get_scaled(double scale) {
   BOOL ret;
   LARGE_INTEGER li;
   uint64_t value;
@@ -58,11 +58,21 @@ os_time_get_us() {
   }
 
   value = li.QuadPart;
-  value *= ((double) 1000000.0 / s_frequency);
+  value *= (scale / s_frequency);
 
   return value;
 }
 
+uint64_t
+os_time_get_us() {
+  return os_time_get_scaled(1000000.0);
+}
+
+uint64_t
+os_time_get_ns() {
+  return os_time_get_scaled(1000000000.0);
+}
+
 struct os_time_sleeper*
 os_time_create_sleeper(void) {
   HANDLE handle;
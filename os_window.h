@@ -22,9 +22,25 @@ void os_window_set_focus_lost_callback(struct os_window_struct* p_window,
                                        void (*p_focus_lost_callback)(void* p),
                                        void* p_focus_lost_callback_object);
 
+/* Presents without waiting on the display: each frame is copied to one of
+ * two images, at most one is with the display at once, puts are spaced at
+ * least a host refresh apart and a newer frame replaces an unsent one. Call
+ * before os_window_get_buffer(). Only X11 implements this.
+ */
+void os_window_set_paced(struct os_window_struct* p_window,
+                         uint32_t refresh_hz);
+/* The host time of the emulated vsync that ended the frame about to be synced,
+ * for paced present latency stats.
+ */
+void os_window_set_vsync_time(struct os_window_struct* p_window,
+                              uint64_t time_us);
+
 uint32_t* os_window_get_buffer(struct os_window_struct* p_window);
 intptr_t os_window_get_handle(struct os_window_struct* p_window);
 void os_window_sync_buffer_to_screen(struct os_window_struct* p_window);
+void os_window_sync_buffer_lines_to_screen(struct os_window_struct* p_window,
+                                           uint32_t start_line,
+                                           uint32_t num_lines);
 void os_window_process_events(struct os_window_struct* p_window);
 int os_window_is_closed(struct os_window_struct* p_window);
 
@@ -1,6 +1,7 @@
 #include "os_window.h"
 
 #include "keyboard.h"
+#include "log.h"
 #include "os_thread.h"
 #include "util.h"
 
@@ -408,6 +409,21 @@ os_window_set_focus_lost_callback(struct os_window_struct* p_window,
   (void) p_focus_lost_callback_object;
 }
 
+void
+os_window_set_paced(struct os_window_struct* p_window, uint32_t refresh_hz) {
+  (void) p_window;
+  (void) refresh_hz;
+  log_do_log(k_log_misc,
+             k_log_warning,
+             "paced present not supported, presenting synchronously");
+}
+
+void
+os_window_set_vsync_time(struct os_window_struct* p_window, uint64_t time_us) {
+  (void) p_window;
+  (void) time_us;
+}
+
 uint32_t*
 os_window_get_buffer(struct os_window_struct* p_window) {
   return p_window->p_buffer;
@@ -446,6 +462,16 @@ os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
   });
 }
 
+void
+os_window_sync_buffer_lines_to_screen(struct os_window_struct* p_window,
+                                      uint32_t start_line,
+                                      uint32_t num_lines) {
+  /* The layer contents are replaced as a whole. */
+  (void) start_line;
+  (void) num_lines;
+  os_window_sync_buffer_to_screen(p_window);
+}
+
 void
 os_window_process_events(struct os_window_struct* p_window) {
   /* Deliberately empty.
@@ -46,6 +46,20 @@ os_window_set_focus_lost_callback(struct os_window_struct* p_window,
   util_bail("headless");
 }
 
+void
+os_window_set_paced(struct os_window_struct* p_window, uint32_t refresh_hz) {
+  (void) p_window;
+  (void) refresh_hz;
+  util_bail("headless");
+}
+
+void
+os_window_set_vsync_time(struct os_window_struct* p_window, uint64_t time_us) {
+  (void) p_window;
+  (void) time_us;
+  util_bail("headless");
+}
+
 uint32_t*
 os_window_get_buffer(struct os_window_struct* p_window) {
   (void) p_window;
@@ -66,6 +80,16 @@ os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
   util_bail("headless");
 }
 
+void
+os_window_sync_buffer_lines_to_screen(struct os_window_struct* p_window,
+                                      uint32_t start_line,
+                                      uint32_t num_lines) {
+  (void) p_window;
+  (void) start_line;
+  (void) num_lines;
+  util_bail("headless");
+}
+
 void
 os_window_process_events(struct os_window_struct* p_window) {
   (void) p_window;
@@ -1,6 +1,7 @@
 #include "os_window.h"
 
 #include "keyboard.h"
+#include "log.h"
 #include "util.h"
 
 #include <windows.h>
@@ -138,6 +139,24 @@ WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
       handled = 1;
     }
     break;
+  case WM_PAINT:
+    if (s_p_window->handle_draw_bitmap != NULL) {
+      /* Unchanged frames aren't blitted, so repaint damage directly. */
+      PAINTSTRUCT paint;
+      HDC handle_paint = BeginPaint(hwnd, &paint);
+      (void) BitBlt(handle_paint,
+                    paint.rcPaint.left,
+                    paint.rcPaint.top,
+                    (paint.rcPaint.right - paint.rcPaint.left),
+                    (paint.rcPaint.bottom - paint.rcPaint.top),
+                    s_p_window->handle_draw_bitmap,
+                    paint.rcPaint.left,
+                    paint.rcPaint.top,
+                    SRCCOPY);
+      (void) EndPaint(hwnd, &paint);
+      handled = 1;
+    }
+    break;
   case WM_DESTROY:
     s_p_window->is_destroyed = 1;
     break;
@@ -318,6 +337,21 @@ os_window_set_focus_lost_callback(struct os_window_struct* p_window,
   p_window->p_focus_lost_callback_object = p_focus_lost_callback_object;
 }
 
+void
+os_window_set_paced(struct os_window_struct* p_window, uint32_t refresh_hz) {
+  (void) p_window;
+  (void) refresh_hz;
+  log_do_log(k_log_misc,
+             k_log_warning,
+             "paced present not supported, presenting synchronously");
+}
+
+void
+os_window_set_vsync_time(struct os_window_struct* p_window, uint64_t time_us) {
+  (void) p_window;
+  (void) time_us;
+}
+
 uint32_t*
 os_window_get_buffer(struct os_window_struct* p_window) {
   return p_window->p_buffer;
@@ -334,25 +368,32 @@ os_window_get_handle(struct os_window_struct* p_window) {
 }
 
 void
-os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
+os_window_sync_buffer_lines_to_screen(struct os_window_struct* p_window,
+                                      uint32_t start_line,
+                                      uint32_t num_lines) {
   BOOL ret;
 
   HDC handle_draw = p_window->handle_draw;
 
   ret = BitBlt(handle_draw,
                0,
-               0,
+               start_line,
                p_window->width,
-               p_window->height,
+               num_lines,
                p_window->handle_draw_bitmap,
                0,
-               0,
+               start_line,
                SRCCOPY);
   if (ret == 0) {
     util_bail("BitBlt failed");
   }
 }
 
+void
+os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
+  os_window_sync_buffer_lines_to_screen(p_window, 0, p_window->height);
+}
+
 void
 os_window_process_events(struct os_window_struct* p_window) {
   MSG msg;
@@ -4,6 +4,7 @@
 #include "os_alloc.h"
 #include "os_x11_keys.h"
 #include "log.h"
+#include "os_time.h"
 #include "util.h"
 #include "video.h"
 
@@ -17,7 +18,9 @@
 
 #include <assert.h>
 #include <err.h>
+#include <inttypes.h>
 #include <pthread.h>
+#include <string.h>
 
 #include <sys/ipc.h>
 #include <sys/shm.h>
@@ -40,6 +43,36 @@ struct os_window_struct {
   uint8_t* p_key_map;
   Atom atom_delete_message;
   int is_deleted;
+
+  /* Paced presentation. The emulator renders into its own buffer and each
+   * frame is copied into whichever of the two images isn't with the server.
+   * The images are p_image and p_paced_image.
+   */
+  int is_paced;
+  uint64_t refresh_us;
+  uint32_t* p_render_buffer;
+  XImage* p_paced_image;
+  XShmSegmentInfo paced_shm_info;
+  void* p_paced_shm_start;
+  int shm_completion_type;
+  uint32_t front;
+  int is_in_flight;
+  int is_pending;
+  /* Lines of each image that are behind the render buffer. */
+  uint32_t stale_start[2];
+  uint32_t stale_end[2];
+  /* Lines of the pending image that differ from the window. */
+  uint32_t put_start;
+  uint32_t put_end;
+  uint64_t last_put_us;
+  uint64_t vsync_us;
+  uint64_t pending_vsync_us;
+  uint64_t in_flight_vsync_us;
+  uint64_t num_presented;
+  uint64_t num_dropped;
+  uint64_t latency_total_us;
+  uint64_t latency_min_us;
+  uint64_t latency_max_us;
 };
 
 static XErrorEvent s_last_error_event;
@@ -297,7 +330,10 @@ os_window_create(uint32_t width, uint32_t height) {
 
   ret = XSelectInput(p_window->d,
                      p_window->w,
-                     (KeyPressMask | KeyReleaseMask | FocusChangeMask));
+                     (KeyPressMask |
+                      KeyReleaseMask |
+                      FocusChangeMask |
+                      ExposureMask));
   if (ret != 1) {
     errx(1, "XSelectInput failed");
   }
@@ -348,6 +384,37 @@ os_window_destroy(struct os_window_struct* p_window) {
     errx(1, "XDestroyWindow failed");
   }
 
+  if (p_window->is_paced) {
+    uint64_t latency_avg_us = 0;
+    if (p_window->num_presented > 0) {
+      latency_avg_us = (p_window->latency_total_us / p_window->num_presented);
+    }
+    log_do_log(k_log_perf,
+               k_log_info,
+               "paced present: %"PRIu64" frames, %"PRIu64" dropped, "
+                   "vsync to put latency us min %"PRIu64" avg %"PRIu64
+                   " max %"PRIu64,
+               p_window->num_presented,
+               p_window->num_dropped,
+               p_window->latency_min_us,
+               latency_avg_us,
+               p_window->latency_max_us);
+
+    bool_ret = XShmDetach(p_window->d, &p_window->paced_shm_info);
+    if (bool_ret != True) {
+      errx(1, "XShmDetach failed");
+    }
+    ret = XDestroyImage(p_window->p_paced_image);
+    if (ret != 1) {
+      errx(1, "XDestroyImage failed");
+    }
+    ret = shmdt(p_window->p_paced_shm_start);
+    if (ret != 0) {
+      errx(1, "shmdt failed");
+    }
+    util_free(p_window->p_render_buffer);
+  }
+
   if (p_window->use_mit_shm) {
     bool_ret = XShmDetach(p_window->d, &p_window->shm_info);
     if (bool_ret != True) {
@@ -393,6 +460,9 @@ os_window_set_focus_lost_callback(struct os_window_struct* p_window,
 
 uint32_t*
 os_window_get_buffer(struct os_window_struct* p_window) {
+  if (p_window->is_paced) {
+    return p_window->p_render_buffer;
+  }
   return (uint32_t*) p_window->p_image_data;
 }
 
@@ -405,21 +475,248 @@ os_window_get_handle(struct os_window_struct* p_window) {
 }
 
 void
-os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
+os_window_set_paced(struct os_window_struct* p_window, uint32_t refresh_hz) {
+  Bool bool_ret;
   int ret;
+  int shmid;
+  void* p_shm_start;
+
+  Display* d = p_window->d;
+  uint32_t width = p_window->width;
+  uint32_t height = p_window->height;
+
+  assert(!p_window->is_paced);
+
+  if (!p_window->use_mit_shm) {
+    log_do_log(k_log_misc,
+               k_log_warning,
+               "paced present needs MIT-SHM, presenting synchronously");
+    return;
+  }
+
+  /* No guard pages here: the emulator never renders into this image. */
+  shmid = shmget(IPC_PRIVATE, (width * height * 4), (IPC_CREAT | 0600));
+  if (shmid < 0) {
+    errx(1, "shmget failed");
+  }
+  p_shm_start = shmat(shmid, NULL, 0);
+  if (p_shm_start == (void*) -1) {
+    (void) shmctl(shmid, IPC_RMID, NULL);
+    errx(1, "shmat failed");
+  }
+
+  p_window->p_paced_image = XShmCreateImage(d,
+                                            DefaultVisual(d, DefaultScreen(d)),
+                                            24,
+                                            ZPixmap,
+                                            NULL,
+                                            &p_window->paced_shm_info,
+                                            width,
+                                            height);
+  if (p_window->p_paced_image == NULL) {
+    (void) shmctl(shmid, IPC_RMID, NULL);
+    errx(1, "XShmCreateImage failed");
+  }
+  p_window->paced_shm_info.shmid = shmid;
+  p_window->paced_shm_info.shmaddr = p_shm_start;
+  p_window->paced_shm_info.readOnly = False;
+  p_window->p_paced_image->data = p_shm_start;
+  p_window->p_paced_shm_start = p_shm_start;
+
+  /* The first image attached fine, so this one will too. */
+  bool_ret = XShmAttach(d, &p_window->paced_shm_info);
+  ret = XSync(d, False);
+  (void) shmctl(shmid, IPC_RMID, NULL);
+  if ((bool_ret != True) || (ret != 1)) {
+    errx(1, "XShmAttach failed");
+  }
+
+  p_window->p_render_buffer = util_mallocz(width * height * 4);
+  p_window->shm_completion_type = (XShmGetEventBase(d) + ShmCompletion);
+  p_window->refresh_us = 0;
+  if (refresh_hz > 0) {
+    p_window->refresh_us = (1000000 / refresh_hz);
+  }
+  p_window->latency_min_us = UINT64_MAX;
+  p_window->is_paced = 1;
+}
+
+static XImage*
+os_window_get_paced_image(struct os_window_struct* p_window, uint32_t index) {
+  if (index == 0) {
+    return p_window->p_image;
+  }
+  return p_window->p_paced_image;
+}
+
+static void
+os_window_extend_lines(uint32_t* p_start,
+                       uint32_t* p_end,
+                       uint32_t start_line,
+                       uint32_t end_line) {
+  if (*p_start == *p_end) {
+    *p_start = start_line;
+    *p_end = end_line;
+    return;
+  }
+  if (start_line < *p_start) {
+    *p_start = start_line;
+  }
+  if (end_line > *p_end) {
+    *p_end = end_line;
+  }
+}
+
+static void
+os_window_paced_try_put(struct os_window_struct* p_window) {
+  uint32_t back;
+  Bool bool_ret;
+  uint64_t time_us;
+
+  if (!p_window->is_pending || p_window->is_in_flight) {
+    return;
+  }
+  /* A frame arriving within a refresh of the last one waits for the next
+   * vsync or X event; the host couldn't show both anyway.
+   */
+  time_us = os_time_get_us();
+  if ((time_us - p_window->last_put_us) < p_window->refresh_us) {
+    return;
+  }
+
+  back = (p_window->front ^ 1);
+  /* Ask for a completion event rather than waiting for the server. */
+  bool_ret = XShmPutImage(p_window->d,
+                          p_window->w,
+                          p_window->gc,
+                          os_window_get_paced_image(p_window, back),
+                          0,
+                          p_window->put_start,
+                          0,
+                          p_window->put_start,
+                          p_window->width,
+                          (p_window->put_end - p_window->put_start),
+                          True);
+  if (bool_ret != True) {
+    errx(1, "XShmPutImage failed");
+  }
+  (void) XFlush(p_window->d);
+
+  p_window->front = back;
+  p_window->is_in_flight = 1;
+  p_window->is_pending = 0;
+  p_window->put_start = 0;
+  p_window->put_end = 0;
+  p_window->last_put_us = time_us;
+  p_window->in_flight_vsync_us = p_window->pending_vsync_us;
+}
+
+void
+os_window_set_vsync_time(struct os_window_struct* p_window, uint64_t time_us) {
+  p_window->vsync_us = time_us;
+  /* Called every vsync, dirty or not, so a put held back by the refresh
+   * interval still goes out when the screen then stays static.
+   */
+  if (p_window->is_paced) {
+    os_window_paced_try_put(p_window);
+  }
+}
+
+static void
+os_window_paced_put_done(struct os_window_struct* p_window) {
+  uint64_t latency_us;
+
+  assert(p_window->is_in_flight);
+  p_window->is_in_flight = 0;
+
+  if (p_window->in_flight_vsync_us != 0) {
+    latency_us = (os_time_get_us() - p_window->in_flight_vsync_us);
+    p_window->num_presented++;
+    p_window->latency_total_us += latency_us;
+    if (latency_us < p_window->latency_min_us) {
+      p_window->latency_min_us = latency_us;
+    }
+    if (latency_us > p_window->latency_max_us) {
+      p_window->latency_max_us = latency_us;
+    }
+  }
+
+  os_window_paced_try_put(p_window);
+}
+
+static void
+os_window_paced_sync(struct os_window_struct* p_window,
+                     uint32_t start_line,
+                     uint32_t end_line) {
+  uint32_t line;
+  uint32_t back = (p_window->front ^ 1);
+  XImage* p_back_image = os_window_get_paced_image(p_window, back);
+  uint32_t line_size = (p_window->width * 4);
+
+  /* The back image is never with the server, so the frame is copied now and
+   * the buffer is free for the next one on return. An unsent frame is
+   * replaced.
+   */
+  if (p_window->is_pending) {
+    p_window->num_dropped++;
+  }
+
+  os_window_extend_lines(&p_window->stale_start[back],
+                         &p_window->stale_end[back],
+                         start_line,
+                         end_line);
+  for (line = p_window->stale_start[back];
+       line < p_window->stale_end[back];
+       ++line) {
+    (void) memcpy((p_back_image->data + (line * line_size)),
+                  (p_window->p_render_buffer + (line * p_window->width)),
+                  line_size);
+  }
+  p_window->stale_start[back] = 0;
+  p_window->stale_end[back] = 0;
+  os_window_extend_lines(&p_window->stale_start[back ^ 1],
+                         &p_window->stale_end[back ^ 1],
+                         start_line,
+                         end_line);
+  os_window_extend_lines(&p_window->put_start,
+                         &p_window->put_end,
+                         start_line,
+                         end_line);
+
+  p_window->is_pending = 1;
+  p_window->pending_vsync_us = p_window->vsync_us;
+
+  os_window_paced_try_put(p_window);
+}
+
+static void
+os_window_put_lines(struct os_window_struct* p_window,
+                    uint32_t start_line,
+                    uint32_t num_lines) {
+  if (start_line >= p_window->height) {
+    return;
+  }
+  if (num_lines > (p_window->height - start_line)) {
+    num_lines = (p_window->height - start_line);
+  }
 
   if (p_window->use_mit_shm) {
-    Bool bool_ret = XShmPutImage(p_window->d,
-                                 p_window->w,
-                                 p_window->gc,
-                                 p_window->p_image,
-                                 0,
-                                 0,
-                                 0,
-                                 0,
-                                 p_window->width,
-                                 p_window->height,
-                                 False);
+    XImage* p_image = p_window->p_image;
+    Bool bool_ret;
+    if (p_window->is_paced) {
+      p_image = os_window_get_paced_image(p_window, p_window->front);
+    }
+    bool_ret = XShmPutImage(p_window->d,
+                            p_window->w,
+                            p_window->gc,
+                            p_image,
+                            0,
+                            start_line,
+                            0,
+                            start_line,
+                            p_window->width,
+                            num_lines,
+                            False);
     if (bool_ret != True) {
       errx(1, "XShmPutImage failed");
     }
@@ -430,12 +727,33 @@ os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
                      p_window->gc,
                      p_window->p_image,
                      0,
+                     start_line,
                      0,
-                     0,
-                     0,
+                     start_line,
                      p_window->width,
-                     p_window->height);
+                     num_lines);
   }
+}
+
+void
+os_window_sync_buffer_lines_to_screen(struct os_window_struct* p_window,
+                                      uint32_t start_line,
+                                      uint32_t num_lines) {
+  int ret;
+
+  if (p_window->is_paced) {
+    if (start_line >= p_window->height) {
+      return;
+    }
+    if (num_lines > (p_window->height - start_line)) {
+      num_lines = (p_window->height - start_line);
+    }
+    os_window_paced_sync(p_window, start_line, (start_line + num_lines));
+    os_window_process_events(p_window);
+    return;
+  }
+
+  os_window_put_lines(p_window, start_line, num_lines);
 
   /* We need to sync here so that the server ack's it has finished the
    * XShmPutImage. Clients of this function expect to be able to start writing
@@ -455,6 +773,11 @@ os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
   os_window_process_events(p_window);
 }
 
+void
+os_window_sync_buffer_to_screen(struct os_window_struct* p_window) {
+  os_window_sync_buffer_lines_to_screen(p_window, 0, p_window->height);
+}
+
 static uint8_t
 os_window_convert_key_code(struct os_window_struct* p_window,
                            uint32_t keycode) {
@@ -527,11 +850,28 @@ os_window_process_events(struct os_window_struct* p_window) {
         p_window->p_focus_lost_callback(p_window->p_focus_lost_callback_object);
       }
       break;
+    case Expose:
+      /* Unchanged frames aren't pushed to the server, so repaint damage
+       * directly.
+       */
+      os_window_put_lines(p_window,
+                          event.xexpose.y,
+                          event.xexpose.height);
+      break;
     default:
+      if (p_window->is_paced &&
+          (event.type == p_window->shm_completion_type)) {
+        os_window_paced_put_done(p_window);
+        break;
+      }
       /* Various events cannot be masked, so we just ignore them. */
       break;
     }
   }
+
+  if (p_window->is_paced) {
+    os_window_paced_try_put(p_window);
+  }
 }
 
 int
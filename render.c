@@ -4,9 +4,21 @@
 #include "teletext.h"
 #include "util.h"
 
+#include "os_channel.h"
+#include "os_thread.h"
+
 #include <assert.h>
 #include <string.h>
 
+/* SSE2 and NEON are baseline on x64 and arm64, so the pixel kernels pick them
+ * at compile time, like the rest of the platform specific code.
+ */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 enum {
   k_render_mode0 = 0,
   k_render_mode1 = 1,
@@ -17,6 +29,58 @@ enum {
   k_render_mode8 = 6,
   k_render_mode4_80 = 7,
   k_render_mode2_10 = 8,
+  k_render_num_modes = 9,
+};
+
+enum {
+  k_render_queue_chunk_words = (16 * 1024),
+  k_render_queue_num_chunks = 4,
+  /* Room left at the end of a chunk for the longest command. */
+  k_render_queue_max_command_words = 4,
+};
+
+/* Render thread command words. The top byte is the command and the low bytes
+ * are its arguments. The pixel commands write at the render thread's position
+ * and then advance it; the set position command moves it.
+ */
+enum {
+  k_render_command_2MHz = 1,
+  k_render_command_1MHz = 2,
+  k_render_command_teletext = 3,
+  /* Followed by a pixel offset into the buffer. */
+  k_render_command_set_pos = 4,
+  k_render_command_set_mode = 5,
+  k_render_command_prepare = 6,
+  k_render_command_set_flash = 7,
+  k_render_command_set_physical_color = 8,
+  /* Followed by the rgba value. */
+  k_render_command_set_palette = 9,
+  k_render_command_teletext_RA_ISV = 10,
+  k_render_command_teletext_DISPEN = 11,
+  k_render_command_teletext_VSYNC = 12,
+  /* Followed by a pixel offset for the row, and the argb value. */
+  k_render_command_horiz_line = 13,
+  k_render_command_grayscale = 14,
+  /* Expands the indexed buffer to host pixels. Bit 0 is set at frame end. */
+  k_render_command_present = 15,
+};
+
+enum {
+  k_render_flag_blank = 0x100,
+  /* Only the second row of the 2 row pixel block. */
+  k_render_flag_odd_row = 0x200,
+  k_render_flag_both_rows = 0x400,
+  k_render_flag_cursor = 0x800,
+  /* Teletext data bytes are queued for off-screen characters too. */
+  k_render_flag_teletext_render = 0x1000,
+};
+
+/* Filled chunks are handed to the render thread in order. A zero length asks
+ * the thread to exit.
+ */
+struct render_queue_message {
+  uint32_t chunk_index;
+  uint32_t length;
 };
 
 struct render_struct;
@@ -81,11 +145,60 @@ struct render_struct {
   int32_t cursor_segment_index;
   int cursor_segments[4];
   int is_crt_grayscale_fakeout;
+  /* Dirty line tracking. Each pair of buffer lines records the last frame
+   * that wrote different pixels to it. Only the thread writing pixels updates
+   * these.
+   */
+  uint32_t* p_dirty_frames;
+  uint32_t* p_dirty_mark;
+  uint32_t dirty_frame;
+  uint32_t presented_frame;
+  uint8_t grayscale_r[256];
+  uint8_t grayscale_g[256];
+  uint8_t grayscale_b[256];
+
+  /* Indexed rendering, only done by the render thread. Pixels are written as
+   * one byte color indexes and changed lines are expanded to host pixels once
+   * a frame.
+   */
+  uint8_t* p_index_buffer;
+  uint8_t index_tables[k_render_num_modes][256 * 16];
+  const uint8_t* p_index_table;
+  uint8_t index_character_black[16];
+  uint32_t index_colors[256];
+  uint32_t line_colors[k_render_index_num_lines];
+  uint32_t num_line_colors;
+  uint32_t expanded_frame;
+
+  /* Render thread. The emulation thread keeps the beam and flyback logic
+   * above, so flyback happens at the same emulated time, and queues the pixel
+   * and teletext work. p_thread_render is the render thread's own copy of the
+   * palette, tables and mode, kept up to date via the queue.
+   */
+  struct render_struct* p_thread_render;
+  struct os_thread_struct* p_thread;
+  intptr_t handle_thread_read;
+  intptr_t handle_client_write;
+  intptr_t handle_client_read;
+  intptr_t handle_thread_write;
+  uint32_t* p_queue_chunks[k_render_queue_num_chunks];
+  uint32_t queue_chunk_index;
+  uint32_t queue_chunks_busy;
+  uint32_t* p_queue_pos;
+  uint32_t* p_queue_end;
+  /* Where the render thread will write the next pixels. */
+  uint32_t queue_render_offset;
+  int queue_teletext_dispen;
+  int queue_teletext_ra_isv;
+  uint32_t* p_thread_pos;
+  uint8_t* p_thread_index_pos;
 
   /* Options. */
   int is_double_size;
   int do_deinterlace_teletext;
   int do_deinterlace_bitmap;
+  int is_render_thread_allowed;
+  int is_indexed;
 };
 
 struct render_struct*
@@ -133,6 +246,11 @@ render_create(struct teletext_struct* p_teletext,
   if (util_has_option(p_opt_flags, "video:no-deinterlace-bitmap")) {
     p_render->do_deinterlace_bitmap = 0;
   }
+  p_render->is_render_thread_allowed = 1;
+  if (util_has_option(p_opt_flags, "video:no-render-thread")) {
+    p_render->is_render_thread_allowed = 0;
+  }
+  p_render->is_indexed = util_has_option(p_opt_flags, "video:indexed");
   (void) util_get_u32_hex_option(&background_color,
                                  p_opt_flags,
                                  "video:background=");
@@ -193,6 +311,15 @@ render_create(struct teletext_struct* p_teletext,
         p_render->render_character_2MHz_black;
   }
 
+  for (i = 0; i < 256; ++i) {
+    /* These constants are from: https://en.wikipedia.org/wiki/Grayscale
+     * "Luma coding in video systems", for PAL.
+     */
+    p_render->grayscale_r[i] = (uint8_t) (i * 0.29);
+    p_render->grayscale_g[i] = (uint8_t) (i * 0.58);
+    p_render->grayscale_b[i] = (uint8_t) (i * 0.11);
+  }
+
   if (background_color != 0) {
     teletext_set_black_rgb(p_teletext, background_color);
   }
@@ -200,11 +327,808 @@ render_create(struct teletext_struct* p_teletext,
   return p_render;
 }
 
+static inline uint32_t
+render_get_grayscale_pixel(struct render_struct* p_render, uint32_t pixel) {
+  /* Table lookups give the same truncation as the floating point multiplies
+   * they replace, and don't vectorize anyway.
+   */
+  uint8_t grey = (p_render->grayscale_r[(pixel >> 16) & 0xFF] +
+                  p_render->grayscale_g[(pixel >> 8) & 0xFF] +
+                  p_render->grayscale_b[pixel & 0xFF]);
+  pixel = (grey | (grey << 8) | (grey << 16));
+  /* Merge alpha back in. */
+  pixel |= 0xff000000;
+  return pixel;
+}
+
+static void
+render_convert_to_grayscale(struct render_struct* p_render) {
+  uint32_t i;
+  uint32_t num_pixels = (p_render->width * p_render->height);
+  uint32_t* p_buffer = p_render->p_buffer;
+
+  if (p_buffer == NULL) {
+    return;
+  }
+
+  for (i = 0; i < num_pixels; ++i) {
+    p_buffer[i] = render_get_grayscale_pixel(p_render, p_buffer[i]);
+  }
+}
+
+static void
+render_fill_pixels(uint32_t* p_pixels, uint32_t num_pixels, uint32_t value) {
+  uint32_t i = 0;
+#if defined(__SSE2__)
+  __m128i fill = _mm_set1_epi32((int) value);
+  for (; (i + 4) <= num_pixels; i += 4) {
+    _mm_storeu_si128((__m128i*) &p_pixels[i], fill);
+  }
+#elif defined(__ARM_NEON)
+  uint32x4_t fill = vdupq_n_u32(value);
+  for (; (i + 4) <= num_pixels; i += 4) {
+    vst1q_u32(&p_pixels[i], fill);
+  }
+#endif
+  for (; i < num_pixels; ++i) {
+    p_pixels[i] = value;
+  }
+}
+
+static void
+render_double_pixels(uint32_t* p_pixels, uint32_t num_pixels) {
+  /* In place, so work backwards to not overwrite pixels not yet read. */
+  uint32_t i = num_pixels;
+  while (i & 3) {
+    i--;
+    p_pixels[i * 2] = p_pixels[i];
+    p_pixels[(i * 2) + 1] = p_pixels[i];
+  }
+#if defined(__SSE2__)
+  while (i > 0) {
+    __m128i pixels;
+    i -= 4;
+    pixels = _mm_loadu_si128((__m128i*) &p_pixels[i]);
+    _mm_storeu_si128((__m128i*) &p_pixels[i * 2],
+                     _mm_unpacklo_epi32(pixels, pixels));
+    _mm_storeu_si128((__m128i*) &p_pixels[(i * 2) + 4],
+                     _mm_unpackhi_epi32(pixels, pixels));
+  }
+#elif defined(__ARM_NEON)
+  while (i > 0) {
+    uint32x4x2_t pixels;
+    i -= 4;
+    pixels.val[0] = vld1q_u32(&p_pixels[i]);
+    pixels.val[1] = pixels.val[0];
+    vst2q_u32(&p_pixels[i * 2], pixels);
+  }
+#endif
+  while (i > 0) {
+    i--;
+    p_pixels[i * 2] = p_pixels[i];
+    p_pixels[(i * 2) + 1] = p_pixels[i];
+  }
+}
+
+static inline void
+render_invert_cursor(uint32_t* p_render_pos,
+                     uint32_t* p_next_render_pos,
+                     uint32_t num_pixels) {
+  uint32_t i;
+  for (i = 0; i < num_pixels; ++i) {
+    p_render_pos[i] ^= 0x00ffffff;
+    if (p_next_render_pos != NULL) {
+      p_next_render_pos[i] ^= 0x00ffffff;
+    }
+  }
+}
+
+static inline void
+render_mark_dirty(struct render_struct* p_render) {
+  *p_render->p_dirty_mark = p_render->dirty_frame;
+}
+
+static void
+render_mark_all_dirty(struct render_struct* p_render, uint32_t frame) {
+  uint32_t i;
+  for (i = 0; i < (p_render->height / 2); ++i) {
+    p_render->p_dirty_frames[i] = frame;
+  }
+}
+
+static inline void
+render_set_dirty_mark(struct render_struct* p_render, uint32_t offset) {
+  p_render->p_dirty_mark =
+      &p_render->p_dirty_frames[offset / (p_render->width * 2)];
+}
+
+/* Copies pixels while comparing them against the ones they replace, in one
+ * pass rather than a memcmp and then a copy. Returns non-zero if any differ.
+ */
+static inline uint32_t
+render_copy_compare(uint32_t* p_dest,
+                    const uint32_t* p_src,
+                    uint32_t num_pixels) {
+  uint32_t i;
+  uint32_t diff = 0;
+  for (i = 0; i < num_pixels; ++i) {
+    diff |= (p_dest[i] ^ p_src[i]);
+    p_dest[i] = p_src[i];
+  }
+  return diff;
+}
+
+static inline void
+render_store_2MHz(struct render_struct* p_render,
+                  uint32_t* p_render_pos,
+                  const struct render_character_2MHz* p_value) {
+  struct render_character_2MHz* p_dest =
+      (struct render_character_2MHz*) p_render_pos;
+  /* Once the line pair differs this frame, there's no need to compare. */
+  if (*p_render->p_dirty_mark == p_render->dirty_frame) {
+    *p_dest = *p_value;
+  } else if (render_copy_compare(p_render_pos, &p_value->host_pixels[0], 8)) {
+    render_mark_dirty(p_render);
+  }
+}
+
+static inline void
+render_store_1MHz(struct render_struct* p_render,
+                  uint32_t* p_render_pos,
+                  const struct render_character_1MHz* p_value) {
+  struct render_character_1MHz* p_dest =
+      (struct render_character_1MHz*) p_render_pos;
+  if (*p_render->p_dirty_mark == p_render->dirty_frame) {
+    *p_dest = *p_value;
+  } else if (render_copy_compare(p_render_pos, &p_value->host_pixels[0], 16)) {
+    render_mark_dirty(p_render);
+  }
+}
+
+static inline void
+render_store_teletext(struct render_struct* p_render,
+                      uint32_t* p_render_pos,
+                      uint32_t* p_next_render_pos) {
+  struct render_character_1MHz characters[2];
+
+  teletext_render(p_render->p_teletext,
+                  &characters[0],
+                  ((p_next_render_pos != NULL) ? &characters[1] : NULL));
+  render_store_1MHz(p_render, p_render_pos, &characters[0]);
+  if (p_next_render_pos != NULL) {
+    render_store_1MHz(p_render, p_next_render_pos, &characters[1]);
+  }
+}
+
+/* Commands that update render state rather than write pixels. Returns the
+ * position after any argument words.
+ */
+static const uint32_t*
+render_thread_state_command(struct render_struct* p_render,
+                            uint32_t word,
+                            const uint32_t* p_words) {
+  uint8_t data = (word & 0xFF);
+  struct teletext_struct* p_teletext = p_render->p_teletext;
+  uint32_t* p_dirty_mark;
+
+  switch (word >> 24) {
+  case k_render_command_set_mode:
+    render_set_mode(p_render,
+                    (word & 1),
+                    ((word >> 1) & 3),
+                    ((word >> 3) & 1));
+    break;
+  case k_render_command_prepare:
+    /* A mode recalc resets the dirty mark to the beam row, but only the
+     * emulation thread tracks the beam.
+     */
+    p_dirty_mark = p_render->p_dirty_mark;
+    render_prepare(p_render);
+    p_render->p_dirty_mark = p_dirty_mark;
+    break;
+  case k_render_command_set_flash:
+    render_set_flash(p_render, (word & 1));
+    break;
+  case k_render_command_set_physical_color:
+    render_set_physical_color(p_render, ((word >> 8) & 0x0F), data);
+    break;
+  case k_render_command_set_palette:
+    render_set_palette(p_render, data, *p_words++);
+    break;
+  case k_render_command_teletext_RA_ISV:
+    teletext_RA_ISV_changed(p_teletext, data, ((word >> 8) & 1));
+    break;
+  case k_render_command_teletext_DISPEN:
+    teletext_DISPEN_changed(p_teletext, (word & 1));
+    break;
+  case k_render_command_teletext_VSYNC:
+    teletext_VSYNC_changed(p_teletext, (word & 1));
+    break;
+  default:
+    assert(0);
+    break;
+  }
+
+  return p_words;
+}
+
+static void
+render_thread_process(struct render_struct* p_render,
+                      const uint32_t* p_words,
+                      uint32_t length) {
+  const uint32_t* p_words_end = (p_words + length);
+  uint32_t* p_pos = p_render->p_thread_pos;
+  uint32_t width = p_render->width;
+  struct teletext_struct* p_teletext = p_render->p_teletext;
+
+  while (p_words < p_words_end) {
+    uint32_t word = *p_words++;
+    uint8_t data = (word & 0xFF);
+    uint32_t* p_row = p_pos;
+    uint32_t* p_next_row = NULL;
+    uint32_t* p_line;
+    uint32_t argb;
+
+    if (word & k_render_flag_odd_row) {
+      p_row += width;
+    } else if (word & k_render_flag_both_rows) {
+      p_next_row = (p_row + width);
+    }
+
+    switch (word >> 24) {
+    case k_render_command_2MHz:
+      {
+        struct render_character_2MHz* p_value;
+        if (word & k_render_flag_blank) {
+          p_value = &p_render->render_character_2MHz_black;
+        } else {
+          p_value = &p_render->p_render_table_2MHz->values[data];
+        }
+        render_store_2MHz(p_render, p_row, p_value);
+        if (p_next_row != NULL) {
+          render_store_2MHz(p_render, p_next_row, p_value);
+        }
+        if (word & k_render_flag_cursor) {
+          render_invert_cursor(p_row, p_next_row, 8);
+          render_mark_dirty(p_render);
+        }
+        p_pos += 8;
+      }
+      break;
+    case k_render_command_1MHz:
+      {
+        struct render_character_1MHz* p_value;
+        if (word & k_render_flag_blank) {
+          p_value = &p_render->render_character_1MHz_black;
+        } else {
+          p_value = &p_render->p_render_table_1MHz->values[data];
+        }
+        render_store_1MHz(p_render, p_row, p_value);
+        if (p_next_row != NULL) {
+          render_store_1MHz(p_render, p_next_row, p_value);
+        }
+        if (word & k_render_flag_cursor) {
+          render_invert_cursor(p_row, p_next_row, 16);
+          render_mark_dirty(p_render);
+        }
+        p_pos += 16;
+      }
+      break;
+    case k_render_command_teletext:
+      teletext_data(p_teletext, data);
+      if (word & k_render_flag_teletext_render) {
+        render_store_teletext(p_render, p_row, p_next_row);
+        if (word & k_render_flag_cursor) {
+          render_invert_cursor(p_row, p_next_row, 16);
+          render_mark_dirty(p_render);
+        }
+        p_pos += 16;
+      }
+      break;
+    case k_render_command_set_pos:
+      render_set_dirty_mark(p_render, *p_words);
+      p_pos = (p_render->p_buffer + *p_words++);
+      break;
+    case k_render_command_horiz_line:
+      render_set_dirty_mark(p_render, *p_words);
+      render_mark_dirty(p_render);
+      p_line = (p_render->p_buffer + *p_words++);
+      argb = *p_words++;
+      render_fill_pixels(p_line, width, argb);
+      break;
+    case k_render_command_grayscale:
+      render_convert_to_grayscale(p_render);
+      render_mark_all_dirty(p_render, p_render->dirty_frame);
+      break;
+    default:
+      p_words = render_thread_state_command(p_render, word, p_words);
+      break;
+    }
+  }
+
+  p_render->p_thread_pos = p_pos;
+}
+
+static inline uint8_t
+render_invert_index(uint8_t index) {
+  if (index < k_render_index_teletext_solid) {
+    /* Inverting both teletext colors inverts the blend. */
+    return (index ^ 0x3F);
+  } else if (index < k_render_index_palette) {
+    return (index ^ 0x07);
+  } else if (index < k_render_index_background) {
+    return (index ^ (k_render_index_palette ^ k_render_index_palette_inverted));
+  } else if (index < k_render_index_clear) {
+    return (index ^ 1);
+  }
+  return index;
+}
+
+static inline void
+render_invert_cursor_indexed(uint8_t* p_render_pos,
+                             uint8_t* p_next_render_pos,
+                             uint32_t num_pixels) {
+  uint32_t i;
+  for (i = 0; i < num_pixels; ++i) {
+    p_render_pos[i] = render_invert_index(p_render_pos[i]);
+    if (p_next_render_pos != NULL) {
+      p_next_render_pos[i] = render_invert_index(p_next_render_pos[i]);
+    }
+  }
+}
+
+static inline void
+render_store_indexed(struct render_struct* p_render,
+                     uint8_t* p_dest,
+                     const uint8_t* p_value,
+                     uint32_t num_pixels) {
+  uint32_t i;
+  uint8_t diff = 0;
+  if (*p_render->p_dirty_mark == p_render->dirty_frame) {
+    (void) memcpy(p_dest, p_value, num_pixels);
+    return;
+  }
+  for (i = 0; i < num_pixels; ++i) {
+    diff |= (p_dest[i] ^ p_value[i]);
+    p_dest[i] = p_value[i];
+  }
+  if (diff) {
+    render_mark_dirty(p_render);
+  }
+}
+
+static uint8_t
+render_get_line_color_index(struct render_struct* p_render, uint32_t argb) {
+  uint32_t i;
+  uint32_t num_line_colors = p_render->num_line_colors;
+
+  for (i = 0; i < num_line_colors; ++i) {
+    if (p_render->line_colors[i] == argb) {
+      return (k_render_index_line + i);
+    }
+  }
+  /* Once full, the last slot gets reused. */
+  if (num_line_colors < k_render_index_num_lines) {
+    num_line_colors++;
+    p_render->num_line_colors = num_line_colors;
+  }
+  i = (num_line_colors - 1);
+  p_render->line_colors[i] = argb;
+
+  return (k_render_index_line + i);
+}
+
+static void
+render_get_index_colors(struct render_struct* p_render, uint32_t* p_colors) {
+  uint32_t i;
+  uint32_t fg;
+  uint32_t bg;
+  uint32_t level;
+  uint32_t background = p_render->render_character_1MHz_black.host_pixels[0];
+
+  for (i = 0; i < 256; ++i) {
+    p_colors[i] = 0xff000000;
+  }
+
+  /* Teletext colors are blended per channel, the same as teletext_render(). */
+  for (fg = 0; fg < 8; ++fg) {
+    uint32_t fg_color = (((fg & 1) << 16) | ((fg & 2) << 7) | ((fg & 4) >> 2));
+    p_colors[k_render_index_teletext_solid + fg] = ((255 * fg_color) |
+                                                    0xff000000);
+    for (bg = 0; bg < 8; ++bg) {
+      uint32_t bg_color = (((bg & 1) << 16) |
+                           ((bg & 2) << 7) |
+                           ((bg & 4) >> 2));
+      for (level = 1; level < 3; ++level) {
+        uint32_t val = (level * 85);
+        uint32_t color = ((val * fg_color) + ((255 - val) * bg_color));
+        p_colors[k_render_index_teletext_blend +
+                 ((level - 1) << 6) +
+                 (fg << 3) +
+                 bg] = (color | 0xff000000);
+      }
+    }
+  }
+
+  for (i = 0; i < 16; ++i) {
+    p_colors[k_render_index_palette + i] = p_render->palette[i];
+    p_colors[k_render_index_palette_inverted + i] =
+        (p_render->palette[i] ^ 0x00ffffff);
+  }
+  p_colors[k_render_index_background] = background;
+  p_colors[k_render_index_background_inverted] = (background ^ 0x00ffffff);
+  p_colors[k_render_index_clear] = 0xff000000;
+  for (i = 0; i < p_render->num_line_colors; ++i) {
+    p_colors[k_render_index_line + i] = p_render->line_colors[i];
+  }
+
+  if (p_render->is_crt_grayscale_fakeout) {
+    for (i = 0; i < 256; ++i) {
+      p_colors[i] = render_get_grayscale_pixel(p_render, p_colors[i]);
+    }
+  }
+}
+
+static void
+render_expand_pixels(uint32_t* p_pixels,
+                     const uint8_t* p_indexes,
+                     uint32_t num_pixels,
+                     const uint32_t* p_colors) {
+  /* Neither SSE2 nor NEON can gather from a table, so this stays a plain
+   * loop; it's still only one pass a frame, and only over changed lines.
+   */
+  uint32_t i;
+  for (i = 0; i < num_pixels; ++i) {
+    p_pixels[i] = p_colors[p_indexes[i]];
+  }
+}
+
+static void
+render_expand_pixels_doubled(uint32_t* p_pixels,
+                             const uint8_t* p_indexes,
+                             uint32_t num_pixels,
+                             const uint32_t* p_colors) {
+  uint32_t i;
+  for (i = 0; i < num_pixels; ++i) {
+    uint32_t pixel = p_colors[p_indexes[i]];
+    p_pixels[i * 2] = pixel;
+    p_pixels[(i * 2) + 1] = pixel;
+  }
+}
+
+static void
+render_expand_indexed(struct render_struct* p_render, int is_frame_end) {
+  uint32_t colors[256];
+  uint32_t i;
+  uint32_t width = p_render->width;
+  uint32_t num_pairs = (p_render->height / 2);
+  uint32_t expanded_frame = p_render->expanded_frame;
+  uint8_t* p_index_buffer = p_render->p_index_buffer;
+  uint32_t* p_buffer = p_render->p_buffer;
+
+  render_get_index_colors(p_render, &colors[0]);
+  if (memcmp(&colors[0], &p_render->index_colors[0], sizeof(colors)) != 0) {
+    /* A palette change recolors everything, even unchanged pixels. */
+    (void) memcpy(&p_render->index_colors[0], &colors[0], sizeof(colors));
+    render_mark_all_dirty(p_render, p_render->dirty_frame);
+  }
+
+  if (is_frame_end) {
+    p_render->is_crt_grayscale_fakeout = 0;
+    p_render->expanded_frame = (p_render->dirty_frame + 1);
+  } else {
+    /* The frame is still being drawn, so expand its lines again later. */
+    p_render->expanded_frame = p_render->dirty_frame;
+  }
+
+  if (p_render->is_double_size) {
+    /* Expand and double in one pass, from the top left quarter, like
+     * render_process_full_buffer() does in place.
+     */
+    for (i = 0; i < num_pairs; ++i) {
+      uint32_t* p_line = (p_buffer + (i * 2 * width));
+      render_expand_pixels_doubled(p_line,
+                                   (p_index_buffer + (i * width)),
+                                   (width / 2),
+                                   &colors[0]);
+      (void) memcpy((p_line + width), p_line, (width * sizeof(uint32_t)));
+    }
+    return;
+  }
+
+  for (i = 0; i < num_pairs; ++i) {
+    uint32_t offset;
+    if ((int32_t) (p_render->p_dirty_frames[i] - expanded_frame) < 0) {
+      continue;
+    }
+    offset = (i * 2 * width);
+    render_expand_pixels((p_buffer + offset),
+                         (p_index_buffer + offset),
+                         (width * 2),
+                         &colors[0]);
+  }
+}
+
+static void
+render_thread_process_indexed(struct render_struct* p_render,
+                              const uint32_t* p_words,
+                              uint32_t length) {
+  const uint32_t* p_words_end = (p_words + length);
+  uint8_t* p_pos = p_render->p_thread_index_pos;
+  uint32_t width = p_render->width;
+  struct teletext_struct* p_teletext = p_render->p_teletext;
+
+  while (p_words < p_words_end) {
+    uint32_t word = *p_words++;
+    uint8_t data = (word & 0xFF);
+    uint8_t* p_row = p_pos;
+    uint8_t* p_next_row = NULL;
+    uint32_t num_pixels = 16;
+    const uint8_t* p_value;
+    uint8_t characters[32];
+    uint8_t* p_line;
+
+    if (word & k_render_flag_odd_row) {
+      p_row += width;
+    } else if (word & k_render_flag_both_rows) {
+      p_next_row = (p_row + width);
+    }
+
+    switch (word >> 24) {
+    case k_render_command_2MHz:
+      if (word & k_render_flag_blank) {
+        p_value = &p_render->index_character_black[0];
+      } else {
+        p_value = (p_render->p_index_table + (data * 8));
+      }
+      render_store_indexed(p_render, p_row, p_value, 8);
+      if (p_next_row != NULL) {
+        render_store_indexed(p_render, p_next_row, p_value, 8);
+      }
+      num_pixels = 8;
+      break;
+    case k_render_command_1MHz:
+      if (word & k_render_flag_blank) {
+        p_value = &p_render->index_character_black[0];
+      } else {
+        p_value = (p_render->p_index_table + (data * 16));
+      }
+      render_store_indexed(p_render, p_row, p_value, 16);
+      if (p_next_row != NULL) {
+        render_store_indexed(p_render, p_next_row, p_value, 16);
+      }
+      break;
+    case k_render_command_teletext:
+      teletext_data(p_teletext, data);
+      if (!(word & k_render_flag_teletext_render)) {
+        continue;
+      }
+      teletext_render_indexed(p_teletext,
+                              &characters[0],
+                              ((p_next_row != NULL) ? &characters[16] : NULL));
+      render_store_indexed(p_render, p_row, &characters[0], 16);
+      if (p_next_row != NULL) {
+        render_store_indexed(p_render, p_next_row, &characters[16], 16);
+      }
+      break;
+    case k_render_command_set_pos:
+      render_set_dirty_mark(p_render, *p_words);
+      p_pos = (p_render->p_index_buffer + *p_words++);
+      continue;
+    case k_render_command_horiz_line:
+      render_set_dirty_mark(p_render, *p_words);
+      render_mark_dirty(p_render);
+      p_line = (p_render->p_index_buffer + *p_words++);
+      (void) memset(p_line,
+                    render_get_line_color_index(p_render, *p_words++),
+                    width);
+      continue;
+    case k_render_command_grayscale:
+      /* Applied to the colors when the frame is expanded. */
+      p_render->is_crt_grayscale_fakeout = 1;
+      continue;
+    case k_render_command_present:
+      render_expand_indexed(p_render, (word & 1));
+      continue;
+    default:
+      p_words = render_thread_state_command(p_render, word, p_words);
+      continue;
+    }
+
+    if (word & k_render_flag_cursor) {
+      render_invert_cursor_indexed(p_row, p_next_row, num_pixels);
+      render_mark_dirty(p_render);
+    }
+    p_pos += num_pixels;
+  }
+
+  p_render->p_thread_index_pos = p_pos;
+}
+
+static void*
+render_thread(void* p) {
+  struct render_struct* p_render = (struct render_struct*) p;
+  struct render_struct* p_thread_render = p_render->p_thread_render;
+
+  while (1) {
+    struct render_queue_message message;
+    os_channel_read(p_render->handle_thread_read, &message, sizeof(message));
+    if (message.length == 0) {
+      break;
+    }
+    if (p_thread_render->p_index_buffer != NULL) {
+      render_thread_process_indexed(
+          p_thread_render,
+          p_render->p_queue_chunks[message.chunk_index],
+          message.length);
+    } else {
+      render_thread_process(p_thread_render,
+                            p_render->p_queue_chunks[message.chunk_index],
+                            message.length);
+    }
+    os_channel_write(p_render->handle_thread_write, &message, sizeof(message));
+  }
+
+  return NULL;
+}
+
+static void
+render_queue_wait_for_chunk(struct render_struct* p_render) {
+  struct render_queue_message message;
+
+  assert(p_render->queue_chunks_busy > 0);
+  os_channel_read(p_render->handle_client_read, &message, sizeof(message));
+  p_render->queue_chunks_busy--;
+}
+
+static void
+render_queue_flush(struct render_struct* p_render) {
+  struct render_queue_message message;
+  uint32_t* p_chunk = p_render->p_queue_chunks[p_render->queue_chunk_index];
+
+  if (p_render->p_queue_pos == p_chunk) {
+    return;
+  }
+
+  message.chunk_index = p_render->queue_chunk_index;
+  message.length = (p_render->p_queue_pos - p_chunk);
+  os_channel_write(p_render->handle_client_write, &message, sizeof(message));
+  p_render->queue_chunks_busy++;
+
+  p_render->queue_chunk_index++;
+  if (p_render->queue_chunk_index == k_render_queue_num_chunks) {
+    p_render->queue_chunk_index = 0;
+  }
+  /* Chunks complete in order, so the next chunk is the oldest busy one. Only
+   * blocks if the render thread is falling behind.
+   */
+  if (p_render->queue_chunks_busy == k_render_queue_num_chunks) {
+    render_queue_wait_for_chunk(p_render);
+  }
+
+  p_chunk = p_render->p_queue_chunks[p_render->queue_chunk_index];
+  p_render->p_queue_pos = p_chunk;
+  p_render->p_queue_end = (p_chunk +
+                           k_render_queue_chunk_words -
+                           k_render_queue_max_command_words);
+}
+
+static void
+render_queue_sync(struct render_struct* p_render) {
+  if (p_render->p_thread_render == NULL) {
+    return;
+  }
+  render_queue_flush(p_render);
+  while (p_render->queue_chunks_busy > 0) {
+    render_queue_wait_for_chunk(p_render);
+  }
+}
+
+static inline uint32_t*
+render_queue_get_pos(struct render_struct* p_render) {
+  if (p_render->p_queue_pos >= p_render->p_queue_end) {
+    render_queue_flush(p_render);
+  }
+  return p_render->p_queue_pos;
+}
+
+static inline void
+render_queue_word(struct render_struct* p_render, uint32_t word) {
+  uint32_t* p_queue_pos = render_queue_get_pos(p_render);
+  *p_queue_pos++ = word;
+  p_render->p_queue_pos = p_queue_pos;
+}
+
+static void
+render_start_thread(struct render_struct* p_render) {
+  uint32_t i;
+  struct render_struct* p_thread_render;
+
+  assert(p_render->p_thread_render == NULL);
+
+  /* The render thread takes over the pixel tables and teletext state from
+   * here on.
+   */
+  p_thread_render = util_malloc(sizeof(struct render_struct));
+  *p_thread_render = *p_render;
+  p_thread_render->p_flyback_callback = NULL;
+  p_thread_render->p_flyback_callback_object = NULL;
+  p_thread_render->is_buffer_owned = 0;
+  p_thread_render->is_render_thread_allowed = 0;
+  p_thread_render->p_thread_pos = p_render->p_buffer;
+  p_render->p_thread_render = p_thread_render;
+
+  if (p_render->is_indexed) {
+    uint32_t size = (p_render->width * p_render->height);
+    p_render->p_index_buffer = util_malloc(size);
+    (void) memset(p_render->p_index_buffer, k_render_index_clear, size);
+    p_thread_render->p_index_buffer = p_render->p_index_buffer;
+    p_thread_render->p_thread_index_pos = p_render->p_index_buffer;
+    (void) memset(&p_thread_render->index_character_black[0],
+                  k_render_index_background,
+                  sizeof(p_thread_render->index_character_black));
+    /* Only the indexed tables get built from here on. */
+    p_thread_render->render_tables_built = 0;
+  }
+
+  for (i = 0; i < k_render_queue_num_chunks; ++i) {
+    p_render->p_queue_chunks[i] =
+        util_malloc(k_render_queue_chunk_words * sizeof(uint32_t));
+  }
+  p_render->queue_chunk_index = 0;
+  p_render->queue_chunks_busy = 0;
+  p_render->p_queue_pos = p_render->p_queue_chunks[0];
+  p_render->p_queue_end = (p_render->p_queue_pos +
+                           k_render_queue_chunk_words -
+                           k_render_queue_max_command_words);
+  p_render->queue_render_offset = 0;
+  p_render->queue_teletext_dispen = -1;
+  p_render->queue_teletext_ra_isv = -1;
+
+  os_channel_get_handles(&p_render->handle_thread_read,
+                         &p_render->handle_client_write,
+                         &p_render->handle_client_read,
+                         &p_render->handle_thread_write);
+  p_render->p_thread = os_thread_create(render_thread, p_render);
+
+  /* Switch over to the queueing render functions. */
+  p_render->needs_render_mode_recalc = 1;
+}
+
+static void
+render_stop_thread(struct render_struct* p_render) {
+  struct render_queue_message message;
+  uint32_t i;
+
+  render_queue_sync(p_render);
+
+  message.chunk_index = 0;
+  message.length = 0;
+  os_channel_write(p_render->handle_client_write, &message, sizeof(message));
+  (void) os_thread_destroy(p_render->p_thread);
+  os_channel_free_handles(p_render->handle_thread_read,
+                          p_render->handle_client_write,
+                          p_render->handle_client_read,
+                          p_render->handle_thread_write);
+
+  for (i = 0; i < k_render_queue_num_chunks; ++i) {
+    util_free(p_render->p_queue_chunks[i]);
+  }
+  util_free(p_render->p_thread_render);
+  p_render->p_thread_render = NULL;
+  util_free(p_render->p_index_buffer);
+  p_render->p_index_buffer = NULL;
+}
+
 void
 render_destroy(struct render_struct* p_render) {
+  if (p_render->p_thread_render != NULL) {
+    render_stop_thread(p_render);
+  }
   if (p_render->is_buffer_owned) {
     util_free(p_render->p_buffer);
   }
+  util_free(p_render->p_dirty_frames);
   util_free(p_render);
 }
 
@@ -277,6 +1201,11 @@ uint32_t
 render_get_buffer_crc32(struct render_struct* p_render) {
   uint32_t crc = util_crc32_init();
 
+  if (p_render->p_index_buffer != NULL) {
+    render_queue_word(p_render, (k_render_command_present << 24));
+  }
+  render_queue_sync(p_render);
+
   if (p_render->p_buffer != NULL) {
     uint32_t bytes = render_get_buffer_size(p_render);
     crc = util_crc32_add(crc, (uint8_t*) p_render->p_buffer, bytes);
@@ -318,6 +1247,7 @@ render_reset_render_pos(struct render_struct* p_render) {
   window_vert_pos = (vert_beam_pos - p_render->vert_beam_window_start_pos);
   p_render->p_render_pos_row = p_render->p_buffer;
   p_render->p_render_pos_row += (window_vert_pos * p_render->width);
+  p_render->p_dirty_mark = &p_render->p_dirty_frames[window_vert_pos / 2];
 
   if (p_render->horiz_beam_pos >= p_render->horiz_beam_window_end_pos) {
     return;
@@ -347,6 +1277,10 @@ render_setup_new_buffer(struct render_struct* p_render) {
   p_render->p_buffer_end = p_buffer;
   p_render->p_buffer_end += (p_render->width * p_render->height);
 
+  p_render->p_dirty_frames =
+      util_mallocz((p_render->height / 2) * sizeof(uint32_t));
+  p_render->p_dirty_mark = p_render->p_dirty_frames;
+
   render_clear_buffer(p_render);
 
   p_render->horiz_beam_pos = 0;
@@ -385,13 +1319,8 @@ render_check_cursor(struct render_struct* p_render,
 
   if (p_render->cursor_segments[p_render->cursor_segment_index] &&
       (p_render_pos >= p_render->p_render_pos_row)) {
-    uint32_t i;
-    for (i = 0; i < num_pixels; ++i) {
-      p_render_pos[i] ^= 0x00ffffff;
-      if (p_next_render_pos != NULL) {
-        p_next_render_pos[i] ^= 0x00ffffff;
-      }
-    }
+    render_invert_cursor(p_render_pos, p_next_render_pos, num_pixels);
+    render_mark_dirty(p_render);
   }
   p_render->cursor_segment_index++;
   if (p_render->cursor_segment_index == 4) {
@@ -427,9 +1356,7 @@ render_function_teletext_deinterlaced(struct render_struct* p_render,
 
   if (p_render_pos <= p_render->p_render_pos_row_max) {
     uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-    teletext_render(p_teletext,
-                    (struct render_character_1MHz*) p_render_pos,
-                    (struct render_character_1MHz*) p_next_render_pos);
+    render_store_teletext(p_render, p_render_pos, p_next_render_pos);
     render_check_cursor(p_render, p_render_pos, p_next_render_pos, 16);
     p_render->p_render_pos += 16;
   } else if ((p_render->horiz_beam_pos & ~15) ==
@@ -469,14 +1396,10 @@ render_function_teletext_interlaced(struct render_struct* p_render,
   if (p_render_pos <= p_render->p_render_pos_row_max) {
     if (p_render->vert_beam_pos & 1) {
       uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-      teletext_render(p_render->p_teletext,
-                      (struct render_character_1MHz*) p_next_render_pos,
-                      NULL);
+      render_store_teletext(p_render, p_next_render_pos, NULL);
       render_check_cursor(p_render, p_next_render_pos, NULL, 16);
     } else {
-      teletext_render(p_render->p_teletext,
-                      (struct render_character_1MHz*) p_render_pos,
-                      NULL);
+      render_store_teletext(p_render, p_render_pos, NULL);
       render_check_cursor(p_render, p_render_pos, NULL, 16);
     }
     p_render->p_render_pos += 16;
@@ -506,8 +1429,8 @@ render_function_1MHz_data_deinterlaced(struct render_struct* p_render,
     struct render_character_1MHz* p_value =
         &p_render->p_render_table_1MHz->values[data];
     uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-    *(struct render_character_1MHz*) p_render_pos = *p_value;
-    *(struct render_character_1MHz*) p_next_render_pos = *p_value;
+    render_store_1MHz(p_render, p_render_pos, p_value);
+    render_store_1MHz(p_render, p_next_render_pos, p_value);
     render_check_cursor(p_render, p_render_pos, p_next_render_pos, 16);
     p_render->p_render_pos += 16;
   } else if ((p_render->horiz_beam_pos & ~15) ==
@@ -535,10 +1458,10 @@ render_function_1MHz_data_interlaced(struct render_struct* p_render,
         &p_render->p_render_table_1MHz->values[data];
     if (p_render->vert_beam_pos & 1) {
       uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-      *(struct render_character_1MHz*) p_next_render_pos = *p_value;
+      render_store_1MHz(p_render, p_next_render_pos, p_value);
       render_check_cursor(p_render, p_next_render_pos, NULL, 16);
     } else {
-      *(struct render_character_1MHz*) p_render_pos = *p_value;
+      render_store_1MHz(p_render, p_render_pos, p_value);
       render_check_cursor(p_render, p_render_pos, NULL, 16);
     }
     p_render->p_render_pos += 16;
@@ -567,8 +1490,8 @@ render_function_1MHz_blank_deinterlaced(struct render_struct* p_render,
     struct render_character_1MHz* p_value =
         &p_render->render_character_1MHz_black;
     uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-    *(struct render_character_1MHz*) p_render_pos = *p_value;
-    *(struct render_character_1MHz*) p_next_render_pos = *p_value;
+    render_store_1MHz(p_render, p_render_pos, p_value);
+    render_store_1MHz(p_render, p_next_render_pos, p_value);
     render_check_cursor(p_render, p_render_pos, p_next_render_pos, 16);
     p_render->p_render_pos += 16;
   } else if ((p_render->horiz_beam_pos & ~15) ==
@@ -597,10 +1520,10 @@ render_function_1MHz_blank_interlaced(struct render_struct* p_render,
         &p_render->render_character_1MHz_black;
     if (p_render->vert_beam_pos & 1) {
       uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-      *(struct render_character_1MHz*) p_next_render_pos = *p_value;
+      render_store_1MHz(p_render, p_next_render_pos, p_value);
       render_check_cursor(p_render, p_next_render_pos, NULL, 16);
     } else {
-      *(struct render_character_1MHz*) p_render_pos = *p_value;
+      render_store_1MHz(p_render, p_render_pos, p_value);
       render_check_cursor(p_render, p_render_pos, NULL, 16);
     }
     p_render->p_render_pos += 16;
@@ -628,8 +1551,8 @@ render_function_2MHz_data_deinterlaced(struct render_struct* p_render,
     struct render_character_2MHz* p_value =
         &p_render->p_render_table_2MHz->values[data];
     uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-    *(struct render_character_2MHz*) p_render_pos = *p_value;
-    *(struct render_character_2MHz*) p_next_render_pos = *p_value;
+    render_store_2MHz(p_render, p_render_pos, p_value);
+    render_store_2MHz(p_render, p_next_render_pos, p_value);
     render_check_cursor(p_render, p_render_pos, p_next_render_pos, 8);
     p_render->p_render_pos += 8;
   } else if ((p_render->horiz_beam_pos & ~7) ==
@@ -657,10 +1580,10 @@ render_function_2MHz_data_interlaced(struct render_struct* p_render,
         &p_render->p_render_table_2MHz->values[data];
     if (p_render->vert_beam_pos & 1) {
       uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-      *(struct render_character_2MHz*) p_next_render_pos = *p_value;
+      render_store_2MHz(p_render, p_next_render_pos, p_value);
       render_check_cursor(p_render, p_next_render_pos, NULL, 8);
     } else {
-      *(struct render_character_2MHz*) p_render_pos = *p_value;
+      render_store_2MHz(p_render, p_render_pos, p_value);
       render_check_cursor(p_render, p_render_pos, NULL, 8);
     }
     p_render->p_render_pos += 8;
@@ -689,8 +1612,8 @@ render_function_2MHz_blank_deinterlaced(struct render_struct* p_render,
     struct render_character_2MHz* p_value =
         &p_render->render_character_2MHz_black;
     uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-    *(struct render_character_2MHz*) p_render_pos = *p_value;
-    *(struct render_character_2MHz*) p_next_render_pos = *p_value;
+    render_store_2MHz(p_render, p_render_pos, p_value);
+    render_store_2MHz(p_render, p_next_render_pos, p_value);
     render_check_cursor(p_render, p_render_pos, p_next_render_pos, 8);
     p_render->p_render_pos += 8;
   } else if ((p_render->horiz_beam_pos & ~7) ==
@@ -719,10 +1642,10 @@ render_function_2MHz_blank_interlaced(struct render_struct* p_render,
         &p_render->render_character_2MHz_black;
     if (p_render->vert_beam_pos & 1) {
       uint32_t* p_next_render_pos = (p_render_pos + p_render->width);
-      *(struct render_character_2MHz*) p_next_render_pos = *p_value;
+      render_store_2MHz(p_render, p_next_render_pos, p_value);
       render_check_cursor(p_render, p_next_render_pos, NULL, 8);
     } else {
-      *(struct render_character_2MHz*) p_render_pos = *p_value;
+      render_store_2MHz(p_render, p_render_pos, p_value);
       render_check_cursor(p_render, p_render_pos, NULL, 8);
     }
     p_render->p_render_pos += 8;
@@ -734,14 +1657,180 @@ render_function_2MHz_blank_interlaced(struct render_struct* p_render,
   }
 }
 
-static uint32_t
-render_get_display_color(struct render_struct* p_render, uint8_t bits) {
-  uint32_t pixel;
+static inline void
+render_queue_pixels(struct render_struct* p_render,
+                    uint32_t command,
+                    uint32_t num_pixels,
+                    int do_deinterlace) {
+  uint32_t* p_queue_pos;
+  uint32_t* p_render_pos = p_render->p_render_pos;
+  uint32_t offset = (p_render_pos - p_render->p_buffer);
+  int is_cursor_row = (p_render_pos >= p_render->p_render_pos_row);
+
+  if (do_deinterlace) {
+    command |= k_render_flag_both_rows;
+  } else if (p_render->vert_beam_pos & 1) {
+    command |= k_render_flag_odd_row;
+    is_cursor_row = 1;
+  }
+
+  /* Same cursor logic as render_check_cursor(). */
+  if (p_render->cursor_segment_index != -1) {
+    if (p_render->cursor_segments[p_render->cursor_segment_index] &&
+        is_cursor_row) {
+      command |= k_render_flag_cursor;
+    }
+    p_render->cursor_segment_index++;
+    if (p_render->cursor_segment_index == 4) {
+      p_render->cursor_segment_index = -1;
+    }
+  }
+
+  p_queue_pos = render_queue_get_pos(p_render);
+  if (offset != p_render->queue_render_offset) {
+    *p_queue_pos++ = (k_render_command_set_pos << 24);
+    *p_queue_pos++ = offset;
+  }
+  *p_queue_pos++ = command;
+  p_render->p_queue_pos = p_queue_pos;
+
+  p_render->queue_render_offset = (offset + num_pixels);
+  p_render->p_render_pos += num_pixels;
+}
+
+static void
+render_function_queue_teletext(struct render_struct* p_render,
+                               uint8_t data,
+                               uint16_t address,
+                               uint64_t ticks) {
+  uint32_t command = ((k_render_command_teletext << 24) | data);
+
+  if (ticks & 1) {
+    return;
+  }
+  if (!(address & 0x2000)) {
+    command = (k_render_command_teletext << 24);
+  }
+
+  p_render->horiz_beam_pos += 16;
+
+  if (p_render->p_render_pos <= p_render->p_render_pos_row_max) {
+    render_queue_pixels(p_render,
+                        (command | k_render_flag_teletext_render),
+                        16,
+                        p_render->do_deinterlace_teletext);
+    return;
+  }
+
+  render_queue_word(p_render, command);
+  if ((p_render->horiz_beam_pos & ~15) ==
+      p_render->horiz_beam_window_start_pos) {
+    render_reset_render_pos(p_render);
+  } else if (p_render->horiz_beam_pos >= 1536) {
+    render_hsync(p_render, 0);
+  }
+}
+
+static void
+render_function_queue_1MHz_data(struct render_struct* p_render,
+                                uint8_t data,
+                                uint16_t address,
+                                uint64_t ticks) {
+  (void) address;
+  (void) ticks;
+
+  p_render->horiz_beam_pos += 16;
+
+  if (p_render->p_render_pos <= p_render->p_render_pos_row_max) {
+    render_queue_pixels(p_render,
+                        ((k_render_command_1MHz << 24) | data),
+                        16,
+                        p_render->do_deinterlace_bitmap);
+  } else if ((p_render->horiz_beam_pos & ~15) ==
+             p_render->horiz_beam_window_start_pos) {
+    render_reset_render_pos(p_render);
+  } else if (p_render->horiz_beam_pos >= 1536) {
+    render_hsync(p_render, 0);
+  }
+}
+
+static void
+render_function_queue_1MHz_blank(struct render_struct* p_render,
+                                 uint8_t data,
+                                 uint16_t address,
+                                 uint64_t ticks) {
+  (void) data;
+  (void) address;
+  (void) ticks;
+
+  p_render->horiz_beam_pos += 16;
+
+  if (p_render->p_render_pos <= p_render->p_render_pos_row_max) {
+    render_queue_pixels(p_render,
+                        ((k_render_command_1MHz << 24) | k_render_flag_blank),
+                        16,
+                        p_render->do_deinterlace_bitmap);
+  } else if ((p_render->horiz_beam_pos & ~15) ==
+             p_render->horiz_beam_window_start_pos) {
+    render_reset_render_pos(p_render);
+  } else if (p_render->horiz_beam_pos >= 1536) {
+    render_hsync(p_render, 0);
+  }
+}
+
+static void
+render_function_queue_2MHz_data(struct render_struct* p_render,
+                                uint8_t data,
+                                uint16_t address,
+                                uint64_t ticks) {
+  (void) address;
+  (void) ticks;
+
+  p_render->horiz_beam_pos += 8;
+
+  if (p_render->p_render_pos <= p_render->p_render_pos_row_max) {
+    render_queue_pixels(p_render,
+                        ((k_render_command_2MHz << 24) | data),
+                        8,
+                        p_render->do_deinterlace_bitmap);
+  } else if ((p_render->horiz_beam_pos & ~7) ==
+             p_render->horiz_beam_window_start_pos) {
+    render_reset_render_pos(p_render);
+  } else if (p_render->horiz_beam_pos >= 1536) {
+    render_hsync(p_render, 0);
+  }
+}
+
+static void
+render_function_queue_2MHz_blank(struct render_struct* p_render,
+                                 uint8_t data,
+                                 uint16_t address,
+                                 uint64_t ticks) {
+  (void) data;
+  (void) address;
+  (void) ticks;
+
+  p_render->horiz_beam_pos += 8;
+
+  if (p_render->p_render_pos <= p_render->p_render_pos_row_max) {
+    render_queue_pixels(p_render,
+                        ((k_render_command_2MHz << 24) | k_render_flag_blank),
+                        8,
+                        p_render->do_deinterlace_bitmap);
+  } else if ((p_render->horiz_beam_pos & ~7) ==
+             p_render->horiz_beam_window_start_pos) {
+    render_reset_render_pos(p_render);
+  } else if (p_render->horiz_beam_pos >= 1536) {
+    render_hsync(p_render, 0);
+  }
+}
+
+static uint8_t
+render_get_physical_color(struct render_struct* p_render, uint8_t bits) {
   uint8_t physical_color = p_render->logical_to_physical_color[bits];
   physical_color ^= 0x7;
-  pixel = p_render->palette[physical_color];
   if (physical_color & 0x8) {
-    if (pixel == 0) {
+    if (p_render->palette[physical_color] == 0) {
       /* Only flash the color if we don't have a NuLA palette override. This
        * is approximately how NuLA works. Note that it is possible to have
        * flashing with NuLA colors, but that requires a write to the NuLA
@@ -751,11 +1840,40 @@ render_get_display_color(struct render_struct* p_render, uint8_t bits) {
       if (p_render->is_flash) {
         physical_color ^= 0x7;
       }
-      pixel = p_render->palette[physical_color];
     }
   }
 
-  return pixel;
+  return physical_color;
+}
+
+static uint32_t
+render_get_display_color(struct render_struct* p_render, uint8_t bits) {
+  return p_render->palette[render_get_physical_color(p_render, bits)];
+}
+
+static void
+render_generate_character(uint32_t* p_host_pixels,
+                          uint32_t num_host_pixels,
+                          uint32_t num_pixels,
+                          const uint32_t* p_colors,
+                          uint8_t shift_register) {
+  uint32_t i;
+  uint32_t j;
+
+  uint32_t pixel_stride = (num_host_pixels / num_pixels);
+
+  for (i = 0; i < num_pixels; ++i) {
+    uint8_t palette_index = (((shift_register & 0x02) >> 1) |
+                             ((shift_register & 0x08) >> 2) |
+                             ((shift_register & 0x20) >> 3) |
+                             ((shift_register & 0x80) >> 4));
+    uint32_t pixel_value = p_colors[palette_index];
+    for (j = 0; j < pixel_stride; ++j) {
+      *p_host_pixels++ = pixel_value;
+    }
+    shift_register <<= 1;
+    shift_register |= 1;
+  }
 }
 
 static void
@@ -763,27 +1881,19 @@ render_generate_1MHz_table(struct render_struct* p_render,
                            struct render_table_1MHz* p_table,
                            uint32_t num_pixels) {
   uint32_t i;
-  uint32_t j;
+  uint32_t colors[16];
 
-  uint32_t pixel_stride = (16 / num_pixels);
-  uint32_t palette_index = 0;
-  uint32_t pixel_value = 0;
+  /* Resolve the palette once rather than per pixel. */
+  for (i = 0; i < 16; ++i) {
+    colors[i] = render_get_display_color(p_render, i);
+  }
 
   for (i = 0; i < 256; ++i) {
-    struct render_character_1MHz* p_character = &p_table->values[i];
-    uint8_t shift_register = i;
-    for (j = 0; j < 16; ++j) {
-      if ((j % pixel_stride) == 0) {
-        palette_index = (((shift_register & 0x02) >> 1) |
-                         ((shift_register & 0x08) >> 2) |
-                         ((shift_register & 0x20) >> 3) |
-                         ((shift_register & 0x80) >> 4));
-        pixel_value = render_get_display_color(p_render, palette_index);
-        shift_register <<= 1;
-        shift_register |= 1;
-      }
-      p_character->host_pixels[j] = pixel_value;
-    }
+    render_generate_character(&p_table->values[i].host_pixels[0],
+                              16,
+                              num_pixels,
+                              &colors[0],
+                              i);
   }
 }
 
@@ -792,28 +1902,55 @@ render_generate_2MHz_table(struct render_struct* p_render,
                            struct render_table_2MHz* p_table,
                            uint32_t num_pixels) {
   uint32_t i;
-  uint32_t j;
+  uint32_t colors[16];
 
-  uint32_t pixel_stride = (8 / num_pixels);
-  uint32_t palette_index = 0;
-  uint32_t pixel_value = 0;
+  for (i = 0; i < 16; ++i) {
+    colors[i] = render_get_display_color(p_render, i);
+  }
 
   for (i = 0; i < 256; ++i) {
-    struct render_character_2MHz* p_character = &p_table->values[i];
-    uint8_t shift_register = i;
-    for (j = 0; j < 8; ++j) {
-      if ((j % pixel_stride) == 0) {
-        palette_index = (((shift_register & 0x02) >> 1) |
-                         ((shift_register & 0x08) >> 2) |
-                         ((shift_register & 0x20) >> 3) |
-                         ((shift_register & 0x80) >> 4));
-        pixel_value = render_get_display_color(p_render, palette_index);
-        shift_register <<= 1;
-        shift_register |= 1;
+    render_generate_character(&p_table->values[i].host_pixels[0],
+                              8,
+                              num_pixels,
+                              &colors[0],
+                              i);
+  }
+}
+
+static void
+render_check_index_table(struct render_struct* p_render) {
+  /* Pixels per character in each mode. */
+  static const uint8_t s_num_pixels[k_render_num_modes] = {
+    8, 4, 2, 8, 4, 0, 2, 16, 1,
+  };
+  int mode = p_render->render_mode;
+  uint8_t* p_table = &p_render->index_tables[mode][0];
+
+  if (!(p_render->render_tables_built & (1 << mode))) {
+    uint32_t i;
+    uint32_t j;
+    uint32_t colors[16];
+    uint32_t host_pixels[16];
+    uint32_t num_host_pixels = (p_render->is_clock_2MHz ? 8 : 16);
+
+    for (i = 0; i < 16; ++i) {
+      colors[i] = (k_render_index_palette +
+                   render_get_physical_color(p_render, i));
+    }
+    for (i = 0; i < 256; ++i) {
+      render_generate_character(&host_pixels[0],
+                                num_host_pixels,
+                                s_num_pixels[mode],
+                                &colors[0],
+                                i);
+      for (j = 0; j < num_host_pixels; ++j) {
+        p_table[(i * num_host_pixels) + j] = host_pixels[j];
       }
-      p_character->host_pixels[j] = pixel_value;
     }
+    p_render->render_tables_built |= (1 << mode);
   }
+
+  p_render->p_index_table = p_table;
 }
 
 static void
@@ -935,6 +2072,14 @@ render_set_mode(struct render_struct* p_render,
   p_render->is_teletext = is_teletext;
 
   p_render->needs_render_mode_recalc = 1;
+
+  if (p_render->p_thread_render != NULL) {
+    render_queue_word(p_render,
+                      ((k_render_command_set_mode << 24) |
+                       (is_teletext << 3) |
+                       (chars_per_line << 1) |
+                       clock_speed));
+  }
 }
 
 void
@@ -954,6 +2099,11 @@ render_set_flash(struct render_struct* p_render, int is_flash) {
   }
 
   p_render->is_flash = is_flash;
+
+  if (p_render->p_thread_render != NULL) {
+    render_queue_word(p_render,
+                      ((k_render_command_set_flash << 24) | is_flash));
+  }
 }
 
 void
@@ -962,6 +2112,13 @@ render_set_physical_color(struct render_struct* p_render,
                           uint8_t physical_color) {
   p_render->logical_to_physical_color[logical_color] = physical_color;
   p_render->render_tables_built = 0;
+
+  if (p_render->p_thread_render != NULL) {
+    render_queue_word(p_render,
+                      ((k_render_command_set_physical_color << 24) |
+                       (logical_color << 8) |
+                       physical_color));
+  }
 }
 
 void
@@ -970,6 +2127,13 @@ render_set_palette(struct render_struct* p_render,
                    uint32_t rgba) {
   p_render->palette[index] = rgba;
   p_render->render_tables_built = 0;
+
+  if (p_render->p_thread_render != NULL) {
+    uint32_t* p_queue_pos = render_queue_get_pos(p_render);
+    *p_queue_pos++ = ((k_render_command_set_palette << 24) | index);
+    *p_queue_pos++ = rgba;
+    p_render->p_queue_pos = p_queue_pos;
+  }
 }
 
 void
@@ -997,6 +2161,53 @@ render_set_RA(struct render_struct* p_render, uint32_t row_address) {
   render_select_render_func(p_render);
 }
 
+void
+render_teletext_RA_ISV_changed(struct render_struct* p_render,
+                               uint8_t ra,
+                               int is_isv) {
+  int ra_isv;
+
+  if (p_render->p_thread_render == NULL) {
+    teletext_RA_ISV_changed(p_render->p_teletext, ra, is_isv);
+    return;
+  }
+  /* Only the low bit of RA matters, and these just latch a value, so only
+   * queue changes.
+   */
+  ra_isv = (((!!is_isv) << 8) | (ra & 1));
+  if (ra_isv == p_render->queue_teletext_ra_isv) {
+    return;
+  }
+  p_render->queue_teletext_ra_isv = ra_isv;
+  render_queue_word(p_render,
+                    ((k_render_command_teletext_RA_ISV << 24) | ra_isv));
+}
+
+void
+render_teletext_DISPEN_changed(struct render_struct* p_render, int value) {
+  if (p_render->p_thread_render == NULL) {
+    teletext_DISPEN_changed(p_render->p_teletext, value);
+    return;
+  }
+  value = !!value;
+  if (value == p_render->queue_teletext_dispen) {
+    return;
+  }
+  p_render->queue_teletext_dispen = value;
+  render_queue_word(p_render,
+                    ((k_render_command_teletext_DISPEN << 24) | value));
+}
+
+void
+render_teletext_VSYNC_changed(struct render_struct* p_render, int value) {
+  if (p_render->p_thread_render == NULL) {
+    teletext_VSYNC_changed(p_render->p_teletext, value);
+    return;
+  }
+  render_queue_word(p_render,
+                    ((k_render_command_teletext_VSYNC << 24) | !!value));
+}
+
 static void
 render_check_mode_recalc(struct render_struct* p_render) {
   if (!p_render->needs_render_mode_recalc) {
@@ -1071,6 +2282,19 @@ render_check_mode_recalc(struct render_struct* p_render) {
     }
   }
 
+  if (p_render->p_thread_render != NULL) {
+    /* The render thread does the pixel work; just queue it. */
+    if (p_render->is_teletext) {
+      p_render->p_render_func = render_function_queue_teletext;
+    } else if (p_render->is_clock_2MHz == 1) {
+      p_render->p_render_func = render_function_queue_2MHz_data;
+      p_render->p_render_blank_func = render_function_queue_2MHz_blank;
+    } else {
+      p_render->p_render_func = render_function_queue_1MHz_data;
+      p_render->p_render_blank_func = render_function_queue_1MHz_blank;
+    }
+  }
+
   render_select_render_func(p_render);
 
   /* Changing 1MHz <-> 2MHz changes the size of the pixel blocks we write, and
@@ -1081,9 +2305,21 @@ render_check_mode_recalc(struct render_struct* p_render) {
 
 void
 render_prepare(struct render_struct* p_render) {
+  if (p_render->is_render_thread_allowed &&
+      (p_render->p_thread_render == NULL) &&
+      (p_render->p_flyback_callback != NULL) &&
+      (p_render->p_buffer != NULL)) {
+    render_start_thread(p_render);
+  }
+
   render_check_mode_recalc(p_render);
-  if (p_render->render_mode == k_render_mode7) {
+  if (p_render->p_thread_render != NULL) {
+    /* The render thread rebuilds its own tables. */
+    render_queue_word(p_render, (k_render_command_prepare << 24));
+  } else if (p_render->render_mode == k_render_mode7) {
     /* Nothing to do. */
+  } else if (p_render->p_index_buffer != NULL) {
+    render_check_index_table(p_render);
   } else if (p_render->is_clock_2MHz) {
     render_check_2MHz_render_table(p_render);
   } else {
@@ -1100,15 +2336,149 @@ render_render(struct render_struct* p_render,
 }
 
 void
-render_clear_buffer(struct render_struct* p_render) {
+render_render_span(struct render_struct* p_render,
+                   const uint8_t* p_data,
+                   uint16_t addr,
+                   uint32_t num_chars,
+                   uint64_t ticks,
+                   uint32_t ticks_inc) {
   uint32_t i;
+  uint32_t* p_render_pos = p_render->p_render_pos;
+  uint32_t num_pixels = 0;
+  int is_blank = 0;
+  void (*p_func)(struct render_struct*, uint8_t, uint16_t, uint64_t) =
+      p_render->p_selected_render_func;
+
+  if ((p_func == render_function_2MHz_data_deinterlaced) ||
+      (p_func == render_function_queue_2MHz_data)) {
+    num_pixels = 8;
+  } else if ((p_func == render_function_2MHz_blank_deinterlaced) ||
+             (p_func == render_function_queue_2MHz_blank)) {
+    num_pixels = 8;
+    is_blank = 1;
+  } else if ((p_func == render_function_1MHz_data_deinterlaced) ||
+             (p_func == render_function_queue_1MHz_data)) {
+    num_pixels = 16;
+  } else if ((p_func == render_function_1MHz_blank_deinterlaced) ||
+             (p_func == render_function_queue_1MHz_blank)) {
+    num_pixels = 16;
+    is_blank = 1;
+  }
+
+  /* The fast path needs the whole span to land inside the buffer row, with no
+   * cursor, so that none of the beam checks can fire. Otherwise, go a
+   * character at a time.
+   */
+  if ((num_pixels == 0) ||
+      (p_render->cursor_segment_index != -1) ||
+      (p_render_pos > p_render->p_render_pos_row_max) ||
+      ((size_t) (p_render->p_render_pos_row_max - p_render_pos) <
+           ((num_chars - 1) * num_pixels))) {
+    for (i = 0; i < num_chars; ++i) {
+      p_func(p_render, p_data[i], ((addr + i) & 0x3FFF), ticks);
+      ticks += ticks_inc;
+    }
+    return;
+  }
+
+  p_render->horiz_beam_pos += (num_chars * num_pixels);
+
+  if (p_render->p_thread_render != NULL) {
+    uint32_t command = ((num_pixels == 8) ? k_render_command_2MHz :
+                                            k_render_command_1MHz);
+    command <<= 24;
+    if (is_blank) {
+      command |= k_render_flag_blank;
+    }
+    for (i = 0; i < num_chars; ++i) {
+      render_queue_pixels(p_render,
+                          (is_blank ? command : (command | p_data[i])),
+                          num_pixels,
+                          p_render->do_deinterlace_bitmap);
+    }
+  } else if (num_pixels == 8) {
+    const struct render_character_2MHz* p_values =
+        &p_render->p_render_table_2MHz->values[0];
+    for (i = 0; i < num_chars; ++i) {
+      const struct render_character_2MHz* p_value =
+          (is_blank ? &p_render->render_character_2MHz_black :
+                      &p_values[p_data[i]]);
+      render_store_2MHz(p_render, p_render_pos, p_value);
+      render_store_2MHz(p_render, (p_render_pos + p_render->width), p_value);
+      p_render_pos += 8;
+    }
+    p_render->p_render_pos = p_render_pos;
+  } else {
+    const struct render_character_1MHz* p_values =
+        &p_render->p_render_table_1MHz->values[0];
+    for (i = 0; i < num_chars; ++i) {
+      const struct render_character_1MHz* p_value =
+          (is_blank ? &p_render->render_character_1MHz_black :
+                      &p_values[p_data[i]]);
+      render_store_1MHz(p_render, p_render_pos, p_value);
+      render_store_1MHz(p_render, (p_render_pos + p_render->width), p_value);
+      p_render_pos += 16;
+    }
+    p_render->p_render_pos = p_render_pos;
+  }
+}
+
+void
+render_clear_buffer(struct render_struct* p_render) {
   uint32_t size = (render_get_buffer_size(p_render) / 4);
-  uint32_t* p_buf = p_render->p_buffer;
 
-  for (i = 0; i < size; ++i) {
-    /* Full alpha and black. */
-    p_buf[i] = 0xff000000;
+  /* Full alpha and black. */
+  render_fill_pixels(p_render->p_buffer, size, 0xff000000);
+  if (p_render->p_index_buffer != NULL) {
+    (void) memset(p_render->p_index_buffer, k_render_index_clear, size);
   }
+
+  /* Called from the UI thread, so mark with the frame in progress, which is
+   * not yet presented.
+   */
+  render_mark_all_dirty(p_render, p_render->dirty_frame);
+}
+
+int
+render_get_dirty_lines(struct render_struct* p_render,
+                       uint32_t* p_start_line,
+                       uint32_t* p_num_lines) {
+  uint32_t i;
+  uint32_t first = UINT32_MAX;
+  uint32_t last = 0;
+  uint32_t num_pairs = (p_render->height / 2);
+  /* Lines being drawn now are marked with this frame, so they are
+   * presented again next time.
+   */
+  uint32_t frame = p_render->dirty_frame;
+  uint32_t presented_frame = p_render->presented_frame;
+
+  p_render->presented_frame = frame;
+
+  if (p_render->is_double_size) {
+    /* Double size expands the buffer in place, so the written pixels can't be
+     * compared against the previous frame.
+     */
+    *p_start_line = 0;
+    *p_num_lines = p_render->height;
+    return 1;
+  }
+
+  for (i = 0; i < num_pairs; ++i) {
+    if ((int32_t) (p_render->p_dirty_frames[i] - presented_frame) >= 0) {
+      if (first == UINT32_MAX) {
+        first = i;
+      }
+      last = i;
+    }
+  }
+  if (first == UINT32_MAX) {
+    return 0;
+  }
+
+  *p_start_line = (first * 2);
+  *p_num_lines = (((last - first) + 1) * 2);
+  return 1;
 }
 
 void
@@ -1117,13 +2487,16 @@ render_process_full_buffer(struct render_struct* p_render) {
   uint32_t line_size;
   uint32_t* p_buffer;
   int32_t line;   /* Must be signed. */
-  int32_t column; /* Must be signed. */
   int32_t lines;
   uint32_t half_width;
 
   if (!p_render->is_double_size) {
     return;
   }
+  if (p_render->p_index_buffer != NULL) {
+    /* Already doubled as the indexes were expanded. */
+    return;
+  }
 
   width = p_render->width;
   line_size = (width * sizeof(uint32_t));
@@ -1132,10 +2505,7 @@ render_process_full_buffer(struct render_struct* p_render) {
   half_width = (width / 2);
   
   for (line = 0; line < lines; ++line) {
-    for (column = (half_width - 1); column >= 0; --column) {
-      p_buffer[column * 2] = p_buffer[column];
-      p_buffer[(column * 2) + 1] = p_buffer[column];
-    }
+    render_double_pixels(p_buffer, half_width);
     p_buffer += width;
   }
 
@@ -1187,45 +2557,35 @@ render_hsync(struct render_struct* p_render, uint32_t hsync_pulse_ticks) {
 }
 
 static void
-render_convert_to_grayscale(struct render_struct* p_render) {
-  uint32_t width;
-  uint32_t height;
-  uint32_t* p_buffer = p_render->p_buffer;
-
-  if (p_buffer == NULL) {
-    return;
-  }
-
-  for (height = 0; height < p_render->height; ++height) {
-    for (width = 0; width < p_render->width; ++width) {
-      uint32_t pixel = *p_buffer;
-      uint8_t r = (pixel >> 16);
-      uint8_t g = (pixel >> 8);
-      uint8_t b = pixel;
-      uint8_t grey;
-      /* These constants are from: https://en.wikipedia.org/wiki/Grayscale
-       * "Luma coding in video systems", for PAL.
-       */
-      r = (r * 0.29);
-      g = (g * 0.58);
-      b = (b * 0.11);
-      grey = (r + g + b);
-      pixel = (grey | (grey << 8) | (grey << 16));
-      /* Merge alpha back in. */
-      pixel |= 0xff000000;
-      *p_buffer = pixel;
-
-      p_buffer++;
-    }
+render_next_dirty_frame(struct render_struct* p_render) {
+  p_render->dirty_frame++;
+  if (p_render->p_thread_render != NULL) {
+    /* The render thread is idle after a sync. */
+    p_render->p_thread_render->dirty_frame = p_render->dirty_frame;
   }
 }
 
 void
 render_vsync(struct render_struct* p_render) {
   if (p_render->p_flyback_callback) {
-    if (p_render->is_crt_grayscale_fakeout) {
+    if (p_render->p_thread_render != NULL) {
+      if (p_render->is_crt_grayscale_fakeout) {
+        render_queue_word(p_render, (k_render_command_grayscale << 24));
+      }
+      if (p_render->p_index_buffer != NULL) {
+        render_queue_word(p_render, ((k_render_command_present << 24) | 1));
+      }
+      /* The frame must be complete before it is handed over. */
+      render_queue_sync(p_render);
+    } else if (p_render->is_crt_grayscale_fakeout) {
       render_convert_to_grayscale(p_render);
+      render_mark_all_dirty(p_render, p_render->dirty_frame);
     }
+  }
+
+  render_next_dirty_frame(p_render);
+
+  if (p_render->p_flyback_callback) {
     p_render->p_flyback_callback(p_render->p_flyback_callback_object);
   }
 
@@ -1241,16 +2601,21 @@ render_vsync(struct render_struct* p_render) {
 
 void
 render_horiz_line(struct render_struct* p_render, uint32_t argb) {
-  uint32_t i;
-
   if (p_render->p_render_pos_row >= p_render->p_buffer_end) {
     return;
   }
+  if (p_render->p_thread_render != NULL) {
+    uint32_t* p_queue_pos = render_queue_get_pos(p_render);
+    *p_queue_pos++ = (k_render_command_horiz_line << 24);
+    *p_queue_pos++ = (p_render->p_render_pos_row - p_render->p_buffer);
+    *p_queue_pos++ = argb;
+    p_render->p_queue_pos = p_queue_pos;
+    return;
+  }
 
   /* Paint a red line to edge of canvas denote CRTC frame boundary. */
-  for (i = 0; i < p_render->width; ++i) {
-    p_render->p_render_pos_row[i] = argb;
-  }
+  render_fill_pixels(p_render->p_render_pos_row, p_render->width, argb);
+  render_mark_dirty(p_render);
 }
 
 void
@@ -16,6 +16,26 @@ struct render_character_1MHz {
   uint32_t host_pixels[16];
 };
 
+/* Pixel values in the palette indexed render buffer, used with video:indexed.
+ * They are expanded to host pixels once per frame.
+ */
+enum {
+  /* Anti-aliased teletext pixels, 0x40 * level + 8 * foreground + background,
+   * for the 2 levels between solid background and solid foreground.
+   */
+  k_render_index_teletext_blend = 0x00,
+  k_render_index_teletext_solid = 0x80,
+  /* Display colors, and the same inverted by the cursor. */
+  k_render_index_palette = 0x90,
+  k_render_index_palette_inverted = 0xA0,
+  k_render_index_background = 0xB0,
+  k_render_index_background_inverted = 0xB1,
+  k_render_index_clear = 0xB2,
+  /* Horizontal line colors, allocated as they are seen. */
+  k_render_index_line = 0xC0,
+  k_render_index_num_lines = 64,
+};
+
 struct render_table_2MHz {
   struct render_character_2MHz values[256];
 };
@@ -67,6 +87,16 @@ void render_set_cursor_segments(struct render_struct* p_render,
 void render_set_DISPEN(struct render_struct* p_render, int is_enabled);
 void render_set_RA(struct render_struct* p_render, uint32_t row_address);
 
+/* The teletext signals go via the renderer because the render thread, if
+ * running, owns the teletext state.
+ */
+void render_teletext_RA_ISV_changed(struct render_struct* p_render,
+                                    uint8_t ra,
+                                    int is_isv);
+void render_teletext_DISPEN_changed(struct render_struct* p_render,
+                                    int value);
+void render_teletext_VSYNC_changed(struct render_struct* p_render, int value);
+
 /* Call render_prepare() before a sequence of render_render() to ensure that
  * all pending pixel table rebuilds are taken care of.
  */
@@ -75,8 +105,24 @@ void render_render(struct render_struct* p_render,
                    uint8_t data,
                    uint16_t addr,
                    uint64_t ticks);
+/* Renders a run of characters, as if by render_render() for each, with the
+ * address and ticks advancing per character. Used when nothing else about the
+ * display changes during the run.
+ */
+void render_render_span(struct render_struct* p_render,
+                        const uint8_t* p_data,
+                        uint16_t addr,
+                        uint32_t num_chars,
+                        uint64_t ticks,
+                        uint32_t ticks_inc);
 
 void render_clear_buffer(struct render_struct* p_render);
+/* Gets the range of buffer lines with pixels that changed since the last
+ * call. Returns 0 if none did, so presenting the frame can be skipped.
+ */
+int render_get_dirty_lines(struct render_struct* p_render,
+                           uint32_t* p_start_line,
+                           uint32_t* p_num_lines);
 void render_process_full_buffer(struct render_struct* p_render);
 void render_hsync(struct render_struct* p_render, uint32_t hsync_pulse_ticks);
 void render_vsync(struct render_struct* p_render);
@@ -7,17 +7,90 @@ echo 'Running test.rom, JIT, fast.'
 echo 'Running test.rom, JIT, fast, debug.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 \
     -mode jit -fast -debug -run
+echo 'Running test.rom, JIT, fast, debug, breakpoints.'
+./beebjit -os test.rom -swram f -test-map -expect 434241 \
+    -mode jit -fast -debug -run \
+    -commands 'b c22d nostop noprint;b c5b3 nostop noprint;c' >/dev/null
+echo 'Running test.rom, JIT, fast, debug, watchpoints.'
+./beebjit -os test.rom -swram f -test-map -expect 434241 \
+    -mode jit -fast -debug -run \
+    -commands 'bmw 70 nostop noprint;bm 1f0 1ff nostop noprint;c' >/dev/null
+# Stack page accesses, including pushes and pulls, must all be seen under the
+# JIT, as under the interpreter: 195 hits plus the initial stop.
+for mode in interp jit; do
+  hits=$(./beebjit -os test.rom -swram f -test-map -expect 434241 \
+      -mode $mode -fast -debug -run \
+      -commands 'bm 1f0 1ff nostop;c' | grep -c 'addr=01F')
+  test "$hits" -eq 196
+done
 echo 'Running test.rom, JIT, fast, accurate.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 \
     -mode jit -fast -accurate
 echo 'Running test.rom, JIT, fast, accurate, debug.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 \
     -mode jit -fast -accurate -debug -run
+echo 'Running test.rom, JIT, fast, accurate, debug, reverse.'
+capture_file=$(mktemp)
+./beebjit -os test.rom -swram f -test-map -expect 434241 \
+    -mode jit -fast -accurate -debug -run -capture "$capture_file" \
+    -commands 'bmw 70;c;c;c;rc;rs;db 0;c' >/dev/null
+# Replaying from frequent checkpoints, including searching back through
+# several of them, must stop at the same places as replaying from power on.
+for cycles in 3001 100000000; do
+  ./beebjit -os test.rom -swram f -test-map -expect 434241 \
+      -mode jit -fast -accurate -debug -run -capture "$capture_file" \
+      -opt bbc:checkpoint-cycles=$cycles \
+      -commands 'bmw 70;c;c;c;rc;rc;rs;rs;c;rs;db 0;c' | grep '^\[' \
+      >"$capture_file.$cycles"
+done
+cmp "$capture_file.3001" "$capture_file.100000000"
+rm -f "$capture_file" "$capture_file.replay" "$capture_file".*
 echo 'Running test.rom, interpreter, fast.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 -mode interp -fast
 echo 'Running test.rom, interpreter, fast, debug, print.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 -mode interp -fast \
     -debug -run -print >/dev/null
+echo 'Running test.rom, interpreter, fast, accurate, debug, trace.'
+trace_file=$(mktemp)
+./beebjit -os test.rom -swram f -test-map -expect 434241 -mode interp -fast \
+    -accurate -debug -run -print | grep '^\[' | cut -c8-59 | \
+    sed 's/IRQ ([A-Z]*) /IRQ       /' >"$trace_file.print"
+./beebjit -os test.rom -swram f -test-map -expect 434241 -mode interp -fast \
+    -accurate -debug -commands "trace $trace_file z;c" >/dev/null
+./trace_tool "$trace_file" | cut -c1-52 | cmp - "$trace_file.print"
+rm -f "$trace_file" "$trace_file.print"
+echo 'Running frame saving, compressed.'
+frames_dir=$(mktemp -d)
+./beebjit -fast -accurate -opt video:always-render -frame-cycles 4000000 \
+    -max-frames 3 -exit-on-max-frames -frames-dir "$frames_dir" >/dev/null
+mkdir "$frames_dir/x"
+./beebjit -fast -accurate -opt video:always-render -frame-cycles 4000000 \
+    -max-frames 3 -exit-on-max-frames -frames-file "$frames_dir/f" >/dev/null
+./frames_tool "$frames_dir/f" "$frames_dir/x" -bgra
+for i in 0 1 2; do
+  cmp "$frames_dir/beebjit_frame_$i.bgra" "$frames_dir/x/beebjit_frame_$i.bgra"
+done
+rm -rf "$frames_dir"
+echo 'Running frame hashes, record and check.'
+hashes_file=$(mktemp)
+./beebjit -fast -accurate -frame-cycles 4000000 -frame-every 5 \
+    -max-frames 20 -exit-on-max-frames -frame-hashes "$hashes_file" >/dev/null
+./beebjit -fast -accurate -frame-cycles 4000000 -frame-every 5 \
+    -max-frames 20 -exit-on-max-frames -check-frame-hashes "$hashes_file" \
+    >/dev/null
+if ./beebjit -fast -accurate -frame-cycles 4000000 -frame-every 4 \
+    -max-frames 20 -exit-on-max-frames -check-frame-hashes "$hashes_file" \
+    >/dev/null 2>&1; then
+  echo 'Frame hashes check did not catch a difference.'
+  exit 1
+fi
+if ./beebjit -fast -accurate -frame-cycles 4000000 -frame-every 5 \
+    -max-frames 10 -exit-on-max-frames -check-frame-hashes "$hashes_file" \
+    >/dev/null 2>&1; then
+  echo 'Frame hashes check did not catch missing frames.'
+  exit 1
+fi
+rm -f "$hashes_file"
 echo 'Running test.rom, interpreter, slow.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 -mode interp
 echo 'Running test.rom, inturbo, fast.'
@@ -28,6 +101,23 @@ echo 'Running test.rom, inturbo, fast, debug.'
 echo 'Running test.rom, inturbo, fast, accurate.'
 ./beebjit -os test.rom -swram f -test-map -expect 434241 \
     -mode inturbo -fast -accurate
+echo 'Running test.rom, inturbo, fast, debug, accurate.'
+./beebjit -os test.rom -swram f -test-map -expect 434241 \
+    -mode inturbo -fast -debug -run -accurate
+# On x64, inturbo's bail out checks are short jumps to an epilog at the end of
+# each opcode's slot. That keeps every opcode but BRK and RTI small enough for
+# its slot in these modes; an opcode that spills over runs in the interpreter.
+if [ "$(uname -m)" = 'x86_64' ]; then
+  echo 'Checking inturbo opcode sizes.'
+  for flags in '' '-accurate' '-debug -run'; do
+    if ./beebjit -os test.rom -swram f -test-map -expect 434241 \
+        -mode inturbo -fast $flags -log perf:info 2>&1 |
+        grep 'excessive len' | grep -v 'opcode \$00 \|opcode \$40 '; then
+      echo "Oversized inturbo opcode with flags: $flags"
+      exit 1
+    fi
+  done
+fi
 
 echo 'Running timing.rom, interpreter, slow.'
 ./beebjit -os timing.rom -test-map -expect 434241 -mode interp
@@ -151,6 +151,40 @@ serial_ula_power_on_reset(struct serial_ula_struct* p_serial_ula) {
   serial_ula_update_mc6850_logic_lines(p_serial_ula);
 }
 
+void
+serial_ula_save_checkpoint(struct serial_ula_struct* p_serial_ula,
+                           struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf,
+                        &p_serial_ula->is_rs423_selected,
+                        sizeof(p_serial_ula->is_rs423_selected));
+  util_buffer_add_chunk(p_buf,
+                        &p_serial_ula->is_motor_on,
+                        sizeof(p_serial_ula->is_motor_on));
+  util_buffer_add_chunk(p_buf,
+                        &p_serial_ula->tape_carrier_count,
+                        sizeof(p_serial_ula->tape_carrier_count));
+  util_buffer_add_chunk(p_buf,
+                        &p_serial_ula->is_tape_DCD,
+                        sizeof(p_serial_ula->is_tape_DCD));
+}
+
+void
+serial_ula_load_checkpoint(struct serial_ula_struct* p_serial_ula,
+                           struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf,
+                        &p_serial_ula->is_rs423_selected,
+                        sizeof(p_serial_ula->is_rs423_selected));
+  util_buffer_get_chunk(p_buf,
+                        &p_serial_ula->is_motor_on,
+                        sizeof(p_serial_ula->is_motor_on));
+  util_buffer_get_chunk(p_buf,
+                        &p_serial_ula->tape_carrier_count,
+                        sizeof(p_serial_ula->tape_carrier_count));
+  util_buffer_get_chunk(p_buf,
+                        &p_serial_ula->is_tape_DCD,
+                        sizeof(p_serial_ula->is_tape_DCD));
+}
+
 uint8_t
 serial_ula_read(struct serial_ula_struct* p_serial_ula) {
   /* EMU NOTE: returns 0 on a real beeb, but appears to have side effects.
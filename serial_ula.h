@@ -8,6 +8,7 @@ struct serial_ula_struct;
 struct bbc_options;
 struct mc6850_struct;
 struct tape_struct;
+struct util_buffer;
 
 struct serial_ula_struct* serial_ula_create(struct mc6850_struct* p_serial,
                                             struct tape_struct* p_tape,
@@ -25,6 +26,10 @@ void serial_ula_set_io_handles(struct serial_ula_struct* p_serial_ula,
                                intptr_t handle_output);
 
 void serial_ula_power_on_reset(struct serial_ula_struct* p_serial_ula);
+void serial_ula_save_checkpoint(struct serial_ula_struct* p_serial_ula,
+                                struct util_buffer* p_buf);
+void serial_ula_load_checkpoint(struct serial_ula_struct* p_serial_ula,
+                                struct util_buffer* p_buf);
 
 uint8_t serial_ula_read(struct serial_ula_struct* p_serial_ula);
 void serial_ula_write(struct serial_ula_struct* p_serial_ula, uint8_t val);
@@ -13,6 +13,13 @@
 #include <math.h>
 #include <string.h>
 
+/* SSE2 and NEON are baseline on x64 and arm64. */
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 static const uint32_t k_sound_clock_rate = 250000;
 /* BBC master clock 2MHz, 8x divider for 250kHz sn76489 chip. */
 static const uint32_t k_sound_clock_divider = 8;
@@ -20,6 +27,38 @@ static const uint32_t k_sound_clock_divider = 8;
 enum {
   /* 0-2 square wave tone channels, 3 noise channel. */
   k_sound_num_channels = 4,
+  /* The resampler's low pass filter, in sn76489 frames, and the number of
+   * fractional positions it is tabulated at.
+   */
+  k_sound_resample_taps = 64,
+  k_sound_resample_phases = 128,
+  /* Deferred synthesis: the register write log size, and a log entry that
+   * stands for a power-on reset rather than a register write.
+   */
+  k_sound_write_log_size = 8192,
+  k_sound_write_reset = 0x100,
+  /* The log entries sound_log_regs() uses to rebuild the register state. */
+  k_sound_regs_log_writes = 12,
+};
+
+/* sn76489 registers. Writes decode into the emulation thread's copy. With
+ * deferred synthesis, the sound thread keeps its own copy, brought up to date
+ * from the write log.
+ */
+struct sound_sn_regs {
+  int16_t volume[k_sound_num_channels];
+  uint16_t period[k_sound_num_channels];
+  /* 0 - low, 1 - medium, 2 - high, 3 -- use tone generator 1. */
+  int noise_frequency;
+  /* 1 is white, 0 is periodic. */
+  int noise_type;
+  uint16_t noise_rng;
+  uint8_t latched_bits;
+};
+
+struct sound_write_record {
+  uint64_t sn_ticks;
+  uint16_t value;
 };
 
 struct sound_struct {
@@ -28,6 +67,7 @@ struct sound_struct {
 
   /* Configuration. */
   int synchronous;
+  int deferred;
   uint32_t driver_buffer_size;
   uint32_t driver_period_size;
   uint32_t sample_rate;
@@ -44,23 +84,48 @@ struct sound_struct {
   struct os_thread_struct* p_thread_sound;
   int16_t* p_driver_frames;
   uint32_t driver_buffer_index;
+  /* The last k_sound_resample_taps frames of the previous chunk precede
+   * p_sn_frames, in p_sn_buffer.
+   */
+  int16_t* p_sn_buffer;
   int16_t* p_sn_frames;
 
-  /* Resampling. */
-  double accumulated_value;
-  double accumulated_count;
-
-  /* sn76489 state. */
+  /* Resampling. The next driver frame is at sn76489 frame
+   * (resample_pos + (resample_rem / sample_rate)), counting from the start of
+   * the current chunk. Each driver frame advances by
+   * (resample_step + (resample_step_rem / sample_rate)).
+   */
+  int16_t* p_resample_kernel;
+  uint32_t resample_pos;
+  uint32_t resample_rem;
+  uint32_t resample_step;
+  uint32_t resample_step_rem;
+
+  /* sn76489 state. The counters and outputs belong to whichever thread is
+   * synthesizing.
+   */
   uint16_t counter[k_sound_num_channels];
   uint8_t output[k_sound_num_channels];
-  uint16_t noise_rng;
-  int16_t volume[k_sound_num_channels];
-  uint16_t period[k_sound_num_channels];
-  /* 0 - low, 1 - medium, 2 - high, 3 -- use tone generator 1. */
-  int noise_frequency;
-  /* 1 is white, 0 is periodic. */
-  int noise_type;
-  uint8_t latched_bits;
+  struct sound_sn_regs regs;
+
+  /* Deferred synthesis. The emulation thread appends register writes, stamped
+   * with the sn76489 tick they happened at, and publishes how far it has
+   * emulated. The sound thread synthesizes each chunk once the emulation is
+   * past it, and publishes how far it has got.
+   * The log is single producer, single consumer: head is only written by the
+   * emulation thread and tail only by the sound thread. write_log_dropped,
+   * also the emulation thread's, notes writes dropped while the log was full.
+   */
+  struct sound_write_record* p_write_log;
+  uint32_t write_log_head;
+  uint32_t write_log_tail;
+  int write_log_dropped;
+  uint64_t cpu_sn_ticks;
+  uint64_t play_sn_ticks;
+  uint64_t sn_ticks_base;
+  uint64_t deferred_lead_sn_ticks;
+  struct sound_sn_regs play_regs;
+  struct os_time_sleeper* p_play_sleeper;
 
   /* Timing. */
   struct timing_struct* p_timing;
@@ -73,16 +138,37 @@ struct sound_struct {
   uint32_t target_latency;
 };
 
+static void
+sound_add_run(int16_t* p_frames, uint32_t num_frames, int16_t value) {
+  uint32_t i = 0;
+#if defined(__SSE2__)
+  __m128i add = _mm_set1_epi16(value);
+  for (; (i + 8) <= num_frames; i += 8) {
+    __m128i frames = _mm_loadu_si128((__m128i*) &p_frames[i]);
+    _mm_storeu_si128((__m128i*) &p_frames[i], _mm_add_epi16(frames, add));
+  }
+#elif defined(__ARM_NEON)
+  int16x8_t add = vdupq_n_s16(value);
+  for (; (i + 8) <= num_frames; i += 8) {
+    vst1q_s16(&p_frames[i], vaddq_s16(vld1q_s16(&p_frames[i]), add));
+  }
+#endif
+  for (; i < num_frames; ++i) {
+    p_frames[i] += value;
+  }
+}
+
 static void
 sound_fill_sn76489_buffer(struct sound_struct* p_sound,
                           uint32_t num_frames,
-                          int16_t* p_volumes,
-                          uint16_t* p_periods,
-                          uint16_t noise_rng,
-                          int noise_type) {
+                          struct sound_sn_regs* p_regs) {
   uint32_t i;
   uint8_t channel;
 
+  int16_t* p_volumes = &p_regs->volume[0];
+  uint16_t* p_periods = &p_regs->period[0];
+  uint16_t noise_rng = p_regs->noise_rng;
+  int noise_type = p_regs->noise_type;
   int16_t* p_sn_frames = p_sound->p_sn_frames;
   uint16_t* p_counters = &p_sound->counter[0];
   uint8_t* p_outputs = &p_sound->output[0];
@@ -94,27 +180,53 @@ sound_fill_sn76489_buffer(struct sound_struct* p_sound,
     util_bail("p_sn_frames overflowed");
   }
 
+  p_sn_frames += sn_frames_filled;
+
+  /* Every channel contributes silence, plus the difference to its volume
+   * while its output is high. The sums wrap identically in any order.
+   */
   for (i = 0; i < num_frames; ++i) {
-    int16_t sample = 0;
-    for (channel = 0; channel < 4; ++channel) {
-      /* Tick the sn76489 clock and see if any timers expire. Flip the flip
-       * flops if they do.
-       */
-      int16_t sample_component = volume_silence;
-      uint16_t counter = p_counters[channel];
-      uint8_t output = p_outputs[channel];
-      int is_noise = 0;
-      if (channel == 3) {
-        is_noise = 1;
+    p_sn_frames[i] = (volume_silence * k_sound_num_channels);
+  }
+
+  /* Rather than tick each sn76489 clock, skip along each channel from one
+   * timer expiry to the next, adding in the runs of output between.
+   */
+  for (channel = 0; channel < k_sound_num_channels; ++channel) {
+    uint16_t counter = p_counters[channel];
+    uint8_t output = p_outputs[channel];
+    int16_t high_value = (p_volumes[channel] - volume_silence);
+    int is_noise = (channel == 3);
+    uint8_t value = output;
+    uint32_t pos = 0;
+
+    if (is_noise) {
+      value = (noise_rng & 1);
+    }
+
+    while (pos < num_frames) {
+      /* Ticks up to and including the one where the counter hits zero. */
+      uint32_t run = (((counter - 1) & 0x3ff) + 1);
+      uint32_t num_left = (num_frames - pos);
+      if (run > num_left) {
+        if (value) {
+          sound_add_run((p_sn_frames + pos), num_left, high_value);
+        }
+        counter = ((counter - num_left) & 0x3ff);
+        break;
+      }
+      if (value) {
+        sound_add_run((p_sn_frames + pos), (run - 1), high_value);
       }
+      pos += (run - 1);
 
-      counter = ((counter - 1) & 0x3ff);
-      if (counter == 0) {
-        counter = p_periods[channel];
-        output = !output;
-        p_outputs[channel] = output;
+      /* The timer expires, so flip the flip flop. */
+      counter = p_periods[channel];
+      output = !output;
+      value = output;
 
-        if (is_noise && output) {
+      if (is_noise) {
+        if (output) {
           /* NOTE: we do this like jsbeeb: we only update the random number
            * every two counter expiries, and we have the period values half what
            * they really are. This might mirror the real silicon? It avoids
@@ -129,78 +241,172 @@ sound_fill_sn76489_buffer(struct sound_struct* p_sound,
             int bit = ((noise_rng & 1) ^ ((noise_rng & 2) >> 1));
             noise_rng = ((noise_rng >> 1) | (bit << 14));
           }
-          p_sound->noise_rng = noise_rng;
+          p_regs->noise_rng = noise_rng;
         }
+        value = (noise_rng & 1);
       }
 
-      if (is_noise) {
-        output = (noise_rng & 1);
+      if (value) {
+        p_sn_frames[pos] += high_value;
       }
+      pos++;
+    }
+
+    p_counters[channel] = counter;
+    p_outputs[channel] = output;
+  }
+
+  p_sound->sn_frames_filled += num_frames;
+}
+
+static double
+sound_bessel_i0(double x) {
+  double term = 1.0;
+  double sum = 1.0;
+  uint32_t k;
 
-      p_counters[channel] = counter;
+  for (k = 1; k < 50; ++k) {
+    double half_x_over_k = (x / (2.0 * k));
+    term *= (half_x_over_k * half_x_over_k);
+    sum += term;
+  }
 
-      if (output) {
-        sample_component = p_volumes[channel];
+  return sum;
+}
+
+static void
+sound_build_resample_kernel(struct sound_struct* p_sound) {
+  /* A Kaiser windowed sinc low pass, cutting off a little below the driver
+   * Nyquist frequency. The box average this replaced let tones just above
+   * the driver Nyquist frequency alias back in at -5dB; this is nearer -40dB.
+   */
+  static const double k_beta = 6.0;
+  uint32_t phase;
+  uint32_t i;
+
+  double cutoff = ((0.408 * p_sound->sample_rate) / k_sound_clock_rate);
+  double half_taps = (k_sound_resample_taps / 2.0);
+  double i0_beta = sound_bessel_i0(k_beta);
+
+  for (phase = 0; phase < k_sound_resample_phases; ++phase) {
+    double taps[k_sound_resample_taps];
+    double sum = 0.0;
+    int32_t total = 0;
+    int16_t* p_kernel =
+        &p_sound->p_resample_kernel[phase * k_sound_resample_taps];
+    /* The middle of the fractional positions this phase covers. */
+    double fraction = ((phase + 0.5) / k_sound_resample_phases);
+
+    /* Tap i applies to the frame (k_sound_resample_taps - 1 - i) before the
+     * one the driver frame falls in. The output is delayed by half the taps.
+     */
+    for (i = 0; i < k_sound_resample_taps; ++i) {
+      double t = ((k_sound_resample_taps - 1 - i) + fraction - half_taps);
+      double x = (t / half_taps);
+      double value = (2.0 * cutoff);
+      if (t != 0.0) {
+        value = (sin(2.0 * M_PI * cutoff * t) / (M_PI * t));
       }
-      sample += sample_component;
+      if (fabs(x) < 1.0) {
+        value *= (sound_bessel_i0(k_beta * sqrt(1.0 - (x * x))) / i0_beta);
+      } else {
+        value = 0.0;
+      }
+      taps[i] = value;
+      sum += value;
+    }
+    /* Unity gain at DC exactly, so constant levels pass through unchanged. */
+    for (i = 0; i < k_sound_resample_taps; ++i) {
+      p_kernel[i] = (int16_t) lround(taps[i] * 32768.0 / sum);
+      total += p_kernel[i];
     }
-    p_sn_frames[sn_frames_filled + i] = sample;
+    p_kernel[k_sound_resample_taps / 2] += (32768 - total);
   }
+}
 
-  p_sound->sn_frames_filled += num_frames;
+static int32_t
+sound_resample_dot(const int16_t* p_frames, const int16_t* p_kernel) {
+  uint32_t i;
+#if defined(__SSE2__)
+  __m128i acc = _mm_setzero_si128();
+  for (i = 0; i < k_sound_resample_taps; i += 8) {
+    __m128i frames = _mm_loadu_si128((const __m128i*) &p_frames[i]);
+    __m128i kernel = _mm_loadu_si128((const __m128i*) &p_kernel[i]);
+    acc = _mm_add_epi32(acc, _mm_madd_epi16(frames, kernel));
+  }
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4E));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xB1));
+  return _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON)
+  int32x4_t acc = vdupq_n_s32(0);
+  for (i = 0; i < k_sound_resample_taps; i += 8) {
+    int16x8_t frames = vld1q_s16(&p_frames[i]);
+    int16x8_t kernel = vld1q_s16(&p_kernel[i]);
+    acc = vmlal_s16(acc, vget_low_s16(frames), vget_low_s16(kernel));
+    acc = vmlal_s16(acc, vget_high_s16(frames), vget_high_s16(kernel));
+  }
+  return vaddvq_s32(acc);
+#else
+  int32_t acc = 0;
+  for (i = 0; i < k_sound_resample_taps; ++i) {
+    acc += (p_frames[i] * p_kernel[i]);
+  }
+  return acc;
+#endif
 }
 
 static uint32_t
 sound_resample_to_driver_buffer(struct sound_struct* p_sound) {
-  uint32_t sn_frames_index;
-
   int16_t* p_driver_frames = p_sound->p_driver_frames;
   int16_t* p_sn_frames = p_sound->p_sn_frames;
-  double resample_count = p_sound->sn_frames_per_driver_frame;
+  const int16_t* p_resample_kernel = p_sound->p_resample_kernel;
   uint32_t num_sn_frames = p_sound->sn_frames_filled;
   uint32_t driver_buffer_size = p_sound->driver_buffer_size;
   uint32_t driver_buffer_index = p_sound->driver_buffer_index;
+  uint32_t sample_rate = p_sound->sample_rate;
+  uint32_t resample_pos = p_sound->resample_pos;
+  uint32_t resample_rem = p_sound->resample_rem;
+  uint32_t resample_step = p_sound->resample_step;
+  uint32_t resample_step_rem = p_sound->resample_step_rem;
   uint32_t num_driver_frames_written = 0;
 
-  /* Carry-over from prevous resample chunk. */
-  double accumulated_value = p_sound->accumulated_value;
-  double accumulated_count = p_sound->accumulated_count;
-
-  /* Downsample it to host device rate via average of sample values.
-   * Sampled sound playback is very sensitive to the quality of downsampling,
-   * so even the splitting of the border sample value into fractions is
-   * important.
+  /* Each driver frame is the low pass filtered sn76489 output at its exact
+   * position, so sampled sound doesn't jitter or alias.
    */
-  for (sn_frames_index = 0;
-       (sn_frames_index < num_sn_frames);
-       ++sn_frames_index) {
-    double leftover;
-    double this_sample_value = p_sn_frames[sn_frames_index];
-    accumulated_count++;
-    if (accumulated_count < resample_count) {
-      accumulated_value += this_sample_value;
-      continue;
+  while (resample_pos < num_sn_frames) {
+    uint32_t phase = (((uint64_t) resample_rem * k_sound_resample_phases) /
+                      sample_rate);
+    int32_t value = sound_resample_dot(
+        (p_sn_frames + resample_pos - (k_sound_resample_taps - 1)),
+        (p_resample_kernel + (phase * k_sound_resample_taps)));
+    value = ((value + (1 << 14)) >> 15);
+    if (value > INT16_MAX) {
+      value = INT16_MAX;
+    } else if (value < INT16_MIN) {
+      value = INT16_MIN;
     }
 
-    leftover = (accumulated_count - resample_count);
-    accumulated_value += ((1.0 - leftover) * this_sample_value);
-
     if (driver_buffer_index < driver_buffer_size) {
-      float average_sample_value = (accumulated_value / resample_count);
-      p_driver_frames[driver_buffer_index] = round(average_sample_value);
+      p_driver_frames[driver_buffer_index] = value;
       driver_buffer_index++;
       num_driver_frames_written++;
     }
 
-    accumulated_value = (leftover * this_sample_value);
-    accumulated_count = leftover;
+    resample_pos += resample_step;
+    resample_rem += resample_step_rem;
+    if (resample_rem >= sample_rate) {
+      resample_rem -= sample_rate;
+      resample_pos++;
+    }
   }
 
-  /* Preserve resample state so we don't lose precision as we cross resample
-   * chunks.
-   */
-  p_sound->accumulated_value = accumulated_value;
-  p_sound->accumulated_count = accumulated_count;
+  /* Keep the filter's history for the next chunk. */
+  (void) memmove((p_sn_frames - k_sound_resample_taps),
+                 (p_sn_frames + num_sn_frames - k_sound_resample_taps),
+                 (k_sound_resample_taps * sizeof(int16_t)));
+
+  p_sound->resample_pos = (resample_pos - num_sn_frames);
+  p_sound->resample_rem = resample_rem;
 
   p_sound->sn_frames_filled = 0;
   p_sound->driver_buffer_index = driver_buffer_index;
@@ -208,39 +414,64 @@ sound_resample_to_driver_buffer(struct sound_struct* p_sound) {
   return num_driver_frames_written;
 }
 
+static uint32_t
+sound_get_sn_frames_for_driver_frames(struct sound_struct* p_sound,
+                                      uint32_t num_frames) {
+  /* Up to and including the frame the last driver frame falls in. */
+  uint64_t rem = (p_sound->resample_rem +
+                  ((uint64_t) (num_frames - 1) * p_sound->resample_step_rem));
+  uint64_t pos = (p_sound->resample_pos +
+                  ((uint64_t) (num_frames - 1) * p_sound->resample_step) +
+                  (rem / p_sound->sample_rate));
+
+  return (uint32_t) (pos + 1);
+}
+
+static void
+sound_setup_resampler(struct sound_struct* p_sound,
+                      uint32_t sample_rate,
+                      uint32_t driver_buffer_size) {
+  p_sound->sample_rate = sample_rate;
+  p_sound->driver_buffer_size = driver_buffer_size;
+
+  /* sn76489 in the BBC ticks at 250kHz (8x divisor on main 2Mhz clock). */
+  p_sound->sn_frames_per_driver_frame = ((double) k_sound_clock_rate /
+                                         (double) sample_rate);
+  /* Room for a whole buffer of driver frames, plus the odd frame of the
+   * resampler's fractional position.
+   */
+  p_sound->sn_frames_per_driver_buffer_size =
+      (ceil(driver_buffer_size * p_sound->sn_frames_per_driver_frame) + 1);
+
+  p_sound->p_driver_frames = util_mallocz(driver_buffer_size * sizeof(int16_t));
+  p_sound->p_sn_buffer = util_mallocz(
+      (k_sound_resample_taps + p_sound->sn_frames_per_driver_buffer_size) *
+      sizeof(int16_t));
+  p_sound->p_sn_frames = (p_sound->p_sn_buffer + k_sound_resample_taps);
+
+  p_sound->resample_pos = 0;
+  p_sound->resample_rem = 0;
+  p_sound->resample_step = (k_sound_clock_rate / sample_rate);
+  p_sound->resample_step_rem = (k_sound_clock_rate % sample_rate);
+  p_sound->p_resample_kernel = util_malloc(
+      (k_sound_resample_phases * k_sound_resample_taps * sizeof(int16_t)));
+  sound_build_resample_kernel(p_sound);
+}
+
 static void
 sound_direct_write_driver_frames(struct sound_struct* p_sound,
-                                 int16_t* p_volumes,
-                                 uint16_t* p_periods,
-                                 uint16_t noise_rng,
-                                 int noise_type,
+                                 struct sound_sn_regs* p_regs,
                                  uint32_t num_frames) {
   uint32_t num_driver_frames;
   int16_t* p_driver_frames = p_sound->p_driver_frames;
-  double num_sn_frames;
-
-  num_sn_frames = (num_frames * p_sound->sn_frames_per_driver_frame);
+  uint32_t num_sn_frames = sound_get_sn_frames_for_driver_frames(p_sound,
+                                                                 num_frames);
 
   p_sound->sn_frames_filled = 0;
-  sound_fill_sn76489_buffer(p_sound,
-                            (uint32_t) num_sn_frames,
-                            p_volumes,
-                            p_periods,
-                            noise_rng,
-                            noise_type);
+  sound_fill_sn76489_buffer(p_sound, num_sn_frames, p_regs);
 
   p_sound->driver_buffer_index = 0;
   num_driver_frames = sound_resample_to_driver_buffer(p_sound);
-
-  /* TODO: the rounding errors causing this need looking into in more detail. */
-  if (num_driver_frames < num_frames) {
-    int16_t sample = 0;
-    if (num_driver_frames > 0) {
-      sample = p_driver_frames[num_driver_frames - 1];
-    }
-    p_driver_frames[num_driver_frames] = sample;
-    num_driver_frames++;
-  }
   assert(num_driver_frames == num_frames);
 
   os_sound_write(p_sound->p_driver, p_driver_frames, num_driver_frames);
@@ -248,38 +479,379 @@ sound_direct_write_driver_frames(struct sound_struct* p_sound,
 
 static void*
 sound_play_thread(void* p) {
-  int16_t volume[4];
-  uint16_t period[4];
+  struct sound_sn_regs regs;
 
   struct sound_struct* p_sound = (struct sound_struct*) p;
   uint32_t period_frames = p_sound->driver_period_size;
 
   /* We read these but the main thread writes them. */
   volatile int* p_do_exit = &p_sound->do_exit;
-  volatile int16_t* p_volume = &p_sound->volume[0];
-  volatile uint16_t* p_period = &p_sound->period[0];
-  volatile uint16_t* p_noise_rng = &p_sound->noise_rng;
-  volatile int* p_noise_type = &p_sound->noise_type;
+  volatile int16_t* p_volume = &p_sound->regs.volume[0];
+  volatile uint16_t* p_period = &p_sound->regs.period[0];
+  volatile uint16_t* p_noise_rng = &p_sound->regs.noise_rng;
+  volatile int* p_noise_type = &p_sound->regs.noise_type;
 
   while (!*p_do_exit) {
     uint32_t i;
 
     for (i = 0; i < 4; ++i) {
-      volume[i] = p_volume[i];
-      period[i] = p_period[i];
+      regs.volume[i] = p_volume[i];
+      regs.period[i] = p_period[i];
+    }
+    regs.noise_rng = *p_noise_rng;
+    regs.noise_type = *p_noise_type;
+
+    sound_direct_write_driver_frames(p_sound, &regs, period_frames);
+
+    *p_noise_rng = regs.noise_rng;
+  }
+
+  return NULL;
+}
+
+static void
+sound_sn_regs_reset(struct sound_struct* p_sound,
+                    struct sound_sn_regs* p_regs) {
+  uint32_t i;
+  int16_t volume_max = p_sound->volumes[0xf];
+
+  /* EMU: initial sn76489 state and behavior is something no two sources seem
+   * to agree on. It doesn't matter a huge amount for BBC emulation because
+   * MOS sets the sound channels up on boot. But the intial BBC power-on
+   * noise does arise from power-on sn76489 state.
+   * I'm choosing a strategy that sets up the registers as if they're all zero
+   * initialized. This leads to max volume, lowest tone in all channels, and
+   * the noise channel is periodic.
+   */
+  /* EMU: note that there are various sn76489 references that cite that chips
+   * seem to start with random register values, e.g.:
+   * http://www.smspower.org/Development/SN76489
+   */
+  for (i = 0; i < 4; ++i) {
+    /* NOTE: b-em uses volume of 8, mid-way volume. */
+    p_regs->volume[i] = volume_max;
+    /* NOTE: b-em == 0x3ff, b2 == 0x3ff, jsbeeb == 0 -> 0x3ff, MAME == 0 -> 0.
+     * I'm willing to bet jsbeeb is closest but still wrong. jsbeeb flips the
+     * output signal to positive immediately as it traverses -1.
+     * beebjit is 0 -> 0x3ff, via direct integer underflow, with no output
+     * signal flip. This means our first waveform will start negative, sort of
+     * matching MAME which notes the sn76489 has "inverted" output.
+     */
+    p_regs->period[i] = 0;
+  }
+
+  /* EMU NOTE: if we zero initialize noise_frequency, this implies a period of
+   * 0x10 on the noise channel.
+   * The original BBC startup noise does sound like a more complicated tone
+   * than just square waves so maybe that is correct:
+   * http://www.8bs.com/sounds/bbc.wav
+   * I'm deviating from my "zero intiialization" policy here to select a
+   * noise frequency register value of 2, which is period 0x40, which sounds
+   * closer to the BBC boot sound we all love!
+   */
+  p_regs->noise_frequency = 2;
+  p_regs->period[3] = 0x40;
+  p_regs->noise_type = 0;
+  p_regs->latched_bits = 0;
+  /* NOTE: MAME, b-em, b2 initialize here to 0x4000. */
+  p_regs->noise_rng = 0;
+}
+
+static void
+sound_reset_counters(struct sound_struct* p_sound) {
+  uint32_t i;
+  for (i = 0; i < 4; ++i) {
+    /* NOTE: b-em randomizes these counters, maybe to get a phase effect? */
+    p_sound->counter[i] = 0;
+    p_sound->output[i] = 0;
+  }
+}
+
+static void
+sound_sn_regs_write(struct sound_struct* p_sound,
+                    struct sound_sn_regs* p_regs,
+                    uint8_t value) {
+  uint8_t command;
+  uint8_t channel;
+
+  int32_t new_period = -1;
+
+  if (value & 0x80) {
+    p_regs->latched_bits = (value & 0x70);
+    command = (value & 0xF0);
+  } else {
+    command = p_regs->latched_bits;
+  }
+  channel = ((command >> 5) & 0x03);
+
+  if (command & 0x10) {
+    /* Update volume of channel. */
+    uint8_t volume_index = (0x0f - (value & 0x0f));
+    p_regs->volume[channel] = p_sound->volumes[volume_index];
+  } else if (channel == 3) {
+    /* For the noise channel, we only ever update the lower bits. */
+    int noise_frequency = (value & 0x03);
+    p_regs->noise_frequency = noise_frequency;
+    if (noise_frequency == 0) {
+      new_period = 0x10;
+    } else if (noise_frequency == 1) {
+      new_period = 0x20;
+    } else if (noise_frequency == 2) {
+      new_period = 0x40;
+    } else {
+      new_period = p_regs->period[2];
+    }
+    p_regs->noise_type = ((value & 0x04) >> 2);
+    p_regs->noise_rng = (1 << 14);
+  } else if (command & 0x80) {
+    /* Period low bits. */
+    uint16_t old_period = p_regs->period[channel];
+    new_period = (value & 0x0f);
+    new_period |= (old_period & 0x3f0);
+  } else {
+    uint16_t old_period = p_regs->period[channel];
+    new_period = ((value & 0x3f) << 4);
+    new_period |= (old_period & 0x0f);
+  }
+
+  if (new_period != -1) {
+    p_regs->period[channel] = new_period;
+    if ((channel == 2) && (p_regs->noise_frequency == 3)) {
+      p_regs->period[3] = new_period;
+    }
+  }
+}
+
+static uint8_t
+sound_inverse_volume_lookup(struct sound_struct* p_sound, int16_t volume) {
+  size_t i;
+  for (i = 0; i < 16; ++i) {
+    if (p_sound->volumes[i] == volume) {
+      return i;
+    }
+  }
+  assert(0);
+  return 0;
+}
+
+static uint64_t
+sound_get_sn_ticks(struct sound_struct* p_sound) {
+  uint64_t sn_ticks = (timing_get_scaled_total_timer_ticks(p_sound->p_timing) /
+                       k_sound_clock_divider);
+
+  /* A power-on reset zeroes the timer ticks, but the log's ticks must carry
+   * on from where they were.
+   */
+  if ((p_sound->sn_ticks_base + sn_ticks) < p_sound->cpu_sn_ticks) {
+    p_sound->sn_ticks_base = (p_sound->cpu_sn_ticks - sn_ticks);
+  }
+
+  return (p_sound->sn_ticks_base + sn_ticks);
+}
+
+static void
+sound_log_put(struct sound_struct* p_sound, uint64_t sn_ticks, uint16_t value) {
+  uint32_t head = p_sound->write_log_head;
+  struct sound_write_record* p_record =
+      &p_sound->p_write_log[head % k_sound_write_log_size];
+
+  p_record->sn_ticks = sn_ticks;
+  p_record->value = value;
+  __atomic_store_n(&p_sound->write_log_head, (head + 1), __ATOMIC_RELEASE);
+}
+
+static void
+sound_log_regs(struct sound_struct* p_sound, uint64_t sn_ticks) {
+  /* Logs the writes that bring the sound thread's registers to the emulation
+   * thread's, after some writes were dropped.
+   */
+  struct sound_sn_regs* p_regs = &p_sound->regs;
+  uint8_t latched_bits = p_regs->latched_bits;
+  uint8_t channel = ((latched_bits >> 5) & 0x03);
+  uint8_t value;
+  uint32_t i;
+
+  for (i = 0; i < 3; ++i) {
+    uint16_t period = p_regs->period[i];
+    sound_log_put(p_sound, sn_ticks, (0x80 | (i << 5) | (period & 0x0f)));
+    sound_log_put(p_sound, sn_ticks, ((period >> 4) & 0x3f));
+  }
+  sound_log_put(p_sound,
+                sn_ticks,
+                (0xE0 | (p_regs->noise_type << 2) | p_regs->noise_frequency));
+  for (i = 0; i < k_sound_num_channels; ++i) {
+    uint8_t volume_index = sound_inverse_volume_lookup(p_sound,
+                                                       p_regs->volume[i]);
+    sound_log_put(p_sound,
+                  sn_ticks,
+                  (0x90 | (i << 5) | (0x0f - volume_index)));
+  }
+
+  /* Finish by latching the latched register again, rewriting its value. */
+  if (latched_bits & 0x10) {
+    uint8_t volume_index = sound_inverse_volume_lookup(
+        p_sound, p_regs->volume[channel]);
+    value = (0x0f - volume_index);
+  } else if (channel == 3) {
+    value = ((p_regs->noise_type << 2) | p_regs->noise_frequency);
+  } else {
+    value = (p_regs->period[channel] & 0x0f);
+  }
+  sound_log_put(p_sound, sn_ticks, (0x80 | latched_bits | value));
+}
+
+static void
+sound_log_write(struct sound_struct* p_sound, uint16_t value) {
+  uint64_t sn_ticks = sound_get_sn_ticks(p_sound);
+  uint64_t max_lead_sn_ticks = (p_sound->sn_frames_per_driver_buffer_size * 2);
+  uint32_t num_needed = 1;
+
+  if (p_sound->write_log_dropped) {
+    num_needed += k_sound_regs_log_writes;
+  }
+
+  while ((p_sound->write_log_head -
+          __atomic_load_n(&p_sound->write_log_tail, __ATOMIC_ACQUIRE)) >
+             (k_sound_write_log_size - num_needed)) {
+    uint64_t play_sn_ticks = __atomic_load_n(&p_sound->play_sn_ticks,
+                                             __ATOMIC_ACQUIRE);
+    /* If the emulation is far ahead, e.g. in fast mode, the sound thread will
+     * skip ahead and never play these writes, so drop this one. The register
+     * state is logged in full once there is room again.
+     * Otherwise, the sound thread is stuck, e.g. the driver is blocked, so
+     * wait for it.
+     */
+    if ((sn_ticks > play_sn_ticks) &&
+        ((sn_ticks - play_sn_ticks) > max_lead_sn_ticks)) {
+      p_sound->write_log_dropped = 1;
+      __atomic_store_n(&p_sound->cpu_sn_ticks, sn_ticks, __ATOMIC_RELEASE);
+      return;
+    }
+    os_time_sleeper_sleep_us(p_sound->p_sleeper, 1000);
+  }
+
+  if (p_sound->write_log_dropped) {
+    sound_log_regs(p_sound, sn_ticks);
+    p_sound->write_log_dropped = 0;
+  }
+  sound_log_put(p_sound, sn_ticks, value);
+  __atomic_store_n(&p_sound->cpu_sn_ticks, sn_ticks, __ATOMIC_RELEASE);
+}
+
+static void
+sound_deferred_fill(struct sound_struct* p_sound,
+                    uint64_t sn_ticks,
+                    uint32_t num_sn_frames) {
+  uint64_t end_sn_ticks = (sn_ticks + num_sn_frames);
+  uint32_t tail = p_sound->write_log_tail;
+  struct sound_sn_regs* p_regs = &p_sound->play_regs;
+
+  p_sound->sn_frames_filled = 0;
+
+  /* Synthesize up to each logged write, then apply it, so each write takes
+   * effect at the same sn76489 tick as if it were synthesized as it happened.
+   * Writes from before the chunk, after skipping ahead, apply at its start.
+   */
+  while (sn_ticks < end_sn_ticks) {
+    uint64_t next_sn_ticks = end_sn_ticks;
+    uint32_t head = __atomic_load_n(&p_sound->write_log_head, __ATOMIC_ACQUIRE);
+    if (tail != head) {
+      struct sound_write_record* p_record =
+          &p_sound->p_write_log[tail % k_sound_write_log_size];
+      if (p_record->sn_ticks <= sn_ticks) {
+        if (p_record->value == k_sound_write_reset) {
+          sound_sn_regs_reset(p_sound, p_regs);
+          sound_reset_counters(p_sound);
+        } else {
+          sound_sn_regs_write(p_sound, p_regs, p_record->value);
+        }
+        tail++;
+        __atomic_store_n(&p_sound->write_log_tail, tail, __ATOMIC_RELEASE);
+        continue;
+      }
+      if (p_record->sn_ticks < next_sn_ticks) {
+        next_sn_ticks = p_record->sn_ticks;
+      }
+    }
+    sound_fill_sn76489_buffer(p_sound, (next_sn_ticks - sn_ticks), p_regs);
+    sn_ticks = next_sn_ticks;
+  }
+}
+
+static void*
+sound_deferred_play_thread(void* p) {
+  struct sound_struct* p_sound = (struct sound_struct*) p;
+  uint32_t chunk_frames = p_sound->sub_period_size;
+  uint64_t sn_ticks = p_sound->play_sn_ticks;
+  uint64_t max_lag_sn_ticks = p_sound->sn_frames_per_driver_buffer_size;
+
+  /* We read this but the main thread writes it. */
+  volatile int* p_do_exit = &p_sound->do_exit;
+
+  while (!*p_do_exit) {
+    uint32_t num_driver_frames;
+    uint32_t num_sn_frames = sound_get_sn_frames_for_driver_frames(
+        p_sound, chunk_frames);
+    uint64_t end_sn_ticks = (sn_ticks + num_sn_frames);
+    uint64_t cpu_sn_ticks = __atomic_load_n(&p_sound->cpu_sn_ticks,
+                                            __ATOMIC_ACQUIRE);
+
+    /* Only synthesize once the emulation is past the whole chunk, so all of
+     * the chunk's writes are in the log.
+     */
+    if (cpu_sn_ticks < end_sn_ticks) {
+      uint64_t delta_us = (((end_sn_ticks - cpu_sn_ticks) * 1000000) /
+                           k_sound_clock_rate);
+      os_time_sleeper_sleep_us(p_sound->p_play_sleeper, (delta_us + 1));
+      continue;
+    }
+    /* If the emulation ran ahead unpaced, e.g. in fast mode, skip the audio
+     * that there was no time to play. Its writes still apply.
+     */
+    if ((cpu_sn_ticks - end_sn_ticks) > max_lag_sn_ticks) {
+      end_sn_ticks = cpu_sn_ticks;
+      sn_ticks = (end_sn_ticks - num_sn_frames);
     }
 
-    sound_direct_write_driver_frames(p_sound,
-                                     volume,
-                                     period,
-                                     *p_noise_rng,
-                                     *p_noise_type,
-                                     period_frames);
+    sound_deferred_fill(p_sound, sn_ticks, num_sn_frames);
+    sn_ticks = end_sn_ticks;
+    __atomic_store_n(&p_sound->play_sn_ticks, sn_ticks, __ATOMIC_RELEASE);
+
+    p_sound->driver_buffer_index = 0;
+    num_driver_frames = sound_resample_to_driver_buffer(p_sound);
+    assert(num_driver_frames == chunk_frames);
+    os_sound_write(p_sound->p_driver,
+                   p_sound->p_driver_frames,
+                   num_driver_frames);
   }
 
   return NULL;
 }
 
+static void
+sound_deferred_tick(struct sound_struct* p_sound) {
+  uint64_t play_sn_ticks;
+  uint64_t cpu_sn_ticks = sound_get_sn_ticks(p_sound);
+
+  __atomic_store_n(&p_sound->cpu_sn_ticks, cpu_sn_ticks, __ATOMIC_RELEASE);
+
+  /* The sound thread blocks in the driver, so it runs at the sound card's
+   * rate. Keep the emulation a short lead ahead of it, which paces the
+   * emulation as the blocking driver writes did. If the emulation is further
+   * ahead than that, e.g. after fast mode, the sound thread skips to catch up
+   * so there's no waiting for it.
+   */
+  play_sn_ticks = __atomic_load_n(&p_sound->play_sn_ticks, __ATOMIC_ACQUIRE);
+  play_sn_ticks += p_sound->deferred_lead_sn_ticks;
+  if ((cpu_sn_ticks > play_sn_ticks) &&
+      ((cpu_sn_ticks - play_sn_ticks) <=
+          p_sound->sn_frames_per_driver_buffer_size)) {
+    uint64_t delta_us = (((cpu_sn_ticks - play_sn_ticks) * 1000000) /
+                         k_sound_clock_rate);
+    os_time_sleeper_sleep_us(p_sound->p_sleeper, delta_us);
+  }
+}
+
 struct sound_struct*
 sound_create(int synchronous,
              struct timing_struct* p_timing,
@@ -293,12 +865,16 @@ sound_create(int synchronous,
   p_sound->p_timing = p_timing;
   p_sound->p_sleeper = os_time_create_sleeper();
   p_sound->synchronous = synchronous;
+  /* Synchronous sound is synthesized on the sound thread by default, from a
+   * log of register writes.
+   */
+  p_sound->deferred = synchronous;
+  if (util_has_option(p_options->p_opt_flags, "sound:no-deferred")) {
+    p_sound->deferred = 0;
+  }
   p_sound->thread_running = 0;
   p_sound->do_exit = 0;
 
-  p_sound->accumulated_value = 0.0;
-  p_sound->accumulated_count = 0.0;
-
   p_sound->prev_system_ticks = 0;
   p_sound->sn_frames_filled = 0;
   p_sound->driver_buffer_index = 0;
@@ -352,8 +928,17 @@ sound_destroy(struct sound_struct* p_sound) {
   if (p_sound->p_driver_frames) {
     util_free(p_sound->p_driver_frames);
   }
-  if (p_sound->p_sn_frames) {
-    util_free(p_sound->p_sn_frames);
+  if (p_sound->p_sn_buffer) {
+    util_free(p_sound->p_sn_buffer);
+  }
+  if (p_sound->p_resample_kernel) {
+    util_free(p_sound->p_resample_kernel);
+  }
+  if (p_sound->p_write_log) {
+    util_free(p_sound->p_write_log);
+  }
+  if (p_sound->p_play_sleeper) {
+    os_time_free_sleeper(p_sound->p_play_sleeper);
   }
   os_time_free_sleeper(p_sound->p_sleeper);
   util_free(p_sound);
@@ -375,8 +960,6 @@ sound_set_driver(struct sound_struct* p_sound,
 
   sample_rate = os_sound_get_sample_rate(p_driver);
   driver_buffer_size = os_sound_get_buffer_size(p_driver);
-  p_sound->sample_rate = sample_rate;
-  p_sound->driver_buffer_size = driver_buffer_size;
   p_sound->driver_period_size = os_sound_get_period_size(p_driver);
 
   /* Calculate the number of time slices to divide a period into, to get around
@@ -398,15 +981,24 @@ sound_set_driver(struct sound_struct* p_sound,
              sub_period_size,
              sub_period_time_us);
 
-  /* sn76489 in the BBC ticks at 250kHz (8x divisor on main 2Mhz clock). */
-  p_sound->sn_frames_per_driver_frame = ((double) k_sound_clock_rate /
-                                         (double) sample_rate);
-  p_sound->sn_frames_per_driver_buffer_size =
-      floor(driver_buffer_size * p_sound->sn_frames_per_driver_frame);
+  sound_setup_resampler(p_sound, sample_rate, driver_buffer_size);
 
-  p_sound->p_driver_frames = util_mallocz(driver_buffer_size * sizeof(int16_t));
-  p_sound->p_sn_frames = util_mallocz(
-      p_sound->sn_frames_per_driver_buffer_size * sizeof(int16_t));
+  if (p_sound->synchronous && p_sound->deferred) {
+    /* Set up here rather than at sound_start_playing(), which may follow the
+     * emulation starting to log writes.
+     */
+    p_sound->p_write_log = util_malloc(
+        (k_sound_write_log_size * sizeof(struct sound_write_record)));
+    p_sound->write_log_head = 0;
+    p_sound->write_log_tail = 0;
+    p_sound->sn_ticks_base = 0;
+    p_sound->cpu_sn_ticks = sound_get_sn_ticks(p_sound);
+    p_sound->play_sn_ticks = p_sound->cpu_sn_ticks;
+    p_sound->deferred_lead_sn_ticks =
+        (2 * sound_get_sn_frames_for_driver_frames(p_sound, sub_period_size));
+    p_sound->play_regs = p_sound->regs;
+    p_sound->p_play_sleeper = os_time_create_sleeper();
+  }
 }
 
 void
@@ -417,64 +1009,29 @@ sound_start_playing(struct sound_struct* p_sound) {
     return;
   }
 
+  assert(!p_sound->thread_running);
   if (p_sound->synchronous) {
-    return;
+    if (!p_sound->deferred) {
+      return;
+    }
+    p_sound->p_thread_sound = os_thread_create(sound_deferred_play_thread,
+                                               p_sound);
+  } else {
+    p_sound->p_thread_sound = os_thread_create(sound_play_thread, p_sound);
   }
-
-  assert(!p_sound->thread_running);
-  p_sound->p_thread_sound = os_thread_create(sound_play_thread, p_sound);
   p_sound->thread_running = 1;
 }
 
 void
 sound_power_on_reset(struct sound_struct* p_sound) {
-  uint32_t i;
-  int16_t volume_max = p_sound->volumes[0xf];
-
-  /* EMU: initial sn76489 state and behavior is something no two sources seem
-   * to agree on. It doesn't matter a huge amount for BBC emulation because
-   * MOS sets the sound channels up on boot. But the intial BBC power-on
-   * noise does arise from power-on sn76489 state.
-   * I'm choosing a strategy that sets up the registers as if they're all zero
-   * initialized. This leads to max volume, lowest tone in all channels, and
-   * the noise channel is periodic.
-   */
-  /* EMU: note that there are various sn76489 references that cite that chips
-   * seem to start with random register values, e.g.:
-   * http://www.smspower.org/Development/SN76489
-   */
-  for (i = 0; i < 4; ++i) {
-    /* NOTE: b-em uses volume of 8, mid-way volume. */
-    p_sound->volume[i] = volume_max;
-    /* NOTE: b-em == 0x3ff, b2 == 0x3ff, jsbeeb == 0 -> 0x3ff, MAME == 0 -> 0.
-     * I'm willing to bet jsbeeb is closest but still wrong. jsbeeb flips the
-     * output signal to positive immediately as it traverses -1.
-     * beebjit is 0 -> 0x3ff, via direct integer underflow, with no output
-     * signal flip. This means our first waveform will start negative, sort of
-     * matching MAME which notes the sn76489 has "inverted" output.
-     */
-    p_sound->period[i] = 0;
-    /* NOTE: b-em randomizes these counters, maybe to get a phase effect? */
-    p_sound->counter[i] = 0;
-    p_sound->output[i] = 0;
+  sound_sn_regs_reset(p_sound, &p_sound->regs);
+  if (sound_is_synchronous(p_sound) && p_sound->deferred) {
+    /* The counters belong to the sound thread, which resets them in turn. */
+    sound_log_write(p_sound, k_sound_write_reset);
+  } else {
+    sound_reset_counters(p_sound);
   }
 
-  /* EMU NOTE: if we zero initialize noise_frequency, this implies a period of
-   * 0x10 on the noise channel.
-   * The original BBC startup noise does sound like a more complicated tone
-   * than just square waves so maybe that is correct:
-   * http://www.8bs.com/sounds/bbc.wav
-   * I'm deviating from my "zero intiialization" policy here to select a
-   * noise frequency register value of 2, which is period 0x40, which sounds
-   * closer to the BBC boot sound we all love!
-   */
-  p_sound->noise_frequency = 2;
-  p_sound->period[3] = 0x40;
-  p_sound->noise_type = 0;
-  p_sound->latched_bits = 0;
-  /* NOTE: MAME, b-em, b2 initialize here to 0x4000. */
-  p_sound->noise_rng = 0;
-
   p_sound->prev_system_ticks = 0;
 }
 
@@ -513,12 +1070,7 @@ sound_advance_sn_timing(struct sound_struct* p_sound) {
     delta_sn_ticks = (sn_frames_per_driver_buffer_size - sn_frames_filled);
   }
 
-  sound_fill_sn76489_buffer(p_sound,
-                            delta_sn_ticks,
-                            &p_sound->volume[0],
-                            &p_sound->period[0],
-                            p_sound->noise_rng,
-                            p_sound->noise_type);
+  sound_fill_sn76489_buffer(p_sound, delta_sn_ticks, &p_sound->regs);
 
   p_sound->prev_system_ticks = curr_system_ticks;
 }
@@ -538,6 +1090,11 @@ sound_tick(struct sound_struct* p_sound, uint64_t curr_time_us) {
 
   assert(sound_is_synchronous(p_sound));
 
+  if (p_sound->deferred) {
+    sound_deferred_tick(p_sound);
+    return;
+  }
+
   sound_advance_sn_timing(p_sound);
   (void) sound_resample_to_driver_buffer(p_sound);
 
@@ -578,71 +1135,15 @@ sound_tick(struct sound_struct* p_sound, uint64_t curr_time_us) {
 
 void
 sound_sn_write(struct sound_struct* p_sound, uint8_t value) {
-  uint8_t command;
-  uint8_t channel;
-
-  int32_t new_period = -1;
-
   if (sound_is_active(p_sound) && p_sound->synchronous) {
-    sound_advance_sn_timing(p_sound);
-  }
-
-  if (value & 0x80) {
-    p_sound->latched_bits = (value & 0x70);
-    command = (value & 0xF0);
-  } else {
-    command = p_sound->latched_bits;
-  }
-  channel = ((command >> 5) & 0x03);
-
-  if (command & 0x10) {
-    /* Update volume of channel. */
-    uint8_t volume_index = (0x0f - (value & 0x0f));
-    p_sound->volume[channel] = p_sound->volumes[volume_index];
-  } else if (channel == 3) {
-    /* For the noise channel, we only ever update the lower bits. */
-    int noise_frequency = (value & 0x03);
-    p_sound->noise_frequency = noise_frequency;
-    if (noise_frequency == 0) {
-      new_period = 0x10;
-    } else if (noise_frequency == 1) {
-      new_period = 0x20;
-    } else if (noise_frequency == 2) {
-      new_period = 0x40;
+    if (p_sound->deferred) {
+      sound_log_write(p_sound, value);
     } else {
-      new_period = p_sound->period[2];
+      sound_advance_sn_timing(p_sound);
     }
-    p_sound->noise_type = ((value & 0x04) >> 2);
-    p_sound->noise_rng = (1 << 14);
-  } else if (command & 0x80) {
-    /* Period low bits. */
-    uint16_t old_period = p_sound->period[channel];
-    new_period = (value & 0x0f);
-    new_period |= (old_period & 0x3f0);
-  } else {
-    uint16_t old_period = p_sound->period[channel];
-    new_period = ((value & 0x3f) << 4);
-    new_period |= (old_period & 0x0f);
   }
 
-  if (new_period != -1) {
-    p_sound->period[channel] = new_period;
-    if ((channel == 2) && (p_sound->noise_frequency == 3)) {
-      p_sound->period[3] = new_period;
-    }
-  }
-}
-
-static uint8_t
-sound_inverse_volume_lookup(struct sound_struct* p_sound, int16_t volume) {
-  size_t i;
-  for (i = 0; i < 16; ++i) {
-    if (p_sound->volumes[i] == volume) {
-      return i;
-    }
-  }
-  assert(0);
-  return 0;
+  sound_sn_regs_write(p_sound, &p_sound->regs, value);
 }
 
 void
@@ -656,17 +1157,26 @@ sound_get_state(struct sound_struct* p_sound,
                 uint8_t* p_noise_frequency,
                 uint16_t* p_noise_rng) {
   size_t i;
+  uint16_t noise_rng = p_sound->regs.noise_rng;
+
+  /* With deferred synthesis, the noise shift register is clocked on the sound
+   * thread, a little behind the emulation.
+   */
+  if (p_sound->p_write_log != NULL) {
+    noise_rng = p_sound->play_regs.noise_rng;
+  }
   for (i = 0; i < 4; ++i) {
-    p_volumes[i] = sound_inverse_volume_lookup(p_sound, p_sound->volume[i]);
-    p_periods[i] = p_sound->period[i];
+    p_volumes[i] = sound_inverse_volume_lookup(p_sound,
+                                               p_sound->regs.volume[i]);
+    p_periods[i] = p_sound->regs.period[i];
     p_counters[i] = p_sound->counter[i];
     p_outputs[i] = p_sound->output[i];
   }
 
-  *p_last_channel = (p_sound->latched_bits >> 5);
-  *p_noise_type = p_sound->noise_type;
-  *p_noise_frequency = p_sound->noise_frequency;
-  *p_noise_rng = p_sound->noise_rng;
+  *p_last_channel = (p_sound->regs.latched_bits >> 5);
+  *p_noise_type = p_sound->regs.noise_type;
+  *p_noise_frequency = p_sound->regs.noise_frequency;
+  *p_noise_rng = noise_rng;
 }
 
 void
@@ -681,14 +1191,64 @@ sound_set_state(struct sound_struct* p_sound,
                 uint16_t noise_rng) {
   size_t i;
   for (i = 0; i < 4; ++i) {
-    p_sound->volume[i] = p_sound->volumes[p_volumes[i]];
-    p_sound->period[i] = p_periods[i];
+    p_sound->regs.volume[i] = p_sound->volumes[p_volumes[i]];
+    p_sound->regs.period[i] = p_periods[i];
     p_sound->counter[i] = p_counters[i];
     p_sound->output[i] = p_outputs[i];
   }
 
-  p_sound->latched_bits = (last_channel << 5);
-  p_sound->noise_type = noise_type;
-  p_sound->noise_frequency = noise_frequency;
-  p_sound->noise_rng = noise_rng;
+  p_sound->regs.latched_bits = (last_channel << 5);
+  p_sound->regs.noise_type = noise_type;
+  p_sound->regs.noise_frequency = noise_frequency;
+  p_sound->regs.noise_rng = noise_rng;
 }
+
+void
+sound_save_checkpoint(struct sound_struct* p_sound, struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, &p_sound->regs, sizeof(p_sound->regs));
+}
+
+void
+sound_load_checkpoint(struct sound_struct* p_sound, struct util_buffer* p_buf) {
+  struct sound_sn_regs regs;
+  uint8_t latched_bits;
+  uint8_t channel;
+  uint8_t value;
+  uint32_t i;
+
+  util_buffer_get_chunk(p_buf, &regs, sizeof(regs));
+
+  /* Synthesis restarts here. The registers go in as writes so that deferred
+   * synthesis picks them up in order.
+   */
+  sound_power_on_reset(p_sound);
+  p_sound->prev_system_ticks =
+      timing_get_scaled_total_timer_ticks(p_sound->p_timing);
+  for (i = 0; i < 3; ++i) {
+    uint16_t period = regs.period[i];
+    sound_sn_write(p_sound, (0x80 | (i << 5) | (period & 0x0F)));
+    sound_sn_write(p_sound, ((period >> 4) & 0x3F));
+  }
+  sound_sn_write(p_sound,
+                 (0xE0 | (regs.noise_type << 2) | regs.noise_frequency));
+  for (i = 0; i < 4; ++i) {
+    value = sound_inverse_volume_lookup(p_sound, regs.volume[i]);
+    sound_sn_write(p_sound, (0x90 | (i << 5) | (0x0F - value)));
+  }
+
+  /* Latch the register that was latched, rewriting its current value. */
+  latched_bits = regs.latched_bits;
+  channel = (latched_bits >> 5);
+  if (latched_bits & 0x10) {
+    value = (0x0F - sound_inverse_volume_lookup(p_sound, regs.volume[channel]));
+  } else if (channel == 3) {
+    value = ((regs.noise_type << 2) | regs.noise_frequency);
+  } else {
+    value = (regs.period[channel] & 0x0F);
+  }
+  sound_sn_write(p_sound, (0x80 | latched_bits | value));
+
+  p_sound->regs.noise_rng = regs.noise_rng;
+}
+
+#include "test-sound.c"
@@ -6,6 +6,7 @@
 struct bbc_options;
 struct os_sound_struct;
 struct timing_struct;
+struct util_buffer;
 
 struct sound_struct;
 
@@ -19,6 +20,10 @@ void sound_set_driver(struct sound_struct* p_sound,
 void sound_start_playing(struct sound_struct* p_sound);
 
 void sound_power_on_reset(struct sound_struct* p_sound);
+void sound_save_checkpoint(struct sound_struct* p_sound,
+                           struct util_buffer* p_buf);
+void sound_load_checkpoint(struct sound_struct* p_sound,
+                           struct util_buffer* p_buf);
 
 int sound_is_active(struct sound_struct* p_sound);
 int sound_is_synchronous(struct sound_struct* p_sound);
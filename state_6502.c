@@ -77,6 +77,54 @@ state_6502_reset(struct state_6502* p_state_6502) {
   state_6502_set_pc(p_state_6502, init_pc);
 }
 
+void
+state_6502_save_checkpoint(struct state_6502* p_state_6502,
+                           struct util_buffer* p_buf) {
+  uint8_t regs[6];
+  uint16_t pc;
+
+  state_6502_get_registers(p_state_6502,
+                           &regs[0],
+                           &regs[1],
+                           &regs[2],
+                           &regs[3],
+                           &regs[4],
+                           &pc);
+  util_buffer_add_chunk(p_buf, &regs[0], 5);
+  util_buffer_add_chunk(p_buf, &pc, sizeof(pc));
+  util_buffer_add_chunk(p_buf,
+                        &p_state_6502->abi_state.irq_fire,
+                        sizeof(p_state_6502->abi_state.irq_fire));
+  util_buffer_add_chunk(p_buf,
+                        &p_state_6502->state,
+                        sizeof(p_state_6502->state));
+  timing_save_timer(p_state_6502->p_timing, p_state_6502->timer_id, p_buf);
+}
+
+void
+state_6502_load_checkpoint(struct state_6502* p_state_6502,
+                           struct util_buffer* p_buf) {
+  uint8_t regs[6];
+  uint16_t pc;
+
+  util_buffer_get_chunk(p_buf, &regs[0], 5);
+  util_buffer_get_chunk(p_buf, &pc, sizeof(pc));
+  state_6502_set_registers(p_state_6502,
+                           regs[0],
+                           regs[1],
+                           regs[2],
+                           regs[3],
+                           regs[4],
+                           pc);
+  util_buffer_get_chunk(p_buf,
+                        &p_state_6502->abi_state.irq_fire,
+                        sizeof(p_state_6502->abi_state.irq_fire));
+  util_buffer_get_chunk(p_buf,
+                        &p_state_6502->state,
+                        sizeof(p_state_6502->state));
+  timing_load_timer(p_state_6502->p_timing, p_state_6502->timer_id, p_buf);
+}
+
 void
 state_6502_get_registers(struct state_6502* p_state_6502,
                          uint8_t* a,
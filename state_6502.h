@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+struct util_buffer;
+
 enum {
   k_state_6502_irq_via_1 = 1,
   k_state_6502_irq_via_2 = 2,
@@ -53,6 +55,10 @@ struct state_6502* state_6502_create(struct timing_struct* p_timing,
 void state_6502_destroy(struct state_6502* p_state_6502);
 
 void state_6502_reset(struct state_6502* p_state_6502);
+void state_6502_save_checkpoint(struct state_6502* p_state_6502,
+                                struct util_buffer* p_buf);
+void state_6502_load_checkpoint(struct state_6502* p_state_6502,
+                                struct util_buffer* p_buf);
 
 void state_6502_get_registers(struct state_6502* p_state_6502,
                               uint8_t* a,
@@ -125,6 +125,30 @@ tape_power_on_reset(struct tape_struct* p_tape) {
   tape_rewind(p_tape);
 }
 
+void
+tape_save_checkpoint(struct tape_struct* p_tape, struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf,
+                        &p_tape->is_tape_running,
+                        sizeof(p_tape->is_tape_running));
+  util_buffer_add_chunk(p_buf, &p_tape->tape_index, sizeof(p_tape->tape_index));
+  util_buffer_add_chunk(p_buf,
+                        &p_tape->tape_buffer_pos,
+                        sizeof(p_tape->tape_buffer_pos));
+  timing_save_timer(p_tape->p_timing, p_tape->timer_id, p_buf);
+}
+
+void
+tape_load_checkpoint(struct tape_struct* p_tape, struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf,
+                        &p_tape->is_tape_running,
+                        sizeof(p_tape->is_tape_running));
+  util_buffer_get_chunk(p_buf, &p_tape->tape_index, sizeof(p_tape->tape_index));
+  util_buffer_get_chunk(p_buf,
+                        &p_tape->tape_buffer_pos,
+                        sizeof(p_tape->tape_buffer_pos));
+  timing_load_timer(p_tape->p_timing, p_tape->timer_id, p_buf);
+}
+
 void
 tape_add_tape(struct tape_struct* p_tape, const char* p_file_name) {
   uint8_t* p_in_file_buf;
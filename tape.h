@@ -8,6 +8,7 @@ struct tape_struct;
 struct bbc_options;
 struct serial_ula_struct;
 struct timing_struct;
+struct util_buffer;
 
 enum {
   k_tape_max_file_size = (1024 * 1024 * 8),
@@ -27,6 +28,10 @@ void tape_set_serial_ula(struct tape_struct* p_tape,
                          struct serial_ula_struct* p_serial_ula);
 
 void tape_power_on_reset(struct tape_struct* p_tape);
+void tape_save_checkpoint(struct tape_struct* p_tape,
+                          struct util_buffer* p_buf);
+void tape_load_checkpoint(struct tape_struct* p_tape,
+                          struct util_buffer* p_buf);
 
 void tape_add_tape(struct tape_struct* p_tape, const char* p_filename);
 void tape_cycle_tape(struct tape_struct* p_tape);
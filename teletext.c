@@ -47,6 +47,18 @@ static uint8_t s_teletext_generated_glyphs[96 * 16 * 20];
 static uint8_t s_teletext_generated_gfx[96 * 16 * 20];
 static uint8_t s_teletext_generated_sep_gfx[96 * 16 * 20];
 
+/* Fully rendered 16 pixel glyph rows, keyed by the glyph data row, which
+ * already reflects the glyph, graphics mode, scanline, smoothing and double
+ * height part, and by the foreground and background colors.
+ */
+enum {
+  k_teletext_row_cache_size = 4096,
+};
+
+struct teletext_row_cache_tag {
+  uint8_t* p_src_data;
+  uint32_t colors;
+};
 
 struct teletext_struct {
   struct render_character_1MHz render_character_1MHz_black;
@@ -74,6 +86,8 @@ struct teletext_struct {
   int incoming_dispen;
   uint8_t* p_render_character;
   uint32_t render_fg_color;
+  struct teletext_row_cache_tag row_cache_tags[k_teletext_row_cache_size];
+  struct render_character_1MHz row_cache[k_teletext_row_cache_size];
 };
 
 static void
@@ -521,27 +535,20 @@ teletext_data(struct teletext_struct* p_teletext, uint8_t data) {
   p_teletext->dispen_pipeline[1] = p_teletext->incoming_dispen;
 }
 
-void
-teletext_render(struct teletext_struct* p_teletext,
-                struct render_character_1MHz* p_out,
-                struct render_character_1MHz* p_next_out) {
-  uint32_t i;
+/* Gets the glyph data row to render for the current character, or NULL if the
+ * display is disabled. Also gets the row for the following buffer line, if
+ * rendering both.
+ */
+static uint8_t*
+teletext_get_render_rows(struct teletext_struct* p_teletext,
+                         int do_next_row,
+                         uint8_t** p_p_next_src_data) {
   uint32_t src_data_scanline;
   int do_render_rounded_scanline;
   uint8_t* p_src_data = p_teletext->p_render_character;
-  uint32_t render_fg_color = p_teletext->render_fg_color;
-  uint32_t bg_color = p_teletext->bg_color;
-  struct render_character_1MHz* p_black =
-      &p_teletext->render_character_1MHz_black;
 
   if (!p_teletext->curr_dispen) {
-    if (p_out) {
-      *p_out = *p_black;
-    }
-    if (p_next_out) {
-      *p_next_out = *p_black;
-    }
-    return;
+    return NULL;
   }
 
   if ((p_teletext->flash_active && !p_teletext->flash_visible_this_frame) ||
@@ -573,7 +580,7 @@ teletext_render(struct teletext_struct* p_teletext,
   /* Handle interlaced rendering. This is a non-default configuration where
    * the renderer only rasters every other line in the canvas.
    */
-  if ((p_next_out == NULL) &&
+  if (!do_next_row &&
       p_teletext->crtc_ra0 &&
       !p_teletext->double_active) {
     do_render_rounded_scanline = 1;
@@ -586,34 +593,126 @@ teletext_render(struct teletext_struct* p_teletext,
   assert(src_data_scanline < 20);
   p_src_data += (src_data_scanline * 16);
 
-  for (i = 0; i < 16; ++i) {
-    uint32_t color;
-    uint8_t val = p_src_data[i];
+  /* Another condition to handle non-interlaced teletext. */
+  *p_p_next_src_data = p_src_data;
+  if (p_teletext->is_isv && !p_teletext->double_active) {
+    *p_p_next_src_data += 16;
+  }
+
+  return p_src_data;
+}
+
+static inline uint8_t
+teletext_get_color_index(uint32_t color) {
+  /* The colors are stored as 0 or 1 per channel. */
+  return (((color >> 16) & 1) | ((color >> 7) & 2) | ((color & 1) << 2));
+}
+
+static void
+teletext_render_row(struct teletext_struct* p_teletext,
+                    struct render_character_1MHz* p_out,
+                    uint8_t* p_src_data,
+                    uint32_t colors) {
+  struct teletext_row_cache_tag* p_tag;
+  struct render_character_1MHz* p_row;
+  uint32_t i;
+  /* Consecutive glyph rows are 16 bytes apart. */
+  uint32_t index = (uint32_t) (((uintptr_t) p_src_data >> 4) + (colors * 613));
+
+  index &= (k_teletext_row_cache_size - 1);
+  p_tag = &p_teletext->row_cache_tags[index];
+  p_row = &p_teletext->row_cache[index];
+
+  if ((p_tag->p_src_data != p_src_data) || (p_tag->colors != colors)) {
+    uint32_t render_fg_color = p_teletext->render_fg_color;
+    uint32_t bg_color = p_teletext->bg_color;
+    for (i = 0; i < 16; ++i) {
+      uint32_t color;
+      uint8_t val = p_src_data[i];
 
-    color = (val * render_fg_color);
-    color += ((255 - val) * bg_color);
+      color = (val * render_fg_color);
+      color += ((255 - val) * bg_color);
 
-    p_out->host_pixels[i] = (color | 0xff000000);
+      p_row->host_pixels[i] = (color | 0xff000000);
+    }
+    p_tag->p_src_data = p_src_data;
+    p_tag->colors = colors;
   }
 
-  p_out = p_next_out;
-  if (p_out == NULL) {
+  *p_out = *p_row;
+}
+
+void
+teletext_render(struct teletext_struct* p_teletext,
+                struct render_character_1MHz* p_out,
+                struct render_character_1MHz* p_next_out) {
+  uint32_t colors;
+  uint8_t* p_next_src_data;
+  uint8_t* p_src_data = teletext_get_render_rows(p_teletext,
+                                                 (p_next_out != NULL),
+                                                 &p_next_src_data);
+
+  if (p_src_data == NULL) {
+    struct render_character_1MHz* p_black =
+        &p_teletext->render_character_1MHz_black;
+    if (p_out) {
+      *p_out = *p_black;
+    }
+    if (p_next_out) {
+      *p_next_out = *p_black;
+    }
     return;
   }
 
-  /* Another condition to handle non-interlaced teletext. */
-  if (p_teletext->is_isv && !p_teletext->double_active) {
-    p_src_data += 16;
+  colors = ((teletext_get_color_index(p_teletext->render_fg_color) << 3) |
+            teletext_get_color_index(p_teletext->bg_color));
+  teletext_render_row(p_teletext, p_out, p_src_data, colors);
+  if (p_next_out != NULL) {
+    teletext_render_row(p_teletext, p_next_out, p_next_src_data, colors);
   }
+}
 
-  for (i = 0; i < 16; ++i) {
-    uint32_t color;
-    uint8_t val = p_src_data[i];
+void
+teletext_render_indexed(struct teletext_struct* p_teletext,
+                        uint8_t* p_out,
+                        uint8_t* p_next_out) {
+  uint32_t i;
+  uint8_t* p_next_src_data;
+  uint8_t fg_index;
+  uint8_t bg_index;
+  uint8_t level_indexes[4];
+  uint8_t* p_src_data = teletext_get_render_rows(p_teletext,
+                                                 (p_next_out != NULL),
+                                                 &p_next_src_data);
+
+  if (p_src_data == NULL) {
+    (void) memset(p_out, k_render_index_background, 16);
+    if (p_next_out) {
+      (void) memset(p_next_out, k_render_index_background, 16);
+    }
+    return;
+  }
 
-    color = (val * render_fg_color);
-    color += ((255 - val) * bg_color);
+  /* The anti-aliased glyph values are only ever 0, 85, 170 or 255, so the
+   * top 2 bits select the blend level.
+   */
+  fg_index = teletext_get_color_index(p_teletext->render_fg_color);
+  bg_index = teletext_get_color_index(p_teletext->bg_color);
+  level_indexes[0] = (k_render_index_teletext_solid + bg_index);
+  level_indexes[1] = (k_render_index_teletext_blend |
+                      (fg_index << 3) |
+                      bg_index);
+  level_indexes[2] = (level_indexes[1] + 0x40);
+  level_indexes[3] = (k_render_index_teletext_solid + fg_index);
 
-    p_out->host_pixels[i] = (color | 0xff000000);
+  for (i = 0; i < 16; ++i) {
+    p_out[i] = level_indexes[p_src_data[i] >> 6];
+  }
+  if (p_next_out == NULL) {
+    return;
+  }
+  for (i = 0; i < 16; ++i) {
+    p_next_out[i] = level_indexes[p_next_src_data[i] >> 6];
   }
 }
 
@@ -23,5 +23,9 @@ void teletext_VSYNC_changed(struct teletext_struct* p_teletext, int value);
 void teletext_render(struct teletext_struct* p_teletext,
                      struct render_character_1MHz* p_out,
                      struct render_character_1MHz* p_next_out);
+/* Renders palette indexes rather than pixels, for the indexed render buffer. */
+void teletext_render_indexed(struct teletext_struct* p_teletext,
+                             uint8_t* p_out,
+                             uint8_t* p_next_out);
 
 #endif /* BEEBJIT_TELETEXT_H */
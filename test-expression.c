@@ -272,6 +272,54 @@ expression_test_parens(void) {
   expression_destroy(p_expression);
 }
 
+static void
+expression_test_compile(void) {
+  struct expression_struct* p_expression = expression_test_get_expression();
+
+  /* Constant sub-expressions fold away. */
+  expression_parse(p_expression, "(1 + 2) * 3 == 9");
+  test_expect_u32(1, p_expression->num_ops);
+  test_expect_u32(1, expression_execute(p_expression));
+  expression_parse(p_expression, "var + (2 * 3)");
+  test_expect_u32(3, p_expression->num_ops);
+  expression_parse(p_expression, "buf[1 + 2]");
+  test_expect_u32(1, p_expression->num_ops);
+  expression_parse(p_expression, "0 && var");
+  test_expect_u32(1, p_expression->num_ops);
+  test_expect_u32(0, expression_execute(p_expression));
+  expression_parse(p_expression, "7 || var");
+  test_expect_u32(1, p_expression->num_ops);
+  test_expect_u32(1, expression_execute(p_expression));
+  expression_parse(p_expression, "1 / 0 || 1");
+  test_expect_u32(5, p_expression->num_ops);
+
+  /* Short-circuit evaluation skips side effects. */
+  s_test_var = 0;
+  expression_parse(p_expression, "(var == 1) && (var = 5)");
+  test_expect_u32(0, expression_execute(p_expression));
+  test_expect_u32(0, s_test_var);
+  s_test_var = 1;
+  test_expect_u32(1, expression_execute(p_expression));
+  test_expect_u32(5, s_test_var);
+  expression_parse(p_expression, "(var == 5) || (var = 0)");
+  test_expect_u32(1, expression_execute(p_expression));
+  test_expect_u32(5, s_test_var);
+  expression_parse(p_expression, "(var == 6) || (var = 0)");
+  test_expect_u32(0, expression_execute(p_expression));
+  test_expect_u32(0, s_test_var);
+
+  /* Run time indices and nested evaluation. */
+  s_test_buf[3] = 33;
+  s_test_var = 2;
+  expression_parse(p_expression, "buf[var + 1] + getindex[var] * 2");
+  test_expect_u32(37, expression_execute(p_expression));
+  expression_parse(p_expression, "buf[var] = getindex[var + 4] + 1");
+  test_expect_u32(7, expression_execute(p_expression));
+  test_expect_u32(7, s_test_buf[2]);
+
+  expression_destroy(p_expression);
+}
+
 void
 expression_test() {
   expression_test_basic();
@@ -283,4 +331,5 @@ expression_test() {
   expression_test_assign();
   expression_test_misc();
   expression_test_parens();
+  expression_test_compile();
 }
@@ -4,6 +4,9 @@
 
 #include "bbc.h"
 #include "emit_6502.h"
+#include "os_time.h"
+
+#include "asm/asm_opcodes.h"
 
 static struct cpu_driver* s_p_cpu_driver = NULL;
 static struct jit_struct* s_p_jit = NULL;
@@ -809,6 +812,66 @@ jit_test_dynamic_opcode_2(void) {
   util_buffer_destroy(p_buf);
 }
 
+static void
+jit_test_dynamic_operand_branch(void) {
+  uint64_t num_compiles;
+  void* p_jit_ptr;
+  struct util_buffer* p_buf = util_buffer_create();
+
+  util_buffer_setup(p_buf, (s_p_mem + 0x3D00), 0x100);
+  emit_LDX(p_buf, k_imm, 0x00);
+  emit_BEQ(p_buf, 2);
+  emit_LDX(p_buf, k_imm, 0x01);
+  emit_STX(p_buf, k_zpg, 0x50);
+  emit_EXIT(p_buf);
+  /* Run twice; the first run splits the block at the branch target. */
+  state_6502_set_pc(s_p_state_6502, 0x3D00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+  state_6502_set_pc(s_p_state_6502, 0x3D00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  test_expect_u32(0x00, s_p_mem[0x50]);
+
+  /* Self-modify the branch offset so it lands on the LDX #$01. */
+  s_p_mem[0x3D03] = 0x00;
+  jit_test_invalidate_code_at_address(s_p_jit, 0x3D03);
+  state_6502_set_pc(s_p_state_6502, 0x3D00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  test_expect_u32(0x01, s_p_mem[0x50]);
+  /* It's a dynamic operand, not a dynamic opcode. */
+  p_jit_ptr = jit_metadata_get_host_jit_ptr(s_p_metadata, 0x3D02);
+  test_expect_u32(0, jit_metadata_is_jit_ptr_dynamic(s_p_metadata, p_jit_ptr));
+  p_jit_ptr = jit_metadata_get_host_jit_ptr(s_p_metadata, 0x3D03);
+  test_expect_u32(1, jit_metadata_is_jit_ptr_dynamic(s_p_metadata, p_jit_ptr));
+
+  /* Run again to settle the block split at the dynamic operand. */
+  state_6502_set_pc(s_p_state_6502, 0x3D00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  /* Flip the offset back. The branch target should be calculated at runtime
+   * without a recompile.
+   */
+  s_p_mem[0x3D03] = 0x02;
+  jit_test_invalidate_code_at_address(s_p_jit, 0x3D03);
+  jit_test_expect_block_invalidated(0, 0x3D00);
+  jit_test_expect_code_invalidated(0, 0x3D02);
+
+  num_compiles = s_p_jit->counter_num_compiles;
+  state_6502_set_pc(s_p_state_6502, 0x3D00);
+  jit_enter(s_p_cpu_driver);
+  interp_testing_unexit(s_p_interp);
+
+  test_expect_u32(0x00, s_p_mem[0x50]);
+  test_expect_u32(num_compiles, s_p_jit->counter_num_compiles);
+
+  util_buffer_destroy(p_buf);
+}
+
 static void
 jit_test_dynamic_opcode_3(void) {
   uint64_t ticks;
@@ -1515,6 +1578,196 @@ jit_test_compile_binary(void) {
   test_expect_binary(p_expect, p_binary, expect_len);
 }
 
+static uint32_t s_jit_test_timer_id;
+
+static void
+jit_test_collapse_timer_callback(void* p) {
+  (void) p;
+
+  /* Releases the wait loop. */
+  s_p_mem[0x70] = 0;
+  (void) timing_stop_timer(s_p_timing, s_jit_test_timer_id);
+}
+
+static uint64_t
+jit_test_collapse_run(uint16_t addr,
+                      uint8_t x,
+                      uint8_t y,
+                      int64_t timer_value,
+                      int is_jit,
+                      uint8_t* p_regs) {
+  uint64_t ticks;
+  uint16_t pc;
+
+  s_p_mem[0x70] = 1;
+  state_6502_set_registers(s_p_state_6502, 0x01, x, y, 0xFF, 0x04, addr);
+  if (timer_value > 0) {
+    (void) timing_start_timer_with_value(s_p_timing,
+                                         s_jit_test_timer_id,
+                                         timer_value);
+  }
+
+  ticks = timing_get_total_timer_ticks(s_p_timing);
+  if (is_jit) {
+    jit_enter(s_p_cpu_driver);
+  } else {
+    /* Without the JIT's callback, the interpreter runs the whole loop. */
+    int64_t countdown = timing_get_countdown(s_p_timing);
+    interp_set_instruction_callback(s_p_interp, NULL, NULL);
+    countdown = interp_enter_with_countdown(s_p_interp, countdown);
+    (void) timing_advance_time(s_p_timing, countdown);
+    interp_set_instruction_callback(s_p_interp,
+                                    jit_interp_instruction_callback,
+                                    s_p_jit);
+  }
+  interp_testing_unexit(s_p_interp);
+  ticks = (timing_get_total_timer_ticks(s_p_timing) - ticks);
+
+  test_expect_u32(0, timing_timer_is_running(s_p_timing, s_jit_test_timer_id));
+  state_6502_get_registers(s_p_state_6502,
+                           &p_regs[0],
+                           &p_regs[1],
+                           &p_regs[2],
+                           &p_regs[3],
+                           &p_regs[4],
+                           &pc);
+  p_regs[5] = (pc - addr);
+
+  return ticks;
+}
+
+static uint64_t
+jit_test_collapse_expect_interp(uint16_t addr,
+                                uint8_t x,
+                                uint8_t y,
+                                int64_t timer_value) {
+  uint8_t jit_regs[6];
+  uint8_t regs[6];
+  uint32_t i;
+  /* The first run compiles the loop, the second runs the compiled code. */
+  uint64_t ticks = jit_test_collapse_run(addr, x, y, timer_value, 1, regs);
+
+  test_expect_u32(ticks,
+                  jit_test_collapse_run(addr, x, y, timer_value, 1, jit_regs));
+  for (i = 0; i < 6; ++i) {
+    test_expect_u32(regs[i], jit_regs[i]);
+  }
+  test_expect_u32(ticks,
+                  jit_test_collapse_run(addr, x, y, timer_value, 0, regs));
+  for (i = 0; i < 6; ++i) {
+    test_expect_u32(regs[i], jit_regs[i]);
+  }
+
+  return ticks;
+}
+
+static void
+jit_test_collapse_loops(void) {
+  uint32_t i;
+  uint32_t num_timers;
+  int64_t* p_timer_values;
+  uint8_t regs[6];
+  struct util_buffer* p_buf = util_buffer_create();
+
+  s_jit_test_timer_id = timing_register_timer(s_p_timing,
+                                              "jit_test_collapse",
+                                              jit_test_collapse_timer_callback,
+                                              NULL);
+  /* Park the machine's timers so that only the test timer bounds the
+   * countdown, which can then be made wider than 32 bits.
+   */
+  num_timers = s_jit_test_timer_id;
+  p_timer_values = util_mallocz(num_timers * sizeof(int64_t));
+  for (i = 0; i < num_timers; ++i) {
+    p_timer_values[i] = INT64_MIN;
+    if (timing_timer_is_running(s_p_timing, i)) {
+      p_timer_values[i] = timing_get_timer_value(s_p_timing, i);
+      (void) timing_stop_timer(s_p_timing, i);
+    }
+  }
+
+  /* DEX and DEY delay loops, with 8-bit counts including the full 256. */
+  util_buffer_setup(p_buf, (s_p_mem + 0x3E00), 0x10);
+  emit_DEX(p_buf);
+  emit_BNE(p_buf, -3);
+  emit_EXIT(p_buf);
+  util_buffer_setup(p_buf, (s_p_mem + 0x3E10), 0x10);
+  emit_NOP(p_buf);
+  emit_DEY(p_buf);
+  emit_BNE(p_buf, -4);
+  emit_EXIT(p_buf);
+
+  /* Each taken DEX, BNE is 5 cycles and the exit sequence is 6. */
+  test_expect_u32(((19 * 5) - 1 + 6),
+                  jit_test_collapse_expect_interp(0x3E00, 0x13, 0, 0));
+  test_expect_u32((4 + 6), jit_test_collapse_expect_interp(0x3E00, 0x01, 0, 0));
+  test_expect_u32(((256 * 5) - 1 + 6),
+                  jit_test_collapse_expect_interp(0x3E00, 0x00, 0, 0));
+  test_expect_u32(((19 * 7) - 1 + 6),
+                  jit_test_collapse_expect_interp(0x3E10, 0, 0x13, 0));
+  test_expect_u32(((256 * 7) - 1 + 6),
+                  jit_test_collapse_expect_interp(0x3E10, 0, 0x00, 0));
+  /* A timer firing part way through the loop. */
+  (void) jit_test_collapse_expect_interp(0x3E00, 0x00, 0, 600);
+  (void) jit_test_collapse_expect_interp(0x3E10, 0, 0x00, 601);
+
+  /* An indefinite loop, collapsed down to countdown modulo loop cycles. A
+   * countdown that fits in 32 bits takes the reciprocal path; sweep the timer
+   * over all the loop phases.
+   */
+  util_buffer_setup(p_buf, (s_p_mem + 0x3F00), 0x10);
+  emit_LDA(p_buf, k_abs, 0x0070);
+  emit_BNE(p_buf, -5);
+  emit_EXIT(p_buf);
+
+  for (i = 0; i < 7; ++i) {
+    int64_t timer_value = (10000 + i);
+    uint64_t ticks = jit_test_collapse_expect_interp(0x3F00,
+                                                     0,
+                                                     0,
+                                                     timer_value);
+    /* A countdown past 32 bits takes the div path. Running that many cycles
+     * in the interpreter is too slow, but moving the timer by a multiple of
+     * the 7 cycle loop must move the exit by exactly as much. Without the
+     * collapse, the JIT would be too slow too.
+     */
+    if (!asm_jit_supports_uopcode(k_opcode_collapse_loop)) {
+      continue;
+    }
+    timer_value += (7ll << 30);
+    test_expect_u32(1, ((ticks + (7ull << 30)) ==
+                        jit_test_collapse_run(0x3F00,
+                                              0,
+                                              0,
+                                              timer_value,
+                                              1,
+                                              regs)));
+    if (i == 0) {
+      /* And far enough out that the reciprocal would give the wrong
+       * remainder.
+       */
+      timer_value += (7ll << 59);
+      test_expect_u32(1, ((ticks + (7ull << 30) + (7ull << 59)) ==
+                          jit_test_collapse_run(0x3F00,
+                                                0,
+                                                0,
+                                                timer_value,
+                                                1,
+                                                regs)));
+    }
+  }
+
+  for (i = 0; i < num_timers; ++i) {
+    if (p_timer_values[i] != INT64_MIN) {
+      (void) timing_start_timer_with_value(s_p_timing, i, p_timer_values[i]);
+    }
+  }
+  util_free(p_timer_values);
+  timing_free_timer(s_p_timing, s_jit_test_timer_id);
+
+  util_buffer_destroy(p_buf);
+}
+
 void
 jit_test(struct bbc_struct* p_bbc) {
   jit_test_init(p_bbc);
@@ -1550,6 +1803,9 @@ jit_test(struct bbc_struct* p_bbc) {
   jit_compiler_testing_set_dynamic_opcode(s_p_compiler, 1);
   jit_compiler_testing_set_dynamic_operand(s_p_compiler, 1);
   jit_test_dynamic_opcode_2();
+  jit_compiler_testing_set_accurate_cycles(s_p_compiler, 0);
+  jit_test_dynamic_operand_branch();
+  jit_compiler_testing_set_accurate_cycles(s_p_compiler, 1);
   jit_test_dynamic_opcode_3();
   jit_compiler_testing_set_dynamic_opcode(s_p_compiler, 0);
   jit_compiler_testing_set_dynamic_operand(s_p_compiler, 0);
@@ -1562,9 +1818,67 @@ jit_test(struct bbc_struct* p_bbc) {
   jit_compiler_testing_set_optimizing(s_p_compiler, 1);
   jit_test_compile_binary();
   jit_test_compile_metadata();
+  jit_test_collapse_loops();
   jit_compiler_testing_set_max_ops(s_p_compiler, 4);
   jit_compiler_testing_set_optimizing(s_p_compiler, 0);
 
   /* Test this with a JIT space that's been used by all the above tests. */
   jit_cleanup_stale_code(s_p_jit);
 }
+
+enum {
+  k_jit_test_bench_modulos = 100000000,
+};
+
+static uint64_t
+jit_test_modulo_run(int use_reciprocal, uint64_t* p_sum) {
+  /* Models the collapsed loop sequence: countdown modulo loop cycles, for a
+   * countdown that fits in 32 bits, as asm_jit_collapse_loop does it.
+   */
+  static const uint32_t k_loop_cycles[8] = { 3, 5, 7, 8, 10, 11, 13, 1000 };
+  uint64_t reciprocals[8];
+  uint32_t i;
+  uint64_t time_us;
+  uint32_t seed = 1;
+  uint64_t sum = 0;
+
+  for (i = 0; i < 8; ++i) {
+    reciprocals[i] = ((UINT64_MAX / k_loop_cycles[i]) + 1);
+  }
+
+  time_us = os_time_get_us();
+  for (i = 0; i < k_jit_test_bench_modulos; ++i) {
+    uint64_t countdown;
+    uint32_t index = (i & 7);
+    uint64_t loop_cycles = k_loop_cycles[index];
+    seed = ((seed * 1103515245) + 12345);
+    countdown = seed;
+    if (use_reciprocal) {
+      uint64_t fraction = (countdown * reciprocals[index]);
+      sum += (uint64_t) (((unsigned __int128) fraction * loop_cycles) >> 64);
+    } else {
+      sum += (countdown % loop_cycles);
+    }
+  }
+  *p_sum = sum;
+
+  return (os_time_get_us() - time_us);
+}
+
+void
+jit_benchmark(void) {
+  uint64_t div_sum;
+  uint64_t reciprocal_sum;
+  uint64_t div_us = jit_test_modulo_run(0, &div_sum);
+  uint64_t reciprocal_us = jit_test_modulo_run(1, &reciprocal_sum);
+
+  test_expect_u32(1, (div_sum == reciprocal_sum));
+
+  log_do_log(k_log_perf,
+             k_log_info,
+             "collapsed loop modulo benchmark, %d ops: "
+             "div %"PRIu64"us, reciprocal %"PRIu64"us",
+             k_jit_test_bench_modulos,
+             div_us,
+             reciprocal_us);
+}
@@ -0,0 +1,582 @@
+/* Appends at the end of sound.c. */
+
+#include "test.h"
+
+enum {
+  k_sound_test_driver_buffer_size = 1024,
+  k_sound_test_chunk_size = 5000,
+  k_sound_test_amplitude = 8000,
+  k_sound_test_bench_seconds = 20,
+};
+
+static struct sound_struct*
+sound_test_create(uint32_t sample_rate) {
+  struct bbc_options options;
+  struct sound_struct* p_sound;
+
+  (void) memset(&options, '\0', sizeof(options));
+  options.p_opt_flags = "";
+  options.p_log_flags = "";
+  p_sound = sound_create(0, NULL, &options);
+  sound_setup_resampler(p_sound,
+                        sample_rate,
+                        k_sound_test_driver_buffer_size);
+
+  return p_sound;
+}
+
+/* The previous resampler, a box average over each driver frame's span of
+ * sn76489 frames, for comparison.
+ */
+static uint32_t
+sound_test_box_resample(int16_t* p_out,
+                        const int16_t* p_in,
+                        uint32_t num_in,
+                        double resample_count,
+                        double* p_accumulated_value,
+                        double* p_accumulated_count) {
+  uint32_t i;
+  uint32_t num_out = 0;
+  double accumulated_value = *p_accumulated_value;
+  double accumulated_count = *p_accumulated_count;
+
+  for (i = 0; i < num_in; ++i) {
+    double leftover;
+    double this_sample_value = p_in[i];
+    accumulated_count++;
+    if (accumulated_count < resample_count) {
+      accumulated_value += this_sample_value;
+      continue;
+    }
+    leftover = (accumulated_count - resample_count);
+    accumulated_value += ((1.0 - leftover) * this_sample_value);
+    p_out[num_out++] = round(accumulated_value / resample_count);
+    accumulated_value = (leftover * this_sample_value);
+    accumulated_count = leftover;
+  }
+
+  *p_accumulated_value = accumulated_value;
+  *p_accumulated_count = accumulated_count;
+
+  return num_out;
+}
+
+/* The previous sn76489 synthesis, ticking every channel at every sample, for
+ * comparison.
+ */
+static void
+sound_test_fill_per_tick(struct sound_struct* p_sound,
+                         uint32_t num_frames,
+                         struct sound_sn_regs* p_regs) {
+  uint32_t i;
+  uint8_t channel;
+
+  int16_t* p_volumes = &p_regs->volume[0];
+  uint16_t* p_periods = &p_regs->period[0];
+  uint16_t noise_rng = p_regs->noise_rng;
+  int noise_type = p_regs->noise_type;
+  int16_t* p_sn_frames = p_sound->p_sn_frames;
+  uint16_t* p_counters = &p_sound->counter[0];
+  uint8_t* p_outputs = &p_sound->output[0];
+  uint32_t sn_frames_filled = p_sound->sn_frames_filled;
+  int16_t volume_silence = p_sound->volume_silence;
+
+  for (i = 0; i < num_frames; ++i) {
+    int16_t sample = 0;
+    for (channel = 0; channel < 4; ++channel) {
+      int16_t sample_component = volume_silence;
+      uint16_t counter = p_counters[channel];
+      uint8_t output = p_outputs[channel];
+      int is_noise = (channel == 3);
+
+      counter = ((counter - 1) & 0x3ff);
+      if (counter == 0) {
+        counter = p_periods[channel];
+        output = !output;
+        p_outputs[channel] = output;
+
+        if (is_noise && output) {
+          if (noise_type == 0) {
+            noise_rng >>= 1;
+            if (noise_rng == 0) {
+              noise_rng = (1 << 14);
+            }
+          } else {
+            int bit = ((noise_rng & 1) ^ ((noise_rng & 2) >> 1));
+            noise_rng = ((noise_rng >> 1) | (bit << 14));
+          }
+          p_regs->noise_rng = noise_rng;
+        }
+      }
+
+      if (is_noise) {
+        output = (noise_rng & 1);
+      }
+
+      p_counters[channel] = counter;
+
+      if (output) {
+        sample_component = p_volumes[channel];
+      }
+      sample += sample_component;
+    }
+    p_sn_frames[sn_frames_filled + i] = sample;
+  }
+
+  p_sound->sn_frames_filled += num_frames;
+}
+
+/* Synthesizes chunks of the given lengths both ways, from the same state, and
+ * expects the same samples and the same state after every chunk.
+ */
+static void
+sound_test_fill_matches_per_tick(struct sound_sn_regs* p_regs,
+                                 const uint16_t* p_counters,
+                                 const uint8_t* p_outputs,
+                                 const uint32_t* p_chunk_sizes,
+                                 uint32_t num_chunks) {
+  uint32_t i;
+  uint32_t chunk;
+  struct sound_sn_regs ref_regs = *p_regs;
+  struct sound_sn_regs run_regs = *p_regs;
+  struct sound_struct* p_ref = sound_test_create(44100);
+  struct sound_struct* p_run = sound_test_create(44100);
+
+  for (i = 0; i < k_sound_num_channels; ++i) {
+    p_ref->counter[i] = p_counters[i];
+    p_ref->output[i] = p_outputs[i];
+    p_run->counter[i] = p_counters[i];
+    p_run->output[i] = p_outputs[i];
+  }
+
+  for (chunk = 0; chunk < num_chunks; ++chunk) {
+    uint32_t num_frames = p_chunk_sizes[chunk];
+    p_ref->sn_frames_filled = 0;
+    p_run->sn_frames_filled = 0;
+    sound_test_fill_per_tick(p_ref, num_frames, &ref_regs);
+    sound_fill_sn76489_buffer(p_run, num_frames, &run_regs);
+    test_expect_binary((uint8_t*) p_ref->p_sn_frames,
+                       (uint8_t*) p_run->p_sn_frames,
+                       (num_frames * sizeof(int16_t)));
+    test_expect_binary((uint8_t*) &p_ref->counter[0],
+                       (uint8_t*) &p_run->counter[0],
+                       sizeof(p_ref->counter));
+    test_expect_binary(&p_ref->output[0],
+                       &p_run->output[0],
+                       sizeof(p_ref->output));
+    test_expect_u32(ref_regs.noise_rng, run_regs.noise_rng);
+  }
+
+  sound_destroy(p_ref);
+  sound_destroy(p_run);
+}
+
+static void
+sound_test_fill_runs(void) {
+  /* Odd chunk sizes so that expiries land on chunk boundaries and runs
+   * straddle them.
+   */
+  static const uint32_t k_chunks[6] = { 1, 7, 1023, 1024, 1025, 4000 };
+  uint16_t counters[k_sound_num_channels] = { 0, 1, 2, 1023 };
+  uint8_t outputs[k_sound_num_channels] = { 0, 1, 0, 1 };
+  uint32_t seed = 1;
+  uint32_t i;
+  uint32_t j;
+  struct sound_sn_regs regs;
+  struct sound_struct* p_sound = sound_test_create(44100);
+  int16_t* p_volumes = &p_sound->volumes[0];
+
+  (void) memset(&regs, '\0', sizeof(regs));
+  regs.noise_rng = (1 << 14);
+
+  /* Tones, with the noise channel silent. */
+  regs.period[0] = 1;
+  regs.period[1] = 2;
+  regs.period[2] = 173;
+  regs.period[3] = 1023;
+  regs.volume[0] = p_volumes[15];
+  regs.volume[1] = p_volumes[7];
+  regs.volume[2] = p_volumes[1];
+  regs.volume[3] = p_volumes[0];
+  sound_test_fill_matches_per_tick(&regs, &counters[0], &outputs[0],
+                                   &k_chunks[0], 6);
+
+  /* Noise, periodic and white, at the fastest rate and a slow one. */
+  regs.volume[3] = p_volumes[12];
+  for (i = 0; i < 4; ++i) {
+    regs.noise_type = (i & 1);
+    regs.period[3] = ((i & 2) ? 300 : 1);
+    sound_test_fill_matches_per_tick(&regs, &counters[0], &outputs[0],
+                                     &k_chunks[0], 6);
+  }
+
+  /* Period 0 counts 1024 ticks, on every channel. */
+  for (i = 0; i < k_sound_num_channels; ++i) {
+    regs.period[i] = 0;
+  }
+  sound_test_fill_matches_per_tick(&regs, &counters[0], &outputs[0],
+                                   &k_chunks[0], 6);
+
+  /* And some random state. */
+  for (i = 0; i < 200; ++i) {
+    for (j = 0; j < k_sound_num_channels; ++j) {
+      seed = ((seed * 1103515245) + 12345);
+      regs.period[j] = ((seed >> 8) & 0x3ff);
+      regs.volume[j] = p_volumes[(seed >> 20) & 0xf];
+      counters[j] = ((seed >> 4) & 0x3ff);
+      outputs[j] = ((seed >> 24) & 1);
+    }
+    regs.noise_type = ((seed >> 25) & 1);
+    regs.noise_rng = ((seed >> 9) & 0x7fff);
+    if (regs.noise_rng == 0) {
+      regs.noise_rng = 1;
+    }
+    sound_test_fill_matches_per_tick(&regs, &counters[0], &outputs[0],
+                                     &k_chunks[0], 6);
+  }
+
+  sound_destroy(p_sound);
+}
+
+/* Resamples a sine tone, returning the output level relative to the input
+ * level, in dB. With is_box, the previous resampler is used.
+ */
+static double
+sound_test_tone_gain(uint32_t sample_rate, double freq, int is_box) {
+  uint32_t chunk;
+  uint32_t i;
+  double phase_inc = (2.0 * M_PI * freq / k_sound_clock_rate);
+  double sum_squares = 0.0;
+  uint32_t num_measured = 0;
+  double box_value = 0.0;
+  double box_count = 0.0;
+  uint32_t sn_pos = 0;
+  struct sound_struct* p_sound = sound_test_create(sample_rate);
+
+  /* Skip the first chunk, while the filter fills. */
+  for (chunk = 0; chunk < 8; ++chunk) {
+    uint32_t num_out;
+    int16_t* p_sn_frames = p_sound->p_sn_frames;
+    for (i = 0; i < k_sound_test_chunk_size; ++i) {
+      p_sn_frames[i] = (k_sound_test_amplitude * sin(phase_inc * sn_pos));
+      sn_pos++;
+    }
+    if (is_box) {
+      num_out = sound_test_box_resample(p_sound->p_driver_frames,
+                                        p_sn_frames,
+                                        k_sound_test_chunk_size,
+                                        p_sound->sn_frames_per_driver_frame,
+                                        &box_value,
+                                        &box_count);
+    } else {
+      p_sound->sn_frames_filled = k_sound_test_chunk_size;
+      p_sound->driver_buffer_index = 0;
+      num_out = sound_resample_to_driver_buffer(p_sound);
+    }
+    if (chunk == 0) {
+      continue;
+    }
+    for (i = 0; i < num_out; ++i) {
+      double value = p_sound->p_driver_frames[i];
+      sum_squares += (value * value);
+      num_measured++;
+    }
+  }
+
+  sound_destroy(p_sound);
+
+  /* A sine's RMS is its amplitude over root 2. */
+  return (20.0 * log10((sqrt(sum_squares / num_measured) * sqrt(2.0) /
+                        k_sound_test_amplitude) +
+                       1e-9));
+}
+
+static void
+sound_test_resample_dc(void) {
+  uint32_t i;
+  uint32_t num_out;
+  struct sound_struct* p_sound = sound_test_create(44100);
+
+  /* Levels hold exactly, including the maximum. */
+  for (i = 0; i < k_sound_test_chunk_size; ++i) {
+    p_sound->p_sn_frames[i] = 32764;
+  }
+  p_sound->sn_frames_filled = k_sound_test_chunk_size;
+  num_out = sound_resample_to_driver_buffer(p_sound);
+  test_expect_u32(882, num_out);
+  for (i = 0; i < k_sound_test_chunk_size; ++i) {
+    p_sound->p_sn_frames[i] = 32764;
+  }
+  p_sound->sn_frames_filled = k_sound_test_chunk_size;
+  p_sound->driver_buffer_index = 0;
+  num_out = sound_resample_to_driver_buffer(p_sound);
+  test_expect_u32(882, num_out);
+  for (i = 0; i < num_out; ++i) {
+    test_expect_u32(32764, p_sound->p_driver_frames[i]);
+  }
+
+  sound_destroy(p_sound);
+}
+
+static void
+sound_test_resample_exact_count(void) {
+  /* The threaded player asks for exactly a period's driver frames each time,
+   * and must get them with no padding or loss, however the fractional
+   * position falls.
+   */
+  uint32_t i;
+  uint32_t total_sn_frames = 0;
+  struct sound_struct* p_sound = sound_test_create(44100);
+
+  for (i = 0; i < 1000; ++i) {
+    uint32_t num_frames = (1 + (i % 700));
+    uint32_t num_sn_frames = sound_get_sn_frames_for_driver_frames(
+        p_sound, num_frames);
+    p_sound->sn_frames_filled = num_sn_frames;
+    p_sound->driver_buffer_index = 0;
+    test_expect_u32(num_frames, sound_resample_to_driver_buffer(p_sound));
+    total_sn_frames += num_sn_frames;
+  }
+  /* 290500 driver frames, the last at exactly (290499 * 250000 / 44100). */
+  test_expect_u32(1646820, total_sn_frames);
+
+  sound_destroy(p_sound);
+}
+
+static void
+sound_test_resample_aliasing(void) {
+  /* Sweep a tone over the frequencies that alias down into the audible range
+   * of the driver rate, i.e. from 20kHz below the driver rate up to the
+   * sn76489 Nyquist frequency.
+   */
+  static const uint32_t k_rates[2] = { 44100, 48000 };
+  uint32_t i;
+
+  for (i = 0; i < 2; ++i) {
+    double freq;
+    double gain;
+    uint32_t sample_rate = k_rates[i];
+    double worst = -1000.0;
+    double box_worst = -1000.0;
+
+    /* Passband. */
+    gain = sound_test_tone_gain(sample_rate, 1000.0, 0);
+    test_expect_u32(1, (fabs(gain) < 0.1));
+    gain = sound_test_tone_gain(sample_rate, 10000.0, 0);
+    test_expect_u32(1, (fabs(gain) < 0.5));
+
+    for (freq = (sample_rate - 20000.0); freq < 125000.0; freq += 1700.0) {
+      gain = sound_test_tone_gain(sample_rate, freq, 0);
+      if (gain > worst) {
+        worst = gain;
+      }
+      gain = sound_test_tone_gain(sample_rate, freq, 1);
+      if (gain > box_worst) {
+        box_worst = gain;
+      }
+    }
+
+    log_do_log(k_log_perf,
+               k_log_info,
+               "resample %"PRIu32"Hz worst alias: %.1fdB, box average %.1fdB",
+               sample_rate,
+               worst,
+               box_worst);
+    test_expect_u32(1, (worst < -30.0));
+    test_expect_u32(1, (box_worst > -10.0));
+  }
+}
+
+static void
+sound_test_resample_benchmark(void) {
+  uint32_t i;
+  uint64_t time_us;
+  uint64_t filter_us;
+  uint64_t box_us;
+  double box_value = 0.0;
+  double box_count = 0.0;
+  uint32_t num_filter_frames = 0;
+  uint32_t num_box_frames = 0;
+  uint32_t num_chunks = ((k_sound_test_bench_seconds * k_sound_clock_rate) /
+                         k_sound_test_chunk_size);
+  struct sound_struct* p_sound = sound_test_create(44100);
+  int16_t* p_frames = util_malloc(k_sound_test_chunk_size * sizeof(int16_t));
+
+  /* Some square wave tones. */
+  for (i = 0; i < k_sound_test_chunk_size; ++i) {
+    p_frames[i] = (((i / 71) & 1) * 4000) + (((i / 113) & 1) * 3000);
+  }
+
+  time_us = os_time_get_us();
+  for (i = 0; i < num_chunks; ++i) {
+    (void) memcpy(p_sound->p_sn_frames,
+                  p_frames,
+                  (k_sound_test_chunk_size * sizeof(int16_t)));
+    p_sound->sn_frames_filled = k_sound_test_chunk_size;
+    p_sound->driver_buffer_index = 0;
+    num_filter_frames += sound_resample_to_driver_buffer(p_sound);
+  }
+  filter_us = (os_time_get_us() - time_us);
+
+  time_us = os_time_get_us();
+  for (i = 0; i < num_chunks; ++i) {
+    num_box_frames += sound_test_box_resample(
+        p_sound->p_driver_frames,
+        p_frames,
+        k_sound_test_chunk_size,
+        p_sound->sn_frames_per_driver_frame,
+        &box_value,
+        &box_count);
+  }
+  box_us = (os_time_get_us() - time_us);
+
+  /* Both produce the same number of frames, give or take the last. */
+  test_expect_u32(1, ((num_filter_frames + 1) >= num_box_frames));
+  test_expect_u32(1, ((num_box_frames + 1) >= num_filter_frames));
+
+  log_do_log(k_log_perf,
+             k_log_info,
+             "resample benchmark, %d seconds to 44100Hz: "
+             "filter %"PRIu64"us, box average %"PRIu64"us",
+             k_sound_test_bench_seconds,
+             filter_us,
+             box_us);
+
+  util_free(p_frames);
+  sound_destroy(p_sound);
+}
+
+static void
+sound_test_deferred_matches_direct(void) {
+  /* Writes at sn76489 ticks, with a power-on reset in among them. */
+  static const uint32_t k_ticks[8] = { 0, 0, 173, 1000,
+                                       1000, 2047, 3001, 3500 };
+  static const uint16_t k_values[8] = { 0x8E, 0x0F, 0x90, 0xE4,
+                                        k_sound_write_reset, 0xA5, 0xF0, 0x91 };
+  uint32_t i;
+  uint32_t num_frames = 4000;
+  uint32_t pos = 0;
+  int16_t* p_first_chunk = util_malloc(num_frames * sizeof(int16_t));
+  struct sound_struct* p_direct = sound_test_create(44100);
+  struct sound_struct* p_deferred = sound_test_create(44100);
+
+  sound_power_on_reset(p_direct);
+  sound_power_on_reset(p_deferred);
+
+  /* Synthesize as the writes happen, as the emulation thread would. */
+  p_direct->sn_frames_filled = 0;
+  for (i = 0; i < 8; ++i) {
+    sound_fill_sn76489_buffer(p_direct,
+                              (k_ticks[i] - pos),
+                              &p_direct->regs);
+    pos = k_ticks[i];
+    if (k_values[i] == k_sound_write_reset) {
+      sound_power_on_reset(p_direct);
+    } else {
+      sound_sn_write(p_direct, k_values[i]);
+    }
+  }
+  sound_fill_sn76489_buffer(p_direct, (num_frames - pos), &p_direct->regs);
+
+  /* Synthesize afterwards from the log, in two chunks. */
+  p_deferred->p_write_log = util_malloc(
+      (k_sound_write_log_size * sizeof(struct sound_write_record)));
+  p_deferred->play_regs = p_deferred->regs;
+  for (i = 0; i < 8; ++i) {
+    p_deferred->p_write_log[i].sn_ticks = k_ticks[i];
+    p_deferred->p_write_log[i].value = k_values[i];
+  }
+  p_deferred->write_log_head = 8;
+  sound_deferred_fill(p_deferred, 0, 2047);
+  test_expect_u32(5, p_deferred->write_log_tail);
+  (void) memcpy(p_first_chunk,
+                p_deferred->p_sn_frames,
+                (2047 * sizeof(int16_t)));
+  sound_deferred_fill(p_deferred, 2047, (num_frames - 2047));
+  test_expect_u32(8, p_deferred->write_log_tail);
+
+  for (i = 0; i < 2047; ++i) {
+    test_expect_u32(p_direct->p_sn_frames[i], p_first_chunk[i]);
+  }
+  for (i = 2047; i < num_frames; ++i) {
+    test_expect_u32(p_direct->p_sn_frames[i],
+                    p_deferred->p_sn_frames[i - 2047]);
+  }
+
+  util_free(p_first_chunk);
+  sound_destroy(p_direct);
+  sound_destroy(p_deferred);
+}
+
+static void
+sound_test_write_log_full_drops(void) {
+  /* Writes that fill the log while the emulation is far ahead of the sound
+   * thread get dropped, and the register state is logged in full later.
+   */
+  uint32_t i;
+  uint32_t seed = 1;
+  struct sound_struct* p_sound = sound_test_create(44100);
+  struct timing_struct* p_timing = timing_create(1);
+  uint64_t sn_ticks;
+
+  sound_power_on_reset(p_sound);
+  p_sound->p_timing = p_timing;
+  p_sound->p_write_log = util_malloc(
+      (k_sound_write_log_size * sizeof(struct sound_write_record)));
+  p_sound->play_regs = p_sound->regs;
+  (void) timing_advance_time_delta(
+      p_timing,
+      ((p_sound->sn_frames_per_driver_buffer_size * 2) + 1) *
+          k_sound_clock_divider);
+
+  /* As sound_sn_write() would, but without a sound thread to drain the log. */
+  for (i = 0; i < (k_sound_write_log_size + 100); ++i) {
+    uint8_t value;
+    seed = ((seed * 1103515245) + 12345);
+    value = (seed >> 16);
+    sound_log_write(p_sound, value);
+    sound_sn_regs_write(p_sound, &p_sound->regs, value);
+  }
+  test_expect_u32(1, p_sound->write_log_dropped);
+  test_expect_u32(k_sound_write_log_size, p_sound->write_log_head);
+
+  sn_ticks = p_sound->cpu_sn_ticks;
+  sound_deferred_fill(p_sound, sn_ticks, 1);
+  test_expect_u32(k_sound_write_log_size, p_sound->write_log_tail);
+
+  sound_log_write(p_sound, 0x0F);
+  sound_sn_regs_write(p_sound, &p_sound->regs, 0x0F);
+  test_expect_u32(0, p_sound->write_log_dropped);
+  test_expect_u32((k_sound_write_log_size + k_sound_regs_log_writes + 1),
+                  p_sound->write_log_head);
+  sound_deferred_fill(p_sound, sn_ticks, 1);
+  test_expect_u32(p_sound->write_log_head, p_sound->write_log_tail);
+
+  for (i = 0; i < k_sound_num_channels; ++i) {
+    test_expect_u32(p_sound->regs.volume[i], p_sound->play_regs.volume[i]);
+    test_expect_u32(p_sound->regs.period[i], p_sound->play_regs.period[i]);
+  }
+  test_expect_u32(p_sound->regs.noise_frequency,
+                  p_sound->play_regs.noise_frequency);
+  test_expect_u32(p_sound->regs.noise_type, p_sound->play_regs.noise_type);
+  test_expect_u32(p_sound->regs.latched_bits,
+                  p_sound->play_regs.latched_bits);
+
+  sound_destroy(p_sound);
+  timing_destroy(p_timing);
+}
+
+void
+sound_test(void) {
+  sound_test_fill_runs();
+  sound_test_deferred_matches_direct();
+  sound_test_write_log_full_drops();
+  sound_test_resample_dc();
+  sound_test_resample_exact_count();
+  sound_test_resample_aliasing();
+}
+
+void
+sound_benchmark(void) {
+  sound_test_resample_benchmark();
+}
@@ -2,6 +2,8 @@
 
 #include "test.h"
 
+#include "os_time.h"
+
 static uint32_t s_timing_test_timer_hits_basic = 0;
 static uint32_t s_timing_test_timer_hits_multi = 0;
 static uint32_t s_timing_test_order_counter = 0;
@@ -15,9 +17,9 @@ timing_test_stop_timers(void* p) {
 
   struct timing_struct* p_timing = (struct timing_struct*) p;
 
-  for (i = 0; i < k_timing_num_timers; ++i) {
-    struct timer_struct* p_timer = &p_timing->timers[i];
-    if (p_timer->firing && (p_timer->value == 0)) {
+  for (i = 0; i < p_timing->max_timers; ++i) {
+    struct timer_struct* p_timer = &p_timing->p_timers[i];
+    if (p_timer->firing && (timing_get_timer_value(p_timing, i) == 0)) {
       test_expect_u32(0, timing_get_timer_value(p_timing, i));
       (void) timing_stop_timer(p_timing, i);
     }
@@ -90,14 +92,14 @@ timing_test_counting() {
    * advance that didn't update all timer baselines.
    */
   test_expect_u32(98, p_timing->countdown);
-  test_expect_u32(100, p_timing->timers[0].value);
+  test_expect_u32(100, p_timing->p_timers[0].value);
   test_expect_u32(98, timing_get_timer_value(p_timing, t1));
 
   countdown = timing_start_timer_with_value(p_timing, t2, 50);
   test_expect_u32(50, countdown);
   test_expect_u32(50, p_timing->countdown);
-  test_expect_u32(100, p_timing->timers[0].value);
-  test_expect_u32(52, p_timing->timers[1].value);
+  test_expect_u32(100, p_timing->p_timers[0].value);
+  test_expect_u32(52, p_timing->p_timers[1].value);
   test_expect_u32(98, timing_get_timer_value(p_timing, t1));
   test_expect_u32(50, timing_get_timer_value(p_timing, t2));
 
@@ -112,14 +114,14 @@ timing_test_counting() {
   countdown = timing_set_timer_value(p_timing, t2, 40);
   test_expect_u32(40, countdown);
   test_expect_u32(40, p_timing->countdown);
-  test_expect_u32(100, p_timing->timers[0].value);
-  test_expect_u32(42, p_timing->timers[1].value);
+  test_expect_u32(100, p_timing->p_timers[0].value);
+  test_expect_u32(42, p_timing->p_timers[1].value);
 
   countdown = timing_adjust_timer_value(p_timing, NULL, t2, -10);
   test_expect_u32(30, countdown);
   test_expect_u32(30, p_timing->countdown);
-  test_expect_u32(100, p_timing->timers[0].value);
-  test_expect_u32(32, p_timing->timers[1].value);
+  test_expect_u32(100, p_timing->p_timers[0].value);
+  test_expect_u32(32, p_timing->p_timers[1].value);
 
   countdown = timing_set_firing(p_timing, t2, 0);
   test_expect_u32(98, countdown);
@@ -318,14 +320,14 @@ timing_test_scaling() {
 
   /* Peek at the internals to make sure we really have a scaled timer. */
   test_expect_u32(299, p_timing->countdown);
-  test_expect_u32(300, p_timing->timers[0].value);
+  test_expect_u32(300, p_timing->p_timers[0].value);
   test_expect_u32(99, timing_get_timer_value(p_timing, t1));
 
   countdown = timing_start_timer_with_value(p_timing, t2, 50);
   test_expect_u32(150, countdown);
   test_expect_u32(150, p_timing->countdown);
-  test_expect_u32(300, p_timing->timers[0].value);
-  test_expect_u32(151, p_timing->timers[1].value);
+  test_expect_u32(300, p_timing->p_timers[0].value);
+  test_expect_u32(151, p_timing->p_timers[1].value);
   test_expect_u32(99, timing_get_timer_value(p_timing, t1));
   test_expect_u32(50, timing_get_timer_value(p_timing, t2));
 
@@ -341,14 +343,14 @@ timing_test_scaling() {
   test_expect_u32(40, timing_get_timer_value(p_timing, t2));
   test_expect_u32(120, countdown);
   test_expect_u32(120, p_timing->countdown);
-  test_expect_u32(300, p_timing->timers[0].value);
-  test_expect_u32(121, p_timing->timers[1].value);
+  test_expect_u32(300, p_timing->p_timers[0].value);
+  test_expect_u32(121, p_timing->p_timers[1].value);
 
   countdown = timing_adjust_timer_value(p_timing, NULL, t2, -10);
   test_expect_u32(90, countdown);
   test_expect_u32(90, p_timing->countdown);
-  test_expect_u32(300, p_timing->timers[0].value);
-  test_expect_u32(91, p_timing->timers[1].value);
+  test_expect_u32(300, p_timing->p_timers[0].value);
+  test_expect_u32(91, p_timing->p_timers[1].value);
 
   countdown = timing_set_firing(p_timing, t2, 0);
   test_expect_u32(299, countdown);
@@ -372,6 +374,40 @@ timing_test_scaling() {
   timing_destroy(p_timing);
 }
 
+static void
+timing_test_scaling_shift() {
+  /* Power of two scale factors use a shift, which must still round towards
+   * zero like a division.
+   */
+  struct timing_struct* p_timing = timing_create(4);
+
+  uint32_t t1 = timing_register_timer(p_timing,
+                                      "test_t1",
+                                      timing_test_timer_fired_basic,
+                                      p_timing);
+  (void) timing_set_firing(p_timing, t1, 0);
+  (void) timing_start_timer_with_value(p_timing, t1, 2);
+  test_expect_u32(8, p_timing->p_timers[0].value);
+  test_expect_u32(2, timing_get_timer_value(p_timing, t1));
+
+  (void) timing_advance_time_delta(p_timing, 7);
+  test_expect_u32(0, timing_get_timer_value(p_timing, t1));
+  test_expect_u32(1, timing_get_scaled_total_timer_ticks(p_timing));
+
+  (void) timing_advance_time_delta(p_timing, 4);
+  test_expect_u32(0, timing_get_timer_value(p_timing, t1));
+  (void) timing_advance_time_delta(p_timing, 1);
+  test_expect_u32(-1, timing_get_timer_value(p_timing, t1));
+  test_expect_u32(3, timing_get_scaled_total_timer_ticks(p_timing));
+
+  (void) timing_adjust_timer_value(p_timing, NULL, t1, -1);
+  test_expect_u32(-2, timing_get_timer_value(p_timing, t1));
+  (void) timing_advance_time_delta(p_timing, 3);
+  test_expect_u32(-2, timing_get_timer_value(p_timing, t1));
+
+  timing_destroy(p_timing);
+}
+
 static void
 timing_test_simultaneous() {
   /* Test ordering of simultaneous expiries. FIFO order is expected. */
@@ -426,12 +462,356 @@ timing_test_reset() {
   test_expect_u32(80, timing_get_timer_value(p_timing, t1));
 }
 
+enum {
+  k_timing_test_many_timers = 100,
+  k_timing_test_bench_timers = 20,
+  k_timing_test_mix_ops = 20000,
+  k_timing_test_bench_ops = 5000000,
+  k_timing_test_bench_scales = 100000000,
+};
+
+struct timing_test_timer {
+  struct timing_struct* p_timing;
+  uint32_t id;
+  int64_t period;
+  /* For the sorted list reference model. */
+  int64_t expiry;
+  struct timing_test_timer* p_prev;
+  struct timing_test_timer* p_next;
+};
+
+static struct timing_test_timer s_timing_test_timers[k_timing_test_many_timers];
+static uint32_t* s_p_timing_test_fired;
+static uint32_t s_timing_test_num_fired;
+static uint32_t s_timing_test_max_fired;
+
+static void
+timing_test_record_fired(uint32_t id) {
+  if (s_timing_test_num_fired < s_timing_test_max_fired) {
+    s_p_timing_test_fired[s_timing_test_num_fired] = id;
+  }
+  s_timing_test_num_fired++;
+}
+
+static void
+timing_test_timer_fired_periodic(void* p) {
+  struct timing_test_timer* p_timer = (struct timing_test_timer*) p;
+  timing_test_record_fired(p_timer->id);
+  if (p_timer->period == 0) {
+    (void) timing_stop_timer(p_timer->p_timing, p_timer->id);
+  } else {
+    (void) timing_set_timer_value(p_timer->p_timing,
+                                  p_timer->id,
+                                  p_timer->period);
+  }
+}
+
+static void
+timing_test_many_timers() {
+  /* More timers than the initial allocation. */
+  uint32_t i;
+  uint32_t fired[k_timing_test_many_timers];
+  struct timing_struct* p_timing = timing_create(1);
+
+  s_p_timing_test_fired = &fired[0];
+  s_timing_test_num_fired = 0;
+  s_timing_test_max_fired = k_timing_test_many_timers;
+
+  for (i = 0; i < k_timing_test_many_timers; ++i) {
+    struct timing_test_timer* p_timer = &s_timing_test_timers[i];
+    p_timer->p_timing = p_timing;
+    p_timer->period = 0;
+    p_timer->id = timing_register_timer(p_timing,
+                                        "test_many",
+                                        timing_test_timer_fired_periodic,
+                                        p_timer);
+    test_expect_u32(i, p_timer->id);
+    /* Values 1 - 100, in a scrambled order. */
+    (void) timing_start_timer_with_value(p_timing, i, (((i * 37) % 100) + 1));
+  }
+
+  (void) timing_advance_time_delta(p_timing, 99);
+  test_expect_u32(99, s_timing_test_num_fired);
+  (void) timing_advance_time_delta(p_timing, 1);
+  test_expect_u32(100, s_timing_test_num_fired);
+  for (i = 0; i < k_timing_test_many_timers; ++i) {
+    test_expect_u32(i, ((fired[i] * 37) % 100));
+    test_expect_u32(0, timing_timer_is_running(p_timing, fired[i]));
+  }
+
+  timing_destroy(p_timing);
+}
+
+static void
+timing_test_accounting() {
+  uint32_t i;
+  struct timer_struct* p_timer;
+  uint32_t fired[32];
+  struct timing_struct* p_timing = timing_create(1);
+
+  s_p_timing_test_fired = &fired[0];
+  s_timing_test_num_fired = 0;
+  s_timing_test_max_fired = 32;
+
+  for (i = 0; i < 3; ++i) {
+    struct timing_test_timer* p_test_timer = &s_timing_test_timers[i];
+    p_test_timer->p_timing = p_timing;
+    p_test_timer->id = timing_register_timer(p_timing,
+                                             "test_accounting",
+                                             timing_test_timer_fired_periodic,
+                                             p_test_timer);
+  }
+  s_timing_test_timers[0].period = 10;
+  s_timing_test_timers[1].period = 25;
+  s_timing_test_timers[2].period = 0;
+  (void) timing_start_timer_with_value(p_timing, 0, 10);
+  (void) timing_start_timer_with_value(p_timing, 1, 25);
+
+  /* Nothing counted until enabled. */
+  (void) timing_advance_time_delta(p_timing, 10);
+  test_expect_u32(1, s_timing_test_num_fired);
+  test_expect_u32(0, p_timing->p_timers[0].fire_count);
+
+  timing_set_accounting(p_timing, 1);
+  (void) timing_advance_time_delta(p_timing, 90);
+  test_expect_u32(14, s_timing_test_num_fired);
+  p_timer = &p_timing->p_timers[0];
+  test_expect_u32(9, p_timer->fire_count);
+  test_expect_u32(20, p_timer->first_fire_ticks);
+  test_expect_u32(100, p_timer->last_fire_ticks);
+  p_timer = &p_timing->p_timers[1];
+  test_expect_u32(4, p_timer->fire_count);
+  test_expect_u32(25, p_timer->first_fire_ticks);
+  test_expect_u32(100, p_timer->last_fire_ticks);
+  test_expect_u32(0, p_timing->p_timers[2].fire_count);
+
+  timing_clear_accounting(p_timing);
+  test_expect_u32(0, p_timing->p_timers[0].fire_count);
+  test_expect_u32(0, p_timing->p_timers[1].callback_ns);
+  (void) timing_advance_time_delta(p_timing, 10);
+  test_expect_u32(1, p_timing->p_timers[0].fire_count);
+  test_expect_u32(110, p_timing->p_timers[0].first_fire_ticks);
+
+  timing_destroy(p_timing);
+}
+
+static uint32_t
+timing_test_rand(uint32_t* p_seed) {
+  *p_seed = ((*p_seed * 1103515245) + 12345);
+  return (*p_seed >> 8);
+}
+
+static void
+timing_test_list_insert(struct timing_test_timer** pp_head,
+                        struct timing_test_timer* p_timer) {
+  /* The previous timing.c expiry list: insert after any equal expiry. */
+  struct timing_test_timer* p_iter = *pp_head;
+  struct timing_test_timer* p_prev = NULL;
+
+  while ((p_iter != NULL) && (p_timer->expiry >= p_iter->expiry)) {
+    p_prev = p_iter;
+    p_iter = p_iter->p_next;
+  }
+  p_timer->p_prev = p_prev;
+  p_timer->p_next = p_iter;
+  if (p_iter != NULL) {
+    p_iter->p_prev = p_timer;
+  }
+  if (p_prev == NULL) {
+    *pp_head = p_timer;
+  } else {
+    p_prev->p_next = p_timer;
+  }
+}
+
+static void
+timing_test_list_remove(struct timing_test_timer** pp_head,
+                        struct timing_test_timer* p_timer) {
+  if (p_timer->p_prev != NULL) {
+    p_timer->p_prev->p_next = p_timer->p_next;
+  } else {
+    *pp_head = p_timer->p_next;
+  }
+  if (p_timer->p_next != NULL) {
+    p_timer->p_next->p_prev = p_timer->p_prev;
+  }
+  p_timer->p_prev = NULL;
+  p_timer->p_next = NULL;
+}
+
+static uint64_t
+timing_test_mix(uint32_t num_ops) {
+  /* A realistic mix: a BBC with discs, tape, serial and replay has around 20
+   * timers, with some very frequent (video, disc bytes) and the CPU frequently
+   * reprogramming others (VIA timers). Three reschedules per expiry, in 2MHz
+   * ticks.
+   * The same operations are run against a model of the previous sorted list,
+   * and the expiry order must match exactly. Returns the time taken by the
+   * timing API.
+   */
+  static const int64_t k_periods[k_timing_test_bench_timers] = {
+    128, 20000, 20000, 65536, 50000, 16, 64, 128, 1666, 3333,
+    40000, 20000, 256, 1024, 4096, 8192, 100000, 2000000, 512, 32,
+  };
+  uint32_t i;
+  uint32_t seed;
+  uint64_t time_us;
+  uint64_t api_us;
+  uint32_t api_num_fired;
+  uint32_t* p_api_fired;
+  int64_t now;
+  struct timing_test_timer* p_head;
+  struct timing_struct* p_timing = timing_create(1);
+
+  s_timing_test_max_fired = num_ops;
+  p_api_fired = util_malloc(s_timing_test_max_fired * sizeof(uint32_t));
+  s_p_timing_test_fired = p_api_fired;
+  s_timing_test_num_fired = 0;
+
+  for (i = 0; i < k_timing_test_bench_timers; ++i) {
+    struct timing_test_timer* p_timer = &s_timing_test_timers[i];
+    p_timer->p_timing = p_timing;
+    p_timer->period = k_periods[i];
+    p_timer->id = timing_register_timer(p_timing,
+                                        "test_bench",
+                                        timing_test_timer_fired_periodic,
+                                        p_timer);
+    (void) timing_start_timer_with_value(p_timing, i, k_periods[i]);
+  }
+
+  seed = 1;
+  time_us = os_time_get_us();
+  for (i = 0; i < num_ops; ++i) {
+    uint32_t r = timing_test_rand(&seed);
+    if ((r % 4) == 0) {
+      (void) timing_advance_time(p_timing, 0);
+    } else {
+      uint32_t id = ((r / 4) % k_timing_test_bench_timers);
+      int64_t value = ((timing_test_rand(&seed) % 65536) + 1);
+      (void) timing_set_timer_value(p_timing, id, value);
+    }
+  }
+  api_us = (os_time_get_us() - time_us);
+  api_num_fired = s_timing_test_num_fired;
+  timing_destroy(p_timing);
+
+  s_p_timing_test_fired = util_malloc(s_timing_test_max_fired *
+                                      sizeof(uint32_t));
+  s_timing_test_num_fired = 0;
+  p_head = NULL;
+  now = 0;
+  for (i = 0; i < k_timing_test_bench_timers; ++i) {
+    struct timing_test_timer* p_timer = &s_timing_test_timers[i];
+    p_timer->expiry = k_periods[i];
+    p_timer->p_prev = NULL;
+    p_timer->p_next = NULL;
+    timing_test_list_insert(&p_head, p_timer);
+  }
+
+  seed = 1;
+  for (i = 0; i < num_ops; ++i) {
+    struct timing_test_timer* p_timer;
+    uint32_t r = timing_test_rand(&seed);
+    if ((r % 4) == 0) {
+      now = p_head->expiry;
+      while ((p_head != NULL) && (p_head->expiry == now)) {
+        p_timer = p_head;
+        timing_test_list_remove(&p_head, p_timer);
+        timing_test_record_fired(p_timer->id);
+        p_timer->expiry = (now + p_timer->period);
+        timing_test_list_insert(&p_head, p_timer);
+      }
+    } else {
+      p_timer = &s_timing_test_timers[(r / 4) % k_timing_test_bench_timers];
+      timing_test_list_remove(&p_head, p_timer);
+      p_timer->expiry = (now + (timing_test_rand(&seed) % 65536) + 1);
+      timing_test_list_insert(&p_head, p_timer);
+    }
+  }
+
+  test_expect_u32(api_num_fired, s_timing_test_num_fired);
+  if (api_num_fired > s_timing_test_max_fired) {
+    api_num_fired = s_timing_test_max_fired;
+  }
+  test_expect_binary((uint8_t*) p_api_fired,
+                     (uint8_t*) s_p_timing_test_fired,
+                     (api_num_fired * sizeof(uint32_t)));
+
+  util_free(p_api_fired);
+  util_free(s_p_timing_test_fired);
+
+  return api_us;
+}
+
 void
 timing_test() {
   timing_test_counting();
   timing_test_basics();
   timing_test_multi_expiry();
   timing_test_scaling();
+  timing_test_scaling_shift();
   timing_test_simultaneous();
   timing_test_reset();
+  timing_test_many_timers();
+  timing_test_accounting();
+  (void) timing_test_mix(k_timing_test_mix_ops);
+}
+
+static uint64_t
+timing_test_scale_down_run(struct timing_struct* p_timing, int64_t* p_sum) {
+  uint32_t i;
+  uint64_t time_us;
+  uint32_t seed = 1;
+  int64_t sum = 0;
+
+  time_us = os_time_get_us();
+  for (i = 0; i < k_timing_test_bench_scales; ++i) {
+    /* Timer values either side of zero, as when timers expire. */
+    int64_t value = ((int64_t) timing_test_rand(&seed) - 0x400000);
+    sum += timing_scale_down(p_timing, value);
+  }
+  *p_sum = sum;
+
+  return (os_time_get_us() - time_us);
+}
+
+static void
+timing_test_scale_down_benchmark(void) {
+  /* The same scale factor down the shift path and then, forced, down the
+   * division path that a non power of two factor takes. The results must
+   * match.
+   */
+  int64_t shift_sum;
+  int64_t div_sum;
+  uint64_t shift_us;
+  uint64_t div_us;
+  struct timing_struct* p_timing = timing_create(4);
+
+  test_expect_u32(1, p_timing->scale_is_shift);
+  shift_us = timing_test_scale_down_run(p_timing, &shift_sum);
+  p_timing->scale_is_shift = 0;
+  div_us = timing_test_scale_down_run(p_timing, &div_sum);
+  test_expect_u32(1, (shift_sum == div_sum));
+
+  log_do_log(k_log_perf,
+             k_log_info,
+             "timer scale down benchmark, %d ops: "
+             "shift %"PRIu64"us, division %"PRIu64"us",
+             k_timing_test_bench_scales,
+             shift_us,
+             div_us);
+
+  timing_destroy(p_timing);
+}
+
+void
+timing_benchmark() {
+  uint64_t api_us = timing_test_mix(k_timing_test_bench_ops);
+  log_do_log(k_log_perf,
+             k_log_info,
+             "timer benchmark, %d timers, %d ops: %"PRIu64"us",
+             k_timing_test_bench_timers,
+             k_timing_test_bench_ops,
+             api_us);
+  timing_test_scale_down_benchmark();
 }
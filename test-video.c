@@ -23,6 +23,7 @@ struct video_struct* g_p_video = NULL;
 uint32_t g_video_test_framebuffer_ready_calls = 0;
 int g_test_fast_flag = 0;
 uint32_t g_timing_scale_factor = 1;
+const char* g_p_video_test_opt_flags = "";
 
 static void
 video_test_framebuffer_ready_callback(void* p,
@@ -39,7 +40,7 @@ video_test_framebuffer_ready_callback(void* p,
 
 static void
 video_test_init() {
-  g_p_options.p_opt_flags = "";
+  g_p_options.p_opt_flags = g_p_video_test_opt_flags;
   g_p_options.p_log_flags = "";
   g_p_options.accurate = 1;
   g_p_bbc_mem = util_mallocz(0x10000);
@@ -1339,6 +1340,168 @@ video_test_scale_factor() {
   (void) timing_advance_time_delta(g_p_timing, 1);
 }
 
+static uint32_t
+video_test_render_some_frames(int is_mode4) {
+  uint32_t i;
+
+  for (i = 0; i < 0x8000; ++i) {
+    g_p_bbc_mem[i] = ((i * 7) ^ (i >> 5));
+  }
+  if (is_mode4) {
+    video_test_setup_mode_4_non_interlaced();
+    video_crtc_write(g_p_video, 0, 12);
+    video_crtc_write(g_p_video, 1, 0x0B);
+    video_crtc_write(g_p_video, 0, 10);
+    video_crtc_write(g_p_video, 1, 0x00);
+    video_crtc_write(g_p_video, 0, 11);
+    video_crtc_write(g_p_video, 1, 0x07);
+    video_crtc_write(g_p_video, 0, 14);
+    video_crtc_write(g_p_video, 1, 0x0B);
+    video_crtc_write(g_p_video, 0, 15);
+    video_crtc_write(g_p_video, 1, 0x20);
+    video_ula_write(g_p_video, 0, 0x88);
+    for (i = 0; i < 16; ++i) {
+      /* Includes flashing physical colors. */
+      video_ula_write(g_p_video, 1, ((i << 4) | ((i + 3) & 0x0F)));
+    }
+  } else {
+    /* Teletext addressing, so the SAA5050 gets real data. */
+    video_crtc_write(g_p_video, 0, 12);
+    video_crtc_write(g_p_video, 1, 0x28);
+  }
+
+  for (i = 0; i < 200; ++i) {
+    (void) timing_advance_time_delta(g_p_timing, 1000);
+    video_advance_crtc_timing(g_p_video);
+    if (i == 100) {
+      video_ula_write(g_p_video, 0, (is_mode4 ? 0x89 : 0x13));
+    }
+  }
+
+  return render_get_buffer_crc32(g_p_render);
+}
+
+static void
+video_test_render_thread() {
+  /* The render thread must produce exactly the same pixels as rendering
+   * directly on the emulation thread.
+   */
+  uint32_t i;
+  uint32_t crc_thread;
+  uint32_t crc_no_thread;
+  uint32_t crc_indexed;
+
+  for (i = 0; i < 2; ++i) {
+    video_test_init();
+    crc_thread = video_test_render_some_frames(i);
+    video_test_end();
+
+    g_p_video_test_opt_flags = "video:no-render-thread";
+    video_test_init();
+    crc_no_thread = video_test_render_some_frames(i);
+    video_test_end();
+
+    /* Likewise rendering palette indexes and expanding them afterwards. */
+    g_p_video_test_opt_flags = "video:indexed";
+    video_test_init();
+    crc_indexed = video_test_render_some_frames(i);
+    video_test_end();
+    g_p_video_test_opt_flags = "";
+
+    test_expect_u32(crc_no_thread, crc_thread);
+    test_expect_u32(crc_no_thread, crc_indexed);
+  }
+}
+
+static void
+video_test_bulk_render() {
+  /* Rendering runs of characters in bulk must produce exactly the same pixels
+   * as rendering tick by tick, with or without the render thread.
+   */
+  uint32_t i;
+  uint32_t j;
+  uint32_t crc_bulk;
+  uint32_t crc_no_bulk;
+  static const char* p_opt_flags[2][2] = {
+    { "", "video:no-bulk-render" },
+    { "video:no-render-thread",
+      "video:no-render-thread,video:no-bulk-render" },
+  };
+
+  for (i = 0; i < 2; ++i) {
+    for (j = 0; j < 2; ++j) {
+      g_p_video_test_opt_flags = p_opt_flags[j][0];
+      video_test_init();
+      crc_bulk = video_test_render_some_frames(i);
+      video_test_end();
+
+      g_p_video_test_opt_flags = p_opt_flags[j][1];
+      video_test_init();
+      crc_no_bulk = video_test_render_some_frames(i);
+      video_test_end();
+      g_p_video_test_opt_flags = "";
+
+      test_expect_u32(crc_no_bulk, crc_bulk);
+    }
+  }
+}
+
+static void
+video_test_advance_frames(uint32_t frames) {
+  uint32_t i;
+  /* A standard frame is 40000 ticks. */
+  for (i = 0; i < (frames * 40); ++i) {
+    (void) timing_advance_time_delta(g_p_timing, 1000);
+    video_advance_crtc_timing(g_p_video);
+  }
+}
+
+static void
+video_test_dirty_lines() {
+  /* Only lines with changed pixels should need presenting. */
+  uint32_t i;
+  uint32_t start_line;
+  uint32_t num_lines;
+
+  for (i = 0; i < 0x8000; ++i) {
+    g_p_bbc_mem[i] = ((i * 7) ^ (i >> 5));
+  }
+  video_test_setup_mode_4_non_interlaced();
+  video_crtc_write(g_p_video, 0, 12);
+  video_crtc_write(g_p_video, 1, 0x0B);
+  video_ula_write(g_p_video, 0, 0x88);
+  for (i = 0; i < 16; ++i) {
+    video_ula_write(g_p_video, 1, ((i << 4) | (i & 0x07)));
+  }
+
+  video_test_advance_frames(5);
+  test_expect_u32(1, render_get_dirty_lines(g_p_render,
+                                            &start_line,
+                                            &num_lines));
+  video_test_advance_frames(5);
+  test_expect_u32(0, render_get_dirty_lines(g_p_render,
+                                            &start_line,
+                                            &num_lines));
+
+  /* One scanline of one character. */
+  g_p_bbc_mem[0x5800 + (10 * 8) + 3] ^= 0xFF;
+  video_test_advance_frames(5);
+  test_expect_u32(1, render_get_dirty_lines(g_p_render,
+                                            &start_line,
+                                            &num_lines));
+  test_expect_u32(2, num_lines);
+  video_test_advance_frames(5);
+  test_expect_u32(0, render_get_dirty_lines(g_p_render,
+                                            &start_line,
+                                            &num_lines));
+
+  render_clear_buffer(g_p_render);
+  test_expect_u32(1, render_get_dirty_lines(g_p_render,
+                                            &start_line,
+                                            &num_lines));
+  test_expect_u32(render_get_height(g_p_render), num_lines);
+}
+
 void
 video_test() {
   video_test_init();
@@ -1434,4 +1597,17 @@ video_test() {
   video_test_scale_factor();
   video_test_end();
   g_timing_scale_factor = 1;
+
+  video_test_render_thread();
+  video_test_bulk_render();
+
+  video_test_init();
+  video_test_dirty_lines();
+  video_test_end();
+
+  g_p_video_test_opt_flags = "video:no-render-thread";
+  video_test_init();
+  video_test_dirty_lines();
+  video_test_end();
+  g_p_video_test_opt_flags = "";
 }
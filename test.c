@@ -8,8 +8,12 @@
 #include <string.h>
 
 extern void timing_test(void);
+extern void timing_benchmark(void);
 extern void video_test(void);
+extern void sound_test(void);
+extern void sound_benchmark(void);
 extern void jit_test(struct bbc_struct* p_bbc);
+extern void jit_benchmark(void);
 extern void expression_test(void);
 extern void bbc_test(struct bbc_struct* p_bbc);
 
@@ -20,12 +24,21 @@ test_do_tests(struct bbc_struct* p_bbc) {
 
   timing_test();
   video_test();
+  sound_test();
   jit_test(p_bbc);
   expression_test();
   bbc_test(p_bbc);
   (void) printf("Tests OK!\n");
 }
 
+void
+test_do_benchmarks(void) {
+  /* Timed runs, too slow for every -test. Results go to the perf log. */
+  timing_benchmark();
+  sound_benchmark();
+  jit_benchmark();
+}
+
 void
 test_expect_u32(uint32_t expectation, uint32_t actual) {
   if (actual != expectation) {
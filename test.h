@@ -7,6 +7,7 @@
 struct bbc_struct;
 
 void test_do_tests(struct bbc_struct* p_bbc);
+void test_do_benchmarks(void);
 
 void test_expect_u32(uint32_t expectation, uint32_t actual);
 void test_expect_eq(uint32_t v1, uint32_t v2);
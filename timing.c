@@ -1,13 +1,16 @@
 #include "timing.h"
 
 #include "log.h"
+#include "os_time.h"
 #include "util.h"
 
 #include <assert.h>
 #include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
 
 enum {
-  k_timing_num_timers = 24,
+  k_timing_initial_timers = 32,
 };
 
 struct timer_struct {
@@ -15,12 +18,18 @@ struct timer_struct {
   void (*p_callback)(void*);
   void* p_object;
   int64_t value;
+  /* Timers expiring at the same time fire in the order they were scheduled. */
+  uint64_t sequence;
   int ticking;
   int firing;
-  struct timer_struct* p_expiry_prev;
-  struct timer_struct* p_expiry_next;
-  struct timer_struct* p_ticking_prev;
-  struct timer_struct* p_ticking_next;
+  /* Position in the expiry heap, or -1. */
+  int32_t heap_index;
+
+  /* Cost accounting, if enabled. */
+  uint64_t fire_count;
+  uint64_t first_fire_ticks;
+  uint64_t last_fire_ticks;
+  uint64_t callback_ns;
 };
 
 struct timing_struct {
@@ -28,14 +37,30 @@ struct timing_struct {
   uint64_t countdown;
   uint64_t odd_even_tracker;
   uint64_t odd_even_mixin;
-  struct timer_struct* p_expiry_head;
-  struct timer_struct* p_ticking_head;
   uint64_t next_timer_expiry;
   uint32_t scale_factor;
+  /* If the scale factor is a power of two (including the common case of 1),
+   * scaling down is a shift instead of a division.
+   */
+  int scale_is_shift;
+  uint32_t scale_shift;
 
+  /* Timers are referred to by id, which is an index into this array. */
+  struct timer_struct* p_timers;
+  uint32_t max_timers;
   uint32_t num_timers;
-  struct timer_struct timers[k_timing_num_timers];
+  /* Binary min-heap of the ids of ticking, firing timers, ordered by expiry.
+   * Rescheduling a timer is O(log n).
+   */
+  uint32_t* p_expiry_heap;
+  uint32_t expiry_heap_size;
+  uint64_t expiry_sequence;
+  /* Ticking timers store their expiry offset by this base, so advancing time
+   * past an expiry doesn't need to visit every ticking timer.
+   */
+  int64_t ticking_base;
   int log_expiries;
+  int is_accounting;
 };
 
 static inline void
@@ -54,10 +79,15 @@ struct timing_struct*
 timing_create(uint32_t scale_factor) {
   struct timing_struct* p_timing = util_mallocz(sizeof(struct timing_struct));
 
+  assert(scale_factor > 0);
   p_timing->scale_factor = scale_factor;
+  if ((scale_factor & (scale_factor - 1)) == 0) {
+    p_timing->scale_is_shift = 1;
+    while ((1u << p_timing->scale_shift) != scale_factor) {
+      p_timing->scale_shift++;
+    }
+  }
   p_timing->total_timer_ticks = 0;
-  p_timing->p_expiry_head = NULL;
-  p_timing->p_ticking_head = NULL;
 
   p_timing->next_timer_expiry = INT64_MAX;
   timing_set_countdown(p_timing, INT64_MAX);
@@ -67,6 +97,8 @@ timing_create(uint32_t scale_factor) {
 
 void
 timing_destroy(struct timing_struct* p_timing) {
+  util_free(p_timing->p_timers);
+  util_free(p_timing->p_expiry_heap);
   util_free(p_timing);
 }
 
@@ -75,29 +107,137 @@ timing_set_log_expiries(struct timing_struct* p_timing, int log_expiries) {
   p_timing->log_expiries = log_expiries;
 }
 
+void
+timing_set_accounting(struct timing_struct* p_timing, int is_accounting) {
+  p_timing->is_accounting = is_accounting;
+}
+
+int
+timing_is_accounting(struct timing_struct* p_timing) {
+  return p_timing->is_accounting;
+}
+
+void
+timing_clear_accounting(struct timing_struct* p_timing) {
+  uint32_t i;
+
+  for (i = 0; i < p_timing->max_timers; ++i) {
+    struct timer_struct* p_timer = &p_timing->p_timers[i];
+    p_timer->fire_count = 0;
+    p_timer->first_fire_ticks = 0;
+    p_timer->last_fire_ticks = 0;
+    p_timer->callback_ns = 0;
+  }
+}
+
+static struct timing_struct* s_p_timing_sort;
+
+static int
+timing_sort_by_cost(const void* p_id1, const void* p_id2) {
+  struct timer_struct* p_timer1 =
+      &s_p_timing_sort->p_timers[*(const uint32_t*) p_id1];
+  struct timer_struct* p_timer2 =
+      &s_p_timing_sort->p_timers[*(const uint32_t*) p_id2];
+
+  if (p_timer1->callback_ns > p_timer2->callback_ns) {
+    return -1;
+  } else if (p_timer1->callback_ns < p_timer2->callback_ns) {
+    return 1;
+  }
+  return 0;
+}
+
+void
+timing_dump_accounting(struct timing_struct* p_timing) {
+  uint32_t i;
+  uint32_t num_ids = 0;
+  uint64_t total_ns = 0;
+  uint32_t* p_ids = util_malloc(p_timing->max_timers * sizeof(uint32_t));
+
+  for (i = 0; i < p_timing->max_timers; ++i) {
+    struct timer_struct* p_timer = &p_timing->p_timers[i];
+    if (p_timer->p_callback == NULL) {
+      continue;
+    }
+    p_ids[num_ids++] = i;
+    total_ns += p_timer->callback_ns;
+  }
+  /* Most expensive first. */
+  s_p_timing_sort = p_timing;
+  qsort(p_ids, num_ids, sizeof(uint32_t), timing_sort_by_cost);
+
+  log_do_log(k_log_perf,
+             k_log_info,
+             "timer costs at %"PRIu64" ticks, callbacks %.3fms total",
+             p_timing->total_timer_ticks,
+             (total_ns / 1000000.0));
+  for (i = 0; i < num_ids; ++i) {
+    struct timer_struct* p_timer = &p_timing->p_timers[p_ids[i]];
+    uint64_t fire_count = p_timer->fire_count;
+    double mean_interval = 0.0;
+    double ns_per_fire = 0.0;
+    if (fire_count > 1) {
+      mean_interval = ((p_timer->last_fire_ticks - p_timer->first_fire_ticks) /
+                       (double) (fire_count - 1));
+    }
+    if (fire_count > 0) {
+      ns_per_fire = (p_timer->callback_ns / (double) fire_count);
+    }
+    log_do_log(k_log_perf,
+               k_log_info,
+               "timer %-20s fires %10"PRIu64" interval %12.1f ticks, "
+               "host %9.3fms (%.0fns/fire)",
+               p_timer->p_name,
+               fire_count,
+               mean_interval,
+               (p_timer->callback_ns / 1000000.0),
+               ns_per_fire);
+  }
+
+  util_free(p_ids);
+}
+
 void
 timing_reset_total_timer_ticks(struct timing_struct* p_timing) {
   p_timing->total_timer_ticks = 0;
 }
 
+static inline int64_t
+timing_scale_down(struct timing_struct* p_timing, int64_t value) {
+  if (p_timing->scale_is_shift) {
+    /* Round towards zero, same as the division, by biasing negative values
+     * up before the shift. Branch free because timer values straddle zero
+     * unpredictably.
+     */
+    int64_t bias = ((value >> 63) & (int64_t) (p_timing->scale_factor - 1));
+    return ((value + bias) >> p_timing->scale_shift);
+  }
+  return (value / (int64_t) p_timing->scale_factor);
+}
+
 static inline uint64_t
 timing_get_countdown_adjustment(struct timing_struct* p_timing) {
   assert(p_timing->next_timer_expiry >= p_timing->countdown);
   return (p_timing->next_timer_expiry - p_timing->countdown);
 }
 
+static inline int64_t
+timing_get_ticking_adjustment(struct timing_struct* p_timing) {
+  return (p_timing->ticking_base + timing_get_countdown_adjustment(p_timing));
+}
+
 static uint64_t
 timing_update_counts(struct timing_struct* p_timing) {
   uint64_t countdown;
   uint64_t next_timer_expiry;
 
-  struct timer_struct* p_expiry_head = p_timing->p_expiry_head;
   uint64_t adjustment = timing_get_countdown_adjustment(p_timing);
 
-  if (p_expiry_head == NULL) {
+  if (p_timing->expiry_heap_size == 0) {
     next_timer_expiry = INT64_MAX;
   } else {
-    next_timer_expiry = p_expiry_head->value;
+    next_timer_expiry = (p_timing->p_timers[p_timing->p_expiry_heap[0]].value -
+                         p_timing->ticking_base);
   }
 
   countdown = (next_timer_expiry - adjustment);
@@ -120,7 +260,11 @@ timing_get_total_timer_ticks(struct timing_struct* p_timing) {
 
 uint64_t
 timing_get_scaled_total_timer_ticks(struct timing_struct* p_timing) {
-  return (p_timing->total_timer_ticks / p_timing->scale_factor);
+  uint64_t ticks = p_timing->total_timer_ticks;
+  if (p_timing->scale_is_shift) {
+    return (ticks >> p_timing->scale_shift);
+  }
+  return (ticks / p_timing->scale_factor);
 }
 
 int
@@ -141,16 +285,28 @@ timing_register_timer(struct timing_struct* p_timing,
 
   assert(p_callback != NULL);
 
-  for (i = 0; i < k_timing_num_timers; ++i) {
-    if (p_timing->timers[i].p_callback == NULL) {
+  for (i = 0; i < p_timing->max_timers; ++i) {
+    if (p_timing->p_timers[i].p_callback == NULL) {
       break;
     }
   }
-  if (i == k_timing_num_timers) {
-    util_bail("out of timer ids");
+  if (i == p_timing->max_timers) {
+    uint32_t max_timers = (p_timing->max_timers * 2);
+    if (max_timers == 0) {
+      max_timers = k_timing_initial_timers;
+    }
+    p_timing->p_timers = util_realloc(p_timing->p_timers,
+                                      (max_timers *
+                                       sizeof(struct timer_struct)));
+    (void) memset(&p_timing->p_timers[i],
+                  '\0',
+                  ((max_timers - i) * sizeof(struct timer_struct)));
+    p_timing->p_expiry_heap = util_realloc(p_timing->p_expiry_heap,
+                                           (max_timers * sizeof(uint32_t)));
+    p_timing->max_timers = max_timers;
   }
 
-  p_timer = &p_timing->timers[i];
+  p_timer = &p_timing->p_timers[i];
 
   p_timer->p_name = p_name;
   p_timer->p_callback = p_callback;
@@ -158,97 +314,141 @@ timing_register_timer(struct timing_struct* p_timing,
   p_timer->value = INT64_MAX;
   p_timer->ticking = 0;
   p_timer->firing = 1;
-  p_timer->p_expiry_prev = NULL;
-  p_timer->p_expiry_next = NULL;
+  p_timer->heap_index = -1;
 
   p_timing->num_timers++;
 
   return i;
 }
 
-static void
-timing_insert_expiring_timer(struct timing_struct* p_timing,
-                             struct timer_struct* p_timer) {
-  struct timer_struct* p_iter = p_timing->p_expiry_head;
-  struct timer_struct* p_prev = NULL;
+void
+timing_free_timer(struct timing_struct* p_timing, uint32_t id) {
+  struct timer_struct* p_timer;
 
-  assert(p_timer->p_expiry_prev == NULL);
-  assert(p_timer->p_expiry_next == NULL);
-  assert(p_timer->ticking);
-  assert(p_timer->firing);
+  assert(id < p_timing->max_timers);
+  p_timer = &p_timing->p_timers[id];
+  assert(p_timer->p_callback != NULL);
+  assert(!p_timer->ticking);
+
+  (void) memset(p_timer, '\0', sizeof(struct timer_struct));
+  p_timing->num_timers--;
+}
 
-  while ((p_iter != NULL) && (p_timer->value >= p_iter->value)) {
-    assert((p_prev == NULL) || (p_iter->value >= p_prev->value));
-    if (p_iter->p_expiry_next) {
-      assert(p_iter->p_expiry_next->p_expiry_prev == p_iter);
+static inline int
+timing_expires_before(struct timer_struct* p_timer1,
+                      struct timer_struct* p_timer2) {
+  if (p_timer1->value != p_timer2->value) {
+    return (p_timer1->value < p_timer2->value);
+  }
+  return (p_timer1->sequence < p_timer2->sequence);
+}
+
+static inline void
+timing_heap_place(struct timing_struct* p_timing,
+                  uint32_t heap_index,
+                  uint32_t id) {
+  p_timing->p_expiry_heap[heap_index] = id;
+  p_timing->p_timers[id].heap_index = heap_index;
+}
+
+static void
+timing_heap_sift_up(struct timing_struct* p_timing, uint32_t heap_index) {
+  uint32_t* p_heap = p_timing->p_expiry_heap;
+  uint32_t id = p_heap[heap_index];
+  struct timer_struct* p_timer = &p_timing->p_timers[id];
+
+  while (heap_index > 0) {
+    uint32_t parent_index = ((heap_index - 1) / 2);
+    uint32_t parent_id = p_heap[parent_index];
+    if (!timing_expires_before(p_timer, &p_timing->p_timers[parent_id])) {
+      break;
     }
-    p_prev = p_iter;
-    p_iter = p_iter->p_expiry_next;
+    timing_heap_place(p_timing, heap_index, parent_id);
+    heap_index = parent_index;
   }
+  timing_heap_place(p_timing, heap_index, id);
+}
 
-  p_timer->p_expiry_prev = p_prev;
-  if (p_prev == NULL) {
-    p_timer->p_expiry_next = p_timing->p_expiry_head;
-    if (p_timing->p_expiry_head) {
-      p_timing->p_expiry_head->p_expiry_prev = p_timer;
+static void
+timing_heap_sift_down(struct timing_struct* p_timing, uint32_t heap_index) {
+  uint32_t* p_heap = p_timing->p_expiry_heap;
+  uint32_t heap_size = p_timing->expiry_heap_size;
+  uint32_t id = p_heap[heap_index];
+  struct timer_struct* p_timer = &p_timing->p_timers[id];
+
+  while (1) {
+    uint32_t child_index = ((heap_index * 2) + 1);
+    uint32_t child_id;
+    if (child_index >= heap_size) {
+      break;
     }
-    p_timing->p_expiry_head = p_timer;
-  } else {
-    p_timer->p_expiry_next = p_prev->p_expiry_next;
-    if (p_prev->p_expiry_next) {
-      p_prev->p_expiry_next->p_expiry_prev = p_timer;
+    child_id = p_heap[child_index];
+    if ((child_index + 1) < heap_size) {
+      uint32_t right_id = p_heap[child_index + 1];
+      if (timing_expires_before(&p_timing->p_timers[right_id],
+                                &p_timing->p_timers[child_id])) {
+        child_index++;
+        child_id = right_id;
+      }
+    }
+    if (!timing_expires_before(&p_timing->p_timers[child_id], p_timer)) {
+      break;
     }
-    p_prev->p_expiry_next = p_timer;
+    timing_heap_place(p_timing, heap_index, child_id);
+    heap_index = child_index;
   }
+  timing_heap_place(p_timing, heap_index, id);
 }
 
 static void
-timing_remove_expiring_timer(struct timing_struct* p_timing,
-                             struct timer_struct* p_timer) {
-  if (p_timer->p_expiry_prev) {
-    p_timer->p_expiry_prev->p_expiry_next = p_timer->p_expiry_next;
-  } else {
-    assert(p_timer == p_timing->p_expiry_head);
-    p_timing->p_expiry_head = p_timer->p_expiry_next;
-  }
-  if (p_timer->p_expiry_next) {
-    p_timer->p_expiry_next->p_expiry_prev = p_timer->p_expiry_prev;
-  }
+timing_heap_insert(struct timing_struct* p_timing,
+                   struct timer_struct* p_timer) {
+  uint32_t heap_index = p_timing->expiry_heap_size;
+
+  assert(p_timer->heap_index == -1);
+  assert(p_timer->ticking);
+  assert(p_timer->firing);
 
-  p_timer->p_expiry_prev = NULL;
-  p_timer->p_expiry_next = NULL;
+  p_timing->expiry_heap_size++;
+  timing_heap_place(p_timing, heap_index, (p_timer - p_timing->p_timers));
+  timing_heap_sift_up(p_timing, heap_index);
 }
 
 static void
-timing_insert_ticking_timer(struct timing_struct* p_timing,
-                            struct timer_struct* p_timer) {
-  struct timer_struct* p_old_head = p_timing->p_ticking_head;
+timing_insert_expiring_timer(struct timing_struct* p_timing,
+                             struct timer_struct* p_timer) {
+  p_timer->sequence = p_timing->expiry_sequence++;
+  timing_heap_insert(p_timing, p_timer);
+}
 
-  assert(p_timer->p_ticking_prev == NULL);
-  assert(p_timer->p_ticking_next == NULL);
+static void
+timing_remove_expiring_timer(struct timing_struct* p_timing,
+                             struct timer_struct* p_timer) {
+  uint32_t moved_id;
+  uint32_t heap_index = p_timer->heap_index;
+  uint32_t last_index = (p_timing->expiry_heap_size - 1);
 
-  p_timing->p_ticking_head = p_timer;
-  p_timer->p_ticking_next = p_old_head;
-  if (p_old_head) {
-    p_old_head->p_ticking_prev = p_timer;
+  assert(p_timer->heap_index != -1);
+
+  p_timing->expiry_heap_size--;
+  p_timer->heap_index = -1;
+  if (heap_index == last_index) {
+    return;
   }
+  /* Fill the hole with the last timer, which may need to move either way. */
+  moved_id = p_timing->p_expiry_heap[last_index];
+  timing_heap_place(p_timing, heap_index, moved_id);
+  timing_heap_sift_up(p_timing, heap_index);
+  timing_heap_sift_down(p_timing, p_timing->p_timers[moved_id].heap_index);
 }
 
 static void
-timing_remove_ticking_timer(struct timing_struct* p_timing,
-                            struct timer_struct* p_timer) {
-  if (p_timer->p_ticking_prev) {
-    p_timer->p_ticking_prev->p_ticking_next = p_timer->p_ticking_next;
-  } else {
-    assert(p_timer == p_timing->p_ticking_head);
-    p_timing->p_ticking_head = p_timer->p_ticking_next;
-  }
-  if (p_timer->p_ticking_next) {
-    p_timer->p_ticking_next->p_ticking_prev = p_timer->p_ticking_prev;
-  }
-
-  p_timer->p_ticking_prev = NULL;
-  p_timer->p_ticking_next = NULL;
+timing_reschedule_expiring_timer(struct timing_struct* p_timing,
+                                 struct timer_struct* p_timer) {
+  /* Same ordering as removing and re-inserting the timer. */
+  p_timer->sequence = p_timing->expiry_sequence++;
+  timing_heap_sift_up(p_timing, p_timer->heap_index);
+  timing_heap_sift_down(p_timing, p_timer->heap_index);
 }
 
 static int64_t
@@ -258,12 +458,11 @@ timing_start_timer_with_internal_value(struct timing_struct* p_timing,
   assert(p_timer->p_callback != NULL);
   assert(!p_timer->ticking);
 
-  value += timing_get_countdown_adjustment(p_timing);
+  value += timing_get_ticking_adjustment(p_timing);
 
   p_timer->value = value;
   p_timer->ticking = 1;
 
-  timing_insert_ticking_timer(p_timing, p_timer);
   if (p_timer->firing) {
     timing_insert_expiring_timer(p_timing, p_timer);
   }
@@ -275,8 +474,8 @@ int64_t
 timing_start_timer(struct timing_struct* p_timing, uint32_t id) {
   struct timer_struct* p_timer;
 
-  assert(id < k_timing_num_timers);
-  p_timer = &p_timing->timers[id];
+  assert(id < p_timing->max_timers);
+  p_timer = &p_timing->p_timers[id];
   return timing_start_timer_with_internal_value(p_timing,
                                                 p_timer,
                                                 p_timer->value);
@@ -288,9 +487,9 @@ timing_start_timer_with_value(struct timing_struct* p_timing,
                               int64_t time) {
   struct timer_struct* p_timer;
 
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  p_timer = &p_timing->timers[id];
+  p_timer = &p_timing->p_timers[id];
 
   time *= p_timing->scale_factor;
 
@@ -301,15 +500,14 @@ int64_t
 timing_stop_timer(struct timing_struct* p_timing, uint32_t id) {
   struct timer_struct* p_timer;
 
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  p_timer = &p_timing->timers[id];
+  p_timer = &p_timing->p_timers[id];
   assert(p_timer->p_callback != NULL);
   assert(p_timer->ticking);
 
   p_timer->ticking = 0;
 
-  timing_remove_ticking_timer(p_timing, p_timer);
   if (p_timer->firing) {
     timing_remove_expiring_timer(p_timing, p_timer);
   }
@@ -317,16 +515,16 @@ timing_stop_timer(struct timing_struct* p_timing, uint32_t id) {
   /* While the timer is not ticking, store the timer value directly. This
    * avoids having to update it while the countdown ticks.
    */
-  p_timer->value -= timing_get_countdown_adjustment(p_timing);
+  p_timer->value -= timing_get_ticking_adjustment(p_timing);
 
   return timing_update_counts(p_timing);
 }
 
 int
 timing_timer_is_running(struct timing_struct* p_timing, uint32_t id) {
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  return p_timing->timers[id].ticking;
+  return p_timing->p_timers[id].ticking;
 }
 
 int64_t
@@ -334,15 +532,14 @@ timing_get_timer_value(struct timing_struct* p_timing, uint32_t id) {
   struct timer_struct* p_timer;
   int64_t ret;
 
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  p_timer = &p_timing->timers[id];
+  p_timer = &p_timing->p_timers[id];
   ret = p_timer->value;
   if (p_timer->ticking) {
-    ret -= timing_get_countdown_adjustment(p_timing);
+    ret -= timing_get_ticking_adjustment(p_timing);
   }
-  ret /= p_timing->scale_factor;
-  return ret;
+  return timing_scale_down(p_timing, ret);
 }
 
 int64_t
@@ -351,21 +548,20 @@ timing_set_timer_value(struct timing_struct* p_timing,
                        int64_t time) {
   struct timer_struct* p_timer;
 
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  p_timer = &p_timing->timers[id];
+  p_timer = &p_timing->p_timers[id];
   assert(p_timer->p_callback != NULL);
 
   time *= p_timing->scale_factor;
   if (p_timer->ticking) {
-    time += timing_get_countdown_adjustment(p_timing);
+    time += timing_get_ticking_adjustment(p_timing);
   }
 
   p_timer->value = time;
 
   if (p_timer->ticking && p_timer->firing) {
-    timing_remove_expiring_timer(p_timing, p_timer);
-    timing_insert_expiring_timer(p_timing, p_timer);
+    timing_reschedule_expiring_timer(p_timing, p_timer);
   }
 
   return timing_update_counts(p_timing);
@@ -381,9 +577,9 @@ timing_adjust_timer_value(struct timing_struct* p_timing,
 
   uint32_t scale_factor = p_timing->scale_factor;
 
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  p_timer = &p_timing->timers[id];
+  p_timer = &p_timing->p_timers[id];
   assert(p_timer->p_callback != NULL);
 
   delta *= scale_factor;
@@ -391,14 +587,17 @@ timing_adjust_timer_value(struct timing_struct* p_timing,
   new_time = (p_timer->value + delta);
 
   if (p_new_value) {
-    *p_new_value = (new_time / scale_factor);
+    int64_t new_value = new_time;
+    if (p_timer->ticking) {
+      new_value -= p_timing->ticking_base;
+    }
+    *p_new_value = timing_scale_down(p_timing, new_value);
   }
 
   p_timer->value = new_time;
 
   if (p_timer->ticking && p_timer->firing) {
-    timing_remove_expiring_timer(p_timing, p_timer);
-    timing_insert_expiring_timer(p_timing, p_timer);
+    timing_reschedule_expiring_timer(p_timing, p_timer);
   }
 
   return timing_update_counts(p_timing);
@@ -406,9 +605,9 @@ timing_adjust_timer_value(struct timing_struct* p_timing,
 
 int
 timing_get_firing(struct timing_struct* p_timing, uint32_t id) {
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  return p_timing->timers[id].firing;
+  return p_timing->p_timers[id].firing;
 }
 
 int64_t
@@ -417,9 +616,9 @@ timing_set_firing(struct timing_struct* p_timing, uint32_t id, int firing) {
 
   int firing_changed = 0;
 
-  assert(id < k_timing_num_timers);
+  assert(id < p_timing->max_timers);
 
-  p_timer = &p_timing->timers[id];
+  p_timer = &p_timing->p_timers[id];
   if (firing != p_timer->firing) {
     firing_changed = 1;
     p_timer->firing = firing;
@@ -438,56 +637,62 @@ timing_set_firing(struct timing_struct* p_timing, uint32_t id, int firing) {
 
 static uint64_t
 timing_do_advance_time(struct timing_struct* p_timing, uint64_t delta) {
-  struct timer_struct* p_timer;
+  int64_t ticking_base;
 
   delta += timing_get_countdown_adjustment(p_timing);
 
-  /* Pass 1: update all timers with their correct new value. */
-  p_timer = p_timing->p_ticking_head;
-  while (p_timer != NULL) {
-    assert(p_timer->ticking);
-    if (p_timer->p_expiry_next) {
-      assert(p_timer->p_expiry_next->p_expiry_prev == p_timer);
-    }
-    if (p_timer->p_ticking_next) {
-      assert(p_timer->p_ticking_next->p_ticking_prev == p_timer);
-    }
-
-    p_timer->value -= delta;
-
-    p_timer = p_timer->p_ticking_next;
-  }
+  /* Moving the base updates all ticking timers with their correct new value. */
+  ticking_base = (p_timing->ticking_base + delta);
+  p_timing->ticking_base = ticking_base;
 
   /* Clear the countdown adjustment. */
   p_timing->next_timer_expiry = 0;
   timing_set_countdown(p_timing, 0);
 
-  /* Pass 2: fire any timers. */
-  p_timer = p_timing->p_expiry_head;
-  while ((p_timer != NULL) && (p_timer->value <= 0)) {
-    struct timer_struct* p_old_timer = p_timer;
+  /* Fire any timers. Callbacks are likely to reschedule timers, so
+   * re-check the top of the heap each time.
+   */
+  while (p_timing->expiry_heap_size > 0) {
+    uint32_t id = p_timing->p_expiry_heap[0];
+    struct timer_struct* p_timer = &p_timing->p_timers[id];
+    if (p_timer->value > ticking_base) {
+      break;
+    }
 
-    assert(p_old_timer->ticking);
-    assert(p_old_timer->firing);
+    assert(p_timer->ticking);
+    assert(p_timer->firing);
 
     /* Callers of timing_do_advance_time() are required to expire active timers
      * exactly on time.
      */
-    assert(p_timer->value == 0);
-    /* Load the next timer, as calling the callback is likely to trash it. */
-    p_timer = p_timer->p_expiry_next;
+    assert(p_timer->value == ticking_base);
     if (p_timing->log_expiries) {
       log_do_log(k_log_perf,
                  k_log_info,
                  "timer %s (0x%"PRIx64") expired at %"PRIu64" ticks",
-                 p_old_timer->p_name,
-                 (uint64_t) p_old_timer,
+                 p_timer->p_name,
+                 (uint64_t) p_timer,
                  p_timing->total_timer_ticks);
     }
-    p_old_timer->p_callback(p_old_timer->p_object);
-    assert(!p_old_timer->ticking ||
-           !p_old_timer->firing ||
-           (p_old_timer->value > 0));
+    if (p_timing->is_accounting) {
+      uint64_t ticks = p_timing->total_timer_ticks;
+      uint64_t start_ns;
+      if (p_timer->fire_count == 0) {
+        p_timer->first_fire_ticks = ticks;
+      }
+      p_timer->fire_count++;
+      p_timer->last_fire_ticks = ticks;
+      start_ns = os_time_get_ns();
+      p_timer->p_callback(p_timer->p_object);
+      p_timing->p_timers[id].callback_ns += (os_time_get_ns() - start_ns);
+    } else {
+      p_timer->p_callback(p_timer->p_object);
+    }
+    /* The callback could have registered a timer, moving the timers. */
+    p_timer = &p_timing->p_timers[id];
+    assert(!p_timer->ticking ||
+           !p_timer->firing ||
+           (p_timer->value > p_timing->ticking_base));
   }
 
   return timing_update_counts(p_timing);
@@ -554,4 +759,81 @@ timing_set_odd_even_mixin(struct timing_struct* p_timing, uint64_t mixin) {
   p_timing->odd_even_mixin = mixin;
 }
 
+void
+timing_save_checkpoint(struct timing_struct* p_timing,
+                       struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf,
+                        &p_timing->total_timer_ticks,
+                        sizeof(p_timing->total_timer_ticks));
+  util_buffer_add_chunk(p_buf,
+                        &p_timing->odd_even_mixin,
+                        sizeof(p_timing->odd_even_mixin));
+}
+
+void
+timing_load_checkpoint(struct timing_struct* p_timing,
+                       struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf,
+                        &p_timing->total_timer_ticks,
+                        sizeof(p_timing->total_timer_ticks));
+  util_buffer_get_chunk(p_buf,
+                        &p_timing->odd_even_mixin,
+                        sizeof(p_timing->odd_even_mixin));
+  /* Recalculate the odd/even tracker for the new ticks. */
+  timing_set_countdown(p_timing, p_timing->countdown);
+}
+
+void
+timing_save_timer(struct timing_struct* p_timing,
+                  uint32_t id,
+                  struct util_buffer* p_buf) {
+  struct timer_struct* p_timer;
+  int64_t value;
+
+  assert(id < p_timing->max_timers);
+
+  p_timer = &p_timing->p_timers[id];
+  value = p_timer->value;
+  if (p_timer->ticking) {
+    value -= timing_get_ticking_adjustment(p_timing);
+  }
+  util_buffer_add_chunk(p_buf, &value, sizeof(value));
+  util_buffer_add_chunk(p_buf, &p_timer->sequence, sizeof(p_timer->sequence));
+  util_buffer_add_chunk(p_buf, &p_timer->ticking, sizeof(p_timer->ticking));
+  util_buffer_add_chunk(p_buf, &p_timer->firing, sizeof(p_timer->firing));
+}
+
+void
+timing_load_timer(struct timing_struct* p_timing,
+                  uint32_t id,
+                  struct util_buffer* p_buf) {
+  struct timer_struct* p_timer;
+
+  assert(id < p_timing->max_timers);
+
+  p_timer = &p_timing->p_timers[id];
+  assert(p_timer->p_callback != NULL);
+
+  if (p_timer->heap_index != -1) {
+    timing_remove_expiring_timer(p_timing, p_timer);
+  }
+
+  util_buffer_get_chunk(p_buf, &p_timer->value, sizeof(p_timer->value));
+  util_buffer_get_chunk(p_buf, &p_timer->sequence, sizeof(p_timer->sequence));
+  util_buffer_get_chunk(p_buf, &p_timer->ticking, sizeof(p_timer->ticking));
+  util_buffer_get_chunk(p_buf, &p_timer->firing, sizeof(p_timer->firing));
+
+  if (p_timer->ticking) {
+    p_timer->value += timing_get_ticking_adjustment(p_timing);
+  }
+  /* The saved sequence keeps timers expiring at the same time in their
+   * original order.
+   */
+  if (p_timer->ticking && p_timer->firing) {
+    timing_heap_insert(p_timing, p_timer);
+  }
+
+  (void) timing_update_counts(p_timing);
+}
+
 #include "test-timing.c"
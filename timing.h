@@ -5,10 +5,16 @@
 #include <stdint.h>
 
 struct timing_struct;
+struct util_buffer;
 
 struct timing_struct* timing_create(uint32_t scale_factor);
 void timing_destroy(struct timing_struct* p_timing);
 void timing_set_log_expiries(struct timing_struct* p_timing, int log_expiries);
+/* Per-timer fire counts, intervals and host time spent in callbacks. */
+void timing_set_accounting(struct timing_struct* p_timing, int is_accounting);
+int timing_is_accounting(struct timing_struct* p_timing);
+void timing_clear_accounting(struct timing_struct* p_timing);
+void timing_dump_accounting(struct timing_struct* p_timing);
 
 void timing_reset_total_timer_ticks(struct timing_struct* p_timing);
 
@@ -52,4 +58,16 @@ int64_t timing_advance_time_delta(struct timing_struct* p_timing,
 /* For compatability with older replays. */
 void timing_set_odd_even_mixin(struct timing_struct* p_timing, uint64_t mixin);
 
+/* Checkpoints. The total ticks, then each module's own timers. */
+void timing_save_checkpoint(struct timing_struct* p_timing,
+                            struct util_buffer* p_buf);
+void timing_load_checkpoint(struct timing_struct* p_timing,
+                            struct util_buffer* p_buf);
+void timing_save_timer(struct timing_struct* p_timing,
+                       uint32_t id,
+                       struct util_buffer* p_buf);
+void timing_load_timer(struct timing_struct* p_timing,
+                       uint32_t id,
+                       struct util_buffer* p_buf);
+
 #endif /* BEEBJIT_TIMING_H */
@@ -0,0 +1,293 @@
+#include "trace.h"
+
+#include "util.h"
+#include "util_compress.h"
+
+#include "os_channel.h"
+#include "os_thread.h"
+
+#include <assert.h>
+#include <string.h>
+
+enum {
+  k_trace_buffer_size = (1024 * 1024),
+  /* Never a valid 16-bit PC, so the next record always has its PC. */
+  k_trace_no_pc = 0x10000,
+};
+
+/* Filled buffers are handed to a writer thread, which compresses and writes
+ * them while the other buffer fills. A zero length asks the thread to exit.
+ */
+struct trace_message {
+  uint32_t buffer_index;
+  uint32_t length;
+};
+
+struct trace_struct {
+  struct util_file* p_file;
+  int is_compressed;
+  struct os_thread_struct* p_thread;
+  intptr_t handle_writer_read;
+  intptr_t handle_client_write;
+  intptr_t handle_client_read;
+  intptr_t handle_writer_write;
+  uint8_t* p_buffers[2];
+  uint32_t buffer_index;
+  uint32_t buffer_pos;
+  int is_writer_busy;
+  uint8_t* p_compress_buffer;
+  size_t compress_buffer_size;
+
+  /* The previous record, to delta against. */
+  int has_previous;
+  uint64_t ticks;
+  uint32_t next_pc;
+  uint8_t reg_a;
+  uint8_t reg_x;
+  uint8_t reg_y;
+  uint8_t reg_s;
+  uint8_t reg_flags;
+};
+
+static void
+trace_put_le32(uint8_t* p_buf, uint32_t val) {
+  p_buf[0] = (val & 0xFF);
+  p_buf[1] = ((val >> 8) & 0xFF);
+  p_buf[2] = ((val >> 16) & 0xFF);
+  p_buf[3] = (val >> 24);
+}
+
+static void
+trace_write_chunk(struct trace_struct* p_trace,
+                  uint8_t* p_buf,
+                  uint32_t length) {
+  uint8_t header[k_trace_chunk_header_size];
+  size_t stored_length = length;
+
+  if (p_trace->is_compressed) {
+    stored_length = p_trace->compress_buffer_size;
+    if (util_compress(&stored_length,
+                      p_buf,
+                      length,
+                      p_trace->p_compress_buffer) != 0) {
+      util_bail("trace compression failed");
+    }
+    p_buf = p_trace->p_compress_buffer;
+  }
+
+  trace_put_le32(&header[0], length);
+  trace_put_le32(&header[4], (uint32_t) stored_length);
+  util_file_write(p_trace->p_file, &header[0], sizeof(header));
+  util_file_write(p_trace->p_file, p_buf, stored_length);
+}
+
+static void*
+trace_writer_thread(void* p) {
+  struct trace_struct* p_trace = (struct trace_struct*) p;
+
+  while (1) {
+    struct trace_message message;
+    os_channel_read(p_trace->handle_writer_read, &message, sizeof(message));
+    if (message.length == 0) {
+      break;
+    }
+    trace_write_chunk(p_trace,
+                      p_trace->p_buffers[message.buffer_index],
+                      message.length);
+    os_channel_write(p_trace->handle_writer_write, &message, sizeof(message));
+  }
+
+  return NULL;
+}
+
+static void
+trace_wait_for_writer(struct trace_struct* p_trace) {
+  struct trace_message message;
+
+  if (!p_trace->is_writer_busy) {
+    return;
+  }
+  os_channel_read(p_trace->handle_client_read, &message, sizeof(message));
+  assert(message.buffer_index != p_trace->buffer_index);
+  p_trace->is_writer_busy = 0;
+}
+
+static void
+trace_flush(struct trace_struct* p_trace) {
+  struct trace_message message;
+
+  if (p_trace->buffer_pos == 0) {
+    return;
+  }
+  /* Only blocks if the host can't write as fast as the 6502 runs. */
+  trace_wait_for_writer(p_trace);
+
+  message.buffer_index = p_trace->buffer_index;
+  message.length = p_trace->buffer_pos;
+  os_channel_write(p_trace->handle_client_write, &message, sizeof(message));
+  p_trace->is_writer_busy = 1;
+
+  p_trace->buffer_index ^= 1;
+  p_trace->buffer_pos = 0;
+}
+
+struct trace_struct*
+trace_create(const char* p_file_name, int is_compressed, int is_65c12) {
+  uint8_t header[k_trace_header_size];
+  struct util_file* p_file = util_file_try_open(p_file_name, 1, 1);
+  struct trace_struct* p_trace;
+
+  if (p_file == NULL) {
+    return NULL;
+  }
+
+  (void) memset(&header[0], '\0', sizeof(header));
+  (void) memcpy(&header[0], TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  trace_put_le32(&header[8], k_trace_version);
+  if (is_compressed) {
+    header[12] |= k_trace_flag_compressed;
+  }
+  if (is_65c12) {
+    header[12] |= k_trace_flag_65c12;
+  }
+  util_file_write(p_file, &header[0], sizeof(header));
+
+  p_trace = util_mallocz(sizeof(struct trace_struct));
+  p_trace->p_file = p_file;
+  p_trace->is_compressed = is_compressed;
+  p_trace->p_buffers[0] = util_malloc(k_trace_buffer_size);
+  p_trace->p_buffers[1] = util_malloc(k_trace_buffer_size);
+  if (is_compressed) {
+    p_trace->compress_buffer_size = util_compress_bound(k_trace_buffer_size);
+    p_trace->p_compress_buffer = util_malloc(p_trace->compress_buffer_size);
+  }
+
+  os_channel_get_handles(&p_trace->handle_writer_read,
+                         &p_trace->handle_client_write,
+                         &p_trace->handle_client_read,
+                         &p_trace->handle_writer_write);
+  p_trace->p_thread = os_thread_create(trace_writer_thread, p_trace);
+
+  return p_trace;
+}
+
+void
+trace_destroy(struct trace_struct* p_trace) {
+  struct trace_message message;
+
+  trace_flush(p_trace);
+  trace_wait_for_writer(p_trace);
+
+  message.buffer_index = 0;
+  message.length = 0;
+  os_channel_write(p_trace->handle_client_write, &message, sizeof(message));
+  (void) os_thread_destroy(p_trace->p_thread);
+  os_channel_free_handles(p_trace->handle_writer_read,
+                          p_trace->handle_client_write,
+                          p_trace->handle_client_read,
+                          p_trace->handle_writer_write);
+
+  util_file_close(p_trace->p_file);
+  util_free(p_trace->p_buffers[0]);
+  util_free(p_trace->p_buffers[1]);
+  util_free(p_trace->p_compress_buffer);
+  util_free(p_trace);
+}
+
+void
+trace_instruction(struct trace_struct* p_trace,
+                  uint64_t ticks,
+                  uint16_t reg_pc,
+                  uint8_t reg_a,
+                  uint8_t reg_x,
+                  uint8_t reg_y,
+                  uint8_t reg_s,
+                  uint8_t reg_flags,
+                  int is_irq,
+                  uint8_t opmode,
+                  uint8_t* p_opcode_bytes,
+                  uint16_t addr) {
+  uint8_t* p_record;
+  uint8_t* p_buf;
+  uint64_t ticks_value;
+  uint32_t oplen;
+  uint32_t i;
+
+  uint8_t tag = 0;
+  int has_previous = p_trace->has_previous;
+
+  if ((p_trace->buffer_pos + k_trace_max_record_size) > k_trace_buffer_size) {
+    trace_flush(p_trace);
+  }
+  p_record = (p_trace->p_buffers[p_trace->buffer_index] + p_trace->buffer_pos);
+  p_buf = (p_record + 1);
+
+  /* Ticks go backwards if a replay rewinds the machine. */
+  if (!has_previous || (ticks < p_trace->ticks)) {
+    tag |= k_trace_tag_absolute_ticks;
+    ticks_value = ticks;
+  } else {
+    ticks_value = (ticks - p_trace->ticks);
+  }
+  do {
+    uint8_t val = (ticks_value & 0x7F);
+    ticks_value >>= 7;
+    if (ticks_value != 0) {
+      val |= 0x80;
+    }
+    *p_buf++ = val;
+  } while (ticks_value != 0);
+
+  if (!has_previous || (reg_pc != p_trace->next_pc)) {
+    tag |= k_trace_tag_pc;
+    *p_buf++ = (reg_pc & 0xFF);
+    *p_buf++ = (reg_pc >> 8);
+  }
+  if (!has_previous || (reg_a != p_trace->reg_a)) {
+    tag |= k_trace_tag_a;
+    *p_buf++ = reg_a;
+  }
+  if (!has_previous || (reg_x != p_trace->reg_x)) {
+    tag |= k_trace_tag_x;
+    *p_buf++ = reg_x;
+  }
+  if (!has_previous || (reg_y != p_trace->reg_y)) {
+    tag |= k_trace_tag_y;
+    *p_buf++ = reg_y;
+  }
+  if (!has_previous || (reg_s != p_trace->reg_s)) {
+    tag |= k_trace_tag_s;
+    *p_buf++ = reg_s;
+  }
+  if (!has_previous || (reg_flags != p_trace->reg_flags)) {
+    tag |= k_trace_tag_flags;
+    *p_buf++ = reg_flags;
+  }
+
+  if (is_irq) {
+    tag |= k_trace_tag_irq;
+    p_trace->next_pc = k_trace_no_pc;
+  } else {
+    oplen = g_opmodelens[opmode];
+    for (i = 0; i < oplen; ++i) {
+      *p_buf++ = p_opcode_bytes[i];
+    }
+    if (trace_opmode_has_addr(opmode)) {
+      *p_buf++ = (addr & 0xFF);
+      *p_buf++ = (addr >> 8);
+    }
+    p_trace->next_pc = (uint16_t) (reg_pc + oplen);
+  }
+
+  *p_record = tag;
+  assert((p_buf - p_record) <= k_trace_max_record_size);
+  p_trace->buffer_pos += (p_buf - p_record);
+
+  p_trace->has_previous = 1;
+  p_trace->ticks = ticks;
+  p_trace->reg_a = reg_a;
+  p_trace->reg_x = reg_x;
+  p_trace->reg_y = reg_y;
+  p_trace->reg_s = reg_s;
+  p_trace->reg_flags = reg_flags;
+}
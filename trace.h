@@ -0,0 +1,73 @@
+#ifndef BEEBJIT_TRACE_H
+#define BEEBJIT_TRACE_H
+
+#include "defs_6502.h"
+
+#include <stdint.h>
+
+/* Binary instruction trace file format.
+ * A 16 byte header: the magic, a little endian 32-bit version and a flags
+ * byte. Then chunks, each with a little endian 32-bit raw length, a little
+ * endian 32-bit stored length and the stored data. The stored data is zlib
+ * format if the compressed flag is set, raw otherwise. Records don't span
+ * chunks.
+ * Each record is a tag byte, the cycle ticks as a LEB128 varint, then the
+ * fields the tag says are present, in tag bit order. The ticks are a delta
+ * from the previous record unless the tag says they're absolute. The PC is
+ * only present if it isn't the previous PC plus the previous instruction
+ * length, and registers are only present if they changed. Instruction records
+ * then have the opcode and operand bytes, plus the effective address for the
+ * indirect modes, where it can't be worked out from the registers.
+ */
+#define TRACE_MAGIC "BJTRACE"
+
+enum {
+  k_trace_header_size = 16,
+  k_trace_chunk_header_size = 8,
+  k_trace_version = 1,
+  k_trace_max_record_size = 24,
+};
+
+enum {
+  k_trace_flag_compressed = 0x01,
+  k_trace_flag_65c12 = 0x02,
+};
+
+enum {
+  k_trace_tag_pc = 0x01,
+  k_trace_tag_a = 0x02,
+  k_trace_tag_x = 0x04,
+  k_trace_tag_y = 0x08,
+  k_trace_tag_s = 0x10,
+  k_trace_tag_flags = 0x20,
+  k_trace_tag_irq = 0x40,
+  k_trace_tag_absolute_ticks = 0x80,
+};
+
+static inline int
+trace_opmode_has_addr(uint8_t opmode) {
+  return ((opmode == k_idx) || (opmode == k_idy) || (opmode == k_id));
+}
+
+struct trace_struct;
+
+struct trace_struct* trace_create(const char* p_file_name,
+                                  int is_compressed,
+                                  int is_65c12);
+/* Flushes everything to the file. */
+void trace_destroy(struct trace_struct* p_trace);
+
+void trace_instruction(struct trace_struct* p_trace,
+                       uint64_t ticks,
+                       uint16_t reg_pc,
+                       uint8_t reg_a,
+                       uint8_t reg_x,
+                       uint8_t reg_y,
+                       uint8_t reg_s,
+                       uint8_t reg_flags,
+                       int is_irq,
+                       uint8_t opmode,
+                       uint8_t* p_opcode_bytes,
+                       uint16_t addr);
+
+#endif /* BEEBJIT_TRACE_H */
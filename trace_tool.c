@@ -0,0 +1,418 @@
+/* Query tool for binary instruction traces, as recorded by the debugger's
+ * "trace" command. See trace.h for the file format.
+ */
+#include "defs_6502.h"
+#include "trace.h"
+#include "util.h"
+#include "util_compress.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+struct trace_tool_filter {
+  int32_t pc_lo;
+  int32_t pc_hi;
+  int32_t addr_lo;
+  int32_t addr_hi;
+  const char* p_opname;
+  uint64_t ticks_from;
+  uint64_t ticks_to;
+  uint64_t max_lines;
+  int is_count_only;
+};
+
+struct trace_tool_state {
+  uint8_t* p_optypes;
+  uint8_t* p_opmodes;
+  uint8_t* p_opmem;
+  uint64_t ticks;
+  uint32_t next_pc;
+  uint16_t reg_pc;
+  uint8_t reg_a;
+  uint8_t reg_x;
+  uint8_t reg_y;
+  uint8_t reg_s;
+  uint8_t reg_flags;
+  uint64_t num_records;
+  uint64_t num_matches;
+};
+
+static int32_t
+trace_tool_get_addr(struct trace_tool_state* p_state,
+                    uint8_t opcode,
+                    uint8_t* p_opcode_bytes,
+                    uint16_t stored_addr) {
+  uint8_t optype = p_state->p_optypes[opcode];
+  uint8_t opmode = p_state->p_opmodes[opcode];
+  uint16_t operand = (p_opcode_bytes[1] | (p_opcode_bytes[2] << 8));
+
+  if (p_state->p_opmem[opcode] == 0) {
+    switch (optype) {
+    case k_php:
+    case k_pha:
+    case k_phx:
+    case k_phy:
+      return (k_6502_stack_addr + p_state->reg_s);
+    case k_plp:
+    case k_pla:
+    case k_plx:
+    case k_ply:
+      return (k_6502_stack_addr + (uint8_t) (p_state->reg_s + 1));
+    default:
+      return -1;
+    }
+  }
+
+  switch (opmode) {
+  case k_zpg:
+    return (operand & 0xFF);
+  case k_zpx:
+    return (uint8_t) (operand + p_state->reg_x);
+  case k_zpy:
+    return (uint8_t) (operand + p_state->reg_y);
+  case k_abs:
+    return operand;
+  case k_abx:
+    return (uint16_t) (operand + p_state->reg_x);
+  case k_aby:
+    return (uint16_t) (operand + p_state->reg_y);
+  default:
+    if (trace_opmode_has_addr(opmode)) {
+      return stored_addr;
+    }
+    return -1;
+  }
+}
+
+static void
+trace_tool_record(struct trace_tool_state* p_state,
+                  struct trace_tool_filter* p_filter,
+                  int is_irq,
+                  uint8_t* p_opcode_bytes,
+                  uint16_t stored_addr) {
+  char opcode_buf[16];
+  char flags_buf[9];
+  char addr_buf[16];
+  uint8_t opcode = p_opcode_bytes[0];
+  int32_t addr = -1;
+
+  if (!is_irq) {
+    addr = trace_tool_get_addr(p_state, opcode, p_opcode_bytes, stored_addr);
+  }
+
+  if ((p_state->ticks < p_filter->ticks_from) ||
+      (p_state->ticks > p_filter->ticks_to)) {
+    return;
+  }
+  if ((p_state->reg_pc < p_filter->pc_lo) ||
+      (p_state->reg_pc > p_filter->pc_hi)) {
+    return;
+  }
+  if ((p_filter->addr_lo != -1) &&
+      ((addr < p_filter->addr_lo) || (addr > p_filter->addr_hi))) {
+    return;
+  }
+  if (p_filter->p_opname != NULL) {
+    const char* p_opname = "IRQ";
+    if (!is_irq) {
+      p_opname = g_p_opnames[p_state->p_optypes[opcode]];
+    }
+    if (strcasecmp(p_opname, p_filter->p_opname)) {
+      return;
+    }
+  }
+
+  p_state->num_matches++;
+  if (p_filter->is_count_only ||
+      (p_state->num_matches > p_filter->max_lines)) {
+    return;
+  }
+
+  if (is_irq) {
+    (void) snprintf(opcode_buf, sizeof(opcode_buf), "IRQ");
+  } else {
+    defs_6502_format_opcode(opcode_buf,
+                            sizeof(opcode_buf),
+                            p_state->p_optypes[opcode],
+                            p_state->p_opmodes[opcode],
+                            opcode,
+                            p_opcode_bytes[1],
+                            p_opcode_bytes[2],
+                            p_state->reg_pc);
+  }
+  defs_6502_format_flags(&flags_buf[0], p_state->reg_flags);
+  addr_buf[0] = '\0';
+  if (addr != -1) {
+    (void) snprintf(addr_buf, sizeof(addr_buf), " [addr=%.4"PRIX16"]",
+                    (uint16_t) addr);
+  }
+
+  (void) printf("%.4"PRIX16": %-14s "
+                "[A=%.2"PRIX8" X=%.2"PRIX8" Y=%.2"PRIX8" S=%.2"PRIX8" F=%s] "
+                "[ticks=%"PRIu64"]%s\n",
+                p_state->reg_pc,
+                opcode_buf,
+                p_state->reg_a,
+                p_state->reg_x,
+                p_state->reg_y,
+                p_state->reg_s,
+                flags_buf,
+                p_state->ticks,
+                addr_buf);
+}
+
+static void
+trace_tool_chunk(struct trace_tool_state* p_state,
+                 struct trace_tool_filter* p_filter,
+                 uint8_t* p_buf,
+                 size_t length) {
+  uint8_t* p_end = (p_buf + length);
+
+  while (p_buf < p_end) {
+    uint8_t opcode_bytes[3];
+    uint64_t ticks_value;
+    uint32_t shift;
+    uint32_t oplen;
+    uint32_t i;
+    uint8_t opmode;
+
+    uint8_t tag = *p_buf++;
+    int is_irq = !!(tag & k_trace_tag_irq);
+    uint16_t stored_addr = 0;
+
+    ticks_value = 0;
+    shift = 0;
+    while (1) {
+      uint8_t val = *p_buf++;
+      ticks_value |= ((uint64_t) (val & 0x7F) << shift);
+      shift += 7;
+      if (!(val & 0x80)) {
+        break;
+      }
+      if (shift >= 64) {
+        util_bail("corrupt trace ticks");
+      }
+    }
+    if (tag & k_trace_tag_absolute_ticks) {
+      p_state->ticks = ticks_value;
+    } else {
+      p_state->ticks += ticks_value;
+    }
+
+    if (tag & k_trace_tag_pc) {
+      p_state->reg_pc = (p_buf[0] | (p_buf[1] << 8));
+      p_buf += 2;
+    } else {
+      if (p_state->next_pc > 0xFFFF) {
+        util_bail("trace record missing PC");
+      }
+      p_state->reg_pc = p_state->next_pc;
+    }
+    if (tag & k_trace_tag_a) {
+      p_state->reg_a = *p_buf++;
+    }
+    if (tag & k_trace_tag_x) {
+      p_state->reg_x = *p_buf++;
+    }
+    if (tag & k_trace_tag_y) {
+      p_state->reg_y = *p_buf++;
+    }
+    if (tag & k_trace_tag_s) {
+      p_state->reg_s = *p_buf++;
+    }
+    if (tag & k_trace_tag_flags) {
+      p_state->reg_flags = *p_buf++;
+    }
+
+    (void) memset(&opcode_bytes[0], '\0', sizeof(opcode_bytes));
+    if (is_irq) {
+      p_state->next_pc = 0x10000;
+    } else {
+      opcode_bytes[0] = *p_buf++;
+      opmode = p_state->p_opmodes[opcode_bytes[0]];
+      oplen = g_opmodelens[opmode];
+      for (i = 1; i < oplen; ++i) {
+        opcode_bytes[i] = *p_buf++;
+      }
+      if (trace_opmode_has_addr(opmode)) {
+        stored_addr = (p_buf[0] | (p_buf[1] << 8));
+        p_buf += 2;
+      }
+      p_state->next_pc = (uint16_t) (p_state->reg_pc + oplen);
+    }
+    /* Buffers are padded, so a corrupt last record can't read off the end. */
+    if (p_buf > p_end) {
+      util_bail("trace record overruns chunk");
+    }
+
+    p_state->num_records++;
+    trace_tool_record(p_state, p_filter, is_irq, &opcode_bytes[0], stored_addr);
+  }
+}
+
+static void
+trace_tool_usage(void) {
+  (void) fprintf(stderr,
+"Usage: trace_tool <trace file> [options]\n"
+"-pc <lo> (<hi>)    : only instructions at PC in hex range.\n"
+"-addr <lo> (<hi>)  : only instructions accessing memory in hex range.\n"
+"-op <name>         : only instructions of type <name>, e.g. STA, or IRQ.\n"
+"-from <t>          : only records at or after <t> ticks.\n"
+"-to <t>            : only records at or before <t> ticks.\n"
+"-max <n>           : print at most <n> records.\n"
+"-count             : just count the matching records.\n");
+  exit(1);
+}
+
+int
+main(int argc, const char* argv[]) {
+  uint8_t header[k_trace_header_size];
+  struct trace_tool_filter filter;
+  struct trace_tool_state state;
+  struct util_file* p_file;
+  int is_compressed;
+  int i;
+
+  uint8_t* p_stored = NULL;
+  uint8_t* p_raw = NULL;
+  size_t stored_alloc = 0;
+  size_t raw_alloc = 0;
+
+  if (argc < 2) {
+    trace_tool_usage();
+  }
+
+  (void) memset(&filter, '\0', sizeof(filter));
+  filter.pc_lo = 0;
+  filter.pc_hi = 0xFFFF;
+  filter.addr_lo = -1;
+  filter.addr_hi = -1;
+  filter.ticks_to = UINT64_MAX;
+  filter.max_lines = UINT64_MAX;
+
+  for (i = 2; i < argc; ++i) {
+    const char* p_arg = argv[i];
+    const char* p_val1 = NULL;
+    const char* p_val2 = NULL;
+    if ((i + 1) < argc) {
+      p_val1 = argv[i + 1];
+    }
+    if (((i + 2) < argc) && (argv[i + 2][0] != '-')) {
+      p_val2 = argv[i + 2];
+    }
+    if (!strcmp(p_arg, "-count")) {
+      filter.is_count_only = 1;
+      continue;
+    }
+    if (p_val1 == NULL) {
+      trace_tool_usage();
+    }
+    ++i;
+    if (!strcmp(p_arg, "-pc") || !strcmp(p_arg, "-addr")) {
+      int32_t lo = (int32_t) util_parse_u64(p_val1, 1);
+      int32_t hi = lo;
+      if (p_val2 != NULL) {
+        hi = (int32_t) util_parse_u64(p_val2, 1);
+        ++i;
+      }
+      if (!strcmp(p_arg, "-pc")) {
+        filter.pc_lo = lo;
+        filter.pc_hi = hi;
+      } else {
+        filter.addr_lo = lo;
+        filter.addr_hi = hi;
+      }
+    } else if (!strcmp(p_arg, "-op")) {
+      filter.p_opname = p_val1;
+    } else if (!strcmp(p_arg, "-from")) {
+      filter.ticks_from = util_parse_u64(p_val1, 0);
+    } else if (!strcmp(p_arg, "-to")) {
+      filter.ticks_to = util_parse_u64(p_val1, 0);
+    } else if (!strcmp(p_arg, "-max")) {
+      filter.max_lines = util_parse_u64(p_val1, 0);
+    } else {
+      trace_tool_usage();
+    }
+  }
+
+  p_file = util_file_try_read_open(argv[1]);
+  if (p_file == NULL) {
+    util_bail("couldn't open %s", argv[1]);
+  }
+  if ((util_file_read(p_file, &header[0], sizeof(header)) != sizeof(header)) ||
+      memcmp(&header[0], TRACE_MAGIC, sizeof(TRACE_MAGIC))) {
+    util_bail("not a beebjit trace file");
+  }
+  if (util_read_le32(&header[8]) != k_trace_version) {
+    util_bail("unsupported trace version");
+  }
+  is_compressed = !!(header[12] & k_trace_flag_compressed);
+
+  defs_6502_init();
+  (void) memset(&state, '\0', sizeof(state));
+  state.next_pc = 0x10000;
+  if (header[12] & k_trace_flag_65c12) {
+    state.p_optypes = defs_6502_get_65c12_optype_map();
+    state.p_opmodes = defs_6502_get_65c12_opmode_map();
+    state.p_opmem = defs_6502_get_65c12_opmem_map();
+  } else {
+    state.p_optypes = defs_6502_get_6502_optype_map();
+    state.p_opmodes = defs_6502_get_6502_opmode_map();
+    state.p_opmem = defs_6502_get_6502_opmem_map();
+  }
+
+  while (1) {
+    uint8_t chunk_header[k_trace_chunk_header_size];
+    uint8_t* p_chunk;
+    size_t raw_length;
+    size_t stored_length;
+    uint64_t ret = util_file_read(p_file,
+                                  &chunk_header[0],
+                                  sizeof(chunk_header));
+    if (ret == 0) {
+      break;
+    } else if (ret != sizeof(chunk_header)) {
+      util_bail("truncated trace file");
+    }
+    raw_length = util_read_le32(&chunk_header[0]);
+    stored_length = util_read_le32(&chunk_header[4]);
+    if ((stored_length + k_trace_max_record_size) > stored_alloc) {
+      stored_alloc = (stored_length + k_trace_max_record_size);
+      p_stored = util_realloc(p_stored, stored_alloc);
+    }
+    if (util_file_read(p_file, p_stored, stored_length) != stored_length) {
+      util_bail("truncated trace file");
+    }
+    p_chunk = p_stored;
+    if (is_compressed) {
+      size_t length = raw_length;
+      if ((raw_length + k_trace_max_record_size) > raw_alloc) {
+        raw_alloc = (raw_length + k_trace_max_record_size);
+        p_raw = util_realloc(p_raw, raw_alloc);
+      }
+      if ((util_uncompress(&length, p_stored, stored_length, p_raw) != 0) ||
+          (length != raw_length)) {
+        util_bail("corrupt compressed trace chunk");
+      }
+      p_chunk = p_raw;
+    } else if (raw_length != stored_length) {
+      util_bail("corrupt trace chunk");
+    }
+    trace_tool_chunk(&state, &filter, p_chunk, raw_length);
+  }
+
+  util_file_close(p_file);
+  util_free(p_stored);
+  util_free(p_raw);
+
+  if (filter.is_count_only) {
+    (void) printf("%"PRIu64" of %"PRIu64" records\n",
+                  state.num_matches,
+                  state.num_records);
+  }
+
+  return 0;
+}
@@ -246,11 +246,22 @@ util_buffer_add_int(struct util_buffer* p_buf, int64_t i) {
 void
 util_buffer_add_chunk(struct util_buffer* p_buf, void* p_src, size_t size) {
   assert((p_buf->pos + size) >= p_buf->pos);
+  if (p_buf->is_internal && ((p_buf->pos + size) > p_buf->length)) {
+    util_buffer_ensure_capacity(p_buf, ((p_buf->pos + size) * 2));
+  }
   assert((p_buf->pos + size) <= p_buf->length);
   (void) memcpy((p_buf->p_mem + p_buf->pos), p_src, size);
   p_buf->pos += size;
 }
 
+void
+util_buffer_get_chunk(struct util_buffer* p_buf, void* p_dst, size_t size) {
+  assert((p_buf->pos + size) >= p_buf->pos);
+  assert((p_buf->pos + size) <= p_buf->length);
+  (void) memcpy(p_dst, (p_buf->p_mem + p_buf->pos), size);
+  p_buf->pos += size;
+}
+
 void
 util_buffer_fill_to_end(struct util_buffer* p_buf, char value) {
   util_buffer_fill(p_buf, value, (p_buf->length - p_buf->pos));
@@ -710,21 +721,61 @@ util_crc32_init() {
   return 0xFFFFFFFF;
 }
 
-uint32_t
-util_crc32_add(uint32_t crc, uint8_t* p_buf, uint32_t len) {
+/* Slicing-by-8: eight table lookups per 8 bytes, all independent, rather
+ * than a bit at a time. Whole frame buffers get checksummed every frame.
+ * Table k is the CRC of a byte followed by k zero bytes.
+ */
+static uint32_t s_crc32_tables[8][256];
+static int s_is_crc32_tables_built;
+
+void
+util_crc32_build_tables(void) {
   uint32_t i;
-  uint32_t j;
 
-  for (i = 0; i < len; ++i) {
-    uint8_t byte = p_buf[i];
-    crc = (crc ^ byte);
+  for (i = 0; i < 256; ++i) {
+    uint32_t j;
+    uint32_t val = i;
     for (j = 0; j < 8; ++j) {
-      int do_eor = (crc & 1);
-      crc = (crc >> 1);
+      int do_eor = (val & 1);
+      val = (val >> 1);
       if (do_eor) {
-        crc ^= 0xEDB88320;
+        val ^= 0xEDB88320;
       }
     }
+    s_crc32_tables[0][i] = val;
+  }
+  for (i = 0; i < 256; ++i) {
+    uint32_t j;
+    for (j = 1; j < 8; ++j) {
+      uint32_t val = s_crc32_tables[j - 1][i];
+      s_crc32_tables[j][i] = ((val >> 8) ^ s_crc32_tables[0][val & 0xFF]);
+    }
+  }
+  s_is_crc32_tables_built = 1;
+}
+
+uint32_t
+util_crc32_add(uint32_t crc, uint8_t* p_buf, uint32_t len) {
+  uint32_t i;
+
+  assert(s_is_crc32_tables_built);
+
+  while (len >= 8) {
+    uint32_t lo = (crc ^ util_read_le32(p_buf));
+    uint32_t hi = util_read_le32(p_buf + 4);
+    crc = (s_crc32_tables[7][lo & 0xFF] ^
+           s_crc32_tables[6][(lo >> 8) & 0xFF] ^
+           s_crc32_tables[5][(lo >> 16) & 0xFF] ^
+           s_crc32_tables[4][lo >> 24] ^
+           s_crc32_tables[3][hi & 0xFF] ^
+           s_crc32_tables[2][(hi >> 8) & 0xFF] ^
+           s_crc32_tables[1][(hi >> 16) & 0xFF] ^
+           s_crc32_tables[0][hi >> 24]);
+    p_buf += 8;
+    len -= 8;
+  }
+  for (i = 0; i < len; ++i) {
+    crc = ((crc >> 8) ^ s_crc32_tables[0][(crc ^ p_buf[i]) & 0xFF]);
   }
 
   return crc;
@@ -46,6 +46,7 @@ void util_buffer_add_5b(struct util_buffer* p_buf,
                         int b5);
 void util_buffer_add_int(struct util_buffer* p_buf, int64_t i);
 void util_buffer_add_chunk(struct util_buffer* p_buf, void* p_src, size_t size);
+void util_buffer_get_chunk(struct util_buffer* p_buf, void* p_dst, size_t size);
 void util_buffer_fill_to_end(struct util_buffer* p_buf, char value);
 void util_buffer_fill(struct util_buffer* p_buf, char value, size_t len);
 
@@ -112,6 +113,8 @@ uint16_t util_read_be16(uint8_t* p_buf);
 uint32_t util_read_be32(uint8_t* p_buf);
 uint16_t util_read_le16(uint8_t* p_buf);
 uint32_t util_read_le32(uint8_t* p_buf);
+/* Must be called once at startup, before any other thread is created. */
+void util_crc32_build_tables(void);
 uint32_t util_crc32_init();
 uint32_t util_crc32_add(uint32_t crc, uint8_t* p_buf, uint32_t len);
 uint32_t util_crc32_finish(uint32_t crc);
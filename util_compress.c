@@ -132,3 +132,38 @@ util_uncompress(size_t* p_dst_len,
 
   return 0;
 }
+
+size_t
+util_compress_bound(size_t src_len) {
+  return compressBound(src_len);
+}
+
+int
+util_compress(size_t* p_dst_len,
+              uint8_t* p_src,
+              size_t src_len,
+              uint8_t* p_dst) {
+  mz_ulong dst_len = *p_dst_len;
+  int ret = compress2(p_dst, &dst_len, p_src, src_len, Z_BEST_SPEED);
+
+  if (ret != Z_OK) {
+    return -1;
+  }
+
+  *p_dst_len = dst_len;
+
+  return 0;
+}
+
+void*
+util_png(size_t* p_png_len,
+         const uint8_t* p_rgb,
+         uint32_t width,
+         uint32_t height) {
+  /* Allocated with malloc(), so util_free() frees it. */
+  return tdefl_write_image_to_png_file_in_memory(p_rgb,
+                                                 (int) width,
+                                                 (int) height,
+                                                 3,
+                                                 p_png_len);
+}
@@ -11,4 +11,19 @@ int util_uncompress(size_t* p_dst_len,
                     size_t src_len,
                     uint8_t* p_dst);
 
+size_t util_compress_bound(size_t src_len);
+/* Fast zlib format compression, as opposed to small. */
+int util_compress(size_t* p_dst_len,
+                  uint8_t* p_src,
+                  size_t src_len,
+                  uint8_t* p_dst);
+
+/* Encodes 8-bit RGB pixels as PNG file data, or returns NULL on failure.
+ * Free with util_free().
+ */
+void* util_png(size_t* p_png_len,
+               const uint8_t* p_rgb,
+               uint32_t width,
+               uint32_t height);
+
 #endif /* BEEBJIT_UTIL_COMPRESS_H */
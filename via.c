@@ -386,6 +386,20 @@ via_power_on_reset(struct via_struct* p_via) {
   via_update_port_a(p_via);
 }
 
+void
+via_save_checkpoint(struct via_struct* p_via, struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_via, sizeof(struct via_struct));
+  timing_save_timer(p_via->p_timing, p_via->t1_timer_id, p_buf);
+  timing_save_timer(p_via->p_timing, p_via->t2_timer_id, p_buf);
+}
+
+void
+via_load_checkpoint(struct via_struct* p_via, struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf, p_via, sizeof(struct via_struct));
+  timing_load_timer(p_via->p_timing, p_via->t1_timer_id, p_buf);
+  timing_load_timer(p_via->p_timing, p_via->t2_timer_id, p_buf);
+}
+
 void
 via_set_CA2_changed_callback(struct via_struct* p_via,
                              void (*p_CA2_changed_callback)
@@ -7,6 +7,7 @@ struct via_struct;
 
 struct bbc_struct;
 struct timing_struct;
+struct util_buffer;
 struct video_struct;
 
 enum {
@@ -25,6 +26,8 @@ struct via_struct* via_create(int id,
 void via_destroy(struct via_struct* p_via);
 
 void via_power_on_reset(struct via_struct* p_via);
+void via_save_checkpoint(struct via_struct* p_via, struct util_buffer* p_buf);
+void via_load_checkpoint(struct via_struct* p_via, struct util_buffer* p_buf);
 
 void via_set_CA2_changed_callback(struct via_struct* p_via,
                                   void (*p_CA2_changed_callback)
@@ -116,6 +116,7 @@ struct video_struct {
   int opt_is_hack_legacy_quest_cap;
   int opt_is_hack_legacy_shift_mode7;
   int opt_is_always_render;
+  int opt_is_no_bulk_render;
 
   /* Timing. */
   uint64_t wall_time;
@@ -191,6 +192,12 @@ struct video_struct {
   int64_t last_vsync_lower_ticks;
   int32_t cursor_skew_counter;
   int dispen_shifts[4];
+
+  /* NuLA palette entries written since power on, for checkpoints. After the
+   * 6845 registers so as not to move the field referenced by JIT.
+   */
+  uint16_t nula_palette_written;
+  uint32_t nula_palette[16];
 };
 
 static inline uint8_t
@@ -483,7 +490,7 @@ video_update_VSYNC(struct video_struct* p_video, uint64_t ticks) {
 
     p_video->last_vsync_raise_ticks = ticks;
   } else {
-    teletext_VSYNC_changed(p_video->p_teletext, 0);
+    render_teletext_VSYNC_changed(p_video->p_render, 0);
 
     p_video->last_vsync_lower_ticks = ticks;
   }
@@ -551,7 +558,7 @@ video_do_rendering_tick(struct video_struct* p_video,
    * is in effect.
    */
   this_external_dispen &= !!(p_video->address_counter & 0x2000);
-  teletext_DISPEN_changed(p_video->p_teletext, this_external_dispen);
+  render_teletext_DISPEN_changed(p_video->p_render, this_external_dispen);
 
   if (!p_video->cursor_disabled) {
     uint32_t cursor_addr =
@@ -595,6 +602,121 @@ video_do_rendering_tick(struct video_struct* p_video,
   p_video->address_counter = address_counter;
 }
 
+/* Gets how many ticks from here on, up to max_ticks, can be rendered in bulk
+ * because they are plain characters, displayed or border: nothing happens at
+ * them other than fetching and rendering data. Returns 0 if the next tick
+ * needs the full tick-by-tick treatment.
+ */
+static uint32_t
+video_get_bulk_render_ticks(struct video_struct* p_video,
+                            uint8_t horiz_counter,
+                            uint32_t max_ticks) {
+  uint32_t num_ticks;
+  uint32_t address_counter;
+  uint8_t r0 = p_video->crtc_registers[k_crtc_reg_horiz_total];
+  uint8_t r1 = p_video->crtc_registers[k_crtc_reg_horiz_displayed];
+  uint8_t r2 = p_video->crtc_registers[k_crtc_reg_horiz_position];
+  int dispen = (p_video->display_enable_bits == k_video_display_enable_all);
+
+  if (p_video->opt_is_no_bulk_render) {
+    return 0;
+  }
+  /* DISPEN, including its skew history, must be steady. */
+  if ((p_video->dispen_shifts[1] != dispen) ||
+      (p_video->dispen_shifts[2] != dispen)) {
+    return 0;
+  }
+  if (p_video->in_hsync || (p_video->cursor_skew_counter >= 0)) {
+    return 0;
+  }
+  if ((horiz_counter >= r0) || (horiz_counter == r1)) {
+    return 0;
+  }
+
+  /* Stop short of R0, R1 and R2 hits. */
+  num_ticks = (uint32_t) (r0 - horiz_counter);
+  if ((r1 > horiz_counter) && ((uint32_t) (r1 - horiz_counter) < num_ticks)) {
+    num_ticks = (uint32_t) (r1 - horiz_counter);
+  }
+  if ((r2 >= horiz_counter) && ((uint32_t) (r2 - horiz_counter) < num_ticks)) {
+    num_ticks = (uint32_t) (r2 - horiz_counter);
+  }
+  if (max_ticks < num_ticks) {
+    num_ticks = max_ticks;
+  }
+
+  /* Stop short of MA13 changing, which is also where the address wraps, and
+   * of the cursor.
+   */
+  address_counter = p_video->address_counter;
+  if ((0x2000 - (address_counter & 0x1FFF)) < num_ticks) {
+    num_ticks = (0x2000 - (address_counter & 0x1FFF));
+  }
+  if (!p_video->cursor_disabled && p_video->has_hit_cursor_line_start) {
+    uint32_t cursor_addr =
+        (p_video->crtc_registers[k_crtc_reg_cursor_high] << 8);
+    cursor_addr |= p_video->crtc_registers[k_crtc_reg_cursor_low];
+    if ((cursor_addr >= address_counter) &&
+        ((cursor_addr - address_counter) < num_ticks)) {
+      num_ticks = (cursor_addr - address_counter);
+    }
+  }
+
+  /* Not worth it for the odd tick. */
+  if (num_ticks < 4) {
+    return 0;
+  }
+  return num_ticks;
+}
+
+static void
+video_do_bulk_render(struct video_struct* p_video,
+                     int* p_is_render_prepared,
+                     uint32_t num_ticks,
+                     uint64_t ticks,
+                     uint32_t ticks_inc) {
+  uint8_t data[256];
+  uint32_t i;
+  uint64_t data_ticks = ticks;
+  uint32_t address_counter = p_video->address_counter;
+  int is_teletext = (p_video->video_ula_control & k_ula_teletext);
+  int external_dispen = p_video->dispen_shifts[p_video->skew_dispen_index];
+
+  assert(num_ticks <= 256);
+
+  if (!*p_is_render_prepared) {
+    render_prepare(p_video->p_render);
+
+    *p_is_render_prepared = 1;
+  }
+
+  /* Same as video_do_rendering_tick() would do each tick, all with the same
+   * values.
+   */
+  render_set_DISPEN(p_video->p_render, external_dispen);
+  render_teletext_DISPEN_changed(
+      p_video->p_render,
+      (external_dispen && (address_counter & 0x2000)));
+
+  for (i = 0; i < num_ticks; ++i) {
+    data[i] = video_read_data_byte(p_video,
+                                   data_ticks,
+                                   (address_counter + i),
+                                   p_video->scanline_counter,
+                                   p_video->screen_wrap_add,
+                                   is_teletext);
+    data_ticks += ticks_inc;
+  }
+  render_render_span(p_video->p_render,
+                     &data[0],
+                     address_counter,
+                     num_ticks,
+                     ticks,
+                     ticks_inc);
+
+  p_video->address_counter = ((address_counter + num_ticks) & 0x3FFF);
+}
+
 void
 video_advance_crtc_timing(struct video_struct* p_video) {
   uint64_t ticks;
@@ -704,6 +826,26 @@ video_advance_crtc_timing(struct video_struct* p_video) {
       }
     }
 
+    if (p_video->is_rendering_active &&
+        !start_of_line_state_checks &&
+        !r7_hit &&
+        !p_video->is_even_vsync) {
+      uint32_t num_ticks = video_get_bulk_render_ticks(
+          p_video,
+          horiz_counter,
+          ((ticks_target - ticks) / ticks_inc));
+      if (num_ticks > 0) {
+        video_do_bulk_render(p_video,
+                             &is_render_prepared,
+                             num_ticks,
+                             ticks,
+                             ticks_inc);
+        horiz_counter += num_ticks;
+        ticks += (num_ticks * ticks_inc);
+        continue;
+      }
+    }
+
     r0_hit = (horiz_counter == r0);
     if (p_video->is_rendering_active) {
       video_do_rendering_tick(p_video,
@@ -837,15 +979,15 @@ check_r7:
          * 0..2..4.. for odd and even frames, and inform the SAA5050 differently
          * for interlace odd frames.
          */
-        teletext_RA_ISV_changed(
-            p_video->p_teletext,
+        render_teletext_RA_ISV_changed(
+            p_video->p_render,
             p_video->is_odd_frame,
             (p_video->crtc_registers[k_crtc_reg_vert_total] >=
              p_video->crtc_registers[k_crtc_reg_vert_displayed]));
       } else {
-        teletext_RA_ISV_changed(p_video->p_teletext,
-                                p_video->scanline_counter,
-                                0);
+        render_teletext_RA_ISV_changed(p_video->p_render,
+                                       p_video->scanline_counter,
+                                       0);
       }
 
       render_set_RA(p_video->p_render, p_video->scanline_counter);
@@ -1428,6 +1570,8 @@ video_create(uint8_t* p_bbc_mem,
       p_options->p_opt_flags, "video:hack-legacy-shift-mode7");
   p_video->opt_is_always_render = util_has_option(
       p_options->p_opt_flags, "video:always-render");
+  p_video->opt_is_no_bulk_render = util_has_option(
+      p_options->p_opt_flags, "video:no-bulk-render");
 
   p_video->frames_skip = 0;
   p_video->frame_skip_counter = 0;
@@ -1550,6 +1694,7 @@ video_ula_power_on_reset(struct video_struct* p_video) {
   p_video->clock_tick_shift = 1;
   p_video->is_shadow_displayed = 0;
   p_video->nula_pending_palette = -1;
+  p_video->nula_palette_written = 0;
 }
 
 static void
@@ -1683,6 +1828,61 @@ video_power_on_reset(struct video_struct* p_video) {
   }
 }
 
+void
+video_save_checkpoint(struct video_struct* p_video,
+                      struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_video, sizeof(struct video_struct));
+  timing_save_timer(p_video->p_timing, p_video->timer_id, p_buf);
+}
+
+void
+video_load_checkpoint(struct video_struct* p_video,
+                      struct util_buffer* p_buf) {
+  struct video_struct host_video = *p_video;
+  struct render_struct* p_render = p_video->p_render;
+  uint8_t control;
+  uint32_t i;
+
+  util_buffer_get_chunk(p_buf, p_video, sizeof(struct video_struct));
+  timing_load_timer(p_video->p_timing, p_video->timer_id, p_buf);
+
+  /* Wall time pacing, painting and the counters belong to the host. */
+  p_video->log_count_horiz_total = host_video.log_count_horiz_total;
+  p_video->log_count_hsync_width = host_video.log_count_hsync_width;
+  p_video->log_count_vsync_width = host_video.log_count_vsync_width;
+  p_video->has_paint_timer_triggered = host_video.has_paint_timer_triggered;
+  p_video->frame_skip_counter = host_video.frame_skip_counter;
+  p_video->wall_time = host_video.wall_time;
+  p_video->vsync_next_time = host_video.vsync_next_time;
+  p_video->num_vsyncs = host_video.num_vsyncs;
+  p_video->num_crtc_advances = host_video.num_crtc_advances;
+  p_video->paint_start_cycles = host_video.paint_start_cycles;
+  p_video->paint_cycles = host_video.paint_cycles;
+
+  /* As for power on, the renderer picks up again at the next wall time vsync.
+   */
+  p_video->is_framing_changed_for_render = 1;
+  p_video->is_wall_time_vsync_hit = 0;
+  p_video->is_rendering_active = 0;
+  render_power_on_reset(p_render);
+  for (i = 0; i < 16; ++i) {
+    render_set_physical_color(p_render, i, p_video->ula_palette[i]);
+    if (p_video->nula_palette_written & (1 << i)) {
+      render_set_palette(p_render, i, p_video->nula_palette[i]);
+    }
+  }
+  control = p_video->video_ula_control;
+  render_set_flash(p_render, video_get_flash(p_video));
+  render_set_cursor_segments(p_render,
+                             !!(control & 0x80),
+                             !!(control & 0x40),
+                             !!(control & 0x20),
+                             !!(control & 0x20));
+
+  video_mode_updated(p_video);
+  video_update_timer(p_video);
+}
+
 uint64_t
 video_get_num_vsyncs(struct video_struct* p_video) {
   return p_video->num_vsyncs;
@@ -1762,7 +1962,6 @@ video_render_full_frame(struct video_struct* p_video) {
   uint32_t horiz_total = (p_regs[k_crtc_reg_horiz_total] + 1);
   uint32_t num_pre_lines = 0;
   uint32_t num_pre_cols = 0;
-  struct teletext_struct* p_teletext = p_video->p_teletext;
   uint32_t hsync_pulse_ticks = (p_video->hsync_pulse_width <<
                                 p_video->clock_tick_shift);
   int is_teletext = (*p_ula_control & k_ula_teletext);
@@ -1787,8 +1986,8 @@ video_render_full_frame(struct video_struct* p_video) {
   render_prepare(p_render);
   render_vsync(p_render);
   render_set_DISPEN(p_render, 0);
-  teletext_VSYNC_changed(p_teletext, 0);
-  teletext_RA_ISV_changed(p_teletext, 0, 1);
+  render_teletext_VSYNC_changed(p_render, 0);
+  render_teletext_RA_ISV_changed(p_render, 0, 1);
 
   for (i_lines = 0; i_lines < num_pre_lines; ++i_lines) {
     (void) render_hsync(p_render, hsync_pulse_ticks);
@@ -1801,7 +2000,7 @@ video_render_full_frame(struct video_struct* p_video) {
         render_render(p_render, 0x00, 0, 0);
       }
       render_set_DISPEN(p_render, 1);
-      teletext_DISPEN_changed(p_teletext, 1);
+      render_teletext_DISPEN_changed(p_render, 1);
       for (i_cols = 0; i_cols < num_cols; ++i_cols) {
         uint8_t data;
         crtc_line_address &= 0x3FFF;
@@ -1823,10 +2022,10 @@ video_render_full_frame(struct video_struct* p_video) {
         }
       }
       render_set_DISPEN(p_render, 0);
-      teletext_DISPEN_changed(p_teletext, 0);
+      render_teletext_DISPEN_changed(p_render, 0);
       (void) render_hsync(p_render, hsync_pulse_ticks);
-      teletext_DISPEN_changed(p_teletext, 1);
-      teletext_DISPEN_changed(p_teletext, 0);
+      render_teletext_DISPEN_changed(p_render, 1);
+      render_teletext_DISPEN_changed(p_render, 0);
     }
   }
 }
@@ -1975,6 +2174,8 @@ video_ula_write(struct video_struct* p_video, uint8_t addr, uint8_t val) {
     tmp = ((val & 0xf) * 0x11);
     pixel |= tmp;
     render_set_palette(p_video->p_render, index, pixel);
+    p_video->nula_palette[index] = pixel;
+    p_video->nula_palette_written |= (1 << index);
     p_video->nula_pending_palette = -1;
     break;
   }
@@ -10,6 +10,7 @@ struct bbc_options;
 struct render_struct;
 struct teletext_struct;
 struct timing_struct;
+struct util_buffer;
 struct via_struct;
 
 struct video_struct* video_create(uint8_t* p_mem,
@@ -40,6 +41,10 @@ void video_shadow_mode_updated(struct video_struct* p_video,
                                int is_shadow_displayed);
 
 void video_power_on_reset(struct video_struct* p_video);
+void video_save_checkpoint(struct video_struct* p_video,
+                           struct util_buffer* p_buf);
+void video_load_checkpoint(struct video_struct* p_video,
+                           struct util_buffer* p_buf);
 
 uint64_t video_get_num_vsyncs(struct video_struct* p_video);
 uint64_t video_get_num_crtc_advances(struct video_struct* p_video);
@@ -544,6 +544,18 @@ wd_fdc_power_on_reset(struct wd_fdc_struct* p_fdc) {
   p_fdc->data_register = 0;
 }
 
+void
+wd_fdc_save_checkpoint(struct wd_fdc_struct* p_fdc, struct util_buffer* p_buf) {
+  util_buffer_add_chunk(p_buf, p_fdc, sizeof(struct wd_fdc_struct));
+  timing_save_timer(p_fdc->p_timing, p_fdc->timer_id, p_buf);
+}
+
+void
+wd_fdc_load_checkpoint(struct wd_fdc_struct* p_fdc, struct util_buffer* p_buf) {
+  util_buffer_get_chunk(p_buf, p_fdc, sizeof(struct wd_fdc_struct));
+  timing_load_timer(p_fdc->p_timing, p_fdc->timer_id, p_buf);
+}
+
 static void
 wd_fdc_set_drq(struct wd_fdc_struct* p_fdc, int level) {
   p_fdc->is_drq = level;
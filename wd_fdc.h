@@ -9,6 +9,7 @@ struct bbc_options;
 struct disc_drive_struct;
 struct state_6502;
 struct timing_struct;
+struct util_buffer;
 
 struct wd_fdc_struct* wd_fdc_create(struct state_6502* p_state_6502,
                                     int is_master,
@@ -24,6 +25,10 @@ void wd_fdc_set_drives(struct wd_fdc_struct* p_fdc,
                        struct disc_drive_struct* p_drive_1);
 
 void wd_fdc_power_on_reset(struct wd_fdc_struct* p_fdc);
+void wd_fdc_save_checkpoint(struct wd_fdc_struct* p_fdc,
+                            struct util_buffer* p_buf);
+void wd_fdc_load_checkpoint(struct wd_fdc_struct* p_fdc,
+                            struct util_buffer* p_buf);
 void wd_fdc_break_reset(struct wd_fdc_struct* p_fdc);
 
 /* Host hardware register I/O. */